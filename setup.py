@@ -330,7 +330,7 @@ if WITH_NCCL and (subprocess.call('ldconfig -p | grep libnccl >/dev/null', shell
         SYSTEM_NCCL = True
 
 main_compile_args = ['-D_THP_CORE']
-main_libraries = ['shm']
+main_libraries = ['shm', 'z']
 main_link_args = [TH_LIB, THS_LIB, THPP_LIB, THNN_LIB, ATEN_LIB, NANOPB_STATIC_LIB]
 main_sources = [
     "torch/csrc/PtrWrapper.cpp",
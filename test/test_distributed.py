@@ -400,6 +400,73 @@ class _DistTestBase(object):
             group, group_id, rank, dist.reduce_op.MAX, -1, 10, 10
         )
 
+    def _test_all_reduce_coalesced_helper(self, group, group_id, rank, op,
+                                          master_value, worker_value, expected_value):
+        for src in group:
+            value = master_value if rank == src else worker_value
+            tensors = [_build_tensor(i + 1, value) for i in range(4)]
+            tensors += [_build_tensor(i + 1, value).double() for i in range(3)]
+            tensors.append(_build_tensor(5, value)[:, 1])  # non-contiguous
+            dist.all_reduce_coalesced(tensors, op, group_id)
+            for tensor in tensors:
+                self.assertEqual(tensor, tensor.clone().fill_(expected_value))
+
+        self._barrier()
+
+    def test_all_reduce_coalesced_sum(self):
+        group, group_id, rank = self._init_global_test()
+        self._test_all_reduce_coalesced_helper(
+            group, group_id, rank, dist.reduce_op.SUM, 2, 10, 2 + (10 * (len(group) - 1))
+        )
+
+    def test_all_reduce_coalesced_group_max(self):
+        group, group_id, rank = self._init_group_test()
+        self._test_all_reduce_coalesced_helper(
+            group, group_id, rank, dist.reduce_op.MAX, -1, 10, 10
+        )
+
+    @unittest.skipIf(BACKEND == 'gloo', "Gloo does not support all_to_all")
+    def test_all_reduce_compressed_fp16(self):
+        group, group_id, rank = self._init_global_test()
+        tensor = _build_tensor(7, 0.5 * (rank + 1))
+        dist.all_reduce_compressed(tensor, dist.compression.FP16,
+                                   dist.reduce_op.SUM, group_id)
+        expected = sum(0.5 * (i + 1) for i in group)
+        self.assertEqual(tensor, _build_tensor(7, expected))
+
+        self._barrier()
+
+    @unittest.skipIf(BACKEND == 'gloo', "Gloo does not support integer all_gather")
+    def test_all_reduce_compressed_topk(self):
+        group, group_id, rank = self._init_global_test()
+        tensor = torch.FloatTensor(len(group) + 5).fill_(1)
+        tensor[rank] = 100
+        residual = torch.FloatTensor(tensor.size()).zero_()
+        dist.all_reduce_compressed(tensor, dist.compression.TOPK,
+                                   dist.reduce_op.SUM, group_id, k=1,
+                                   residual=residual)
+
+        expected = torch.FloatTensor(tensor.size()).zero_()
+        expected[:len(group)] = 100
+        expected_residual = torch.FloatTensor(tensor.size()).fill_(1)
+        expected_residual[rank] = 0
+        self.assertEqual(tensor, expected)
+        self.assertEqual(residual, expected_residual)
+
+        self._barrier()
+
+    def test_iall_reduce_sum(self):
+        group, group_id, rank = self._init_global_test()
+        tensors = [_build_tensor(i + 1, rank) for i in range(5)]
+        requests = [dist.iall_reduce(tensor, dist.reduce_op.SUM, group_id) for tensor in tensors]
+        # requests are executed in order, so all of them are done after the last one
+        requests[-1].wait()
+        for request, tensor in zip(requests, tensors):
+            self.assertTrue(request.is_completed())
+            self.assertEqual(tensor, tensor.clone().fill_(sum(group)))
+
+        self._barrier()
+
     # SCATTER
     def _test_scatter_helper(self, group, group_id, rank):
         for dest in group:
@@ -465,6 +532,49 @@ class _DistTestBase(object):
         group, group_id, rank = self._init_group_test()
         self._test_all_gather_helper(group, group_id, rank)
 
+    # REDUCE SCATTER
+    def _test_reduce_scatter_helper(self, group, group_id, rank):
+        if rank in group:
+            tensors = [_build_tensor(5, rank + i) for i in group]
+            tensor = _build_tensor(5, -1)
+            dist.reduce_scatter(tensor, tensors, dist.reduce_op.SUM, group_id)
+
+            expected = sum(r + rank for r in group)
+            self.assertEqual(tensor, _build_tensor(5, expected))
+
+        self._barrier()
+
+    def test_reduce_scatter(self):
+        group, group_id, rank = self._init_global_test()
+        self._test_reduce_scatter_helper(group, group_id, rank)
+
+    def test_reduce_scatter_group(self):
+        group, group_id, rank = self._init_group_test()
+        self._test_reduce_scatter_helper(group, group_id, rank)
+
+    # ALL TO ALL
+    def _test_all_to_all_helper(self, group, group_id, rank):
+        if rank in group:
+            input_tensors = [_build_tensor(5, 100 * rank + i) for i in group]
+            output_tensors = [_build_tensor(5, -1) for i in group]
+            dist.all_to_all(output_tensors, input_tensors, group_id)
+
+            expected_tensors = [_build_tensor(5, 100 * i + rank) for i in group]
+            for t1, t2 in zip(output_tensors, expected_tensors):
+                self.assertEqual(t1, t2)
+
+        self._barrier()
+
+    @unittest.skipIf(BACKEND == 'gloo', "Gloo does not support all_to_all")
+    def test_all_to_all(self):
+        group, group_id, rank = self._init_global_test()
+        self._test_all_to_all_helper(group, group_id, rank)
+
+    @unittest.skipIf(BACKEND == 'gloo', "Gloo does not support all_to_all")
+    def test_all_to_all_group(self):
+        group, group_id, rank = self._init_group_test()
+        self._test_all_to_all_helper(group, group_id, rank)
+
     # BARRIER
     def _test_barrier_helper(self, group, group_id, rank):
         WAIT_TIME = 0.3  # seconds
@@ -487,11 +597,36 @@ class _DistTestBase(object):
         group, group_id, rank = self._init_global_test()
         self._test_barrier_helper(group, group_id, rank)
 
+    def test_tracing(self):
+        group, group_id, rank = self._init_global_test()
+        dist.clear_trace()
+        dist.enable_tracing()
+        tensor = _build_tensor(10, rank)
+        dist.all_reduce(tensor, dist.reduce_op.SUM, group_id)
+        dist.barrier(group_id)
+        dist.enable_tracing(False)
+        dist.all_reduce(tensor, dist.reduce_op.SUM, group_id)
+
+        events = dist.get_trace_events()
+        self.assertEqual([event['name'] for event in events],
+                         ['all_reduce', 'barrier'])
+        self.assertEqual(events[0]['bytes'], tensor.numel() * 4)
+        self.assertLessEqual(events[0]['start'], events[1]['start'])
+
+        stats = dist.get_trace_stats()
+        self.assertEqual(stats['all_reduce']['count'], 1)
+        self.assertEqual(sum(stats['all_reduce']['histogram']), 1)
+        self.assertEqual(stats['barrier']['bytes'], 0)
+
+        dist.clear_trace()
+        self.assertEqual(dist.get_trace_events(), [])
+        self._barrier()
+
     def test_barrier_group(self):
         group, group_id, rank = self._init_group_test()
         self._test_barrier_helper(group, group_id, rank)
 
-if BACKEND == 'tcp' or BACKEND == 'gloo':
+if BACKEND in ('tcp', 'gloo', 'shm'):
     WORLD_SIZE = os.environ['WORLD_SIZE']
 
     class TestTCPOrGloo(TestCase, _DistTestBase):
@@ -964,6 +964,34 @@ class TestNN(NNTestCase):
         module.__repr__()
         str(module)
 
+    def test_TemporalConvolution_threads(self):
+        module = nn.TemporalConvolution(4, 5, 3, 2)
+        input = torch.randn(6, 11, 4)
+        num_threads = torch.get_num_threads()
+        try:
+            torch.set_num_threads(1)
+            output = module.forward(input).clone()
+            gradOutput = torch.randn(output.size())
+            gradInput = module.backward(input, gradOutput).clone()
+            torch.set_num_threads(4)
+            self.assertEqual(module.forward(input), output, 0)
+            self.assertEqual(module.backward(input, gradOutput), gradInput, 0)
+        finally:
+            torch.set_num_threads(num_threads)
+
+    def test_SpatialUpSamplingNearest_noncontiguous(self):
+        module = nn.SpatialUpSamplingNearest(2)
+        input = torch.randn(2, 3, 4, 5)
+        expected = module.forward(input).clone()
+        gradOutput = torch.randn(expected.size())
+        expectedGrad = module.backward(input, gradOutput).clone()
+
+        module.output = torch.randn(2, 10, 8, 3).transpose(1, 3)
+        module.gradInput = torch.randn(2, 5, 4, 3).transpose(1, 3)
+        self.assertFalse(module.output.is_contiguous())
+        self.assertEqual(module.forward(input), expected, 0)
+        self.assertEqual(module.backward(input, gradOutput), expectedGrad, 0)
+
     def test_Index(self):
         net = nn.Index(0)
 
@@ -896,6 +896,22 @@ class TestNN(NNTestCase):
         m = pickle.loads(pickle.dumps(m))
         self.assertIsInstance(m, nn.Linear)
 
+    def test_fuse_conv_bn_eval(self):
+        input = Variable(torch.randn(4, 3, 9, 9))
+        for bias, affine in product([True, False], [True, False]):
+            conv = nn.Conv2d(3, 6, 3, bias=bias)
+            bn = nn.BatchNorm2d(6, affine=affine)
+            bn.running_mean.uniform_(-1, 1)
+            bn.running_var.uniform_(0.5, 2)
+            conv.eval()
+            bn.eval()
+            fused = torch.nn.utils.fuse_conv_bn_eval(conv, bn)
+            self.assertEqual(fused(input), bn(conv(input)))
+            self.assertEqual(conv.bias is None, not bias)
+
+        self.assertRaises(ValueError,
+                          lambda: torch.nn.utils.fuse_conv_bn_eval(nn.Conv2d(3, 6, 3), nn.BatchNorm2d(6)))
+
     def test_embedding_padding_idx(self):
         embedding = nn.Embedding(10, 20, padding_idx=0)
         input = Variable(torch.LongTensor([[0, 2, 4, 5], [4, 3, 0, 9]]))
@@ -2802,6 +2818,56 @@ class TestNN(NNTestCase):
         input = Variable(torch.randn(1, 1, 2, 2, 2), requires_grad=True)
         self.assertTrue(gradcheck(lambda x: F.upsample(x, 4, mode='trilinear'), (input,)))
 
+    def _test_threads_match_serial(self, fn, size):
+        input = Variable(torch.randn(*size), requires_grad=True)
+        num_threads = torch.get_num_threads()
+        try:
+            torch.set_num_threads(1)
+            serial_output = fn(input)
+            grad_output = torch.randn(serial_output.size())
+            serial_grad, = torch.autograd.grad(serial_output, input, grad_output)
+            torch.set_num_threads(4)
+            output = fn(input)
+            grad, = torch.autograd.grad(output, input, grad_output)
+        finally:
+            torch.set_num_threads(num_threads)
+        self.assertEqual(output, serial_output, prec=0)
+        self.assertEqual(grad, serial_grad, prec=0)
+
+    def test_upsampling_threads_match_serial(self):
+        # the kernels hand whole planes to each thread
+        self._test_threads_match_serial(lambda x: F.upsample(x, scale_factor=3, mode='nearest'), (3, 5, 4, 6))
+        self._test_threads_match_serial(lambda x: F.upsample(x, (9, 13), mode='bilinear'), (3, 5, 4, 6))
+        self._test_threads_match_serial(lambda x: F.upsample(x, (5, 9, 13), mode='trilinear'), (2, 5, 3, 4, 6))
+
+    def test_max_pool2d_threads_match_serial(self):
+        # a single frame is split over its planes, a batch over frames and planes
+        self._test_threads_match_serial(lambda x: F.max_pool2d(x, 3, 2, 1), (7, 11, 9))
+        self._test_threads_match_serial(lambda x: F.max_pool2d(x, 3, 2, 1), (1, 7, 11, 9))
+        self._test_threads_match_serial(lambda x: F.max_pool2d(x, 2, dilation=2), (5, 3, 11, 9))
+
+    def test_softmax_masked_large_row(self):
+        # rows this long take the single pass kernel, which must skip masked
+        # entries even before it has seen a finite one
+        input = torch.randn(2, 20000)
+        input[:, :10] = -float('inf')
+        input[1, 15000:] = -float('inf')
+        for i, length in enumerate((20000, 15000)):
+            row = input[i, 10:length]
+            shifted = row - row.max()
+            expected = shifted.exp() / shifted.exp().sum()
+            log_expected = shifted - math.log(shifted.exp().sum())
+
+            output = F.softmax(Variable(input)).data[i]
+            self.assertEqual(output[:10], torch.zeros(10), prec=0)
+            self.assertEqual(output[10:length], expected, prec=1e-5)
+            if length < 20000:
+                self.assertEqual(output[length:].sum(), 0, prec=0)
+
+            log_output = F.log_softmax(Variable(input)).data[i]
+            self.assertEqual(log_output[10:length], log_expected, prec=1e-4)
+            self.assertTrue((log_output[:10] == -float('inf')).all())
+
     def test_linear_broadcasting(self):
         m = nn.Linear(5, 8)
         inp = Variable(torch.randn(2, 3, 5))
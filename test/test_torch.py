@@ -1,6 +1,8 @@
 import sys
+import io
 import os
 import math
+import mmap
 import random
 import copy
 import torch
@@ -3757,7 +3759,7 @@ class TestTorch(TestCase):
         self.assertEqual(r[:, :50].std(), 4, 0.3)
         self.assertEqual(r[:, 50:].std(), 1, 0.2)
 
-    def test_serialization(self):
+    def _test_serialization(self, mmap=False, **save_kwargs):
         a = [torch.randn(5, 5).float() for i in range(2)]
         b = [a[i % 2] for i in range(4)]
         b += [a[0].storage()]
@@ -3770,9 +3772,9 @@ class TestTorch(TestCase):
         for use_name in (False, True):
             with tempfile.NamedTemporaryFile() as f:
                 handle = f if not use_name else f.name
-                torch.save(b, handle)
+                torch.save(b, handle, **save_kwargs)
                 f.seek(0)
-                c = torch.load(handle)
+                c = torch.load(handle, mmap=mmap)
             self.assertEqual(b, c, 0)
             self.assertTrue(isinstance(c[0], torch.FloatTensor))
             self.assertTrue(isinstance(c[1], torch.FloatTensor))
@@ -3796,6 +3798,65 @@ class TestTorch(TestCase):
             rootview = c[8]
             self.assertEqual(rootview.data_ptr(), c[0].data_ptr())
 
+    def test_serialization(self):
+        self._test_serialization()
+
+    def test_serialization_page_aligned(self):
+        self._test_serialization(page_aligned=True)
+        self._test_serialization(page_aligned=True, mmap=True)
+
+    def test_serialization_mmap(self):
+        a = torch.randn(1000).double()
+        b = [a, a[10:20], torch.ByteTensor([1, 2, 3])]
+        with tempfile.NamedTemporaryFile() as f:
+            torch.save(b, f, page_aligned=True)
+            f.seek(0)
+            c = torch.load(f, mmap=True)
+            self.assertEqual(b, c, 0)
+            self.assertEqual(c[0].data_ptr() % mmap.PAGESIZE, 0)
+            self.assertEqual(c[1].storage().data_ptr(), c[0].data_ptr())
+            # mappings are copy-on-write
+            c[0].fill_(1)
+            f.seek(0)
+            self.assertEqual(torch.load(f, mmap=True)[0], a, 0)
+
+        # files that aren't page aligned are read
+        with tempfile.NamedTemporaryFile() as f:
+            torch.save(b, f)
+            f.seek(0)
+            self.assertEqual(torch.load(f, mmap=True), b, 0)
+
+    def test_serialization_chunked(self):
+        self._test_serialization(chunked=True)
+        self._test_serialization(chunked=True, num_threads=1)
+        self._test_serialization(compress=True)
+
+        # storages larger than a chunk, compressible and not
+        b = [torch.randn(5000000), torch.zeros(5000000).long()]
+        for compress in (False, True):
+            with tempfile.NamedTemporaryFile() as f:
+                torch.save(b, f, compress=compress, num_threads=3)
+                f.seek(0)
+                self.assertEqual(torch.load(f), b, 0)
+
+        self.assertRaises(ValueError, lambda: torch.save(b, io.BytesIO(), page_aligned=True, compress=True))
+
+    def test_serialization_chunked_checksum(self):
+        a = torch.randn(100000)
+        with tempfile.NamedTemporaryFile() as f:
+            torch.save(a, f, chunked=True)
+            # flip a bit in the middle of the data
+            f.seek(os.path.getsize(f.name) // 2)
+            byte = bytearray(f.read(1))
+            byte[0] ^= 1
+            f.seek(-1, 1)
+            f.write(bytes(byte))
+            f.flush()
+            f.seek(0)
+            with self.assertRaises(RuntimeError) as error:
+                torch.load(f)
+            self.assertIn('checksum', str(error.exception))
+
     def test_half_tensor(self):
         x = torch.randn(5, 5).float()
         y = torch.randn(5, 5).float()
@@ -3825,8 +3886,7 @@ class TestTorch(TestCase):
             self.assertIsInstance(xc2, type(xc))
             self.assertEqual(xc.float(), xc2.float())
 
-    @unittest.skipIf(not torch.cuda.is_available(), 'no CUDA')
-    def test_serialization_cuda(self):
+    def _test_serialization_cuda(self, mmap=False, **save_kwargs):
         device_count = torch.cuda.device_count()
         t0 = torch.cuda.FloatTensor(5).fill_(1)
         torch.cuda.set_device(device_count - 1)
@@ -3834,14 +3894,28 @@ class TestTorch(TestCase):
         torch.cuda.set_device(0)
         b = (t0, tn)
         with tempfile.NamedTemporaryFile() as f:
-            torch.save(b, f)
+            torch.save(b, f, **save_kwargs)
             f.seek(0)
-            c = torch.load(f)
+            c = torch.load(f, mmap=mmap)
             self.assertEqual(b, c, 0)
             u0, un = c
             self.assertEqual(u0.get_device(), 0)
             self.assertEqual(un.get_device(), device_count - 1)
 
+    @unittest.skipIf(not torch.cuda.is_available(), 'no CUDA')
+    def test_serialization_cuda(self):
+        self._test_serialization_cuda()
+
+    @unittest.skipIf(not torch.cuda.is_available(), 'no CUDA')
+    def test_serialization_page_aligned_cuda(self):
+        self._test_serialization_cuda(page_aligned=True)
+        self._test_serialization_cuda(page_aligned=True, mmap=True)
+
+    @unittest.skipIf(not torch.cuda.is_available(), 'no CUDA')
+    def test_serialization_chunked_cuda(self):
+        self._test_serialization_cuda(chunked=True)
+        self._test_serialization_cuda(compress=True)
+
     def test_serialization_backwards_compat(self):
         a = [torch.arange(1 + i, 26 + i).view(5, 5).float() for i in range(2)]
         b = [a[i % 2] for i in range(4)]
@@ -1,5 +1,6 @@
 #include <Python.h>
 
+#include <algorithm>
 #include <memory>
 #include <unordered_map>
 #include <vector>
@@ -15,6 +16,7 @@ static std::unordered_map<std::string, THDChannelType> name2channel_type = {
     {"mpi", THDChannelMPI},
     {"tcp", THDChannelTCP},
     {"gloo", THDChannelGloo},
+    {"shm", THDChannelSHM},
 };
 
 static bool THDPModule_loadClasses(PyObject *self)
@@ -77,6 +79,7 @@ static bool THDPModule_assignStateless(PyObject *self)
 
 static std::unordered_map<PyObject*, THDReduceOp> obj2reduceop;
 static std::unordered_map<PyObject*, THDGroup> obj2group;
+static std::unordered_map<PyObject*, THDCompression> obj2compression;
 
 #ifdef WITH_CUDA
 extern THCState* state;
@@ -227,6 +230,16 @@ static THDReduceOp _getReduceOp(PyObject *obj)
   return it->second;
 }
 
+static THDCompression _getCompression(PyObject *obj)
+{
+  auto it = obj2compression.find(obj);
+  if (it == obj2compression.end()) {
+    throw std::runtime_error("compression should be a constant from "
+        "torch.distributed.compression");
+  }
+  return it->second;
+}
+
 static THDGroup _getGroup(PyObject *obj)
 {
   auto it = obj2group.find(obj);
@@ -353,6 +366,148 @@ PyObject* THDPModule_allReduce(PyObject *_unused, PyObject *args)
   END_HANDLE_TH_ERRORS
 }
 
+PyObject* THDPModule_allReduceCoalesced(PyObject *_unused, PyObject *args)
+{
+  HANDLE_TH_ERRORS
+  PyObject* sequence = PyTuple_GET_ITEM(args, 0);
+  Py_ssize_t tmp_length;
+  std::size_t length;
+  std::vector<THDPTensorDesc> descriptors;
+  std::vector<THDTensorDescriptor*> raw_descriptors;
+  THDGroup group;
+  THDReduceOp op;
+
+  if (PyTuple_GET_SIZE(args) != 3 || !PySequence_Check(sequence)) {
+    goto invalid_arguments;
+  }
+
+  tmp_length = PySequence_Length(sequence);
+  THPUtils_assert(tmp_length >= 0, "couldn't obtain the length of %s",
+      THPUtils_typename(sequence));
+
+  length = static_cast<std::size_t>(tmp_length);
+  descriptors.reserve(length);
+  for (std::size_t i = 0; i < length; ++i) {
+    if (!THPModule_isTensor(PySequence_ITEM(sequence, i)))
+      goto invalid_arguments;
+
+    descriptors.push_back(
+      THDPTensorDesc(THDPModule_makeDescriptor(PySequence_ITEM(sequence, i)))
+    );
+    raw_descriptors.push_back(descriptors.back());
+  }
+
+  group = _getGroup(PyTuple_GET_ITEM(args, 2));
+  op = _getReduceOp(PyTuple_GET_ITEM(args, 1));
+  {
+    AutoNoGIL guard;
+    THDAllReduceCoalesced(raw_descriptors.data(), length, op, group);
+  }
+  Py_RETURN_NONE;
+
+invalid_arguments:
+  THPUtils_invalidArguments(args, NULL, "all_reduce_coalesced", 1,
+      "(list[tensor] in_out, reduce_op op, group gr)");
+  Py_RETURN_NONE;
+  END_HANDLE_TH_ERRORS
+}
+
+PyObject* THDPModule_allReduceCompressed(PyObject *_unused, PyObject *args)
+{
+  HANDLE_TH_ERRORS
+  if (PyTuple_GET_SIZE(args) != 6 || !THPModule_isTensor(PyTuple_GET_ITEM(args, 0)) ||
+        !THPUtils_checkLong(PyTuple_GET_ITEM(args, 4)) ||
+        (PyTuple_GET_ITEM(args, 5) != Py_None &&
+         !THPModule_isTensor(PyTuple_GET_ITEM(args, 5)))) {
+    THPUtils_invalidArguments(args, NULL, "all_reduce_compressed", 1,
+        "(tensor in_out, reduce_op op, group gr, compression compression, "
+        "int k, tensor residual or None)");
+    return NULL;
+  }
+
+  THDGroup group = _getGroup(PyTuple_GET_ITEM(args, 2));
+  THDReduceOp op = _getReduceOp(PyTuple_GET_ITEM(args, 1));
+  THDCompression compression = _getCompression(PyTuple_GET_ITEM(args, 3));
+  long k = THPUtils_unpackLong(PyTuple_GET_ITEM(args, 4));
+  THDPTensorDesc desc {THDPModule_makeDescriptor(PyTuple_GET_ITEM(args, 0))};
+  THDPTensorDesc residual;
+  if (PyTuple_GET_ITEM(args, 5) != Py_None)
+    residual = THDPTensorDesc(THDPModule_makeDescriptor(PyTuple_GET_ITEM(args, 5)));
+  {
+    AutoNoGIL guard;
+    THDAllReduceCompressed(desc, op, compression, k, residual, group);
+  }
+  Py_RETURN_NONE;
+  END_HANDLE_TH_ERRORS
+}
+
+PyObject* THDPModule_iallReduce(PyObject *_unused, PyObject *args)
+{
+  HANDLE_TH_ERRORS
+  if (PyTuple_GET_SIZE(args) != 3 || !THPModule_isTensor(PyTuple_GET_ITEM(args, 0))) {
+    THPUtils_invalidArguments(args, NULL, "iall_reduce", 1, "(tensor in_out, reduce_op op, group gr)");
+    return NULL;
+  }
+
+  THDGroup group = _getGroup(PyTuple_GET_ITEM(args, 2));
+  THDReduceOp op = _getReduceOp(PyTuple_GET_ITEM(args, 1));
+  THDPTensorDesc desc {THDPModule_makeDescriptor(PyTuple_GET_ITEM(args, 0))};
+  THDRequest* req;
+  {
+    AutoNoGIL guard;
+    req = THDIAllReduce(desc, op, group);
+  }
+  return THPWrapper_New(req, (void(*)(void*))THDRequest_free);
+  END_HANDLE_TH_ERRORS
+}
+
+PyObject* THDPModule_iallReduceCoalesced(PyObject *_unused, PyObject *args)
+{
+  HANDLE_TH_ERRORS
+  PyObject* sequence = PyTuple_GET_ITEM(args, 0);
+  Py_ssize_t tmp_length;
+  std::size_t length;
+  std::vector<THDPTensorDesc> descriptors;
+  std::vector<THDTensorDescriptor*> raw_descriptors;
+  THDGroup group;
+  THDReduceOp op;
+  THDRequest* req;
+
+  if (PyTuple_GET_SIZE(args) != 3 || !PySequence_Check(sequence)) {
+    goto invalid_arguments;
+  }
+
+  tmp_length = PySequence_Length(sequence);
+  THPUtils_assert(tmp_length >= 0, "couldn't obtain the length of %s",
+      THPUtils_typename(sequence));
+
+  length = static_cast<std::size_t>(tmp_length);
+  descriptors.reserve(length);
+  for (std::size_t i = 0; i < length; ++i) {
+    if (!THPModule_isTensor(PySequence_ITEM(sequence, i)))
+      goto invalid_arguments;
+
+    descriptors.push_back(
+      THDPTensorDesc(THDPModule_makeDescriptor(PySequence_ITEM(sequence, i)))
+    );
+    raw_descriptors.push_back(descriptors.back());
+  }
+
+  group = _getGroup(PyTuple_GET_ITEM(args, 2));
+  op = _getReduceOp(PyTuple_GET_ITEM(args, 1));
+  {
+    AutoNoGIL guard;
+    req = THDIAllReduceCoalesced(raw_descriptors.data(), length, op, group);
+  }
+  return THPWrapper_New(req, (void(*)(void*))THDRequest_free);
+
+invalid_arguments:
+  THPUtils_invalidArguments(args, NULL, "iall_reduce_coalesced", 1,
+      "(list[tensor] in_out, reduce_op op, group gr)");
+  Py_RETURN_NONE;
+  END_HANDLE_TH_ERRORS
+}
+
 PyObject* THDPModule_reduce(PyObject *_unused, PyObject *args)
 {
   HANDLE_TH_ERRORS
@@ -375,6 +530,29 @@ PyObject* THDPModule_reduce(PyObject *_unused, PyObject *args)
   END_HANDLE_TH_ERRORS
 }
 
+PyObject* THDPModule_ireduce(PyObject *_unused, PyObject *args)
+{
+  HANDLE_TH_ERRORS
+  if (PyTuple_GET_SIZE(args) != 4 || !THPModule_isTensor(PyTuple_GET_ITEM(args, 0)) ||
+        !THPUtils_checkLong(PyTuple_GET_ITEM(args, 1))) {
+    THPUtils_invalidArguments(args, NULL, "ireduce", 1,
+        "(tensor reduced, int dst_rank, reduce_op op, group gr)");
+    return NULL;
+  }
+
+  THDGroup group = _getGroup(PyTuple_GET_ITEM(args, 3));
+  THDReduceOp op = _getReduceOp(PyTuple_GET_ITEM(args, 2));
+  THDPTensorDesc desc {THDPModule_makeDescriptor(PyTuple_GET_ITEM(args, 0))};
+  int dst_rank = THPUtils_unpackLong(PyTuple_GET_ITEM(args, 1));
+  THDRequest* req;
+  {
+    AutoNoGIL guard;
+    req = THDIReduce(desc, op, dst_rank, group);
+  }
+  return THPWrapper_New(req, (void(*)(void*))THDRequest_free);
+  END_HANDLE_TH_ERRORS
+}
+
 PyObject* THDPModule_broadcast(PyObject *_unused, PyObject *args)
 {
   HANDLE_TH_ERRORS
@@ -396,6 +574,28 @@ PyObject* THDPModule_broadcast(PyObject *_unused, PyObject *args)
   END_HANDLE_TH_ERRORS
 }
 
+PyObject* THDPModule_ibroadcast(PyObject *_unused, PyObject *args)
+{
+  HANDLE_TH_ERRORS
+  if (PyTuple_GET_SIZE(args) != 3 || !THPModule_isTensor(PyTuple_GET_ITEM(args, 0)) ||
+        !THPUtils_checkLong(PyTuple_GET_ITEM(args, 1))) {
+    THPUtils_invalidArguments(args, NULL, "ibroadcast", 1,
+        "(tensor src_dst, int src_rank, group gr)");
+    return NULL;
+  }
+
+  THDGroup group = _getGroup(PyTuple_GET_ITEM(args, 2));
+  THDPTensorDesc desc {THDPModule_makeDescriptor(PyTuple_GET_ITEM(args, 0))};
+  int src_rank = THPUtils_unpackLong(PyTuple_GET_ITEM(args, 1));
+  THDRequest* req;
+  {
+    AutoNoGIL guard;
+    req = THDIBroadcast(desc, src_rank, group);
+  }
+  return THPWrapper_New(req, (void(*)(void*))THDRequest_free);
+  END_HANDLE_TH_ERRORS
+}
+
 PyObject* THDPModule_allGather(PyObject *_unused, PyObject *args)
 {
   HANDLE_TH_ERRORS
@@ -443,6 +643,157 @@ invalid_arguments:
   END_HANDLE_TH_ERRORS
 }
 
+PyObject* THDPModule_iallGather(PyObject *_unused, PyObject *args)
+{
+  HANDLE_TH_ERRORS
+  PyObject* sequence = PyTuple_GET_ITEM(args, 0);
+  Py_ssize_t tmp_length;
+  std::size_t length;
+  std::vector<THDPTensorDesc> descriptors;
+  std::vector<THDTensorDescriptor*> raw_descriptors;
+  THDGroup group;
+  THDPTensorDesc desc;
+  THDRequest* req;
+
+  if (PyTuple_GET_SIZE(args) != 3 || !PySequence_Check(sequence) ||
+        !THPModule_isTensor(PyTuple_GET_ITEM(args, 1))) {
+    goto invalid_arguments;
+  }
+
+  tmp_length = PySequence_Length(sequence);
+  THPUtils_assert(tmp_length >= 0, "couldn't obtain the length of %s",
+      THPUtils_typename(sequence));
+
+  length = static_cast<std::size_t>(tmp_length);
+  descriptors.reserve(length);
+  for (std::size_t i = 0; i < length; ++i) {
+    if (!THPModule_isTensor(PySequence_ITEM(sequence, i)))
+      goto invalid_arguments;
+
+    descriptors.push_back(
+      THDPTensorDesc(THDPModule_makeDescriptor(PySequence_ITEM(sequence, i)))
+    );
+    raw_descriptors.push_back(descriptors.back());
+  }
+
+  group = _getGroup(PyTuple_GET_ITEM(args, 2));
+  desc = THDPTensorDesc(THDPModule_makeDescriptor(PyTuple_GET_ITEM(args, 1)));
+  {
+    AutoNoGIL guard;
+    req = THDIAllGather(raw_descriptors.data(), length, desc, group);
+  }
+  return THPWrapper_New(req, (void(*)(void*))THDRequest_free);
+
+invalid_arguments:
+  THPUtils_invalidArguments(args, NULL, "iall_gather", 1,
+      "(list[tensor] output, tensor input, group gr)");
+  Py_RETURN_NONE;
+  END_HANDLE_TH_ERRORS
+}
+
+PyObject* THDPModule_reduceScatter(PyObject *_unused, PyObject *args)
+{
+  HANDLE_TH_ERRORS
+  PyObject* sequence = PyTuple_GET_ITEM(args, 1);
+  Py_ssize_t tmp_length;
+  std::size_t length;
+  std::vector<THDPTensorDesc> descriptors;
+  std::vector<THDTensorDescriptor*> raw_descriptors;
+  THDGroup group;
+  THDReduceOp op;
+  THDPTensorDesc desc;
+
+  if (PyTuple_GET_SIZE(args) != 4 || !PySequence_Check(sequence) ||
+        !THPModule_isTensor(PyTuple_GET_ITEM(args, 0))) {
+    goto invalid_arguments;
+  }
+
+  tmp_length = PySequence_Length(sequence);
+  THPUtils_assert(tmp_length >= 0, "couldn't obtain the length of %s",
+      THPUtils_typename(sequence));
+
+  length = static_cast<std::size_t>(tmp_length);
+  descriptors.reserve(length);
+  for (std::size_t i = 0; i < length; ++i) {
+    if (!THPModule_isTensor(PySequence_ITEM(sequence, i)))
+      goto invalid_arguments;
+
+    descriptors.push_back(
+      THDPTensorDesc(THDPModule_makeDescriptor(PySequence_ITEM(sequence, i)))
+    );
+    raw_descriptors.push_back(descriptors.back());
+  }
+
+  group = _getGroup(PyTuple_GET_ITEM(args, 3));
+  op = _getReduceOp(PyTuple_GET_ITEM(args, 2));
+  desc = THDPTensorDesc(THDPModule_makeDescriptor(PyTuple_GET_ITEM(args, 0)));
+  {
+    AutoNoGIL guard;
+    THDReduceScatter(desc, raw_descriptors.data(), length, op, group);
+  }
+  Py_RETURN_NONE;
+
+invalid_arguments:
+  THPUtils_invalidArguments(args, NULL, "reduce_scatter", 1,
+      "(tensor output, list[tensor] input, reduce_op op, group gr)");
+  Py_RETURN_NONE;
+  END_HANDLE_TH_ERRORS
+}
+
+PyObject* THDPModule_allToAll(PyObject *_unused, PyObject *args)
+{
+  HANDLE_TH_ERRORS
+  PyObject* output_sequence = PyTuple_GET_ITEM(args, 0);
+  PyObject* input_sequence = PyTuple_GET_ITEM(args, 1);
+  Py_ssize_t tmp_length;
+  std::size_t length;
+  std::vector<THDPTensorDesc> descriptors;
+  std::vector<THDTensorDescriptor*> raw_output;
+  std::vector<THDTensorDescriptor*> raw_input;
+  THDGroup group;
+
+  if (PyTuple_GET_SIZE(args) != 3 || !PySequence_Check(output_sequence) ||
+        !PySequence_Check(input_sequence)) {
+    goto invalid_arguments;
+  }
+
+  tmp_length = PySequence_Length(output_sequence);
+  THPUtils_assert(tmp_length >= 0, "couldn't obtain the length of %s",
+      THPUtils_typename(output_sequence));
+  THPUtils_assert(tmp_length == PySequence_Length(input_sequence),
+      "all_to_all expects output and input lists of the same length");
+
+  length = static_cast<std::size_t>(tmp_length);
+  descriptors.reserve(2 * length);
+  for (std::size_t i = 0; i < length; ++i) {
+    if (!THPModule_isTensor(PySequence_ITEM(output_sequence, i)) ||
+          !THPModule_isTensor(PySequence_ITEM(input_sequence, i)))
+      goto invalid_arguments;
+
+    descriptors.push_back(
+      THDPTensorDesc(THDPModule_makeDescriptor(PySequence_ITEM(output_sequence, i)))
+    );
+    raw_output.push_back(descriptors.back());
+    descriptors.push_back(
+      THDPTensorDesc(THDPModule_makeDescriptor(PySequence_ITEM(input_sequence, i)))
+    );
+    raw_input.push_back(descriptors.back());
+  }
+
+  group = _getGroup(PyTuple_GET_ITEM(args, 2));
+  {
+    AutoNoGIL guard;
+    THDAllToAll(raw_output.data(), raw_input.data(), length, group);
+  }
+  Py_RETURN_NONE;
+
+invalid_arguments:
+  THPUtils_invalidArguments(args, NULL, "all_to_all", 1,
+      "(list[tensor] output, list[tensor] input, group gr)");
+  Py_RETURN_NONE;
+  END_HANDLE_TH_ERRORS
+}
+
 PyObject* THDPModule_gatherSend(PyObject *_unused, PyObject *args)
 {
   HANDLE_TH_ERRORS
@@ -656,15 +1007,88 @@ PyObject* THDPModule_requestWait(PyObject *_unused, PyObject *_req)
   END_HANDLE_TH_ERRORS
 }
 
+PyObject* THDPModule_enableTracing(PyObject *_unused, PyObject *_enabled)
+{
+  HANDLE_TH_ERRORS
+  if (!PyBool_Check(_enabled)) {
+    THPUtils_invalidArguments(_enabled, NULL, "enableTracing", 1, "(bool enabled)");
+    return NULL;
+  }
+
+  THDTraceEnable(_enabled == Py_True);
+  Py_RETURN_NONE;
+  END_HANDLE_TH_ERRORS
+}
+
+PyObject* THDPModule_clearTrace(PyObject *_unused)
+{
+  HANDLE_TH_ERRORS
+  THDTraceClear();
+  Py_RETURN_NONE;
+  END_HANDLE_TH_ERRORS
+}
+
+PyObject* THDPModule_getTraceEvents(PyObject *_unused)
+{
+  HANDLE_TH_ERRORS
+  std::vector<THDTraceEvent> events(THDTraceGetEvents(NULL, 0));
+  // more events could have been recorded in the meantime
+  events.resize(std::min(events.size(), THDTraceGetEvents(events.data(), events.size())));
+
+  THPObjectPtr list(PyList_New(events.size()));
+  if (!list) return NULL;
+  for (std::size_t i = 0; i < events.size(); ++i) {
+    const auto& event = events[i];
+    PyObject* item = Py_BuildValue("(ssiKKKK)", event.name, event.algorithm,
+        event.group, (unsigned long long)event.start_us,
+        (unsigned long long)event.duration_us, (unsigned long long)event.wait_us,
+        (unsigned long long)event.bytes);
+    if (!item) return NULL;
+    PyList_SET_ITEM(list.get(), i, item);
+  }
+  return list.release();
+  END_HANDLE_TH_ERRORS
+}
+
+PyObject* THDPModule_getTraceStats(PyObject *_unused)
+{
+  HANDLE_TH_ERRORS
+  std::vector<THDTraceStats> stats(THDTraceGetStats(NULL, 0));
+  stats.resize(std::min(stats.size(), THDTraceGetStats(stats.data(), stats.size())));
+
+  THPObjectPtr list(PyList_New(stats.size()));
+  if (!list) return NULL;
+  for (std::size_t i = 0; i < stats.size(); ++i) {
+    const auto& op_stats = stats[i];
+    THPObjectPtr histogram(PyList_New(THD_TRACE_HISTOGRAM_BUCKETS));
+    if (!histogram) return NULL;
+    for (std::size_t bucket = 0; bucket < THD_TRACE_HISTOGRAM_BUCKETS; ++bucket) {
+      PyObject* count = PyLong_FromUnsignedLongLong(op_stats.histogram[bucket]);
+      if (!count) return NULL;
+      PyList_SET_ITEM(histogram.get(), bucket, count);
+    }
+
+    PyObject* item = Py_BuildValue("(sKKKKO)", op_stats.name,
+        (unsigned long long)op_stats.count, (unsigned long long)op_stats.bytes,
+        (unsigned long long)op_stats.total_us, (unsigned long long)op_stats.wait_us,
+        histogram.get());
+    if (!item) return NULL;
+    PyList_SET_ITEM(list.get(), i, item);
+  }
+  return list.release();
+  END_HANDLE_TH_ERRORS
+}
+
 PyObject* THDPModule_initExtension(PyObject *_unused, PyObject *args) {
-  if (PyTuple_GET_SIZE(args) != 3) {
-    THPUtils_invalidArguments(args, NULL, "initExtension", 1, "(bool is_master_worker, reduce_op obj, group obj)");
+  if (PyTuple_GET_SIZE(args) != 4) {
+    THPUtils_invalidArguments(args, NULL, "initExtension", 1, "(bool is_master_worker, reduce_op obj, group obj, compression obj)");
     return NULL;
   }
 
   PyObject* is_master_worker_obj = PyTuple_GET_ITEM(args, 0);
   PyObject* reduce_op_obj = PyTuple_GET_ITEM(args, 1);
   PyObject* group_obj = PyTuple_GET_ITEM(args, 2);
+  PyObject* compression_obj = PyTuple_GET_ITEM(args, 3);
 
   THPUtils_assert(PyBool_Check(is_master_worker_obj), "first argument should be a bool");
   bool is_master_worker = is_master_worker_obj == Py_True;
@@ -688,6 +1112,16 @@ PyObject* THDPModule_initExtension(PyObject *_unused, PyObject *args) {
   REGISTER_GROUP(WORLD);
 #undef REGISTER_GROUP
 
+  THPObjectPtr compression;
+#define REGISTER_COMPRESSION(NAME)                                           \
+  compression = PyObject_GetAttrString(compression_obj, #NAME);              \
+  THPUtils_assert(compression, "Missing object for compression " #NAME);     \
+  obj2compression.emplace(compression.get(), THDCompression##NAME);
+  REGISTER_COMPRESSION(NONE);
+  REGISTER_COMPRESSION(FP16);
+  REGISTER_COMPRESSION(TOPK);
+#undef REGISTER_COMPRESSION
+
   if (is_master_worker) {
     PyObject *module = PyImport_ImportModule("torch.distributed");
     THPUtils_assert(module, "class loader couldn't access torch.distributed module");
@@ -713,9 +1147,18 @@ static struct PyMethodDef _THDPModule_methods[] = {
   {"_dist_recv_any_source", (PyCFunction)THDPModule_recvAnySource, METH_O, NULL},
   {"_dist_recv", (PyCFunction)THDPModule_recv, METH_VARARGS, NULL},
   {"_dist_all_reduce", (PyCFunction)THDPModule_allReduce, METH_VARARGS, NULL},
+  {"_dist_all_reduce_coalesced", (PyCFunction)THDPModule_allReduceCoalesced, METH_VARARGS, NULL},
+  {"_dist_all_reduce_compressed", (PyCFunction)THDPModule_allReduceCompressed, METH_VARARGS, NULL},
+  {"_dist_iall_reduce", (PyCFunction)THDPModule_iallReduce, METH_VARARGS, NULL},
+  {"_dist_iall_reduce_coalesced", (PyCFunction)THDPModule_iallReduceCoalesced, METH_VARARGS, NULL},
   {"_dist_reduce", (PyCFunction)THDPModule_reduce, METH_VARARGS, NULL},
+  {"_dist_ireduce", (PyCFunction)THDPModule_ireduce, METH_VARARGS, NULL},
   {"_dist_broadcast", (PyCFunction)THDPModule_broadcast, METH_VARARGS, NULL},
+  {"_dist_ibroadcast", (PyCFunction)THDPModule_ibroadcast, METH_VARARGS, NULL},
   {"_dist_all_gather", (PyCFunction)THDPModule_allGather, METH_VARARGS, NULL},
+  {"_dist_iall_gather", (PyCFunction)THDPModule_iallGather, METH_VARARGS, NULL},
+  {"_dist_reduce_scatter", (PyCFunction)THDPModule_reduceScatter, METH_VARARGS, NULL},
+  {"_dist_all_to_all", (PyCFunction)THDPModule_allToAll, METH_VARARGS, NULL},
   {"_dist_gather_send", (PyCFunction)THDPModule_gatherSend, METH_VARARGS, NULL},
   {"_dist_gather_recv", (PyCFunction)THDPModule_gatherRecv, METH_VARARGS, NULL},
   {"_dist_scatter_send", (PyCFunction)THDPModule_scatterSend, METH_VARARGS, NULL},
@@ -724,6 +1167,10 @@ static struct PyMethodDef _THDPModule_methods[] = {
   {"_dist_new_group", (PyCFunction)THDPModule_newGroup, METH_VARARGS, NULL},
   {"_dist_request_is_completed", (PyCFunction)THDPModule_requestIsCompleted, METH_O, NULL},
   {"_dist_request_wait", (PyCFunction)THDPModule_requestWait, METH_O, NULL},
+  {"_dist_enable_tracing", (PyCFunction)THDPModule_enableTracing, METH_O, NULL},
+  {"_dist_clear_trace", (PyCFunction)THDPModule_clearTrace, METH_NOARGS, NULL},
+  {"_dist_get_trace_events", (PyCFunction)THDPModule_getTraceEvents, METH_NOARGS, NULL},
+  {"_dist_get_trace_stats", (PyCFunction)THDPModule_getTraceStats, METH_NOARGS, NULL},
   {NULL}
 };
 
@@ -246,6 +246,26 @@ static PyObject *THPStorage_(setFromFile)(THPStorage *self, PyObject *args)
 }
 #endif // !defined(THD_GENERIC_FILE)
 
+#if !defined(THC_GENERIC_FILE) && !defined(THD_GENERIC_FILE)
+static PyObject * THPStorage_(newWithMappedFile)(PyObject *_unused, PyObject *args)
+{
+  HANDLE_TH_ERRORS
+  THPUtils_assert(PyTuple_GET_SIZE(args) == 2, "_new_with_mapped_file expects "
+      "a file and an offset");
+  int fd = PyObject_AsFileDescriptor(PyTuple_GET_ITEM(args, 0));
+  THPUtils_assert(fd != -1, "_new_with_mapped_file couldn't retrieve a file "
+      "descriptor from given object");
+  PyObject *offset = PyTuple_GET_ITEM(args, 1);
+  THPUtils_assert(THPUtils_checkLong(offset), "_new_with_mapped_file expects "
+      "an integer offset, but got %s", THPUtils_typename(offset));
+  THStorage *storage = THPStorage_(mapFileRaw)(fd, THPUtils_unpackLong(offset));
+  if (storage == nullptr)
+    return nullptr;
+  return THPStorage_(New)(storage);
+  END_HANDLE_TH_ERRORS
+}
+#endif
+
 #ifdef THC_GENERIC_FILE
 PyObject * THPStorage_(getDevice)(THPStorage *self)
 {
@@ -306,6 +326,7 @@ static PyMethodDef THPStorage_(methods)[] = {
 #endif // !defined(THD_GENERIC_FILE)
 #if !defined(THC_GENERIC_FILE) && !defined(THD_GENERIC_FILE)
   {"from_buffer", (PyCFunction)THPStorage_(fromBuffer), METH_VARARGS | METH_KEYWORDS | METH_STATIC, NULL},
+  {"_new_with_mapped_file", (PyCFunction)THPStorage_(newWithMappedFile), METH_VARARGS | METH_STATIC, NULL},
 #endif
   {"from_file", (PyCFunction)THPStorage_(fromFile), METH_VARARGS | METH_KEYWORDS | METH_STATIC, NULL},
 #ifdef THC_GENERIC_FILE
@@ -55,7 +55,7 @@ void THPStorage_(writeFileRaw)(THStorage *self, int fd)
     if (remaining != 0)
       throw std::system_error(result, std::system_category());
   } else {
-    int64_t buffer_size = std::min(size, (int64_t)5000);
+    int64_t buffer_size = std::min(size, (int64_t)(1048576 / sizeof(real)));
     std::unique_ptr<uint8_t[]> le_buffer(new uint8_t[buffer_size * sizeof(real)]);
     for (int64_t i = 0; i < size; i += buffer_size) {
       size_t to_convert = std::min(size - i, buffer_size);
@@ -123,7 +123,7 @@ THStorage * THPStorage_(readFileRaw)(int fd, THStorage *_storage)
     if (remaining != 0)
       throw std::system_error(result, std::system_category());
   } else {
-    int64_t buffer_size = std::min(size, (int64_t)5000);
+    int64_t buffer_size = std::min(size, (int64_t)(1048576 / sizeof(real)));
     std::unique_ptr<uint8_t[]> le_buffer(new uint8_t[buffer_size * sizeof(real)]);
     for (int64_t i = 0; i < size; i += buffer_size) {
       size_t to_convert = std::min(size - i, buffer_size);
@@ -153,6 +153,46 @@ THStorage * THPStorage_(readFileRaw)(int fd, THStorage *_storage)
   return storage.release();
 }
 
+#ifndef THC_GENERIC_FILE
+// Instead of reading the storage written at `offset`, maps its data as
+// copy-on-write pages of the file. The data has to start at a page boundary.
+THStorage * THPStorage_(mapFileRaw)(int fd, int64_t offset)
+{
+  int64_t size;
+  ssize_t result = pread(fd, &size, sizeof(int64_t), offset);
+  if (result < 0)
+    throw std::system_error(errno, std::system_category());
+  if (result != sizeof(int64_t))
+    throw std::runtime_error("unexpected EOF. The file might be corrupted.");
+  // the file is always little endian, so only bytes can be mapped elsewhere
+  THPUtils_assert(sizeof(real) == 1 || THP_nativeByteOrder() == THPByteOrder::THP_LITTLE_ENDIAN,
+      "can't map storages saved on little endian machines on a big endian one");
+  int64_t data_offset = offset + sizeof(int64_t);
+  THPUtils_assert(data_offset % sysconf(_SC_PAGESIZE) == 0,
+      "can't map storage data at offset %lld, it isn't a multiple of the page size",
+      (long long)data_offset);
+  if (size == 0)
+    return THStorage_(new)(LIBRARY_STATE_NOARGS);
+
+  struct stat file_stat;
+  SYSCHECK(fstat(fd, &file_stat));
+  if (data_offset + size * (int64_t)sizeof(real) > file_stat.st_size)
+    throw std::runtime_error("unexpected EOF. The file might be corrupted.");
+
+  // The allocator closes the descriptor it maps once the data is mapped
+  // (the mapping stays valid), so it gets a duplicate and the caller's file
+  // stays open. Without KEEPFD no descriptor is held for every storage.
+  int mapped_fd = dup(fd);
+  if (mapped_fd == -1)
+    throw std::system_error(errno, std::system_category());
+  THMapAllocatorContext *ctx = THMapAllocatorContext_newWithOffset(
+      NULL, mapped_fd, data_offset, TH_ALLOCATOR_MAPPED_FROMFD);
+  THStorage *storage = THStorage_(newWithAllocator)(LIBRARY_STATE size, &THMapAllocator, ctx);
+  THStorage_(clearFlag)(LIBRARY_STATE storage, TH_STORAGE_RESIZABLE);
+  return storage;
+}
+#endif
+
 #undef SYSCHECK
 
 #endif
@@ -6,5 +6,8 @@ void THPTensor_(writeMetadataRaw)(THTensor *self, int fd);
 THTensor * THPTensor_(newWithMetadataFileRaw)(int fd, THStorage *storage);
 void THPStorage_(writeFileRaw)(THStorage *self, int fd);
 THStorage * THPStorage_(readFileRaw)(int fd, THStorage *storage);
+#ifndef THC_GENERIC_FILE
+THStorage * THPStorage_(mapFileRaw)(int fd, int64_t offset);
+#endif
 
 #endif
@@ -1,10 +1,314 @@
 #include <Python.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <exception>
+#include <mutex>
 #include <system_error>
+#include <thread>
+#include <vector>
 
 #include "THP.h"
+#include "torch/csrc/utils/auto_gil.h"
 
 #include "generic/serialization.cpp"
 #include <TH/THGenerateAllTypes.h>
 
 #include "generic/serialization.cpp"
 #include <TH/THGenerateHalfType.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Chunked checkpoints
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Part of a storage that is written, compressed and checksummed by one thread
+struct StorageChunk {
+  uint8_t *data;
+  uint64_t size;         // bytes in memory
+  int element_size;
+  uint64_t offset;       // position in the file
+  uint64_t stored_size;  // bytes in the file, equal to size if not compressed
+  uint32_t crc;          // CRC32 of the little endian data
+};
+
+// Per-thread space for data that has to be converted or (de)compressed
+struct ChunkBuffers {
+  std::vector<uint8_t> little_endian;
+  std::vector<uint8_t> stored;
+};
+
+static const uint64_t MAX_CHUNK_SIZE = 1 << 30; // zlib's crc32 takes 32-bit sizes
+
+bool needsSwap(int element_size) {
+  return element_size > 1 && THP_nativeByteOrder() != THPByteOrder::THP_LITTLE_ENDIAN;
+}
+
+void toLittleEndian(uint8_t *dst, const uint8_t *src, int element_size, uint64_t size) {
+  auto order = THPByteOrder::THP_LITTLE_ENDIAN;
+  if (element_size == 2) {
+    THP_encodeInt16Buffer(dst, (const int16_t*)src, order, size / 2);
+  } else if (element_size == 4) {
+    THP_encodeInt32Buffer(dst, (const int32_t*)src, order, size / 4);
+  } else if (element_size == 8) {
+    THP_encodeInt64Buffer(dst, (const int64_t*)src, order, size / 8);
+  } else {
+    throw std::runtime_error("unsupported element size " + std::to_string(element_size));
+  }
+}
+
+void fromLittleEndian(uint8_t *dst, const uint8_t *src, int element_size, uint64_t size) {
+  auto order = THPByteOrder::THP_LITTLE_ENDIAN;
+  if (element_size == 2) {
+    THP_decodeInt16Buffer((int16_t*)dst, src, order, size / 2);
+  } else if (element_size == 4) {
+    THP_decodeInt32Buffer((int32_t*)dst, src, order, size / 4);
+  } else if (element_size == 8) {
+    THP_decodeInt64Buffer((int64_t*)dst, src, order, size / 8);
+  } else {
+    throw std::runtime_error("unsupported element size " + std::to_string(element_size));
+  }
+}
+
+void pwriteAll(int fd, const uint8_t *bytes, uint64_t size, uint64_t offset) {
+  while (size > 0) {
+    // we write and read in 1GB blocks to avoid bugs on some OSes
+    ssize_t result = pwrite(fd, bytes, std::min<uint64_t>(size, 1073741824), offset);
+    if (result < 0) {
+      if (errno == EINTR) continue;
+      throw std::system_error(errno, std::system_category());
+    }
+    bytes += result;
+    offset += result;
+    size -= result;
+  }
+}
+
+void preadAll(int fd, uint8_t *bytes, uint64_t size, uint64_t offset) {
+  while (size > 0) {
+    ssize_t result = pread(fd, bytes, std::min<uint64_t>(size, 1073741824), offset);
+    if (result == 0)
+      throw std::runtime_error("unexpected EOF. The file might be corrupted.");
+    if (result < 0) {
+      if (errno == EINTR) continue;
+      throw std::system_error(errno, std::system_category());
+    }
+    bytes += result;
+    offset += result;
+    size -= result;
+  }
+}
+
+/*
+ * Splits storages given as (data pointer, size in bytes, element size)
+ * tuples into chunks of at most chunk_size bytes. Requires the GIL.
+ */
+bool splitStorages(PyObject *storages, uint64_t chunk_size, std::vector<StorageChunk>& chunks) {
+  THPUtils_assertRet(false, PySequence_Check(storages), "expected a sequence of storages");
+  THPUtils_assertRet(false, chunk_size > 0 && chunk_size <= MAX_CHUNK_SIZE,
+      "chunk size has to be between 1 and %llu bytes", (unsigned long long)MAX_CHUNK_SIZE);
+  Py_ssize_t num_storages = PySequence_Length(storages);
+  for (Py_ssize_t i = 0; i < num_storages; i++) {
+    THPObjectPtr storage(PySequence_GetItem(storages, i));
+    if (!storage) return false;
+    unsigned long long data;
+    long long size;
+    int element_size;
+    if (!PyArg_ParseTuple(storage.get(), "KLi", &data, &size, &element_size))
+      return false;
+    THPUtils_assertRet(false, size >= 0 && element_size > 0 && chunk_size % element_size == 0,
+        "invalid storage at index %d", (int)i);
+    for (uint64_t offset = 0; offset < (uint64_t)size; offset += chunk_size) {
+      StorageChunk chunk;
+      chunk.data = (uint8_t*)data + offset;
+      chunk.size = std::min<uint64_t>(chunk_size, size - offset);
+      chunk.element_size = element_size;
+      chunk.offset = chunk.stored_size = chunk.crc = 0;
+      chunks.push_back(chunk);
+    }
+  }
+  return true;
+}
+
+// Runs fn(i, buffers) for every i in [0, n) on num_threads threads
+template<typename F>
+void parallelForChunks(size_t n, int num_threads, const F& fn) {
+  std::atomic<size_t> next(0);
+  std::atomic<bool> failed(false);
+  std::exception_ptr error;
+  std::mutex error_mutex;
+  auto work = [&]() {
+    ChunkBuffers buffers;
+    size_t i;
+    while (!failed && (i = next++) < n) {
+      try {
+        fn(i, buffers);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error) error = std::current_exception();
+        failed = true;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  size_t extra_threads = std::min<size_t>(std::max(num_threads, 1), n);
+  for (size_t t = 1; t < extra_threads; t++)
+    threads.emplace_back(work);
+  work();
+  for (auto& thread : threads)
+    thread.join();
+  if (error)
+    std::rethrow_exception(error);
+}
+
+void writeChunk(int fd, StorageChunk& chunk, bool compress, std::atomic<uint64_t>& end,
+                ChunkBuffers& buffers) {
+  const uint8_t *bytes = chunk.data;
+  if (needsSwap(chunk.element_size)) {
+    buffers.little_endian.resize(chunk.size);
+    toLittleEndian(buffers.little_endian.data(), bytes, chunk.element_size, chunk.size);
+    bytes = buffers.little_endian.data();
+  }
+  chunk.crc = crc32(0L, bytes, chunk.size);
+
+  chunk.stored_size = chunk.size;
+  if (compress) {
+    uLongf compressed_size = compressBound(chunk.size);
+    buffers.stored.resize(compressed_size);
+    if (compress2(buffers.stored.data(), &compressed_size, bytes, chunk.size, Z_BEST_SPEED) != Z_OK)
+      throw std::runtime_error("couldn't compress a checkpoint chunk");
+    // incompressible chunks are stored as they are
+    if (compressed_size < chunk.size) {
+      bytes = buffers.stored.data();
+      chunk.stored_size = compressed_size;
+    }
+    chunk.offset = end.fetch_add(chunk.stored_size);
+  }
+  pwriteAll(fd, bytes, chunk.stored_size, chunk.offset);
+}
+
+void readChunk(int fd, StorageChunk& chunk, ChunkBuffers& buffers) {
+  bool swap = needsSwap(chunk.element_size);
+  bool compressed = chunk.stored_size != chunk.size;
+  uint8_t *bytes = chunk.data;
+  if (swap) {
+    buffers.little_endian.resize(chunk.size);
+    bytes = buffers.little_endian.data();
+  }
+  if (compressed) {
+    buffers.stored.resize(chunk.stored_size);
+    preadAll(fd, buffers.stored.data(), chunk.stored_size, chunk.offset);
+    uLongf size = chunk.size;
+    if (uncompress(bytes, &size, buffers.stored.data(), chunk.stored_size) != Z_OK ||
+        size != chunk.size)
+      throw std::runtime_error("couldn't decompress the chunk at offset " +
+          std::to_string(chunk.offset) + ". The file might be corrupted.");
+  } else {
+    preadAll(fd, bytes, chunk.size, chunk.offset);
+  }
+  if (crc32(0L, bytes, chunk.size) != chunk.crc)
+    throw std::runtime_error("checksum mismatch in the chunk at offset " +
+        std::to_string(chunk.offset) + ". The file might be corrupted.");
+  if (swap)
+    fromLittleEndian(chunk.data, bytes, chunk.element_size, chunk.size);
+}
+
+void preallocate(int fd, uint64_t offset, uint64_t size) {
+  if (size == 0)
+    return;
+#ifdef __linux__
+  // reserves contiguous space, some file systems don't support it
+  if (posix_fallocate(fd, offset, size) == 0)
+    return;
+#endif
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) == -1)
+    throw std::system_error(errno, std::system_category());
+  if ((uint64_t)file_stat.st_size < offset + size && ftruncate(fd, offset + size) == -1)
+    throw std::system_error(errno, std::system_category());
+}
+
+} // anonymous namespace
+
+PyObject * THPModule_writeStorageChunks(PyObject *_unused, PyObject *args)
+{
+  HANDLE_TH_ERRORS
+  int fd;
+  PyObject *storages;
+  unsigned long long offset, chunk_size;
+  int compress, num_threads;
+  if (!PyArg_ParseTuple(args, "iOKKii", &fd, &storages, &offset, &chunk_size,
+        &compress, &num_threads))
+    return NULL;
+  std::vector<StorageChunk> chunks;
+  if (!splitStorages(storages, chunk_size, chunks))
+    return NULL;
+
+  std::atomic<uint64_t> end(offset);
+  {
+    AutoNoGIL no_gil;
+    if (!compress) {
+      // uncompressed chunks have fixed positions
+      for (auto& chunk : chunks)
+        chunk.offset = end.fetch_add(chunk.size);
+      preallocate(fd, offset, end.load() - offset);
+    }
+    parallelForChunks(chunks.size(), num_threads, [&](size_t i, ChunkBuffers& buffers) {
+      writeChunk(fd, chunks[i], compress, end, buffers);
+    });
+  }
+
+  THPObjectPtr chunk_list(PyList_New(chunks.size()));
+  if (!chunk_list) return NULL;
+  for (size_t i = 0; i < chunks.size(); i++) {
+    PyObject *chunk = Py_BuildValue("(KKk)", (unsigned long long)chunks[i].offset,
+        (unsigned long long)chunks[i].stored_size, (unsigned long)chunks[i].crc);
+    if (!chunk) return NULL;
+    PyList_SET_ITEM(chunk_list.get(), i, chunk);
+  }
+  return Py_BuildValue("(KN)", (unsigned long long)end.load(), chunk_list.release());
+  END_HANDLE_TH_ERRORS
+}
+
+PyObject * THPModule_readStorageChunks(PyObject *_unused, PyObject *args)
+{
+  HANDLE_TH_ERRORS
+  int fd;
+  PyObject *storages, *chunk_list;
+  unsigned long long chunk_size;
+  int num_threads;
+  if (!PyArg_ParseTuple(args, "iOKOi", &fd, &storages, &chunk_size, &chunk_list, &num_threads))
+    return NULL;
+  std::vector<StorageChunk> chunks;
+  if (!splitStorages(storages, chunk_size, chunks))
+    return NULL;
+  THPUtils_assert(PySequence_Check(chunk_list) &&
+      PySequence_Length(chunk_list) == (Py_ssize_t)chunks.size(),
+      "expected a list of %d chunks", (int)chunks.size());
+  for (size_t i = 0; i < chunks.size(); i++) {
+    THPObjectPtr chunk(PySequence_GetItem(chunk_list, i));
+    if (!chunk) return NULL;
+    unsigned long long chunk_offset, stored_size;
+    unsigned long crc;
+    if (!PyArg_ParseTuple(chunk.get(), "KKk", &chunk_offset, &stored_size, &crc))
+      return NULL;
+    chunks[i].offset = chunk_offset;
+    chunks[i].stored_size = stored_size;
+    chunks[i].crc = crc;
+  }
+
+  {
+    AutoNoGIL no_gil;
+    parallelForChunks(chunks.size(), num_threads, [&](size_t i, ChunkBuffers& buffers) {
+      readChunk(fd, chunks[i], buffers);
+    });
+  }
+  Py_RETURN_NONE;
+  END_HANDLE_TH_ERRORS
+}
@@ -7,4 +7,8 @@
 #include "generic/serialization.h"
 #include <TH/THGenerateHalfType.h>
 
+// Write and read storages split into chunks on multiple threads
+PyObject * THPModule_writeStorageChunks(PyObject *_unused, PyObject *args);
+PyObject * THPModule_readStorageChunks(PyObject *_unused, PyObject *args);
+
 #endif
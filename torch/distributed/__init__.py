@@ -3,6 +3,7 @@ torch.distributed provides an MPI-like interface for exchanging tensor
 data across multi-machine networks. It supports a few different backends
 and initialization methods.
 """
+import json
 import torch
 import warnings
 
@@ -25,7 +26,7 @@ def init_process_group(backend, init_method='env://', **kwargs):
 
     Arguments:
         backend (str): Name of the backend to use. Depending on build-time configuration
-            valid values include: ``tcp``, ``mpi`` and ``gloo``.
+            valid values include: ``tcp``, ``mpi``, ``gloo`` and ``shm``.
         init_method (str, optional): URL specifying how to initialize the package.
         world_size (int, optional): Number of processes participating in the job.
         rank (int, optional): Rank of the current process.
@@ -45,7 +46,7 @@ def init_process_group(backend, init_method='env://', **kwargs):
     torch._C._dist_init_process_group(backend, init_method, world_size,
                                       group_name, rank)
     _initialized = _INITIALIZED_PG
-    if not torch._C._dist_init_extension(False, reduce_op, group):
+    if not torch._C._dist_init_extension(False, reduce_op, group, compression):
         raise RuntimeError("distributed module initialization failed")
 
 
@@ -76,7 +77,7 @@ def init_master_worker(backend, init_method='env://', **kwargs):
     import torch.distributed.remote_types as remote_types
     _extend_scope(collectives)
     _extend_scope(remote_types)
-    if not torch._C._dist_init_extension(True, reduce_op, group):
+    if not torch._C._dist_init_extension(True, reduce_op, group, compression):
         raise RuntimeError("distributed module initialization failed")
 
 
@@ -91,6 +92,12 @@ class group(object):
     WORLD = object()
 
 
+class compression(object):
+    NONE = object()
+    FP16 = object()
+    TOPK = object()
+
+
 class _DistributedRequest(object):
     def __init__(self, request):
         self.request = request
@@ -191,6 +198,28 @@ def broadcast(tensor, src, group=group.WORLD):
     return torch._C._dist_broadcast(tensor, src, group)
 
 
+def ibroadcast(tensor, src, group=group.WORLD):
+    """Broadcasts the tensor to the whole group asynchronously.
+
+    Asynchronous collectives are executed one at a time, in the order in which
+    they were issued, on a communication thread. ``tensor`` must not be used
+    until the request completes, and all pending requests must complete
+    before any synchronous function is called.
+
+    Arguments:
+        tensor (Tensor): Data to be sent if ``src`` is the rank of current
+            process, and tensor to be used to save received data otherwise.
+        src (int): Source rank.
+        group (optional): Group of the collective.
+
+    Returns:
+        A distributed request object.
+    """
+    assert torch.distributed._initialized == _INITIALIZED_PG, \
+        "collective only supported in process-group mode"
+    return _DistributedRequest(torch._C._dist_ibroadcast(tensor, src, group))
+
+
 def all_reduce(tensor, op=reduce_op.SUM, group=group.WORLD):
     """Reduces the tensor data across all machines in such a way that all get
     the final result.
@@ -209,6 +238,96 @@ def all_reduce(tensor, op=reduce_op.SUM, group=group.WORLD):
     return torch._C._dist_all_reduce(tensor, op, group)
 
 
+def iall_reduce(tensor, op=reduce_op.SUM, group=group.WORLD):
+    """Asynchronous version of :func:`all_reduce`.
+
+    See :func:`ibroadcast` for the ordering rules of asynchronous collectives.
+
+    Arguments:
+        tensor (Tensor): Input and output of the collective. The function
+            operates in-place.
+        op (optional): One of the values from ``torch.distributed.reduce_op``
+            enum.  Specifies an operation used for element-wise reductions.
+        group (optional): Group of the collective.
+
+    Returns:
+        A distributed request object.
+    """
+    assert torch.distributed._initialized == _INITIALIZED_PG, \
+        "collective only supported in process-group mode"
+    return _DistributedRequest(torch._C._dist_iall_reduce(tensor, op, group))
+
+
+def all_reduce_coalesced(tensors, op=reduce_op.SUM, group=group.WORLD):
+    """Reduces a list of tensors across all machines, like calling
+    :func:`all_reduce` on every element, but much faster for many small tensors.
+
+    Consecutive tensors of the same type are copied into flat buckets and
+    every bucket is reduced at once. All processes have to pass lists of
+    tensors with matching types and sizes, in the same order.
+
+    Arguments:
+        tensors (list[Tensor]): Inputs and outputs of the collective. The
+            function operates in-place.
+        op (optional): One of the values from ``torch.distributed.reduce_op``
+            enum.  Specifies an operation used for element-wise reductions.
+        group (optional): Group of the collective.
+    """
+    assert torch.distributed._initialized == _INITIALIZED_PG, \
+        "collective only supported in process-group mode"
+    return torch._C._dist_all_reduce_coalesced(tensors, op, group)
+
+
+def all_reduce_compressed(tensor, compression, op=reduce_op.SUM,
+                          group=group.WORLD, k=0, residual=None):
+    """Reduces the tensor data across all machines, compressing it on the wire.
+
+    With ``compression.FP16`` the tensor is sent in half precision, but
+    reduced in its own precision. With ``compression.TOPK`` every process
+    sends only the ``k`` elements of ``tensor + residual`` with the largest
+    magnitude; the remaining ones are stored in ``residual`` and are added to
+    the tensor in the next call. Only float and double tensors are supported.
+
+    Arguments:
+        tensor (Tensor): Input and output of the collective. The function
+            operates in-place.
+        compression: One of the values from ``torch.distributed.compression``
+            enum.
+        op (optional): One of the values from ``torch.distributed.reduce_op``
+            enum.  Specifies an operation used for element-wise reductions.
+            ``compression.TOPK`` supports only ``reduce_op.SUM``.
+        group (optional): Group of the collective.
+        k (int, optional): Number of elements sent with ``compression.TOPK``.
+        residual (Tensor, optional): Error feedback buffer of the same size as
+            ``tensor``, required by ``compression.TOPK``. It should be zeroed
+            before the first call and passed unchanged to the following ones.
+    """
+    assert torch.distributed._initialized == _INITIALIZED_PG, \
+        "collective only supported in process-group mode"
+    return torch._C._dist_all_reduce_compressed(tensor, op, group, compression,
+                                                k, residual)
+
+
+def iall_reduce_coalesced(tensors, op=reduce_op.SUM, group=group.WORLD):
+    """Asynchronous version of :func:`all_reduce_coalesced`.
+
+    See :func:`ibroadcast` for the ordering rules of asynchronous collectives.
+
+    Arguments:
+        tensors (list[Tensor]): Inputs and outputs of the collective. The
+            function operates in-place.
+        op (optional): One of the values from ``torch.distributed.reduce_op``
+            enum.  Specifies an operation used for element-wise reductions.
+        group (optional): Group of the collective.
+
+    Returns:
+        A distributed request object.
+    """
+    assert torch.distributed._initialized == _INITIALIZED_PG, \
+        "collective only supported in process-group mode"
+    return _DistributedRequest(torch._C._dist_iall_reduce_coalesced(tensors, op, group))
+
+
 def reduce(tensor, dst, op=reduce_op.SUM, group=group.WORLD):
     """Reduces the tensor data across all machines.
 
@@ -226,6 +345,27 @@ def reduce(tensor, dst, op=reduce_op.SUM, group=group.WORLD):
     return torch._C._dist_reduce(tensor, dst, op, group)
 
 
+def ireduce(tensor, dst, op=reduce_op.SUM, group=group.WORLD):
+    """Asynchronous version of :func:`reduce`.
+
+    See :func:`ibroadcast` for the ordering rules of asynchronous collectives.
+
+    Arguments:
+        tensor (Tensor): Input and output of the collective. The function
+            operates in-place.
+        dst (int): Destination rank.
+        op (optional): One of the values from ``torch.distributed.reduce_op``
+            enum.  Specifies an operation used for element-wise reductions.
+        group (optional): Group of the collective.
+
+    Returns:
+        A distributed request object.
+    """
+    assert torch.distributed._initialized == _INITIALIZED_PG, \
+        "collective only supported in process-group mode"
+    return _DistributedRequest(torch._C._dist_ireduce(tensor, dst, op, group))
+
+
 def all_gather(tensor_list, tensor, group=group.WORLD):
     """Gathers tensors from the whole group in a list.
 
@@ -240,6 +380,63 @@ def all_gather(tensor_list, tensor, group=group.WORLD):
     return torch._C._dist_all_gather(tensor_list, tensor, group)
 
 
+def iall_gather(tensor_list, tensor, group=group.WORLD):
+    """Asynchronous version of :func:`all_gather`.
+
+    See :func:`ibroadcast` for the ordering rules of asynchronous collectives.
+
+    Arguments:
+        tensor_list (list[Tensor]): Output list. It should contain
+            correctly-sized tensors to be used for output of the collective.
+        tensor (Tensor): Tensor to be broadcast from current process.
+        group (optional): Group of the collective.
+
+    Returns:
+        A distributed request object.
+    """
+    assert torch.distributed._initialized == _INITIALIZED_PG, \
+        "collective only supported in process-group mode"
+    return _DistributedRequest(torch._C._dist_iall_gather(tensor_list, tensor, group))
+
+
+def reduce_scatter(tensor, tensor_list, op=reduce_op.SUM, group=group.WORLD):
+    """Reduces a list of tensors across all machines and scatters the result.
+
+    Every process ends up with the reduction of the ``i``-th tensors of all
+    processes in ``tensor``, where ``i`` is its rank in the group.
+
+    Arguments:
+        tensor (Tensor): Output of the collective.
+        tensor_list (list[Tensor]): Input list. It should contain one tensor
+            of the same size as ``tensor`` for every process in the group.
+        op (optional): One of the values from ``torch.distributed.reduce_op``
+            enum.  Specifies an operation used for element-wise reductions.
+        group (optional): Group of the collective.
+    """
+    assert torch.distributed._initialized == _INITIALIZED_PG, \
+        "collective only supported in process-group mode"
+    return torch._C._dist_reduce_scatter(tensor, tensor_list, op, group)
+
+
+def all_to_all(output_tensor_list, input_tensor_list, group=group.WORLD):
+    """Exchanges a tensor with every process in the group.
+
+    The ``i``-th tensor of ``input_tensor_list`` is sent to the process with
+    rank ``i``, which receives it in the element of its
+    ``output_tensor_list`` that corresponds to the sender's rank.
+
+    Arguments:
+        output_tensor_list (list[Tensor]): Output list. It should contain
+            one correctly-sized tensor for every process in the group.
+        input_tensor_list (list[Tensor]): Input list. It should contain one
+            tensor for every process in the group.
+        group (optional): Group of the collective.
+    """
+    assert torch.distributed._initialized == _INITIALIZED_PG, \
+        "collective only supported in process-group mode"
+    return torch._C._dist_all_to_all(output_tensor_list, input_tensor_list, group)
+
+
 def gather(tensor, **kwargs):
     """Gathers a list of tensors in a single process.
 
@@ -335,6 +532,91 @@ def new_group(ranks=None):
     return torch._C._dist_new_group(ranks)
 
 
+def enable_tracing(enabled=True):
+    """Starts or stops recording of distributed operations in this process.
+
+    Every traced call records its start time, duration, the size of tensor
+    data passed to it, the time spent waiting for other processes and, if the
+    backend reports it, the algorithm it used. Only blocking calls are traced.
+
+    Arguments:
+        enabled (bool, optional): Whether to record operations.
+    """
+    torch._C._dist_enable_tracing(enabled)
+
+
+def clear_trace():
+    """Drops all recorded events and statistics."""
+    torch._C._dist_clear_trace()
+
+
+def get_trace_events():
+    """Returns the most recent traced operations (at most 65536).
+
+    Returns:
+        A list of dicts with keys ``name``, ``algorithm``, ``group``,
+        ``start`` (microseconds since the epoch), ``duration``, ``wait``
+        (both in microseconds) and ``bytes``.
+    """
+    keys = ('name', 'algorithm', 'group', 'start', 'duration', 'wait', 'bytes')
+    return [dict(zip(keys, event)) for event in torch._C._dist_get_trace_events()]
+
+
+def get_trace_stats():
+    """Returns statistics of all operations traced since the last
+    :func:`clear_trace`.
+
+    Returns:
+        A dict mapping operation names to dicts with keys ``count``,
+        ``bytes``, ``time``, ``wait`` (both in microseconds), ``bandwidth``
+        (bytes per second) and ``histogram``, where ``histogram[i]`` counts
+        calls that took from ``2 ** (i - 1)`` to ``2 ** i`` microseconds.
+    """
+    stats = {}
+    for name, count, nbytes, time, wait, histogram in torch._C._dist_get_trace_stats():
+        stats[name] = {
+            'count': count,
+            'bytes': nbytes,
+            'time': time,
+            'wait': wait,
+            'bandwidth': nbytes * 1e6 / time if time > 0 else 0.0,
+            'histogram': histogram,
+        }
+    return stats
+
+
+def dump_chrome_trace(path):
+    """Writes traced events to a file that can be loaded in ``chrome://tracing``.
+
+    Events are shown under the rank of the process. Timestamps of all
+    processes use the same clock, so files written by several processes can
+    be merged by concatenating their ``traceEvents`` lists.
+
+    Arguments:
+        path (str): Name of the file to write.
+    """
+    rank = get_rank()
+    trace_events = []
+    for event in get_trace_events():
+        trace_events.append({
+            'name': event['name'],
+            'cat': 'distributed',
+            'ph': 'X',
+            'ts': event['start'],
+            'dur': event['duration'],
+            'pid': rank,
+            'tid': 0,
+            'args': {
+                'algorithm': event['algorithm'],
+                'group': event['group'],
+                'bytes': event['bytes'],
+                'wait': event['wait'],
+            },
+        })
+    with open(path, 'w') as f:
+        json.dump({'traceEvents': trace_events}, f)
+
+
 def _register_stream(stream):
     if not _initialized:
         raise RuntimeError("torch.distributed needs to be initialized first")
@@ -1,4 +1,8 @@
 #include "THAllocator.h"
+#if defined(USE_C11_ATOMICS)
+/* THAtomic.h needs ATOMIC_INT_LOCK_FREE to enable refcounted mappings */
+#include <stdatomic.h>
+#endif
 #include "THAtomic.h"
 
 /* stuff for mapped files */
@@ -39,6 +43,7 @@ struct THMapAllocatorContext_ {
   char *filename; /* file name */
   int flags;
   ptrdiff_t size; /* mapped size */
+  ptrdiff_t offset; /* position of the mapping in the file, a multiple of the page size */
   int fd;
 };
 
@@ -68,6 +73,7 @@ THMapAllocatorContext *THMapAllocatorContext_new(const char *filename, int flags
   }
   ctx->flags = flags;
   ctx->size = 0;
+  ctx->offset = 0;
   ctx->fd = -1;
 
   return ctx;
@@ -81,6 +87,19 @@ THMapAllocatorContext *THMapAllocatorContext_newWithFd(const char *filename, int
   return ctx;
 }
 
+THMapAllocatorContext *THMapAllocatorContext_newWithOffset(const char *filename, int fd,
+    ptrdiff_t offset, int flags)
+{
+  THMapAllocatorContext *ctx = THMapAllocatorContext_newWithFd(filename, fd, flags);
+  if (offset < 0) {
+    THMapAllocatorContext_free(ctx);
+    THError("invalid mapping offset <%td>", offset);
+  }
+  ctx->offset = offset;
+
+  return ctx;
+}
+
 char * THMapAllocatorContext_filename(THMapAllocatorContext *ctx)
 {
   return ctx->filename;
@@ -126,6 +145,8 @@ static void *_map_alloc(void* ctx_, ptrdiff_t size)
       THError("TH_ALLOCATOR_MAPPED_KEEPFD not supported on Windows");
     if (ctx->flags & TH_ALLOCATOR_MAPPED_FROMFD)
       THError("TH_ALLOCATOR_MAPPED_FROMFD not supported on Windows");
+    if (ctx->offset != 0)
+      THError("mapping a file at an offset is not supported on Windows");
 
     /* open file */
     /* FILE_FLAG_RANDOM_ACCESS ? */
@@ -250,13 +271,13 @@ static void *_map_alloc(void* ctx_, ptrdiff_t size)
 
     if(size > 0)
     {
-      if(size > file_stat.st_size)
+      if(ctx->offset + size > file_stat.st_size)
       {
-        if(ctx->flags)
+        if(ctx->flags & ~TH_ALLOCATOR_MAPPED_FROMFD)
         {
-          if(ftruncate(fd, size) == -1)
+          if(ftruncate(fd, ctx->offset + size) == -1)
             THError("unable to resize file <%s> to the right size", ctx->filename);
-          if(fstat(fd, &file_stat) == -1 || file_stat.st_size < size)
+          if(fstat(fd, &file_stat) == -1 || file_stat.st_size < ctx->offset + size)
           {
             close(fd);
             THError("unable to stretch file <%s> to the right size", ctx->filename);
@@ -274,21 +295,30 @@ static void *_map_alloc(void* ctx_, ptrdiff_t size)
         }
         else
         {
-          close(fd);
-          THError("file <%s> size is smaller than the required mapping size <%ld>", ctx->filename, size);
+          if (!(ctx->flags & TH_ALLOCATOR_MAPPED_FROMFD))
+            close(fd);
+          THError("file <%s> size is smaller than the required mapping size <%ld>", ctx->filename, ctx->offset + size);
         }
       }
     }
     else
-      size = file_stat.st_size;
+    {
+      if(ctx->offset >= file_stat.st_size)
+      {
+        if (!(ctx->flags & TH_ALLOCATOR_MAPPED_FROMFD))
+          close(fd);
+        THError("file <%s> has no data to map after offset <%td>", ctx->filename, ctx->offset);
+      }
+      size = file_stat.st_size - ctx->offset;
+    }
 
     ctx->size = size; /* if we are here, it must be the right size */
 
     /* map it */
     if (ctx->flags & (TH_ALLOCATOR_MAPPED_SHARED | TH_ALLOCATOR_MAPPED_SHAREDMEM))
-      data = mmap(NULL, ctx->size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+      data = mmap(NULL, ctx->size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, ctx->offset);
     else
-      data = mmap(NULL, ctx->size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+      data = mmap(NULL, ctx->size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, ctx->offset);
 
     if (ctx->flags & TH_ALLOCATOR_MAPPED_KEEPFD) {
       ctx->fd = fd;
@@ -377,6 +407,12 @@ THMapAllocatorContext *THMapAllocatorContext_new(const char *filename, int flags
   return NULL;
 }
 
+THMapAllocatorContext *THMapAllocatorContext_newWithOffset(const char *filename, int fd,
+    ptrdiff_t offset, int flags) {
+  THError("file mapping not supported on your system");
+  return NULL;
+}
+
 void THMapAllocatorContext_free(THMapAllocatorContext *ctx) {
   THError("file mapping not supported on your system");
 }
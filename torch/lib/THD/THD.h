@@ -15,12 +15,14 @@
 #endif
 #include "base/ChannelType.h"
 #include "base/Cuda.h"
+#include "base/Tracing.h"
 
 #include "process_group/General.h"
 #include "process_group/Collectives.h"
 
 #include "master_worker/master/Master.h"
 #include "master_worker/master/State.h"
+#include "master_worker/master/THDFuture.h"
 #include "master_worker/master/THDRandom.h"
 #include "master_worker/master/THDStorage.h"
 #include "master_worker/master/THDTensor.h"
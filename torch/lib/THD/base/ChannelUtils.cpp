@@ -7,6 +7,7 @@
 #include <sys/poll.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <climits>
 #include <cstring>
 #include <memory>
 #include <string>
@@ -24,6 +25,22 @@ void setSocketNoDelay(int socket) {
   SYSCHECK(setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (char*)&flag, optlen));
 }
 
+// Drops first `bytes` bytes from `iov`, returns number of buffers that were
+// consumed completely
+std::size_t advanceIovec(struct iovec* iov, std::size_t count, std::size_t bytes) {
+  std::size_t consumed = 0;
+  while (consumed < count && bytes >= iov[consumed].iov_len) {
+    bytes -= iov[consumed].iov_len;
+    ++consumed;
+  }
+
+  if (consumed < count) {
+    iov[consumed].iov_base = static_cast<std::uint8_t*>(iov[consumed].iov_base) + bytes;
+    iov[consumed].iov_len -= bytes;
+  }
+  return consumed;
+}
+
 port_type getSocketPort(int fd) {
   port_type listen_port;
   struct sockaddr_storage addr_storage;
@@ -253,4 +270,55 @@ std::tuple<int, std::string> accept(int listen_socket, int timeout) {
   return std::make_tuple(socket, sockaddrToString(reinterpret_cast<struct sockaddr*>(&addr)));
 }
 
+void send_iovec(int socket, struct iovec* iov, std::size_t count) {
+  // skip empty buffers, sending nothing would be taken for a closed connection
+  std::size_t consumed = advanceIovec(iov, count, 0);
+  iov += consumed;
+  count -= consumed;
+
+  while (count > 0) {
+    struct msghdr message;
+    std::memset(&message, 0, sizeof(message));
+    message.msg_iov = iov;
+    message.msg_iovlen = std::min<std::size_t>(count, IOV_MAX);
+
+    ssize_t bytes_sent;
+    SYSCHECK(bytes_sent = ::sendmsg(socket, &message, 0))
+    if (bytes_sent == 0)
+      throw std::system_error(ECONNRESET, std::system_category());
+
+    consumed = advanceIovec(iov, count, bytes_sent);
+    iov += consumed;
+    count -= consumed;
+  }
+}
+
+void recv_iovec(int socket, struct iovec* iov, std::size_t count) {
+  std::size_t consumed = advanceIovec(iov, count, 0);
+  iov += consumed;
+  count -= consumed;
+
+  while (count > 0) {
+    struct msghdr message;
+    std::memset(&message, 0, sizeof(message));
+    message.msg_iov = iov;
+    message.msg_iovlen = std::min<std::size_t>(count, IOV_MAX);
+
+    ssize_t bytes_received;
+    SYSCHECK(bytes_received = ::recvmsg(socket, &message, 0))
+    if (bytes_received == 0)
+      throw std::system_error(ECONNRESET, std::system_category());
+
+    consumed = advanceIovec(iov, count, bytes_received);
+    iov += consumed;
+    count -= consumed;
+  }
+}
+
+void setSocketBufferSize(int socket, int size) {
+  // the kernel doubles the value and caps it at net.core.{w,r}mem_max
+  SYSCHECK(::setsockopt(socket, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size)))
+  SYSCHECK(::setsockopt(socket, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)))
+}
+
 } // namespace thd
@@ -3,6 +3,7 @@
 #include <THPP/Tensor.hpp>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <cstdlib>
 #include <cstdint>
 #include <functional>
@@ -125,6 +126,13 @@ void recv_bytes(int socket, T* buffer, std::size_t length)
   }
 }
 
+/*
+ * Send and receive all data described by `count` buffers of `iov` with
+ * scatter-gather I/O. Entries of `iov` are modified.
+ */
+void send_iovec(int socket, struct iovec* iov, std::size_t count);
+void recv_iovec(int socket, struct iovec* iov, std::size_t count);
+
 inline port_type convertToPort(long port) {
   if ((port < 0) || (port >= std::numeric_limits<port_type>::max()))
     throw std::domain_error("invalid port (value out of range)");
@@ -142,6 +150,7 @@ inline rank_type convertToRank(long rank, long min = 0) {
 std::pair<int, port_type> listen(port_type port = 0);
 int connect(const std::string& address, port_type port, bool wait = true, int timeout = -1);
 std::tuple<int, std::string> accept(int listen_socket, int timeout = -1);
+void setSocketBufferSize(int socket, int size);
 
 std::string sockaddrToString(struct sockaddr *addr);
 std::pair<std::string, std::string> splitAddress(const std::string &addr);
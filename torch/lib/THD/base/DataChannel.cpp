@@ -1,17 +1,118 @@
 #include "DataChannel.hpp"
+#include "Tracing.hpp"
 #ifdef WITH_GLOO
 #include "data_channels/DataChannelGloo.hpp"
 #endif // WITH_GLOO
 #ifdef WITH_MPI
 #include "data_channels/DataChannelMPI.hpp"
 #endif // WITH_MPI
+#ifdef WITH_SHM
+#include "data_channels/DataChannelSHM.hpp"
+#endif // WITH_SHM
 #include "data_channels/DataChannelTCP.hpp"
 
+#include <THPP/tensors/THTensor.hpp>
+#include <TH/THHalf.h>
+
 #include <algorithm>
+#include <cstdint>
+#include <memory>
 #include <stdexcept>
 #include <tuple>
 
 namespace thd {
+namespace {
+
+// Upper bound on the size of a bucket in `allReduceCoalesced`
+constexpr std::uint64_t COALESCED_BUCKET_BYTES = 1 << 24;
+
+struct AsyncRequest : DataChannel::Request {
+  AsyncRequest(QueueWorker::Request&& request)
+    : _request(std::move(request)) {}
+
+  bool isCompleted() override { return _request.isCompleted(); }
+  void wait() override { _request.wait(); }
+
+private:
+  QueueWorker::Request _request;
+};
+
+// Shallow copies keep tensors alive until an asynchronous operation is done
+using tensor_list = std::vector<std::shared_ptr<thpp::Tensor>>;
+
+std::shared_ptr<tensor_list> shallowCopies(std::vector<thpp::Tensor*>& tensors) {
+  auto copies = std::make_shared<tensor_list>();
+  for (auto tensor : tensors)
+    copies->emplace_back(tensor->clone_shallow());
+  return copies;
+}
+
+std::vector<thpp::Tensor*> rawPointers(const tensor_list& tensors) {
+  std::vector<thpp::Tensor*> pointers;
+  for (auto& tensor : tensors)
+    pointers.push_back(tensor.get());
+  return pointers;
+}
+
+std::vector<thpp::Tensor*> rawPointers(const std::vector<std::unique_ptr<thpp::Tensor>>& tensors) {
+  std::vector<thpp::Tensor*> pointers;
+  for (auto& tensor : tensors)
+    pointers.push_back(tensor.get());
+  return pointers;
+}
+
+template<typename T>
+void encodeHalf(const thpp::Tensor& src, thpp::Tensor& dst) {
+  auto input = reinterpret_cast<const T*>(src.data());
+  auto output = reinterpret_cast<unsigned short*>(dst.data());
+  for (long i = 0; i < src.numel(); ++i) {
+    float value = static_cast<float>(input[i]);
+    TH_float2halfbits(&value, output + i);
+  }
+}
+
+template<typename T>
+void decodeHalf(const thpp::Tensor& src, thpp::Tensor& dst) {
+  auto input = reinterpret_cast<const unsigned short*>(src.data());
+  auto output = reinterpret_cast<T*>(dst.data());
+  for (long i = 0; i < dst.numel(); ++i) {
+    float value;
+    TH_halfbits2float(const_cast<unsigned short*>(input + i), &value);
+    output[i] = static_cast<T>(value);
+  }
+}
+
+// Converts between a contiguous floating point tensor and half precision bits
+void toHalf(const thpp::Tensor& src, thpp::Tensor& dst) {
+  if (src.type() == thpp::Type::FLOAT)
+    encodeHalf<float>(src, dst);
+  else
+    encodeHalf<double>(src, dst);
+}
+
+void fromHalf(const thpp::Tensor& src, thpp::Tensor& dst) {
+  if (dst.type() == thpp::Type::FLOAT)
+    decodeHalf<float>(src, dst);
+  else
+    decodeHalf<double>(src, dst);
+}
+
+void reduceInto(thpp::Tensor& result, const thpp::Tensor& data,
+                THDReduceOp operation) {
+  if (operation == THDReduceOp::THDReduceMIN) {
+    result.cmin(result, data);
+  } else if (operation == THDReduceOp::THDReduceMAX) {
+    result.cmax(result, data);
+  } else if (operation == THDReduceOp::THDReduceSUM) {
+    result.cadd(result, data);
+  } else if (operation == THDReduceOp::THDReducePRODUCT) {
+    result.cmul(result, data);
+  } else {
+    throw std::logic_error("unsupported reduce operation");
+  }
+}
+
+} // anonymous namespace
 
 #define GET_CONFIG getInitConfig(init_method, world_size, group_name, rank)
 DataChannel* DataChannel::newChannel(THDChannelType type, std::string init_method,
@@ -39,6 +140,15 @@ DataChannel* DataChannel::newChannel(THDChannelType type, std::string init_metho
         "try to recompile the THD package with Gloo support"
       );
 
+    case THDChannelSHM:
+#ifdef WITH_SHM
+      return new DataChannelSHM(GET_CONFIG);
+#endif // WITH_SHM
+      throw std::runtime_error(
+        "the shm backend is not available; "
+        "it requires Linux, because it relies on futexes"
+      );
+
     default:
       throw std::runtime_error("unsupported data channel type");
   }
@@ -46,6 +156,282 @@ DataChannel* DataChannel::newChannel(THDChannelType type, std::string init_metho
 #undef GET_CONFIG
 
 
+DataChannel::DataChannel() {}
+
+
+DataChannel::~DataChannel() {}
+
+
+void DataChannel::allReduceCoalesced(std::vector<thpp::Tensor*>& data,
+                                     THDReduceOp operation, THDGroup group_id) {
+  std::size_t begin = 0;
+  while (begin < data.size()) {
+    // tensors [begin, end) make up the next bucket
+    auto& first = *data[begin];
+    std::uint64_t bucket_bytes = 0;
+    long bucket_numel = 0;
+    std::size_t end = begin;
+    for (; end < data.size(); ++end) {
+      auto& tensor = *data[end];
+      if (tensor.type() != first.type() || tensor.isCuda() != first.isCuda())
+        break;
+
+      std::uint64_t tensor_bytes = tensor.elementSize() * tensor.numel();
+      if (end > begin && bucket_bytes + tensor_bytes > COALESCED_BUCKET_BYTES)
+        break;
+
+      bucket_bytes += tensor_bytes;
+      bucket_numel += tensor.numel();
+    }
+
+    if (end - begin == 1 && first.isContiguous()) {
+      allReduce(first, operation, group_id);
+    } else if (bucket_numel > 0) {
+      auto bucket = first.newTensor();
+      bucket->resize({bucket_numel});
+
+      std::vector<std::unique_ptr<thpp::Tensor>> slices;
+      long offset = 0;
+      for (std::size_t i = begin; i < end; ++i) {
+        long numel = data[i]->numel();
+        if (numel == 0) {
+          slices.emplace_back(nullptr);
+          continue;
+        }
+
+        slices.emplace_back(bucket->newNarrow(0, offset, numel));
+        slices.back()->copy(*data[i]);
+        offset += numel;
+      }
+
+      allReduce(*bucket, operation, group_id);
+
+      for (std::size_t i = begin; i < end; ++i) {
+        if (slices[i - begin])
+          data[i]->copy(*slices[i - begin]);
+      }
+    }
+
+    begin = end;
+  }
+}
+
+
+void DataChannel::allReduceCompressed(thpp::Tensor& data, THDReduceOp operation,
+                                      THDCompression compression, long k,
+                                      thpp::Tensor* residual, THDGroup group_id) {
+  if (compression == THDCompressionNONE) {
+    allReduce(data, operation, group_id);
+    return;
+  }
+
+  const auto& group = _getGroup(group_id);
+  rank_type group_rank;
+  bool exists;
+
+  std::tie(group_rank, exists) = group.getGroupRank(getRank());
+  if (!exists)
+    return;
+
+  if (data.type() != thpp::Type::FLOAT && data.type() != thpp::Type::DOUBLE)
+    throw std::logic_error("allReduceCompressed: only float and double tensors can be compressed");
+  if (!data.isContiguous())
+    throw std::logic_error("allReduceCompressed: tensor is not contiguous");
+  if (data.numel() == 0)
+    return;
+
+  if (compression == THDCompressionFP16) {
+    tracer.setAlgorithm("fp16");
+    _allReduceHalf(data, operation, group, group_rank, group_id);
+  } else if (compression == THDCompressionTOPK) {
+    if (operation != THDReduceOp::THDReduceSUM)
+      throw std::logic_error("allReduceCompressed: top-k compression supports only sum");
+    if (!residual)
+      throw std::logic_error("allReduceCompressed: top-k compression requires a residual tensor");
+    assertSameSizeAndType(*residual, data, "allReduceCompressed");
+
+    tracer.setAlgorithm("topk");
+    _allReduceTopK(data, k, *residual, group, group_id);
+  } else {
+    throw std::logic_error("allReduceCompressed: unsupported compression");
+  }
+}
+
+
+void DataChannel::_allReduceHalf(thpp::Tensor& data, THDReduceOp operation,
+                                 const Group& group, rank_type group_rank,
+                                 THDGroup group_id) {
+  /*
+   * Every process converts its tensor to half precision and sends chunk `i`
+   * to group rank `i`, which reduces the chunks it received in full
+   * precision. Reduced chunks are sent back in half precision as well.
+   * This is the data movement of a ring allreduce at half of the bytes.
+   */
+
+  rank_type size = group.size();
+  long numel = data.numel();
+  long chunk = (numel + size - 1) / size;
+
+  // half precision bits of every chunk, padded to `size * chunk` elements
+  thpp::THTensor<short> encoded, received;
+  encoded.resize({static_cast<long>(size) * chunk});
+  received.resize({static_cast<long>(size) * chunk});
+  encoded.zero();
+
+  std::unique_ptr<thpp::Tensor> flat_data(data.newView({numel}));
+  std::unique_ptr<thpp::Tensor> used(encoded.newNarrow(0, 0, numel));
+  toHalf(*flat_data, *used);
+
+  std::vector<std::unique_ptr<thpp::Tensor>> encoded_chunks, received_chunks;
+  for (rank_type i = 0; i < size; ++i) {
+    encoded_chunks.emplace_back(encoded.newNarrow(0, i * chunk, chunk));
+    received_chunks.emplace_back(received.newNarrow(0, i * chunk, chunk));
+  }
+
+  auto raw_encoded = rawPointers(encoded_chunks);
+  auto raw_received = rawPointers(received_chunks);
+  allToAll(raw_received, raw_encoded, group_id);
+
+  std::unique_ptr<thpp::Tensor> result(data.newTensor());
+  std::unique_ptr<thpp::Tensor> contribution(data.newTensor());
+  result->resize({chunk});
+  contribution->resize({chunk});
+  fromHalf(*received_chunks[0], *result);
+  for (rank_type i = 1; i < size; ++i) {
+    fromHalf(*received_chunks[i], *contribution);
+    reduceInto(*result, *contribution, operation);
+  }
+
+  toHalf(*result, *encoded_chunks[group_rank]);
+  allGather(raw_received, *encoded_chunks[group_rank], group_id);
+
+  std::unique_ptr<thpp::Tensor> reduced(received.newNarrow(0, 0, numel));
+  fromHalf(*reduced, *flat_data);
+}
+
+
+void DataChannel::_allReduceTopK(thpp::Tensor& data, long k, thpp::Tensor& residual,
+                                 const Group& group, THDGroup group_id) {
+  /*
+   * Error feedback: elements that are not sent stay in `residual` and are
+   * added to the next tensor, so every update is applied eventually.
+   * Processes exchange (index, value) pairs of their `k` largest elements,
+   * which are summed into a dense result.
+   *
+   * `residual` is only written once the exchange succeeded, so a backend
+   * that can't gather the pairs leaves both tensors as they were.
+   */
+
+  long numel = data.numel();
+  k = std::max(1L, std::min(k, numel));
+
+  std::unique_ptr<thpp::Tensor> flat_data(data.newView({numel}));
+  std::unique_ptr<thpp::Tensor> flat_residual(residual.newView({numel}));
+  std::unique_ptr<thpp::Tensor> accumulated(flat_residual->clone());
+  accumulated->cadd(*accumulated, *flat_data);
+
+  std::unique_ptr<thpp::Tensor> magnitude(data.newTensor());
+  std::unique_ptr<thpp::Tensor> values(data.newTensor());
+  thpp::THTensor<long> indices;
+  magnitude->abs(*accumulated);
+  values->topk(indices, *magnitude, k, 0, 1, 0);
+  values->indexSelect(*accumulated, 0, indices);
+
+  std::unique_ptr<thpp::Tensor> zeros(data.newTensor());
+  zeros->resize({k});
+  zeros->zero();
+  accumulated->indexCopy(0, indices, *zeros);
+
+  std::vector<std::unique_ptr<thpp::Tensor>> all_indices, all_values;
+  for (rank_type i = 0; i < group.size(); ++i) {
+    all_indices.emplace_back(indices.newTensor());
+    all_indices.back()->resize({k});
+    all_values.emplace_back(data.newTensor());
+    all_values.back()->resize({k});
+  }
+
+  auto raw_indices = rawPointers(all_indices);
+  auto raw_values = rawPointers(all_values);
+  allGather(raw_indices, indices, group_id);
+  allGather(raw_values, *values, group_id);
+
+  flat_residual->copy(*accumulated);
+  flat_data->zero();
+  for (rank_type i = 0; i < group.size(); ++i)
+    flat_data->indexAdd(0, *all_indices[i], *all_values[i]);
+}
+
+
+DataChannel::Request* DataChannel::iallGather(std::vector<thpp::Tensor*>& output,
+                                              thpp::Tensor& input, THDGroup group_id) {
+  auto outputs = shallowCopies(output);
+  std::shared_ptr<thpp::Tensor> tensor(input.clone_shallow());
+  return _async([this, outputs, tensor, group_id]{
+    auto raw_outputs = rawPointers(*outputs);
+    this->allGather(raw_outputs, *tensor, group_id);
+  });
+}
+
+
+DataChannel::Request* DataChannel::iallReduce(thpp::Tensor& data, THDReduceOp operation,
+                                              THDGroup group_id) {
+  std::shared_ptr<thpp::Tensor> tensor(data.clone_shallow());
+  return _async([this, tensor, operation, group_id]{
+    this->allReduce(*tensor, operation, group_id);
+  });
+}
+
+
+DataChannel::Request* DataChannel::iallReduceCoalesced(std::vector<thpp::Tensor*>& data,
+                                                       THDReduceOp operation,
+                                                       THDGroup group_id) {
+  auto tensors = shallowCopies(data);
+  return _async([this, tensors, operation, group_id]{
+    auto raw_tensors = rawPointers(*tensors);
+    this->allReduceCoalesced(raw_tensors, operation, group_id);
+  });
+}
+
+
+DataChannel::Request* DataChannel::ireduce(thpp::Tensor& data, THDReduceOp operation,
+                                           rank_type dst_rank, THDGroup group_id) {
+  std::shared_ptr<thpp::Tensor> tensor(data.clone_shallow());
+  return _async([this, tensor, operation, dst_rank, group_id]{
+    this->reduce(*tensor, operation, dst_rank, group_id);
+  });
+}
+
+
+DataChannel::Request* DataChannel::ibroadcast(thpp::Tensor& data, rank_type src_rank,
+                                              THDGroup group_id) {
+  std::shared_ptr<thpp::Tensor> tensor(data.clone_shallow());
+  return _async([this, tensor, src_rank, group_id]{
+    this->broadcast(*tensor, src_rank, group_id);
+  });
+}
+
+
+DataChannel::Request* DataChannel::_async(std::function<void ()>&& operation) {
+  {
+    std::lock_guard<std::mutex> lock(_async_mutex);
+    if (!_async_worker)
+      _async_worker.reset(new QueueWorker());
+  }
+
+  return new AsyncRequest(_async_worker->push(std::move(operation)));
+}
+
+
+void DataChannel::_stopAsyncWorker() {
+  std::unique_ptr<QueueWorker> worker;
+  {
+    std::lock_guard<std::mutex> lock(_async_mutex);
+    worker = std::move(_async_worker);
+  }
+  // the worker joins its thread when it goes out of scope
+}
+
+
 DataChannel::Group::Group()
 {}
 
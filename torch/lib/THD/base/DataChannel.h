@@ -7,5 +7,11 @@ enum THDReduceOp {
   THDReducePRODUCT,
 };
 
+enum THDCompression {
+  THDCompressionNONE = 0,
+  THDCompressionFP16,
+  THDCompressionTOPK,
+};
+
 typedef int THDGroup;
 const THDGroup THDGroupWORLD = 0;
@@ -8,6 +8,9 @@
 
 #include <THPP/Tensor.hpp>
 
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <unordered_map>
 #include <utility>
@@ -19,6 +22,8 @@ MAKE_HASHABLE(thpp::Type, static_cast<char>(t));
 
 namespace thd {
 
+struct QueueWorker;
+
 struct DataChannel {
 
   struct Request {
@@ -68,8 +73,8 @@ struct DataChannel {
     std::unordered_map<rank_type, rank_type> _old2new;
   };
 
-  DataChannel() {};
-  virtual ~DataChannel() {};
+  DataChannel();
+  virtual ~DataChannel();
 
   virtual bool init() = 0;
 
@@ -84,8 +89,41 @@ struct DataChannel {
                        rank_type src_rank, THDGroup group_id = THDGroupWORLD) = 0;
   virtual void allReduce(thpp::Tensor& data, THDReduceOp operation,
                          THDGroup group_id = THDGroupWORLD) = 0;
+  /*
+   * Allreduces all `data` tensors. Consecutive tensors of the same type are
+   * flattened into size-capped buckets and every bucket is reduced with
+   * a single `allReduce` call, so per-call overhead is paid per bucket
+   * instead of per tensor.
+   */
+  virtual void allReduceCoalesced(std::vector<thpp::Tensor*>& data,
+                                  THDReduceOp operation,
+                                  THDGroup group_id = THDGroupWORLD);
+  /*
+   * Allreduces `data` using a lossy encoding on the wire. `FP16` sends
+   * half precision values, but accumulates them in the precision of `data`.
+   * `TOPK` exchanges only the `k` elements of largest magnitude and keeps
+   * the others in `residual`, which is added to `data` on the next call.
+   */
+  virtual void allReduceCompressed(thpp::Tensor& data, THDReduceOp operation,
+                                   THDCompression compression, long k,
+                                   thpp::Tensor* residual,
+                                   THDGroup group_id = THDGroupWORLD);
   virtual void reduce(thpp::Tensor& data, THDReduceOp operation,
                       rank_type dst_rank, THDGroup group_id = THDGroupWORLD) = 0;
+  /*
+   * `input` holds one tensor per group rank; every process ends up with
+   * the reduction of all processes' `input[group_rank]` in `output`.
+   */
+  virtual void reduceScatter(thpp::Tensor& output, std::vector<thpp::Tensor*>& input,
+                             THDReduceOp operation,
+                             THDGroup group_id = THDGroupWORLD) = 0;
+  /*
+   * `input` and `output` hold one tensor per group rank; `input[i]` of this
+   * process ends up in `output[group_rank]` of the process with group rank `i`.
+   */
+  virtual void allToAll(std::vector<thpp::Tensor*>& output,
+                        std::vector<thpp::Tensor*>& input,
+                        THDGroup group_id = THDGroupWORLD) = 0;
   virtual void broadcast(thpp::Tensor& data, rank_type src_rank,
                          THDGroup group_id = THDGroupWORLD) = 0;
   virtual void send(Scalar& value, rank_type src_rank) = 0;
@@ -100,8 +138,48 @@ struct DataChannel {
 
   virtual THDGroup newGroup(const std::vector<rank_type>& ranks) = 0;
 
+  /*
+   * Asynchronous versions of the collectives. They are queued onto
+   * a communication thread owned by the channel and executed one at a time,
+   * in the order in which they were issued, so they overlap with computation
+   * but never with each other. Tensors must not be accessed until the
+   * returned request completes, and all outstanding requests have to complete
+   * before any blocking operation is issued. When the channel is destroyed,
+   * the running operation is finished and requests that haven't started fail.
+   */
+  virtual Request* iallGather(std::vector<thpp::Tensor*>& output, thpp::Tensor& input,
+                              THDGroup group_id = THDGroupWORLD);
+  virtual Request* iallReduce(thpp::Tensor& data, THDReduceOp operation,
+                              THDGroup group_id = THDGroupWORLD);
+  virtual Request* iallReduceCoalesced(std::vector<thpp::Tensor*>& data,
+                                       THDReduceOp operation,
+                                       THDGroup group_id = THDGroupWORLD);
+  virtual Request* ireduce(thpp::Tensor& data, THDReduceOp operation,
+                           rank_type dst_rank, THDGroup group_id = THDGroupWORLD);
+  virtual Request* ibroadcast(thpp::Tensor& data, rank_type src_rank,
+                              THDGroup group_id = THDGroupWORLD);
+
   static DataChannel* newChannel(THDChannelType type, std::string init_method,
                                  int world_size, std::string group_name, int rank);
+
+protected:
+  Request* _async(std::function<void ()>&& operation);
+  /*
+   * Finishes the running asynchronous operation and fails the queued ones.
+   * The worker calls into the derived channel, so every derived destructor
+   * has to call it before it releases anything.
+   */
+  void _stopAsyncWorker();
+  virtual const Group& _getGroup(THDGroup group_id) = 0;
+
+private:
+  void _allReduceHalf(thpp::Tensor& data, THDReduceOp operation,
+                      const Group& group, rank_type group_rank, THDGroup group_id);
+  void _allReduceTopK(thpp::Tensor& data, long k, thpp::Tensor& residual,
+                      const Group& group, THDGroup group_id);
+
+  std::unique_ptr<QueueWorker> _async_worker; // started on first async call
+  std::mutex _async_mutex;
 };
 
 } // namespace thd
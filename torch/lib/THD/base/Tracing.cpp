@@ -0,0 +1,167 @@
+#include "Tracing.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace thd {
+namespace {
+
+// Number of most recent events kept by the tracer
+constexpr std::size_t MAX_TRACE_EVENTS = 1 << 16;
+
+// Innermost operation traced in the current thread
+thread_local Tracer::Scope* current_scope = nullptr;
+
+std::uint64_t toMicroseconds(std::chrono::steady_clock::duration duration) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+}
+
+std::size_t histogramBucket(std::uint64_t duration_us) {
+  std::size_t bucket = 0;
+  while (duration_us > 0 && bucket < THD_TRACE_HISTOGRAM_BUCKETS - 1) {
+    duration_us >>= 1;
+    ++bucket;
+  }
+  return bucket;
+}
+
+} // anonymous namespace
+
+Tracer tracer;
+
+
+Tracer::Scope::Scope(const char* name, std::uint64_t bytes, int group)
+  : _active(tracer.isEnabled())
+  , _parent(nullptr)
+  , _wait_us(0)
+{
+  if (!_active)
+    return;
+
+  _event.name = name;
+  _event.algorithm = "";
+  _event.group = group;
+  _event.bytes = bytes;
+  _event.start_us = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+  _start = std::chrono::steady_clock::now();
+
+  _parent = current_scope;
+  current_scope = this;
+}
+
+
+Tracer::Scope::~Scope() {
+  if (!_active)
+    return;
+
+  current_scope = _parent;
+  _event.duration_us = toMicroseconds(std::chrono::steady_clock::now() - _start);
+  _event.wait_us = _wait_us.load();
+  if (_parent)
+    _parent->_wait_us += _event.wait_us;
+  tracer._record(_event);
+}
+
+
+Tracer::Tracer()
+  : _enabled(false)
+{}
+
+
+void Tracer::enable(bool enabled) {
+  _enabled = enabled;
+}
+
+
+void Tracer::setAlgorithm(const char* algorithm) {
+  if (current_scope && current_scope->_event.algorithm[0] == '\0')
+    current_scope->_event.algorithm = algorithm;
+}
+
+
+Tracer::Scope* Tracer::currentScope() {
+  return current_scope;
+}
+
+
+void Tracer::addWaitTime(Scope* scope, std::chrono::steady_clock::duration duration) {
+  scope->_wait_us += toMicroseconds(duration);
+}
+
+
+void Tracer::clear() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _events.clear();
+  _stats.clear();
+  _stats_index.clear();
+}
+
+
+std::vector<THDTraceEvent> Tracer::events() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return std::vector<THDTraceEvent>(_events.begin(), _events.end());
+}
+
+
+std::vector<THDTraceStats> Tracer::stats() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _stats;
+}
+
+
+void Tracer::_record(const THDTraceEvent& event) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  if (_events.size() == MAX_TRACE_EVENTS)
+    _events.pop_front();
+  _events.push_back(event);
+
+  auto it = _stats_index.find(event.name);
+  if (it == _stats_index.end()) {
+    THDTraceStats stats;
+    std::memset(&stats, 0, sizeof(stats));
+    stats.name = event.name;
+    it = _stats_index.emplace(event.name, _stats.size()).first;
+    _stats.push_back(stats);
+  }
+
+  auto& stats = _stats[it->second];
+  stats.count++;
+  stats.bytes += event.bytes;
+  stats.total_us += event.duration_us;
+  stats.wait_us += event.wait_us;
+  stats.histogram[histogramBucket(event.duration_us)]++;
+}
+
+} // namespace thd
+
+
+using namespace thd;
+
+void THDTraceEnable(int enabled) {
+  tracer.enable(enabled != 0);
+}
+
+int THDTraceIsEnabled() {
+  return tracer.isEnabled();
+}
+
+void THDTraceClear() {
+  tracer.clear();
+}
+
+size_t THDTraceGetEvents(THDTraceEvent* events, size_t max_events) {
+  auto recorded = tracer.events();
+  if (events) {
+    std::copy_n(recorded.begin(), std::min(max_events, recorded.size()), events);
+  }
+  return recorded.size();
+}
+
+size_t THDTraceGetStats(THDTraceStats* stats, size_t max_stats) {
+  auto recorded = tracer.stats();
+  if (stats) {
+    std::copy_n(recorded.begin(), std::min(max_stats, recorded.size()), stats);
+  }
+  return recorded.size();
+}
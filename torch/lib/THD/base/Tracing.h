@@ -0,0 +1,41 @@
+#pragma once
+
+#include "../THD.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define THD_TRACE_HISTOGRAM_BUCKETS 32
+
+/*
+ * A single traced operation. Timestamps are in microseconds since the Unix
+ * epoch, so traces of different processes can be put side by side.
+ */
+typedef struct THDTraceEvent {
+  const char* name;
+  const char* algorithm; // chosen by the data channel, empty if not reported
+  int group;
+  uint64_t start_us;
+  uint64_t duration_us;
+  uint64_t wait_us; // time spent waiting for data from other processes
+  uint64_t bytes;
+} THDTraceEvent;
+
+/*
+ * Aggregate of all traced calls of one operation. Bucket `i` of the
+ * histogram counts calls that took [2^(i-1), 2^i) microseconds.
+ */
+typedef struct THDTraceStats {
+  const char* name;
+  uint64_t count;
+  uint64_t bytes;
+  uint64_t total_us;
+  uint64_t wait_us;
+  uint64_t histogram[THD_TRACE_HISTOGRAM_BUCKETS];
+} THDTraceStats;
+
+THD_API void THDTraceEnable(int enabled);
+THD_API int THDTraceIsEnabled();
+THD_API void THDTraceClear();
+THD_API size_t THDTraceGetEvents(THDTraceEvent* events, size_t max_events);
+THD_API size_t THDTraceGetStats(THDTraceStats* stats, size_t max_stats);
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "Tracing.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace thd {
+
+/*
+ * Records timing of collectives and point-to-point operations. When tracing
+ * is disabled, the cost of a traced call is a single atomic load.
+ *
+ * Only the most recent events are kept, while per-operation statistics
+ * cover every call since the last `clear`.
+ */
+struct Tracer {
+  // Traces one operation from construction to destruction
+  struct Scope {
+    Scope(const char* name, std::uint64_t bytes, int group = 0);
+    ~Scope();
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+  private:
+    bool _active;
+    Scope* _parent;
+    THDTraceEvent _event;
+    std::chrono::steady_clock::time_point _start;
+    // waits of this operation and of the ones nested in it, worker threads
+    // add to it while the operation waits for them
+    std::atomic<std::uint64_t> _wait_us;
+
+    friend struct Tracer;
+  };
+
+  Tracer();
+
+  void enable(bool enabled);
+  bool isEnabled() const {
+    return _enabled.load(std::memory_order_relaxed);
+  }
+
+  // Reports the algorithm used by the operation traced in this thread, the
+  // outermost report wins when algorithms are nested
+  void setAlgorithm(const char* algorithm);
+  // Innermost operation traced in the calling thread, nullptr if none
+  static Scope* currentScope();
+  // Reports time spent waiting for other processes on behalf of `scope`
+  void addWaitTime(Scope* scope, std::chrono::steady_clock::duration duration);
+
+  void clear();
+  std::vector<THDTraceEvent> events() const;
+  std::vector<THDTraceStats> stats() const;
+
+private:
+  void _record(const THDTraceEvent& event);
+
+  std::atomic<bool> _enabled;
+
+  mutable std::mutex _mutex;
+  std::deque<THDTraceEvent> _events;
+  std::vector<THDTraceStats> _stats;
+  std::unordered_map<std::string, std::size_t> _stats_index;
+};
+
+extern Tracer tracer;
+
+/*
+ * Measures waiting for other processes, when tracing is enabled. The time
+ * goes to the operation traced in the calling thread, so a worker thread
+ * waiting on behalf of another one has to pass the scope of that thread.
+ */
+struct WaitTimer {
+  explicit WaitTimer(Tracer::Scope* scope = Tracer::currentScope())
+    : _scope(tracer.isEnabled() ? scope : nullptr)
+  {
+    if (_scope)
+      _start = std::chrono::steady_clock::now();
+  }
+
+  ~WaitTimer() {
+    if (_scope)
+      tracer.addWaitTime(_scope, std::chrono::steady_clock::now() - _start);
+  }
+
+private:
+  Tracer::Scope* _scope;
+  std::chrono::steady_clock::time_point _start;
+};
+
+} // namespace thd
@@ -7,6 +7,7 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <cstdlib>
 #include <cstring>
 #include <memory>
 #include <stdexcept>
@@ -48,6 +49,24 @@
 
 
 namespace thd {
+namespace {
+
+// Maximal number of algorithms cached for every group
+constexpr char CACHE_SIZE_ENV[] = "THD_GLOO_CACHE_SIZE";
+constexpr std::size_t DEFAULT_CACHE_SIZE = 64;
+
+std::size_t loadCacheSize() {
+  const char* value = std::getenv(CACHE_SIZE_ENV);
+  if (value == nullptr)
+    return DEFAULT_CACHE_SIZE;
+
+  long result = std::stol(value);
+  if (result < 2)
+    throw std::domain_error(std::string(CACHE_SIZE_ENV) + " has to be at least 2");
+  return result;
+}
+
+} // anonymous namespace
 
 DataChannelGloo::RequestGloo::RequestGloo(QueueWorker::Request&& request)
   : _request(std::move(request)) {
@@ -96,11 +115,13 @@ DataChannelGloo::DataChannelGloo(InitMethod::Config config)
 }
 
 
-DataChannelGloo::~DataChannelGloo() {}
+DataChannelGloo::~DataChannelGloo() {
+  _stopAsyncWorker();
+}
 
 
 bool DataChannelGloo::init() {
-  _cache = std::unique_ptr<GlooCache>(new GlooCache(_rank, _device));
+  _cache = std::unique_ptr<GlooCache>(new GlooCache(_rank, _device, loadCacheSize()));
 
   std::vector<rank_type> ranks;
   ranks.reserve(_num_processes);
@@ -135,10 +156,9 @@ void DataChannelGloo::allGatherT(std::vector<thpp::Tensor*>& output,
     }
   }
   std::uint64_t tensor_bytes = input.elementSize() * input.numel();
-  std::uint64_t all_tensor_bytes = tensor_bytes * output.size();
   auto ret = _cache->getAlgorithm<CollectiveType::ALL_GATHER, T>(
-    group_id, _groups.at(group_id), input_device, tensor_bytes, all_tensor_bytes, input.numel());
-
+    group_id, _groups.at(group_id), input_device, tensor_bytes);
+  std::size_t bucket_bytes = GlooCache::buffer_bytes(ret);
 
   {
     std::lock_guard<std::mutex> lock(*GlooCache::mutex(ret));
@@ -146,7 +166,7 @@ void DataChannelGloo::allGatherT(std::vector<thpp::Tensor*>& output,
     GlooCache::algorithm(ret)->run();
     for (std::size_t i = 0; i < output.size(); i++) {
       std::memcpy(output.at(i)->data(),
-                  GlooCache::output_buffer(ret).get() + (i * tensor_bytes),
+                  GlooCache::output_buffer(ret).get() + (i * bucket_bytes),
                   tensor_bytes);
     }
   }
@@ -188,7 +208,7 @@ void DataChannelGloo::allReduceT(thpp::Tensor& t, THDReduceOp operation,
                                  THDGroup group_id) {
   std::uint64_t tensor_bytes = t.elementSize() * t.numel();
   auto ret = _cache->getAlgorithm<CollectiveType::ALL_REDUCE, T>(
-    group_id, _groups.at(group_id), getDeviceType(t), tensor_bytes, t.numel(), operation);
+    group_id, _groups.at(group_id), getDeviceType(t), tensor_bytes, operation);
 
   {
     std::lock_guard<std::mutex> lock(*GlooCache::mutex(ret));
@@ -212,12 +232,52 @@ void DataChannelGloo::reduce(thpp::Tensor& data, THDReduceOp operation,
 }
 
 
+// XXX: Gloo has no reduce-scatter algorithm yet, so the whole input is
+// allreduced and only the slice belonging to this process is kept.
+void DataChannelGloo::reduceScatter(thpp::Tensor& output,
+                                    std::vector<thpp::Tensor*>& input,
+                                    THDReduceOp operation, THDGroup group_id) {
+  RETURN_IF_NOT_IN_GROUP
+
+  const auto& group = _groups.at(group_id);
+  if (input.size() != group.size())
+    throw std::logic_error("reduceScatter: number of input tensors and group size does not match");
+
+  for (auto in_tensor : input)
+    assertSameSizeAndType(*in_tensor, output, "reduceScatter");
+
+  long numel = output.numel();
+  std::unique_ptr<thpp::Tensor> flat(output.newTensor());
+  flat->resize({numel * static_cast<long>(input.size())});
+  for (std::size_t i = 0; i < input.size(); ++i) {
+    std::unique_ptr<thpp::Tensor> slice(flat->newNarrow(0, i * numel, numel));
+    std::unique_ptr<thpp::Tensor> in_view(input[i]->newView({numel}));
+    slice->copy(*in_view);
+  }
+
+  allReduce(*flat, operation, group_id);
+
+  std::unique_ptr<thpp::Tensor> own(
+      flat->newNarrow(0, group.mustGetGroupRank(_rank) * numel, numel));
+  std::unique_ptr<thpp::Tensor> out_view(output.newView({numel}));
+  out_view->copy(*own);
+}
+
+
+// XXX: `allToAll` is not supported by Gloo yet.
+void DataChannelGloo::allToAll(std::vector<thpp::Tensor*>& output,
+                               std::vector<thpp::Tensor*>& input,
+                               THDGroup group_id) {
+  throw std::runtime_error("DataChannelGloo does not support allToAll");
+}
+
+
 template<typename T>
 void DataChannelGloo::broadcastT(thpp::Tensor& data, rank_type src_rank,
                                  THDGroup group_id) {
   std::uint64_t tensor_bytes = data.elementSize() * data.numel();
   auto ret = _cache->getAlgorithm<CollectiveType::BROADCAST, T>(
-    group_id, _groups.at(group_id), getDeviceType(data), tensor_bytes, data.numel(),
+    group_id, _groups.at(group_id), getDeviceType(data), tensor_bytes,
     _groups.at(group_id).mustGetGroupRank(src_rank));
 
   {
@@ -289,6 +349,39 @@ void DataChannelGloo::barrier(THDGroup group_id) {
 }
 
 
+template<typename T>
+void DataChannelGloo::prewarmT(CollectiveType collective,
+                               const std::vector<std::size_t>& sizes,
+                               DeviceType device, THDReduceOp operation,
+                               rank_type src_rank, THDGroup group_id) {
+  const auto& group = _groups.at(group_id);
+  for (auto bytes : sizes) {
+    if (collective == CollectiveType::ALL_GATHER) {
+      _cache->getAlgorithm<CollectiveType::ALL_GATHER, T>(
+        group_id, group, device, bytes);
+    } else if (collective == CollectiveType::ALL_REDUCE) {
+      _cache->getAlgorithm<CollectiveType::ALL_REDUCE, T>(
+        group_id, group, device, bytes, operation);
+    } else if (collective == CollectiveType::BROADCAST) {
+      _cache->getAlgorithm<CollectiveType::BROADCAST, T>(
+        group_id, group, device, bytes, group.mustGetGroupRank(src_rank));
+    } else {
+      throw std::invalid_argument("DataChannelGloo can't prewarm this collective");
+    }
+  }
+}
+
+
+void DataChannelGloo::prewarm(CollectiveType collective, thpp::Type type,
+                              const std::vector<std::size_t>& sizes,
+                              DeviceType device, THDReduceOp operation,
+                              rank_type src_rank, THDGroup group_id) {
+  RETURN_IF_NOT_IN_GROUP
+  GENERATE_ALL_TYPES(type, prewarmT, collective, sizes, device, operation,
+                     src_rank, group_id)
+}
+
+
 THDGroup DataChannelGloo::newGroup(const std::vector<rank_type>& ranks) {
   auto new_group = DataChannelGloo::Group(_addr, _port, ranks, _num_processes - 1, Store::CLIENT_ONLY);
   THDGroup new_group_id = static_cast<THDGroup>(_groups.size());
@@ -297,5 +390,10 @@ THDGroup DataChannelGloo::newGroup(const std::vector<rank_type>& ranks) {
   return new_group_id;
 }
 
+
+const DataChannel::Group& DataChannelGloo::_getGroup(THDGroup group_id) {
+  return _groups.at(group_id);
+}
+
 } // namespace thd
 
@@ -55,6 +55,10 @@ struct DataChannelGloo : DataChannel {
                  THDGroup group_id = THDGroupWORLD) override;
   void reduce(thpp::Tensor& data, THDReduceOp operation, rank_type dst_rank,
               THDGroup group_id = THDGroupWORLD) override;
+  void reduceScatter(thpp::Tensor& output, std::vector<thpp::Tensor*>& input,
+                     THDReduceOp operation, THDGroup group_id = THDGroupWORLD) override;
+  void allToAll(std::vector<thpp::Tensor*>& output, std::vector<thpp::Tensor*>& input,
+                THDGroup group_id = THDGroupWORLD) override;
   void broadcast(thpp::Tensor& data, rank_type src_id,
                  THDGroup group_id = THDGroupWORLD) override;
   void send(Scalar& data, rank_type dst_id) override;
@@ -69,6 +73,22 @@ struct DataChannelGloo : DataChannel {
 
   THDGroup newGroup(const std::vector<rank_type>& ranks) override;
 
+  /*
+   * Creates algorithms of `collective` (all gather, all reduce or broadcast)
+   * for tensors of `sizes` bytes, so that their first calls don't have to
+   * connect the processes. It has to be called by all members of the group,
+   * with the same arguments. `operation` is used only by all reduce and
+   * `src_rank` only by broadcast.
+   */
+  void prewarm(CollectiveType collective, thpp::Type type,
+               const std::vector<std::size_t>& sizes,
+               DeviceType device = DeviceType::CPU,
+               THDReduceOp operation = THDReduceSUM, rank_type src_rank = 0,
+               THDGroup group_id = THDGroupWORLD);
+
+protected:
+  const DataChannel::Group& _getGroup(THDGroup group_id) override;
+
 private:
 
   template<typename T>
@@ -83,6 +103,11 @@ private:
   void broadcastT(thpp::Tensor& data, rank_type src_rank,
                   THDGroup group_id = THDGroupWORLD);
 
+  template<typename T>
+  void prewarmT(CollectiveType collective, const std::vector<std::size_t>& sizes,
+                DeviceType device, THDReduceOp operation, rank_type src_rank,
+                THDGroup group_id);
+
   rank_type _rank; // Current process' rank
   std::string _addr;
   port_type _port;
@@ -82,6 +82,8 @@ DataChannelMPI::DataChannelMPI()
 
 
 DataChannelMPI::~DataChannelMPI() {
+  _stopAsyncWorker();
+
   for (auto& group : _groups) {
     auto comm = group.second.first;
     if (comm != MPI_COMM_WORLD && comm != MPI_COMM_NULL)
@@ -272,6 +274,66 @@ void DataChannelMPI::reduce(thpp::Tensor& data, THDReduceOp operation,
 }
 
 
+void DataChannelMPI::reduceScatter(thpp::Tensor& output,
+                                   std::vector<thpp::Tensor*>& input,
+                                   THDReduceOp operation, THDGroup group_id) {
+  const auto& group_pair = _groups.at(group_id);
+  const auto& comm = group_pair.first;
+  if (comm == MPI_COMM_NULL)
+    return;
+
+  if (input.size() != group_pair.second.size())
+    throw std::logic_error("reduceScatter: number of input tensors and group size does not match");
+
+  for (auto in_tensor : input)
+    assertSameSizeAndType(*in_tensor, output, "reduceScatter");
+
+  std::uint64_t tensor_bytes = output.elementSize() * output.numel();
+  std::uint64_t all_tensors_bytes = tensor_bytes * input.size();
+  std::unique_ptr<std::uint8_t[]> tmp_data(new std::uint8_t[all_tensors_bytes]);
+  for (std::size_t i = 0; i < input.size(); ++i)
+    memcpy(tmp_data.get() + (i * tensor_bytes), input.at(i)->data(), tensor_bytes);
+
+  MPI_Reduce_scatter_block(tmp_data.get(), output.data(), output.numel(),
+                           mpi_datatype.at(output.type()), mpi_op.at(operation), comm);
+}
+
+
+void DataChannelMPI::allToAll(std::vector<thpp::Tensor*>& output,
+                              std::vector<thpp::Tensor*>& input,
+                              THDGroup group_id) {
+  const auto& group_pair = _groups.at(group_id);
+  const auto& comm = group_pair.first;
+  if (comm == MPI_COMM_NULL)
+    return;
+
+  if (input.size() != group_pair.second.size() || output.size() != input.size())
+    throw std::logic_error("allToAll: number of tensors and group size does not match");
+
+  for (std::size_t i = 0; i < input.size(); ++i) {
+    assertSameSizeAndType(*input[i], *input[0], "allToAll");
+    assertSameSizeAndType(*output[i], *input[0], "allToAll");
+  }
+
+  auto& like = *input[0];
+  std::uint64_t tensor_bytes = like.elementSize() * like.numel();
+  std::uint64_t all_tensors_bytes = tensor_bytes * input.size();
+  std::unique_ptr<std::uint8_t[]> send_data(new std::uint8_t[all_tensors_bytes]);
+  std::unique_ptr<std::uint8_t[]> recv_data(new std::uint8_t[all_tensors_bytes]);
+  for (std::size_t i = 0; i < input.size(); ++i)
+    memcpy(send_data.get() + (i * tensor_bytes), input.at(i)->data(), tensor_bytes);
+
+  MPI_Alltoall(
+    send_data.get(), like.numel(), mpi_datatype.at(like.type()),
+    recv_data.get(), like.numel(), mpi_datatype.at(like.type()),
+    comm
+  );
+
+  for (std::size_t i = 0; i < output.size(); ++i)
+    memcpy(output.at(i)->data(), recv_data.get() + (i * tensor_bytes), tensor_bytes);
+}
+
+
 void DataChannelMPI::_broadcastPack(thpp::Tensor& data, rank_type src_rank,
                                     MPI_Comm comm) const {
   std::uint64_t tensor_bytes = data.elementSize() * data.numel();
@@ -358,18 +420,20 @@ void DataChannelMPI::receive(thpp::Tensor& data) {
   if (!data.isContiguous())
     throw std::logic_error("tensor to receive is not contiguous");
 
+  // the data has to come from the sender of the size, not from any process
   std::uint64_t tensor_bytes;
+  MPI_Status status;
   MPI_Recv(&tensor_bytes, 1, MPI_UINT64_T, MPI_ANY_SOURCE, 0,
-           MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+           MPI_COMM_WORLD, &status);
 
   std::uint64_t actual_tensor_bytes = data.elementSize() * data.numel();
   if (actual_tensor_bytes == tensor_bytes) {
-    MPI_Recv(data.data(), tensor_bytes, MPI_UINT8_T, MPI_ANY_SOURCE, 0, MPI_COMM_WORLD,
+    MPI_Recv(data.data(), tensor_bytes, MPI_UINT8_T, status.MPI_SOURCE, 0, MPI_COMM_WORLD,
              MPI_STATUS_IGNORE);
   } else {
     // receive invalid data
     std::unique_ptr<std::uint8_t[]> bytes(new std::uint8_t[tensor_bytes]);
-    MPI_Recv(bytes.get(), tensor_bytes, MPI_UINT8_T, MPI_ANY_SOURCE, 0, MPI_COMM_WORLD,
+    MPI_Recv(bytes.get(), tensor_bytes, MPI_UINT8_T, status.MPI_SOURCE, 0, MPI_COMM_WORLD,
              MPI_STATUS_IGNORE);
     throw std::logic_error("tensor sizes does not match");
   }
@@ -505,4 +569,9 @@ THDGroup DataChannelMPI::newGroup(const std::vector<rank_type>& ranks) {
   return new_group_id;
 }
 
+
+const DataChannel::Group& DataChannelMPI::_getGroup(THDGroup group_id) {
+  return _groups.at(group_id).second;
+}
+
 } // namespace thd
@@ -47,6 +47,10 @@ struct DataChannelMPI : DataChannel {
                  THDGroup group_id = THDGroupWORLD) override;
   void reduce(thpp::Tensor& data, THDReduceOp operation, rank_type dst_rank,
               THDGroup group_id = THDGroupWORLD) override;
+  void reduceScatter(thpp::Tensor& output, std::vector<thpp::Tensor*>& input,
+                     THDReduceOp operation, THDGroup group_id = THDGroupWORLD) override;
+  void allToAll(std::vector<thpp::Tensor*>& output, std::vector<thpp::Tensor*>& input,
+                THDGroup group_id = THDGroupWORLD) override;
   void broadcast(thpp::Tensor& data, rank_type src_rank,
                  THDGroup group_id = THDGroupWORLD) override;
   void send(Scalar& data, rank_type dst_rank) override;
@@ -60,6 +64,9 @@ struct DataChannelMPI : DataChannel {
   void barrier(THDGroup group_id = THDGroupWORLD) override;
   THDGroup newGroup(const std::vector<rank_type>& ranks) override;
 
+protected:
+  const DataChannel::Group& _getGroup(THDGroup group_id) override;
+
 private:
   void _broadcastPack(thpp::Tensor& data, rank_type src_rank, MPI_Comm comm) const;
   void _broadcastUnpack(thpp::Tensor& data, rank_type src_rank, MPI_Comm comm) const;
@@ -0,0 +1,1118 @@
+#include "DataChannelSHM.hpp"
+#include "../Tracing.hpp"
+
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+
+
+namespace thd {
+namespace {
+
+// Capacity of every point-to-point ring in bytes (read by master only)
+constexpr char RING_SIZE_ENV[] = "THD_SHM_RING_SIZE";
+// Size of every slot used by collectives in bytes (read by master only)
+constexpr char SLOT_SIZE_ENV[] = "THD_SHM_SLOT_SIZE";
+
+constexpr long DEFAULT_RING_BYTES = 1 << 18;
+constexpr long DEFAULT_SLOT_BYTES = 1 << 20;
+constexpr long MIN_RING_BYTES = 1 << 12;
+constexpr long MIN_SLOT_BYTES = 1 << 12;
+
+// Rings and slots are aligned to this many bytes.
+constexpr std::size_t SHARED_ALIGNMENT = 64;
+
+// Number of times a condition is checked before a process goes to sleep,
+// if every process can have a CPU for itself
+constexpr int SPIN_COUNT = 4096;
+// Sleeping processes wake up this often to check if their peers are alive
+constexpr long LIVENESS_CHECK_SECONDS = 1;
+
+// Allreduces of more than two processes and at least this many bytes reduce
+// every chunk in two phases, so that each process reads only a part of
+// every slot
+constexpr std::uint64_t PARTITIONED_REDUCE_MIN_BYTES = 1 << 15;
+
+// Every channel of a process gets segments with different names
+std::atomic<std::uint64_t> segment_counter(0);
+
+inline std::size_t alignUp(std::size_t bytes, std::size_t alignment) {
+  return (bytes + alignment - 1) / alignment * alignment;
+}
+
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#endif
+}
+
+static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t),
+              "futex words have to be plain 32-bit integers");
+
+// Futexes are not private, because they are shared between processes
+int futex(std::atomic<std::uint32_t>& word, int operation, std::uint32_t value,
+          const struct timespec* timeout) {
+  return ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word),
+                   operation, value, timeout, nullptr, 0);
+}
+
+// Copies bytes [`offset`, `offset + length`) of tensor memory to `dst`
+void copyFromTensor(const TensorBlocks& blocks, std::uint64_t offset,
+                    std::uint64_t length, std::uint8_t* dst) {
+  forEachPiece(blocks, offset, length, [&dst](std::uint8_t* ptr, std::uint64_t bytes) {
+    std::memcpy(dst, ptr, bytes);
+    dst += bytes;
+  });
+}
+
+// Copies `length` bytes from `src` to bytes starting at `offset` of tensor memory
+void copyToTensor(const TensorBlocks& blocks, std::uint64_t offset,
+                  std::uint64_t length, const std::uint8_t* src) {
+  forEachPiece(blocks, offset, length, [&src](std::uint8_t* ptr, std::uint64_t bytes) {
+    std::memcpy(ptr, src, bytes);
+    src += bytes;
+  });
+}
+
+// Processes that have exited but weren't reaped yet count as dead
+bool isAlive(pid_t pid) {
+  if (::kill(pid, 0) == -1 && errno == ESRCH)
+    return false;
+
+  std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+  std::string line;
+  if (!std::getline(stat, line))
+    return true;
+
+  // the state follows the command name, which is in parentheses
+  auto position = line.rfind(')');
+  return position == std::string::npos || position + 2 >= line.size() ||
+    line[position + 2] != 'Z';
+}
+
+inline std::uint64_t tensorBytes(const thpp::Tensor& tensor) {
+  return tensor.elementSize() * tensor.numel();
+}
+
+} // namespace
+
+
+DataChannelSHM::RequestSHM::RequestSHM(QueueWorker::Request&& request)
+  : _request(std::move(request)) {
+}
+
+
+DataChannelSHM::RequestSHM::~RequestSHM() {}
+
+
+bool DataChannelSHM::RequestSHM::isCompleted() {
+  return _request.isCompleted();
+}
+
+
+void DataChannelSHM::RequestSHM::wait() {
+  _request.wait();
+}
+
+
+DataChannelSHM::DataChannelSHM(InitMethod::Config config)
+  : DataChannelSHM(config, -1)
+{}
+
+
+DataChannelSHM::DataChannelSHM(InitMethod::Config config, int timeout)
+  : _rank(config.rank)
+  , _num_processes(config.world_size)
+  , _timeout(timeout)
+  , _spin_count(0)
+  , _listen_socket(-1)
+  , _master_port(0)
+  , _ring_bytes(0)
+  , _slot_bytes(0)
+  , _segment_context(nullptr)
+  , _segment(nullptr)
+  , _process_info(nullptr)
+{
+  if (_rank == 0) { // MASTER
+    _listen_socket = config.master.listen_socket;
+    _ring_bytes = alignUp(loadEnv(RING_SIZE_ENV, DEFAULT_RING_BYTES, MIN_RING_BYTES),
+                          SHARED_ALIGNMENT);
+    _slot_bytes = alignUp(loadEnv(SLOT_SIZE_ENV, DEFAULT_SLOT_BYTES, MIN_SLOT_BYTES),
+                          SHARED_ALIGNMENT);
+  } else { // WORKER
+    _master_addr = config.worker.master_addr;
+    _master_port = config.worker.master_port;
+  }
+
+  // spinning processes would take CPU time from the ones they wait for
+  long cpus = ::sysconf(_SC_NPROCESSORS_ONLN);
+  if (cpus >= static_cast<long>(_num_processes))
+    _spin_count = SPIN_COUNT;
+}
+
+
+DataChannelSHM::~DataChannelSHM()
+{
+  _stopAsyncWorker();
+
+  if (_listen_socket != -1)
+    ::close(_listen_socket);
+
+  for (auto& entry : _groups) {
+    auto& area = entry.second;
+    if (area.segment_context)
+      THRefcountedMapAllocator.free(area.segment_context, area.segment);
+  }
+
+  if (_segment)
+    THRefcountedMapAllocator.free(_segment_context, _segment);
+}
+
+
+void DataChannelSHM::_initWorker() {
+  int socket = connect(_master_addr, _master_port);
+
+  send_value<rank_type>(socket, _rank, true);
+  send_string(socket, getHostname());
+
+  _segment_name = recv_string(socket);
+  _ring_bytes = recv_value<std::uint64_t>(socket);
+  _slot_bytes = recv_value<std::uint64_t>(socket);
+  _mapMainSegment(false);
+
+  // tell master that the segment is mapped and wait until everyone has done it
+  send_value<std::uint8_t>(socket, 1);
+  recv_value<std::uint8_t>(socket);
+  ::close(socket);
+}
+
+
+void DataChannelSHM::_initMaster() {
+  /*
+   * Sockets are used only to agree on the name of the main segment. Master
+   * creates it after checking that all processes run on the same host and
+   * releases them once all of them have mapped it, so from then on every
+   * process can find pids of all other processes in the segment.
+   */
+
+  std::vector<int> sockets(_num_processes, -1);
+  auto close_sockets = [&sockets]() {
+    for (int socket : sockets) {
+      if (socket != -1)
+        ::close(socket);
+    }
+  };
+
+  try {
+    auto hostname = getHostname();
+    for (rank_type i = 1; i < _num_processes; ++i) {
+      int p_socket;
+      std::tie(p_socket, std::ignore) = accept(_listen_socket, _timeout);
+
+      rank_type p_rank = recv_value<rank_type>(p_socket);
+      std::string p_hostname = recv_string(p_socket);
+
+      if (p_rank == 0 || p_rank >= _num_processes) {
+        ::close(p_socket);
+        throw std::out_of_range(
+          "worker's rank(" + std::to_string(p_rank) + ") is out"
+          "of range: [1, " + std::to_string(_num_processes - 1) + "]"
+        );
+      }
+
+      if (sockets[p_rank] != -1) {
+        ::close(p_socket);
+        throw std::logic_error(
+          "two processes reported a rank of " + std::to_string(p_rank)
+        );
+      }
+
+      sockets[p_rank] = p_socket;
+      if (p_hostname != hostname) {
+        throw std::logic_error(
+          "the shm backend requires all processes to run on one host, but "
+          "process with rank " + std::to_string(p_rank) + " runs on " +
+          p_hostname + " and master on " + hostname
+        );
+      }
+    }
+
+    _segment_name = "/thd_shm_" + std::to_string(::getpid()) + "_" +
+      std::to_string(segment_counter++);
+    _mapMainSegment(true);
+
+    for (rank_type rank = 1; rank < _num_processes; ++rank) {
+      send_string(sockets[rank], _segment_name, true);
+      send_value<std::uint64_t>(sockets[rank], _ring_bytes, true);
+      send_value<std::uint64_t>(sockets[rank], _slot_bytes);
+    }
+
+    for (rank_type rank = 1; rank < _num_processes; ++rank)
+      recv_value<std::uint8_t>(sockets[rank]);
+
+    for (rank_type rank = 1; rank < _num_processes; ++rank)
+      send_value<std::uint8_t>(sockets[rank], 1);
+  } catch (...) {
+    close_sockets();
+    throw;
+  }
+
+  close_sockets();
+
+  // close socket for listening, we will not use it anymore
+  ::close(_listen_socket);
+  _listen_socket = -1;
+}
+
+
+bool DataChannelSHM::init() {
+  if (_rank == 0) {
+    _initMaster();
+  } else {
+    _initWorker();
+  }
+
+  std::vector<rank_type> ranks;
+  ranks.reserve(_num_processes);
+  for (rank_type rank = 0; rank < _num_processes; ++rank)
+    ranks.push_back(rank);
+
+  // the world uses the area at the end of the main segment
+  GroupArea world {};
+  world.group = DataChannel::Group(ranks, _num_processes - 1);
+  world.group_rank = _rank;
+  world.is_member = true;
+  world.segment = _segment;
+  world.header = reinterpret_cast<GroupHeader*>(
+    _segment + _mainSegmentBytes() - _groupAreaBytes(_num_processes));
+  world.slots = reinterpret_cast<std::uint8_t*>(world.header + 1);
+
+  _groups.insert({THDGroupWORLD, world});
+  return true;
+}
+
+
+std::size_t DataChannelSHM::_mainSegmentBytes() const {
+  /*
+   * The main segment holds, in order: `ProcessInfo` of every process,
+   * headers of all rings, memory of all rings and the area of the world.
+   * The ring from process `i` to process `j` has index `i * size + j`.
+   */
+  std::size_t size = _num_processes;
+  return size * sizeof(ProcessInfo) + size * size * (sizeof(Ring) + _ring_bytes) +
+    _groupAreaBytes(size);
+}
+
+
+std::size_t DataChannelSHM::_groupAreaBytes(std::size_t group_size) const {
+  return sizeof(GroupHeader) + (2 * group_size + 2) * _slot_bytes;
+}
+
+
+void DataChannelSHM::_mapMainSegment(bool create) {
+  int flags = TH_ALLOCATOR_MAPPED_SHAREDMEM;
+  flags |= create ? TH_ALLOCATOR_MAPPED_EXCLUSIVE : TH_ALLOCATOR_MAPPED_NOCREATE;
+
+  // new segments are filled with zeros, which is a valid state of all headers
+  _segment_context = THMapAllocatorContext_new(_segment_name.c_str(), flags);
+  _segment = reinterpret_cast<std::uint8_t*>(
+    THRefcountedMapAllocator.malloc(_segment_context, _mainSegmentBytes()));
+
+  _process_info = reinterpret_cast<ProcessInfo*>(_segment);
+  _process_info[_rank].pid.store(::getpid());
+}
+
+
+void DataChannelSHM::_mapGroupSegment(GroupArea& area, THDGroup group_id,
+                                      bool create) {
+  auto name = _segment_name + "_g" + std::to_string(group_id);
+  int flags = TH_ALLOCATOR_MAPPED_SHAREDMEM;
+  flags |= create ? TH_ALLOCATOR_MAPPED_EXCLUSIVE : TH_ALLOCATOR_MAPPED_NOCREATE;
+
+  area.segment_context = THMapAllocatorContext_new(name.c_str(), flags);
+  area.segment = reinterpret_cast<std::uint8_t*>(
+    THRefcountedMapAllocator.malloc(area.segment_context,
+                                    _groupAreaBytes(area.group.size())));
+  area.header = reinterpret_cast<GroupHeader*>(area.segment);
+  area.slots = reinterpret_cast<std::uint8_t*>(area.header + 1);
+}
+
+
+std::size_t DataChannelSHM::_subSlotBytes(const GroupArea& area,
+                                          const thpp::Tensor& like) const {
+  // operations sending different data to every process split slots evenly
+  std::size_t bytes = _slot_bytes / area.group.size();
+  if (bytes >= SHARED_ALIGNMENT)
+    return bytes / SHARED_ALIGNMENT * SHARED_ALIGNMENT;
+
+  bytes = bytes / like.elementSize() * like.elementSize();
+  if (bytes == 0)
+    throw std::logic_error(std::string(SLOT_SIZE_ENV) + " is too small for a group of " +
+                           std::to_string(area.group.size()) + " processes");
+  return bytes;
+}
+
+
+void DataChannelSHM::_wait(Event& event, const std::function<bool ()>& ready) {
+  /*
+   * Waiting processes spin for a while, because the condition usually
+   * becomes true quickly, and then sleep on the futex. `seq` is read before
+   * the condition is checked, so if the condition changes afterwards, the
+   * futex call returns immediately.
+   */
+
+  for (int spin = 0; spin < _spin_count; ++spin) {
+    if (ready())
+      return;
+    cpuRelax();
+  }
+
+  WaitTimer wait_timer;
+  struct timespec timeout = {LIVENESS_CHECK_SECONDS, 0};
+  while (true) {
+    std::uint32_t seq = event.seq.load();
+    if (ready())
+      return;
+
+    event.waiters.fetch_add(1);
+    int result = futex(event.seq, FUTEX_WAIT, seq, &timeout);
+    int error = errno;
+    event.waiters.fetch_sub(1);
+
+    if (result == -1) {
+      if (error == ETIMEDOUT) {
+        _checkProcesses();
+      } else if (error != EAGAIN && error != EINTR) {
+        throw std::system_error(error, std::system_category());
+      }
+    }
+  }
+}
+
+
+void DataChannelSHM::_notify(Event& event) {
+  event.seq.fetch_add(1);
+  if (event.waiters.load() > 0)
+    futex(event.seq, FUTEX_WAKE, INT_MAX, nullptr);
+}
+
+
+void DataChannelSHM::_checkProcesses() {
+  for (rank_type rank = 0; rank < _num_processes; ++rank) {
+    pid_t pid = _process_info[rank].pid.load();
+    if (pid != 0 && !isAlive(pid)) {
+      throw std::runtime_error(
+        "process with rank " + std::to_string(rank) + " has terminated"
+      );
+    }
+  }
+}
+
+
+void DataChannelSHM::_barrier(GroupArea& area) {
+  // the last process to arrive starts the next generation of the barrier
+  auto& event = area.header->barrier;
+  std::uint32_t generation = event.seq.load();
+  if (area.header->arrived.fetch_add(1) + 1 == area.group.size()) {
+    area.header->arrived.store(0);
+    _notify(event);
+  } else {
+    _wait(event, [&event, generation]() { return event.seq.load() != generation; });
+  }
+}
+
+
+std::uint64_t DataChannelSHM::_nextBuffer(GroupArea& area) {
+  return area.round++ % 2;
+}
+
+
+/*
+ * Only the root of gather and scatter can check its arguments. It still takes
+ * part in the first round and leaves its verdict in the result slot, so all
+ * processes throw after the same number of rounds instead of the others
+ * waiting for rounds the root never starts.
+ */
+void DataChannelSHM::_checkRoot(GroupArea& area, std::uint64_t buffer, bool is_root,
+                                const std::string& error, const std::string& what) {
+  auto verdict = area.result(buffer, _slot_bytes);
+  if (is_root)
+    *verdict = error.empty();
+  _barrier(area);
+  if (!error.empty())
+    throw std::logic_error(error);
+  if (!*verdict)
+    throw std::logic_error(what + ": arguments were rejected by the root");
+}
+
+
+auto DataChannelSHM::_ring(rank_type src_rank, rank_type dst_rank) -> Ring& {
+  auto rings = reinterpret_cast<Ring*>(_segment + _num_processes * sizeof(ProcessInfo));
+  return rings[src_rank * _num_processes + dst_rank];
+}
+
+
+std::uint8_t* DataChannelSHM::_ringData(rank_type src_rank, rank_type dst_rank) {
+  std::size_t size = _num_processes;
+  return _segment + size * sizeof(ProcessInfo) + size * size * sizeof(Ring) +
+    (src_rank * size + dst_rank) * _ring_bytes;
+}
+
+
+void DataChannelSHM::_write(rank_type dst_rank, std::uint64_t bytes,
+                            const copy_fn& copy) {
+  auto& ring = _ring(_rank, dst_rank);
+  auto data = _ringData(_rank, dst_rank);
+  auto& outbox = _process_info[_rank].outbox;
+  auto& inbox = _process_info[dst_rank].inbox;
+
+  // only this process writes to the ring, so `written` can't change under us
+  std::uint64_t written = ring.written.load(std::memory_order_relaxed);
+  for (std::uint64_t done = 0; done < bytes;) {
+    std::uint64_t free_bytes = 0;
+    _wait(outbox, [&]() {
+      free_bytes = _ring_bytes - (written - ring.read.load(std::memory_order_acquire));
+      return free_bytes > 0;
+    });
+
+    std::uint64_t position = written % _ring_bytes;
+    std::uint64_t length = std::min({free_bytes, bytes - done, _ring_bytes - position});
+    copy(data + position, done, length);
+
+    done += length;
+    written += length;
+    ring.written.store(written, std::memory_order_release);
+    _notify(inbox);
+  }
+}
+
+
+void DataChannelSHM::_read(rank_type src_rank, std::uint64_t bytes,
+                           const copy_fn& copy) {
+  auto& ring = _ring(src_rank, _rank);
+  auto data = _ringData(src_rank, _rank);
+  auto& inbox = _process_info[_rank].inbox;
+  auto& outbox = _process_info[src_rank].outbox;
+
+  std::uint64_t read = ring.read.load(std::memory_order_relaxed);
+  for (std::uint64_t done = 0; done < bytes;) {
+    std::uint64_t ready_bytes = 0;
+    _wait(inbox, [&]() {
+      ready_bytes = ring.written.load(std::memory_order_acquire) - read;
+      return ready_bytes > 0;
+    });
+
+    std::uint64_t position = read % _ring_bytes;
+    std::uint64_t length = std::min({ready_bytes, bytes - done, _ring_bytes - position});
+    copy(data + position, done, length);
+
+    done += length;
+    read += length;
+    ring.read.store(read, std::memory_order_release);
+    _notify(outbox);
+  }
+}
+
+
+void DataChannelSHM::_sendMessage(rank_type dst_rank, std::uint64_t bytes,
+                                  const copy_fn& copy) {
+  // every message is preceded by its size in bytes
+  _write(dst_rank, sizeof(bytes),
+    [&bytes](std::uint8_t* ring, std::uint64_t offset, std::uint64_t length) {
+      std::memcpy(ring, reinterpret_cast<std::uint8_t*>(&bytes) + offset, length);
+    }
+  );
+  _write(dst_rank, bytes, copy);
+}
+
+
+void DataChannelSHM::_receiveMessage(rank_type src_rank, std::uint64_t bytes,
+                                     const copy_fn& copy, const std::string& what) {
+  std::uint64_t message_bytes;
+  _read(src_rank, sizeof(message_bytes),
+    [&message_bytes](std::uint8_t* ring, std::uint64_t offset, std::uint64_t length) {
+      std::memcpy(reinterpret_cast<std::uint8_t*>(&message_bytes) + offset, ring, length);
+    }
+  );
+
+  if (message_bytes != bytes) {
+    // remove invalid data from the ring
+    _read(src_rank, message_bytes, [](std::uint8_t*, std::uint64_t, std::uint64_t) {});
+    throw std::logic_error(what + " sizes do not match");
+  }
+
+  _read(src_rank, bytes, copy);
+}
+
+
+void DataChannelSHM::_checkPeer(rank_type rank, const std::string& message) {
+  if (rank >= _num_processes) {
+    throw std::out_of_range(
+      "rank(" + std::to_string(rank) + ") is out of range: [0, " +
+      std::to_string(_num_processes - 1) + "]"
+    );
+  }
+
+  if (rank == _rank)
+    throw std::logic_error(message);
+}
+
+
+rank_type DataChannelSHM::getRank() {
+  return _rank;
+}
+
+
+rank_type DataChannelSHM::getNumProcesses() {
+  return _num_processes;
+}
+
+
+void DataChannelSHM::allGather(std::vector<thpp::Tensor*>& output,
+                               thpp::Tensor& input, THDGroup group_id) {
+  /*
+   * All collectives pass tensors through slots of the group area in chunks
+   * of at most `_slot_bytes`. Every process copies its chunk to its own
+   * slot, waits on the group barrier and then copies out what it needs, so
+   * each byte is copied once by its owner and once by every reader.
+   */
+
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  auto& area = _groups.at(group_id);
+  if (!area.is_member)
+    return;
+
+  if (output.size() != area.group.size())
+    throw std::logic_error("allGather: number of output tensors and group size does not match");
+
+  for (auto out_tensor : output)
+    assertSameSizeAndType(*out_tensor, input, "allGather");
+
+  TensorBlocks input_blocks(input);
+  std::vector<TensorBlocks> output_blocks;
+  for (auto out_tensor : output)
+    output_blocks.emplace_back(*out_tensor);
+
+  std::uint64_t tensor_bytes = tensorBytes(input);
+  for (std::uint64_t offset = 0; offset < tensor_bytes; offset += _slot_bytes) {
+    std::uint64_t length = std::min<std::uint64_t>(_slot_bytes, tensor_bytes - offset);
+    auto buffer = _nextBuffer(area);
+
+    copyFromTensor(input_blocks, offset, length,
+                   area.slot(buffer, area.group_rank, _slot_bytes));
+    _barrier(area);
+    for (rank_type i = 0; i < area.group.size(); ++i)
+      copyToTensor(output_blocks[i], offset, length, area.slot(buffer, i, _slot_bytes));
+  }
+}
+
+
+void DataChannelSHM::gather(std::vector<thpp::Tensor*>& output,
+                            thpp::Tensor& input, rank_type dst_rank,
+                            THDGroup group_id) {
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  auto& area = _groups.at(group_id);
+  if (!area.is_member)
+    return;
+
+  // assert if dst_rank exists in group
+  auto group_dst_rank = area.group.mustGetGroupRank(dst_rank);
+  bool is_root = (area.group_rank == group_dst_rank);
+  std::vector<TensorBlocks> output_blocks;
+  std::string error;
+  if (is_root) {
+    try {
+      if (output.size() != area.group.size())
+        throw std::logic_error("gather: number of output tensors and group size does not match");
+
+      for (auto out_tensor : output) {
+        assertSameSizeAndType(*out_tensor, input, "gather");
+        output_blocks.emplace_back(*out_tensor);
+      }
+    } catch (const std::logic_error& e) {
+      error = e.what();
+    }
+  }
+
+  TensorBlocks input_blocks(input);
+  std::uint64_t tensor_bytes = tensorBytes(input);
+  for (std::uint64_t offset = 0; offset < tensor_bytes; offset += _slot_bytes) {
+    std::uint64_t length = std::min<std::uint64_t>(_slot_bytes, tensor_bytes - offset);
+    auto buffer = _nextBuffer(area);
+
+    copyFromTensor(input_blocks, offset, length,
+                   area.slot(buffer, area.group_rank, _slot_bytes));
+    if (offset == 0)
+      _checkRoot(area, buffer, is_root, error, "gather");
+    else
+      _barrier(area);
+    if (is_root) {
+      for (rank_type i = 0; i < area.group.size(); ++i)
+        copyToTensor(output_blocks[i], offset, length, area.slot(buffer, i, _slot_bytes));
+    }
+  }
+
+  // empty tensors take no rounds, so the root has nobody to tell
+  if (!error.empty())
+    throw std::logic_error(error);
+}
+
+
+void DataChannelSHM::scatter(std::vector<thpp::Tensor*>& input,
+                             thpp::Tensor& output, rank_type src_rank,
+                             THDGroup group_id) {
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  auto& area = _groups.at(group_id);
+  if (!area.is_member)
+    return;
+
+  // assert if src_rank exists in group
+  auto group_src_rank = area.group.mustGetGroupRank(src_rank);
+  bool is_root = (area.group_rank == group_src_rank);
+  std::vector<TensorBlocks> input_blocks;
+  std::string error;
+  if (is_root) {
+    try {
+      if (input.size() != area.group.size())
+        throw std::logic_error("scatter: number of input tensors and group size does not match");
+
+      for (auto in_tensor : input) {
+        assertSameSizeAndType(*in_tensor, output, "scatter");
+        input_blocks.emplace_back(*in_tensor);
+      }
+    } catch (const std::logic_error& e) {
+      error = e.what();
+    }
+  }
+
+  TensorBlocks output_blocks(output);
+  std::uint64_t tensor_bytes = tensorBytes(output);
+  for (std::uint64_t offset = 0; offset < tensor_bytes; offset += _slot_bytes) {
+    std::uint64_t length = std::min<std::uint64_t>(_slot_bytes, tensor_bytes - offset);
+    auto buffer = _nextBuffer(area);
+
+    if (is_root && error.empty()) {
+      for (rank_type i = 0; i < area.group.size(); ++i)
+        copyFromTensor(input_blocks[i], offset, length, area.slot(buffer, i, _slot_bytes));
+    }
+    if (offset == 0)
+      _checkRoot(area, buffer, is_root, error, "scatter");
+    else
+      _barrier(area);
+    copyToTensor(output_blocks, offset, length,
+                 area.slot(buffer, area.group_rank, _slot_bytes));
+  }
+
+  // empty tensors take no rounds, so the root has nobody to tell
+  if (!error.empty())
+    throw std::logic_error(error);
+}
+
+
+void DataChannelSHM::allReduce(thpp::Tensor& data, THDReduceOp operation,
+                               THDGroup group_id) {
+  /*
+   * Small tensors are reduced by every process straight from all slots into
+   * the tensor. For larger ones that would make every process read the data
+   * of the whole group, so instead each process reduces a part of the chunk
+   * into the result slot and all of them copy the result out after another
+   * barrier.
+   *
+   * Slots are always reduced in the order of group ranks, so every process
+   * ends up with exactly the same result.
+   */
+
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  auto& area = _groups.at(group_id);
+  if (!area.is_member)
+    return;
+
+  // reductions work on flat memory, so strided tensors are reduced in a
+  // contiguous copy
+  std::unique_ptr<thpp::Tensor> contiguous;
+  if (!data.isContiguous())
+    contiguous.reset(data.clone());
+  auto& input = contiguous ? *contiguous : data;
+
+  rank_type size = area.group.size();
+  auto tensor_data = static_cast<std::uint8_t*>(input.data());
+  std::uint64_t tensor_bytes = tensorBytes(input);
+  bool direct = size <= 2 || tensor_bytes < PARTITIONED_REDUCE_MIN_BYTES;
+  tracer.setAlgorithm(direct ? "direct" : "partitioned");
+
+  // parts reduced by different processes don't share cache lines
+  long part_alignment = std::max<long>(1, SHARED_ALIGNMENT / input.elementSize());
+  for (std::uint64_t offset = 0; offset < tensor_bytes; offset += _slot_bytes) {
+    std::uint64_t length = std::min<std::uint64_t>(_slot_bytes, tensor_bytes - offset);
+    long numel = length / input.elementSize();
+    auto buffer = _nextBuffer(area);
+    auto slots = area.slot(buffer, 0, _slot_bytes);
+
+    std::memcpy(area.slot(buffer, area.group_rank, _slot_bytes),
+                tensor_data + offset, length);
+    _barrier(area);
+
+    if (direct) {
+      reduceSlots(input.type(), tensor_data + offset, slots, _slot_bytes,
+                  size, 0, numel, operation);
+    } else {
+      auto result = area.result(buffer, _slot_bytes);
+      long part = alignUp((numel + size - 1) / size, part_alignment);
+      long begin = std::min<long>(numel, part * area.group_rank);
+      long end = std::min<long>(numel, begin + part);
+      reduceSlots(input.type(), result, slots, _slot_bytes, size, begin, end,
+                  operation);
+      _barrier(area);
+      std::memcpy(tensor_data + offset, result, length);
+    }
+  }
+
+  if (contiguous)
+    data.copy(*contiguous);
+}
+
+
+void DataChannelSHM::reduce(thpp::Tensor& data, THDReduceOp operation,
+                            rank_type dst_rank, THDGroup group_id) {
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  auto& area = _groups.at(group_id);
+  if (!area.is_member)
+    return;
+
+  auto group_dst_rank = area.group.mustGetGroupRank(dst_rank);
+  bool is_root = (area.group_rank == group_dst_rank);
+
+  std::unique_ptr<thpp::Tensor> contiguous;
+  if (is_root && !data.isContiguous())
+    contiguous.reset(data.clone());
+  auto& input = contiguous ? *contiguous : data;
+
+  TensorBlocks input_blocks(input);
+  auto tensor_data = static_cast<std::uint8_t*>(input.data());
+  std::uint64_t tensor_bytes = tensorBytes(input);
+  for (std::uint64_t offset = 0; offset < tensor_bytes; offset += _slot_bytes) {
+    std::uint64_t length = std::min<std::uint64_t>(_slot_bytes, tensor_bytes - offset);
+    auto buffer = _nextBuffer(area);
+
+    copyFromTensor(input_blocks, offset, length,
+                   area.slot(buffer, area.group_rank, _slot_bytes));
+    _barrier(area);
+    if (is_root) {
+      reduceSlots(input.type(), tensor_data + offset, area.slot(buffer, 0, _slot_bytes),
+                  _slot_bytes, area.group.size(), 0, length / input.elementSize(),
+                  operation);
+    }
+  }
+
+  if (contiguous)
+    data.copy(*contiguous);
+}
+
+
+void DataChannelSHM::reduceScatter(thpp::Tensor& output,
+                                   std::vector<thpp::Tensor*>& input,
+                                   THDReduceOp operation, THDGroup group_id) {
+  /*
+   * Every slot is split into one part per process. A process copies the
+   * chunk of `input[i]` to part `i` of its slot, so after the barrier
+   * process `i` reduces part `i` of all slots into its output.
+   */
+
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  auto& area = _groups.at(group_id);
+  if (!area.is_member)
+    return;
+
+  rank_type size = area.group.size();
+  if (input.size() != size)
+    throw std::logic_error("reduceScatter: number of input tensors and group size does not match");
+
+  std::vector<TensorBlocks> input_blocks;
+  for (auto in_tensor : input) {
+    assertSameSizeAndType(*in_tensor, output, "reduceScatter");
+    input_blocks.emplace_back(*in_tensor);
+  }
+
+  std::unique_ptr<thpp::Tensor> contiguous;
+  if (!output.isContiguous())
+    contiguous.reset(output.clone());
+  auto& result = contiguous ? *contiguous : output;
+
+  auto result_data = static_cast<std::uint8_t*>(result.data());
+  std::uint64_t tensor_bytes = tensorBytes(output);
+  std::uint64_t part_bytes = _subSlotBytes(area, output);
+  for (std::uint64_t offset = 0; offset < tensor_bytes; offset += part_bytes) {
+    std::uint64_t length = std::min<std::uint64_t>(part_bytes, tensor_bytes - offset);
+    auto buffer = _nextBuffer(area);
+    auto slot = area.slot(buffer, area.group_rank, _slot_bytes);
+
+    for (rank_type i = 0; i < size; ++i)
+      copyFromTensor(input_blocks[i], offset, length, slot + i * part_bytes);
+    _barrier(area);
+    reduceSlots(output.type(), result_data + offset,
+                area.slot(buffer, 0, _slot_bytes) + area.group_rank * part_bytes,
+                _slot_bytes, size, 0, length / output.elementSize(), operation);
+  }
+
+  if (contiguous)
+    output.copy(*contiguous);
+}
+
+
+void DataChannelSHM::allToAll(std::vector<thpp::Tensor*>& output,
+                              std::vector<thpp::Tensor*>& input,
+                              THDGroup group_id) {
+  /*
+   * Slots are split into parts like in `reduceScatter`: part `i` of the
+   * slot of process `j` carries the chunk of `input[i]` of process `j`,
+   * which becomes the chunk of `output[j]` of process `i`.
+   */
+
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  auto& area = _groups.at(group_id);
+  if (!area.is_member)
+    return;
+
+  rank_type size = area.group.size();
+  if (input.size() != size || output.size() != size)
+    throw std::logic_error("allToAll: number of tensors and group size does not match");
+
+  std::vector<TensorBlocks> input_blocks, output_blocks;
+  for (std::size_t i = 0; i < size; ++i) {
+    assertSameSizeAndType(*input[i], *input[0], "allToAll");
+    assertSameSizeAndType(*output[i], *input[0], "allToAll");
+    input_blocks.emplace_back(*input[i]);
+    output_blocks.emplace_back(*output[i]);
+  }
+
+  std::uint64_t tensor_bytes = tensorBytes(*input[0]);
+  std::uint64_t part_bytes = _subSlotBytes(area, *input[0]);
+  for (std::uint64_t offset = 0; offset < tensor_bytes; offset += part_bytes) {
+    std::uint64_t length = std::min<std::uint64_t>(part_bytes, tensor_bytes - offset);
+    auto buffer = _nextBuffer(area);
+    auto slot = area.slot(buffer, area.group_rank, _slot_bytes);
+
+    for (rank_type i = 0; i < size; ++i)
+      copyFromTensor(input_blocks[i], offset, length, slot + i * part_bytes);
+    _barrier(area);
+    for (rank_type j = 0; j < size; ++j) {
+      copyToTensor(output_blocks[j], offset, length,
+                   area.slot(buffer, j, _slot_bytes) + area.group_rank * part_bytes);
+    }
+  }
+}
+
+
+void DataChannelSHM::broadcast(thpp::Tensor& data, rank_type src_rank,
+                               THDGroup group_id) {
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  auto& area = _groups.at(group_id);
+  if (!area.is_member)
+    return;
+
+  auto group_src_rank = area.group.mustGetGroupRank(src_rank);
+  bool is_root = (area.group_rank == group_src_rank);
+
+  TensorBlocks blocks(data);
+  std::uint64_t tensor_bytes = tensorBytes(data);
+  for (std::uint64_t offset = 0; offset < tensor_bytes; offset += _slot_bytes) {
+    std::uint64_t length = std::min<std::uint64_t>(_slot_bytes, tensor_bytes - offset);
+    auto slot = area.slot(_nextBuffer(area), 0, _slot_bytes);
+
+    if (is_root)
+      copyFromTensor(blocks, offset, length, slot);
+    _barrier(area);
+    if (!is_root)
+      copyToTensor(blocks, offset, length, slot);
+  }
+}
+
+
+void DataChannelSHM::send(Scalar& data, rank_type dst_rank) {
+  auto request = _send_worker.push([this, &data, dst_rank]{
+    this->_send(data, dst_rank);
+  });
+  request.wait();
+}
+
+
+void DataChannelSHM::send(thpp::Tensor& data, rank_type dst_rank) {
+  auto request = _send_worker.push([this, &data, dst_rank]{
+    this->_send(data, dst_rank);
+  });
+  request.wait();
+}
+
+
+void DataChannelSHM::receive(Scalar& data, rank_type src_rank) {
+  auto request = _receive_worker.push([this, &data, src_rank]{
+    this->_receive(data, src_rank);
+  });
+  request.wait();
+}
+
+
+void DataChannelSHM::receive(thpp::Tensor& data) {
+  auto request = _receive_worker.push([this, &data]{
+    // take the message from the first process that has started sending one
+    rank_type src_rank = 0;
+    this->_wait(this->_process_info[this->_rank].inbox, [this, &src_rank]() {
+      for (rank_type rank = 0; rank < this->_num_processes; ++rank) {
+        if (rank == this->_rank)
+          continue;
+
+        auto& ring = this->_ring(rank, this->_rank);
+        if (ring.written.load(std::memory_order_acquire) !=
+            ring.read.load(std::memory_order_relaxed)) {
+          src_rank = rank;
+          return true;
+        }
+      }
+      return false;
+    });
+
+    this->_receive(data, src_rank);
+  });
+
+  request.wait();
+}
+
+
+void DataChannelSHM::receive(thpp::Tensor& data, rank_type src_rank) {
+  auto request = _receive_worker.push([this, &data, src_rank]{
+    this->_receive(data, src_rank);
+  });
+  request.wait();
+}
+
+
+DataChannelSHM::RequestSHM* DataChannelSHM::isend(thpp::Tensor& data,
+                                                  rank_type dst_rank) {
+  std::shared_ptr<thpp::Tensor> copy_tensor(data.clone_shallow());
+  auto request = _send_worker.push([this, copy_tensor, dst_rank]{
+    this->_send(*copy_tensor, dst_rank);
+  });
+  return new DataChannelSHM::RequestSHM(std::move(request));
+}
+
+
+DataChannelSHM::RequestSHM* DataChannelSHM::ireceive(thpp::Tensor& data,
+                                                     rank_type src_rank) {
+  std::shared_ptr<thpp::Tensor> copy_tensor(data.clone_shallow());
+  auto request = _receive_worker.push([this, copy_tensor, src_rank]{
+    this->_receive(*copy_tensor, src_rank);
+  });
+  return new DataChannelSHM::RequestSHM(std::move(request));
+}
+
+
+void DataChannelSHM::barrier(THDGroup group_id) {
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  auto& area = _groups.at(group_id);
+  if (!area.is_member)
+    return;
+
+  _barrier(area);
+}
+
+
+THDGroup DataChannelSHM::newGroup(const std::vector<rank_type>& ranks) {
+  /*
+   * Every group has its own segment created by its first process, so all
+   * processes have to create groups in the same order. The world barrier
+   * makes sure that the segment exists before other members open it.
+   */
+
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  GroupArea area {};
+  area.group = DataChannel::Group(ranks, _num_processes - 1);
+  std::tie(area.group_rank, area.is_member) = area.group.getGroupRank(_rank);
+  THDGroup new_group_id = static_cast<THDGroup>(_groups.size());
+
+  if (area.is_member && area.group_rank == 0)
+    _mapGroupSegment(area, new_group_id, true);
+  _barrier(_groups.at(THDGroupWORLD));
+  if (area.is_member && area.group_rank != 0)
+    _mapGroupSegment(area, new_group_id, false);
+
+  _groups.insert({new_group_id, area});
+  return new_group_id;
+}
+
+
+const DataChannel::Group& DataChannelSHM::_getGroup(THDGroup group_id) {
+  return _groups.at(group_id).group;
+}
+
+
+void DataChannelSHM::_send(const Scalar& data, rank_type dst_rank) {
+  _checkPeer(dst_rank, "cannot send scalar to process with same rank");
+
+  auto bytes = reinterpret_cast<const std::uint8_t*>(data.data());
+  _sendMessage(dst_rank, data.elementSize(),
+    [bytes](std::uint8_t* ring, std::uint64_t offset, std::uint64_t length) {
+      std::memcpy(ring, bytes + offset, length);
+    }
+  );
+}
+
+
+void DataChannelSHM::_send(thpp::Tensor& data, rank_type dst_rank) {
+  _checkPeer(dst_rank, "cannot send tensor to process with same rank");
+
+  // strided tensors are copied straight from their memory
+  TensorBlocks blocks(data);
+  _sendMessage(dst_rank, tensorBytes(data),
+    [&blocks](std::uint8_t* ring, std::uint64_t offset, std::uint64_t length) {
+      copyFromTensor(blocks, offset, length, ring);
+    }
+  );
+}
+
+
+void DataChannelSHM::_receive(Scalar& data, rank_type src_rank) {
+  _checkPeer(src_rank, "cannot receive scalar from process with same rank");
+
+  auto bytes = reinterpret_cast<std::uint8_t*>(data.data());
+  _receiveMessage(src_rank, data.elementSize(),
+    [bytes](std::uint8_t* ring, std::uint64_t offset, std::uint64_t length) {
+      std::memcpy(bytes + offset, ring, length);
+    },
+    "scalar"
+  );
+}
+
+
+void DataChannelSHM::_receive(thpp::Tensor& data, rank_type src_rank) {
+  _checkPeer(src_rank, "cannot receive tensor from process with same rank");
+
+  // strided tensors are copied straight into their memory
+  TensorBlocks blocks(data);
+  _receiveMessage(src_rank, tensorBytes(data),
+    [&blocks](std::uint8_t* ring, std::uint64_t offset, std::uint64_t length) {
+      copyToTensor(blocks, offset, length, ring);
+    },
+    "tensor"
+  );
+}
+
+} // namespace thd
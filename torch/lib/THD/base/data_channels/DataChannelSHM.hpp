@@ -0,0 +1,196 @@
+#pragma once
+
+#include "../DataChannel.hpp"
+#include "DataChannelUtils.hpp"
+
+#include <TH/THAllocator.h>
+
+#include <sys/types.h>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace thd {
+
+/*
+ * Data channel for processes running on a single host. All data goes through
+ * shared memory segments in /dev/shm and processes wait for each other on
+ * futexes, so no operation touches the network stack.
+ *
+ * Every ordered pair of processes has a ring buffer for point-to-point
+ * messages. Collectives of every group use slots of a segment shared by
+ * the group members: each process copies its data to its slot once and
+ * the others read (or reduce) it straight from there.
+ */
+struct DataChannelSHM : DataChannel {
+
+  struct RequestSHM : DataChannel::Request {
+    RequestSHM(QueueWorker::Request&& request);
+    virtual ~RequestSHM();
+
+    virtual bool isCompleted() override;
+    virtual void wait() override;
+
+  private:
+    QueueWorker::Request _request;
+  };
+
+  DataChannelSHM(InitMethod::Config config);
+  DataChannelSHM(InitMethod::Config config, int timeout);
+  virtual ~DataChannelSHM();
+
+  bool init() override;
+
+  rank_type getRank() override;
+  rank_type getNumProcesses() override;
+
+  void allGather(std::vector<thpp::Tensor*>& output, thpp::Tensor& input,
+                 THDGroup group_id = THDGroupWORLD) override;
+  void gather(std::vector<thpp::Tensor*>& output, thpp::Tensor& input,
+              rank_type dst_rank, THDGroup group_id = THDGroupWORLD) override;
+  void scatter(std::vector<thpp::Tensor*>& input, thpp::Tensor& output,
+               rank_type src_rank, THDGroup group_id = THDGroupWORLD) override;
+  void allReduce(thpp::Tensor& data, THDReduceOp operation,
+                 THDGroup group_id = THDGroupWORLD) override;
+  void reduce(thpp::Tensor& data, THDReduceOp operation, rank_type dst_rank,
+              THDGroup group_id = THDGroupWORLD) override;
+  void reduceScatter(thpp::Tensor& output, std::vector<thpp::Tensor*>& input,
+                     THDReduceOp operation, THDGroup group_id = THDGroupWORLD) override;
+  void allToAll(std::vector<thpp::Tensor*>& output, std::vector<thpp::Tensor*>& input,
+                THDGroup group_id = THDGroupWORLD) override;
+  void broadcast(thpp::Tensor& data, rank_type src_id,
+                 THDGroup group_id = THDGroupWORLD) override;
+  void send(Scalar& data, rank_type dst_id) override;
+  void send(thpp::Tensor& data, rank_type dst_id) override;
+  void receive(Scalar& data, rank_type src_id) override;
+  void receive(thpp::Tensor& data) override;
+  void receive(thpp::Tensor& data, rank_type src_id) override;
+  RequestSHM* isend(thpp::Tensor& data, rank_type dst_rank) override;
+  RequestSHM* ireceive(thpp::Tensor& data, rank_type src_rank) override;
+
+  void barrier(THDGroup group_id = THDGroupWORLD) override;
+
+  THDGroup newGroup(const std::vector<rank_type>& ranks) override;
+
+protected:
+  const DataChannel::Group& _getGroup(THDGroup group_id) override;
+
+private:
+  /*
+   * A futex word with a count of processes sleeping on it. `seq` changes
+   * every time the event is signalled.
+   */
+  struct alignas(64) Event {
+    std::atomic<std::uint32_t> seq;
+    std::atomic<std::uint32_t> waiters;
+  };
+
+  // Shared state of a process, placed at the beginning of the main segment
+  struct alignas(64) ProcessInfo {
+    std::atomic<pid_t> pid;
+    Event inbox;  // signalled when a message is written to any of its rings
+    Event outbox; // signalled when a message is read from any of its rings
+  };
+
+  // Header of a single-producer single-consumer ring of `_ring_bytes` bytes
+  struct alignas(64) Ring {
+    alignas(64) std::atomic<std::uint64_t> written; // total bytes written
+    alignas(64) std::atomic<std::uint64_t> read;    // total bytes read
+  };
+
+  // Header of the collective area of a group, followed by the slots
+  struct alignas(64) GroupHeader {
+    Event barrier; // `seq` is the number of completed barriers
+    alignas(64) std::atomic<std::uint32_t> arrived;
+  };
+
+  /*
+   * Slots of a group are double buffered: `2 * size` slots of `_slot_bytes`
+   * for data and 2 result slots. Collectives copy data in, synchronize and
+   * copy data out, and they alternate the buffers between such rounds, so
+   * a single barrier per round is enough to keep a buffer from being
+   * overwritten while other processes are still reading it.
+   */
+  struct GroupArea {
+    DataChannel::Group group;
+    rank_type group_rank;
+    bool is_member;
+    THMapAllocatorContext* segment_context; // nullptr for the main segment
+    std::uint8_t* segment;
+    GroupHeader* header;
+    std::uint8_t* slots;
+    std::uint64_t round; // number of rounds done, the same in all members
+
+    std::uint8_t* slot(std::uint64_t buffer, rank_type index, std::size_t slot_bytes) const {
+      return slots + (buffer * group.size() + index) * slot_bytes;
+    }
+
+    std::uint8_t* result(std::uint64_t buffer, std::size_t slot_bytes) const {
+      return slots + (2 * group.size() + buffer) * slot_bytes;
+    }
+  };
+
+  // Copies `length` bytes at `offset` of a message to or from ring memory
+  using copy_fn = std::function<void (std::uint8_t*, std::uint64_t, std::uint64_t)>;
+
+  void _initMaster();
+  void _initWorker();
+  std::size_t _mainSegmentBytes() const;
+  std::size_t _groupAreaBytes(std::size_t group_size) const;
+  void _mapMainSegment(bool create);
+  void _mapGroupSegment(GroupArea& area, THDGroup group_id, bool create);
+  std::size_t _subSlotBytes(const GroupArea& area, const thpp::Tensor& like) const;
+
+  void _wait(Event& event, const std::function<bool ()>& ready);
+  void _notify(Event& event);
+  void _checkProcesses();
+  void _barrier(GroupArea& area);
+  std::uint64_t _nextBuffer(GroupArea& area);
+  void _checkRoot(GroupArea& area, std::uint64_t buffer, bool is_root,
+                  const std::string& error, const std::string& what);
+
+  Ring& _ring(rank_type src_rank, rank_type dst_rank);
+  std::uint8_t* _ringData(rank_type src_rank, rank_type dst_rank);
+  void _write(rank_type dst_rank, std::uint64_t bytes, const copy_fn& copy);
+  void _read(rank_type src_rank, std::uint64_t bytes, const copy_fn& copy);
+  void _sendMessage(rank_type dst_rank, std::uint64_t bytes, const copy_fn& copy);
+  void _receiveMessage(rank_type src_rank, std::uint64_t bytes,
+                       const copy_fn& copy, const std::string& what);
+  void _checkPeer(rank_type rank, const std::string& message);
+  void _send(const Scalar& data, rank_type dst_rank);
+  void _send(thpp::Tensor& data, rank_type dst_rank);
+  void _receive(Scalar& data, rank_type src_rank);
+  void _receive(thpp::Tensor& data, rank_type src_rank);
+
+  rank_type _rank; // Rank of current process, range: [0.._num_processes-1]
+  rank_type _num_processes;
+  int _timeout; // Accept waiting timeout in milliseconds (it is optional, default = infinity)
+  int _spin_count; // checks of a condition before sleeping, 0 if CPUs are oversubscribed
+  int _listen_socket; // Master's socket used only during initialization
+  std::string _master_addr; // Used only by workers during initialization
+  port_type _master_port;
+
+  std::size_t _ring_bytes; // capacity of every point-to-point ring (chosen by master)
+  std::size_t _slot_bytes; // size of every collective slot (chosen by master)
+
+  std::string _segment_name; // group segments are named after it
+  THMapAllocatorContext* _segment_context;
+  std::uint8_t* _segment;
+  ProcessInfo* _process_info; // one per process
+
+  // General mutex for collectives - point-to-point operations don't use it
+  std::mutex _mutex;
+
+  // Existing groups of processes and corresponding group ids
+  std::unordered_map<THDGroup, GroupArea> _groups;
+
+  // Workers
+  QueueWorker _send_worker, _receive_worker;
+};
+
+} // namespace thd
@@ -1,11 +1,19 @@
 #include "DataChannelTCP.hpp"
+#include "../Tracing.hpp"
+
+#include <TH/THAllocator.h>
 
 #include <sys/poll.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <exception>
 #include <future>
 #include <memory>
 #include <stdexcept>
@@ -37,6 +45,167 @@ inline std::uint64_t pow2(T value) {
   return pof2;
 }
 
+// Messages of at least this many bytes are allreduced with the ring algorithm.
+constexpr std::uint64_t RING_ALLREDUCE_MIN_BYTES = 1 << 19;
+// Reductions receive data in segments of this many bytes, so that reducing
+// one segment overlaps with the transfer of the next one.
+constexpr std::uint64_t PIPELINE_SEGMENT_BYTES = 1 << 18;
+
+inline long segmentNumel(const thpp::Tensor& tensor) {
+  return std::max<long>(1, PIPELINE_SEGMENT_BYTES / tensor.elementSize());
+}
+
+// Message segments of at least this many bytes are split between all
+// connections to a peer, shorter ones travel whole on the first connection.
+constexpr std::uint64_t STRIPE_MIN_BYTES = 1 << 16;
+
+// Part of a message segment of `length` bytes carried by connection `index`
+// out of `count`, as a pair of offset and length.
+inline std::pair<std::uint64_t, std::uint64_t> stripePart(std::uint64_t length,
+                                                          std::size_t count,
+                                                          std::size_t index) {
+  if (count == 1 || length < STRIPE_MIN_BYTES)
+    return index == 0 ? std::make_pair(std::uint64_t(0), length)
+                      : std::make_pair(length, std::uint64_t(0));
+
+  std::uint64_t part_bytes = (length + count - 1) / count;
+  std::uint64_t begin = std::min<std::uint64_t>(length, index * part_bytes);
+  return std::make_pair(begin, std::min(length, begin + part_bytes) - begin);
+}
+
+// Every channel of a process gets host segments with different names
+std::atomic<std::uint64_t> segment_counter(0);
+
+/*
+ * Cuts a tensor into runs of consecutive elements, in the order in which
+ * they travel on the wire. A contiguous tensor is viewed as flat and can be
+ * cut anywhere. A strided one is cut between slices of its outermost
+ * dimension with more than one element, which narrow views can address.
+ */
+struct TensorSlices {
+  explicit TensorSlices(thpp::Tensor& tensor)
+    : dim(0)
+    , slice_numel(1)
+  {
+    if (tensor.isContiguous()) {
+      count = tensor.numel();
+      view.reset(tensor.newView({count}));
+      return;
+    }
+
+    auto sizes = tensor.sizes();
+    while (sizes[dim] == 1)
+      ++dim;
+    count = sizes[dim];
+    slice_numel = tensor.numel() / count;
+    view.reset(tensor.newNarrow(dim, 0, count));
+  }
+
+  // view of `length` slices starting with slice `begin`
+  std::unique_ptr<thpp::Tensor> get(long begin, long length) const {
+    return std::unique_ptr<thpp::Tensor>(view->newNarrow(dim, begin, length));
+  }
+
+  std::unique_ptr<thpp::Tensor> view;
+  int dim;
+  long count; // number of slices
+  long slice_numel;
+};
+
+// Copies all elements of a tensor to or from `flat` memory
+void copyBlocks(const TensorBlocks& blocks, std::uint8_t* flat,
+                std::uint64_t length, bool to_flat) {
+  if (length == 0)
+    return;
+
+  forEachPiece(blocks, 0, length, [&](std::uint8_t* ptr, std::uint64_t bytes) {
+    if (to_flat) {
+      std::memcpy(flat, ptr, bytes);
+    } else {
+      std::memcpy(ptr, flat, bytes);
+    }
+    flat += bytes;
+  });
+}
+
+// Blocks shorter than this are staged through a small buffer instead of
+// being passed one by one to `sendmsg`/`recvmsg`
+constexpr std::uint64_t IOVEC_MIN_BLOCK_BYTES = 64;
+constexpr std::uint64_t STAGING_BUFFER_BYTES = 1 << 16;
+constexpr std::size_t IOVEC_BATCH_SIZE = 1024;
+
+/*
+ * Sends or receives bytes [`offset`, `offset + length`) of tensor memory
+ * described by `blocks`, without making the tensor contiguous. On the wire
+ * the data looks exactly like the one of a contiguous tensor.
+ */
+void transferBlocks(int socket, const TensorBlocks& blocks, std::uint64_t offset,
+                    std::uint64_t length, bool is_send) {
+  if (length == 0)
+    return;
+
+  if (blocks.count == 1) {
+    if (is_send) {
+      send_bytes<std::uint8_t>(socket, blocks.data + offset, length);
+    } else {
+      recv_bytes<std::uint8_t>(socket, blocks.data + offset, length);
+    }
+  } else if (blocks.block_bytes >= IOVEC_MIN_BLOCK_BYTES) {
+    std::vector<struct iovec> iov;
+    iov.reserve(IOVEC_BATCH_SIZE);
+    auto flush = [&]() {
+      if (is_send) {
+        send_iovec(socket, iov.data(), iov.size());
+      } else {
+        recv_iovec(socket, iov.data(), iov.size());
+      }
+      iov.clear();
+    };
+
+    forEachPiece(blocks, offset, length, [&](std::uint8_t* ptr, std::uint64_t bytes) {
+      iov.push_back({ptr, bytes});
+      if (iov.size() == IOVEC_BATCH_SIZE)
+        flush();
+    });
+    if (!iov.empty())
+      flush();
+  } else {
+    std::unique_ptr<std::uint8_t[]> staging(
+        new std::uint8_t[std::min(length, STAGING_BUFFER_BYTES)]);
+    for (std::uint64_t done = 0; done < length; done += STAGING_BUFFER_BYTES) {
+      auto chunk_bytes = std::min(STAGING_BUFFER_BYTES, length - done);
+      auto position = staging.get();
+      if (is_send) {
+        forEachPiece(blocks, offset + done, chunk_bytes, [&](std::uint8_t* ptr, std::uint64_t bytes) {
+          std::memcpy(position, ptr, bytes);
+          position += bytes;
+        });
+        send_bytes<std::uint8_t>(socket, staging.get(), chunk_bytes);
+      } else {
+        recv_bytes<std::uint8_t>(socket, staging.get(), chunk_bytes);
+        forEachPiece(blocks, offset + done, chunk_bytes, [&](std::uint8_t* ptr, std::uint64_t bytes) {
+          std::memcpy(ptr, position, bytes);
+          position += bytes;
+        });
+      }
+    }
+  }
+}
+
+// Number of connections between every pair of processes (read by master only)
+constexpr char CONNECTIONS_ENV[] = "THD_TCP_CONNECTIONS";
+// Every connection costs a socket per peer and two threads, so more than a
+// few of them only waste descriptors
+constexpr long MAX_CONNECTIONS = 16;
+// Send and receive buffer size of every connection, system default if unset
+constexpr char BUFFER_SIZE_ENV[] = "THD_TCP_BUFFER_SIZE";
+// Set to 0 to reduce over TCP even between processes sharing a host (read by
+// master only)
+constexpr char SHARED_MEMORY_ENV[] = "THD_TCP_SHARED_MEMORY";
+
+// Slots of shared memory segments are aligned to this many bytes.
+constexpr std::size_t SHARED_SLOT_ALIGNMENT = 64;
+
 } // namespace
 
 
@@ -67,6 +236,8 @@ DataChannelTCP::DataChannelTCP(InitMethod::Config config, int timeout)
   : _socket(-1)
   , _port(0)
   , _timeout(timeout)
+  , _connections(1)
+  , _shared_memory(true)
   , _processes(config.world_size)
   , _poll_events(nullptr)
 {
@@ -75,6 +246,8 @@ DataChannelTCP::DataChannelTCP(InitMethod::Config config, int timeout)
   if (_rank == 0) { // MASTER
     _socket = config.master.listen_socket;
     _port = config.master.listen_port;
+    _connections = std::min(loadEnv(CONNECTIONS_ENV, 1, 1), MAX_CONNECTIONS);
+    _shared_memory = (loadEnv(SHARED_MEMORY_ENV, 1, 0) != 0);
 
     _processes[0] = {
       .rank = 0,
@@ -96,12 +269,25 @@ DataChannelTCP::DataChannelTCP(InitMethod::Config config, int timeout)
 
 DataChannelTCP::~DataChannelTCP()
 {
+  _stopAsyncWorker();
+
   if (_socket != -1)
     ::close(_socket);
 
+  for (auto& entry : _host_topologies) {
+    auto& topology = entry.second;
+    if (topology.segment)
+      THRefcountedMapAllocator.free(topology.segment_context, topology.segment);
+  }
+
   for (const auto& process : _processes) {
     if ((process.rank != _rank) && (process.socket != -1))
       ::close(process.socket);
+
+    for (int socket : process.streams) {
+      if (socket != -1)
+        ::close(socket);
+    }
   }
 }
 
@@ -115,7 +301,12 @@ bool DataChannelTCP::initWorker() {
   send_value<rank_type>(master.socket, _rank, true);
   send_value<port_type>(master.socket, _port); // send listening port to master
 
-  // get all metadata of other processes in network
+  // get number of connections to open to every process, whether to use
+  // shared memory and all metadata of other processes in network
+  _connections = recv_value<std::uint32_t>(master.socket);
+  if (_connections < 1 || _connections > MAX_CONNECTIONS)
+    throw std::runtime_error("master sent an invalid number of connections");
+  _shared_memory = recv_value<std::uint8_t>(master.socket);
   for (std::size_t i = 1; i < _processes.size(); ++i) {
     rank_type p_rank = recv_value<rank_type>(master.socket);
     port_type p_port = recv_value<port_type>(master.socket);
@@ -129,6 +320,19 @@ bool DataChannelTCP::initWorker() {
     };
   }
 
+  for (auto& process : _processes)
+    process.streams.assign(_connections - 1, -1);
+
+  // open additional connections to master, it is accepting them only after
+  // it has sent metadata to every worker
+  for (std::uint32_t stream = 1; stream < _connections; ++stream) {
+    int socket = connect(master.address, master.port);
+    master.streams[stream - 1] = socket;
+
+    send_value<rank_type>(socket, _rank, true);
+    send_value<std::uint32_t>(socket, stream);
+  }
+
   /*
    * Firstly we are connecting to workers with rank lower than our rank,
    * then we accepting connections from other wokers with higher rank.
@@ -139,19 +343,34 @@ bool DataChannelTCP::initWorker() {
 
   for (rank_type r = 1; r < _rank; ++r) {
     auto& process = _processes[r];
-    process.socket = connect(process.address, process.port);
+    for (std::uint32_t stream = 0; stream < _connections; ++stream) {
+      int socket = connect(process.address, process.port);
+      if (stream == 0) {
+        process.socket = socket;
+      } else {
+        process.streams[stream - 1] = socket;
+      }
 
-    // send rank to tell to the accepting process who we are
-    send_value<rank_type>(process.socket, _rank);
+      // send rank and connection index to tell to the accepting process who we are
+      send_value<rank_type>(socket, _rank, true);
+      send_value<std::uint32_t>(socket, stream);
+    }
   }
 
   for (rank_type i = _rank + 1; i < _processes.size(); ++i) {
-    int socket;
-    std::tie(socket, std::ignore) = accept(_socket, _timeout);
-
-    // get rank of process we have just accepted
-    rank_type p_rank = recv_value<rank_type>(socket);
-    _processes[p_rank].socket = socket;
+    for (std::uint32_t j = 0; j < _connections; ++j) {
+      int socket;
+      std::tie(socket, std::ignore) = accept(_socket, _timeout);
+
+      // get rank of process we have just accepted and index of the connection
+      rank_type p_rank = recv_value<rank_type>(socket);
+      std::uint32_t stream = recv_value<std::uint32_t>(socket);
+      if (stream == 0) {
+        _processes.at(p_rank).socket = socket;
+      } else {
+        _processes.at(p_rank).streams.at(stream - 1) = socket;
+      }
+    }
   }
 
   // close socket for listening, we will not use it anymore
@@ -194,10 +413,13 @@ bool DataChannelTCP::initMaster() {
     };
   }
 
-  // send informations about processes to all workers
+  // send number of connections, the shared memory switch and informations
+  // about processes to all workers
   for (const auto& worker : _processes) {
     if (worker.rank == 0) continue;
 
+    send_value<std::uint32_t>(worker.socket, _connections, true);
+    send_value<std::uint8_t>(worker.socket, _shared_memory, true);
     for (auto& process : _processes) {
       if (process.rank == 0) continue;
 
@@ -207,6 +429,22 @@ bool DataChannelTCP::initMaster() {
     }
   }
 
+  // accept additional connections from all workers
+  for (auto& process : _processes)
+    process.streams.assign(_connections - 1, -1);
+
+  for (std::size_t i = 0; i < (_processes.size() - 1) * (_connections - 1); ++i) {
+    int socket;
+    std::tie(socket, std::ignore) = accept(_socket, _timeout);
+
+    rank_type p_rank = recv_value<rank_type>(socket);
+    std::uint32_t stream = recv_value<std::uint32_t>(socket);
+    if (p_rank == 0 || stream == 0)
+      throw std::logic_error("unexpected connection while initializing data channel");
+
+    _processes.at(p_rank).streams.at(stream - 1) = socket;
+  }
+
   // close socket for listening, we will not use it anymore
   ::close(_socket);
   _socket = -1;
@@ -227,12 +465,45 @@ bool DataChannelTCP::init() {
       THDGroupWORLD,
       DataChannel::Group(ranks, _processes.size() - 1)
     });
+
+    _tuneSockets();
+    for (std::uint32_t stream = 1; stream < _connections; ++stream) {
+      _stream_send_workers.emplace_back(new QueueWorker());
+      _stream_receive_workers.emplace_back(new QueueWorker());
+    }
+
+    _exchangeHostnames();
   }
 
   return ok;
 }
 
 
+void DataChannelTCP::_tuneSockets() {
+  /*
+   * Every socket has TCP_NODELAY set already (see `connect` and `accept`).
+   * Buffer sizes are left to the kernel autotuning unless they are given
+   * explicitly, which may be needed for links with large bandwidth-delay
+   * product when the system limits are too low.
+   */
+  long buffer_size = loadEnv(BUFFER_SIZE_ENV, 0, 0);
+  if (buffer_size == 0)
+    return;
+
+  if (buffer_size > INT_MAX)
+    throw std::domain_error(std::string(BUFFER_SIZE_ENV) + " is too large");
+
+  for (const auto& process : _processes) {
+    if (process.rank == _rank)
+      continue;
+
+    setSocketBufferSize(process.socket, buffer_size);
+    for (int socket : process.streams)
+      setSocketBufferSize(socket, buffer_size);
+  }
+}
+
+
 rank_type DataChannelTCP::getRank() {
   return _rank;
 }
@@ -360,16 +631,23 @@ void DataChannelTCP::allReduce(thpp::Tensor& data, THDReduceOp operation,
                                THDGroup group_id) {
   /*
    * Allreduce implementation is recursive doubling algorithm. It is good
-   * algorithm for small sizes of message but other (theoratically better)
-   * implementations could not be addapted because of non-commutative
-   * operations on tensors (operation cannot be commutative because this could
-   * introduce different numerical errors on different workers).
+   * algorithm for small sizes of message, but every round ships the whole
+   * tensor, so large messages in groups of more than two processes are
+   * handed over to the ring algorithm (see `_allReduceRing`).
+   *
+   * Reductions are ordered by rank so that every worker ends up with exactly
+   * the same result (reordering could introduce different numerical errors
+   * on different workers).
    *
    * More about efficiency can be found here:
    *   > http://www.mcs.anl.gov/~thakur/papers/ijhpca-coll.pdf (section 4.5)
    *
    * Implementation is based on:
    *   > https://github.com/pmodels/mpich/blob/master/src/mpi/coll/allreduce.c
+   *
+   * When several processes of the group share a host, their data is reduced
+   * through shared memory instead (see `_allReduceHierarchical`), unless
+   * THD_TCP_SHARED_MEMORY=0 was given to the master.
    */
 
   std::lock_guard<std::mutex> lock(_mutex);
@@ -382,8 +660,29 @@ void DataChannelTCP::allReduce(thpp::Tensor& data, THDReduceOp operation,
   if (!exists)
     return;
 
+  // the decision has to be the same in every process of the group
+  auto topology = _shared_memory ? &_getHostTopology(group_id, group) : nullptr;
+  if (topology && topology->leaders.size() < group.size() && data.numel() > 0) {
+    tracer.setAlgorithm("shared_memory");
+    _allReduceHierarchical(data, operation, *topology);
+  } else {
+    _allReduceFlat(data, operation, group, group_rank);
+  }
+}
+
+
+void DataChannelTCP::_allReduceFlat(thpp::Tensor& data, THDReduceOp operation,
+                                    const DataChannel::Group& group,
+                                    rank_type group_rank) {
   std::uint64_t tensor_bytes = data.elementSize() * data.numel();
-  auto tmp_tensor = std::unique_ptr<thpp::Tensor>(data.clone());
+  if (group.size() > 2 && tensor_bytes >= RING_ALLREDUCE_MIN_BYTES &&
+      TensorSlices(data).count >= group.size()) {
+    tracer.setAlgorithm("ring");
+    _allReduceRing(data, operation, group, group_rank);
+    return;
+  }
+
+  tracer.setAlgorithm("recursive_doubling");
 
   auto pof2 = pow2(group.size());
   int rem = group.size() - pof2;
@@ -394,8 +693,7 @@ void DataChannelTCP::allReduce(thpp::Tensor& data, THDReduceOp operation,
       send(data, group.mustGetGlobalRank(group_rank + 1));
       newrank = -1;
     } else {
-      receive(*tmp_tensor, group.mustGetGlobalRank(group_rank - 1));
-      _reduce(data, *tmp_tensor, operation);
+      _receiveReduce(data, group.mustGetGlobalRank(group_rank - 1), operation);
       newrank = group_rank / 2;
     }
   } else {
@@ -408,17 +706,12 @@ void DataChannelTCP::allReduce(thpp::Tensor& data, THDReduceOp operation,
       int newdst = newrank ^ mask;
       int dst = (newdst < rem) ? (newdst * 2 + 1) : (newdst + rem);
 
+      // segments of `data` are reduced in place as soon as they are both
+      // sent and received, so keep the lower rank's operand first
       auto dst_global_rank = group.mustGetGlobalRank(dst);
-      req_ptr send_request {isend(data, dst_global_rank)};
-      receive(*tmp_tensor, dst_global_rank);
-      send_request->wait();
-
-      if (dst < group_rank) {
-        _reduce(data, *tmp_tensor, operation);
-      } else {
-        _reduce(*tmp_tensor, data, operation);
-        std::memcpy(data.data(), tmp_tensor->data(), tensor_bytes);
-      }
+      auto send_requests = _isendSegments(data, dst_global_rank);
+      _receiveReduce(data, dst_global_rank, operation,
+                     static_cast<rank_type>(dst) < group_rank, &send_requests);
 
       mask <<= 1;
     }
@@ -434,6 +727,127 @@ void DataChannelTCP::allReduce(thpp::Tensor& data, THDReduceOp operation,
 }
 
 
+void DataChannelTCP::_allReduceRing(thpp::Tensor& data, THDReduceOp operation,
+                                    const DataChannel::Group& group,
+                                    rank_type group_rank) {
+  /*
+   * Ring allreduce is a reduce-scatter followed by an allgather, both passing
+   * one chunk per step to the right neighbour. Every process sends
+   * 2 * (p - 1) / p of the tensor in total instead of log2(p) full copies,
+   * which makes it bandwidth optimal for large messages.
+   *
+   * Chunk `c` is always fully reduced by group rank `c - 1` and then copied
+   * verbatim to all other processes, so the result is identical everywhere
+   * even though chunks are reduced in different orders.
+   *
+   * Chunks are made of whole slices (see `TensorSlices`), so that strided
+   * tensors are reduced in place too. There are at least as many slices as
+   * processes.
+   *
+   * More about efficiency can be found here:
+   *   > http://www.mcs.anl.gov/~thakur/papers/ijhpca-coll.pdf (section 4.5)
+   */
+
+  rank_type size = group.size();
+  auto left = group.mustGetGlobalRank((size + group_rank - 1) % size);
+  auto right = group.mustGetGlobalRank((group_rank + 1) % size);
+
+  TensorSlices slices(data);
+  std::vector<std::unique_ptr<thpp::Tensor>> chunks(size);
+  for (rank_type c = 0; c < size; ++c) {
+    long begin = slices.count * c / size;
+    long end = slices.count * (c + 1) / size;
+    chunks[c] = slices.get(begin, end - begin);
+  }
+
+  for (rank_type step = 0; step < size - 1; ++step) {
+    auto send_chunk = (group_rank + size - step) % size;
+    auto recv_chunk = (group_rank + size - step - 1) % size;
+
+    req_ptr send_request {isend(*chunks[send_chunk], right)};
+    _receiveReduce(*chunks[recv_chunk], left, operation);
+    send_request->wait();
+  }
+
+  for (rank_type step = 0; step < size - 1; ++step) {
+    auto send_chunk = (group_rank + 1 + size - step) % size;
+    auto recv_chunk = (group_rank + size - step) % size;
+
+    req_ptr send_request {isend(*chunks[send_chunk], right)};
+    receive(*chunks[recv_chunk], left);
+    send_request->wait();
+  }
+}
+
+
+void DataChannelTCP::_allReduceHierarchical(thpp::Tensor& data,
+                                            THDReduceOp operation,
+                                            HostTopology& topology) {
+  /*
+   * Processes sharing a host copy their data to their own slot of a shared
+   * memory segment and then each of them reduces a part of the tensor
+   * across all slots into the result slot. Only one leader per host takes
+   * part in the allreduce between hosts; it publishes the final result in
+   * the segment, from which the other local processes copy it.
+   *
+   * Sockets to local processes carry only one byte per synchronization,
+   * so no tensor data goes through the loopback interface.
+   */
+
+  const auto& local_ranks = topology.local_ranks;
+  std::size_t local_size = local_ranks.size();
+  if (local_size == 1) {
+    _allReduceFlat(data, operation, topology.leaders,
+                   topology.leaders.mustGetGroupRank(_rank));
+    return;
+  }
+
+  std::size_t local_rank = std::distance(
+    local_ranks.begin(),
+    std::find(local_ranks.begin(), local_ranks.end(), _rank)
+  );
+  bool between_hosts = topology.leaders.size() > 1;
+
+  std::size_t tensor_bytes = data.elementSize() * data.numel();
+  std::size_t slot_bytes = (tensor_bytes + SHARED_SLOT_ALIGNMENT - 1) /
+    SHARED_SLOT_ALIGNMENT * SHARED_SLOT_ALIGNMENT;
+  if (slot_bytes > topology.slot_bytes)
+    _mapSegment(topology, std::max(slot_bytes, 2 * topology.slot_bytes));
+
+  // strided tensors are copied to and from the slots piece by piece
+  TensorBlocks blocks(data);
+  auto result = topology.segment + local_size * topology.slot_bytes;
+  copyBlocks(blocks, topology.segment + local_rank * topology.slot_bytes,
+             tensor_bytes, true);
+  _localBarrier(local_ranks);
+
+  long numel = data.numel();
+  long chunk = (numel + local_size - 1) / local_size;
+  long begin = std::min<long>(numel, chunk * local_rank);
+  long end = std::min<long>(numel, begin + chunk);
+  reduceSlots(data.type(), result, topology.segment, topology.slot_bytes,
+              local_size, begin, end, operation);
+  _localBarrier(local_ranks);
+
+  /*
+   * The result slot is not written again before every local process enters
+   * the next allreduce, so no synchronization is needed after the copy.
+   */
+  if (between_hosts) {
+    if (local_rank == 0) {
+      copyBlocks(blocks, result, tensor_bytes, false);
+      _allReduceFlat(data, operation, topology.leaders,
+                     topology.leaders.mustGetGroupRank(_rank));
+      copyBlocks(blocks, result, tensor_bytes, true);
+    }
+    _localBarrier(local_ranks);
+  }
+
+  if (!between_hosts || local_rank != 0)
+    copyBlocks(blocks, result, tensor_bytes, false);
+}
+
+
 void DataChannelTCP::reduce(thpp::Tensor& data, THDReduceOp operation,
                             rank_type dst_rank, THDGroup group_id) {
   /*
@@ -455,7 +869,6 @@ void DataChannelTCP::reduce(thpp::Tensor& data, THDReduceOp operation,
   int dim = log2ceil(group.size());
   rank_type virtual_rank = (group_rank + group.size() - group_dst_rank) % group.size();
   long long mask = 0;
-  auto result_tensor = std::unique_ptr<thpp::Tensor>(data.clone());
 
   for (int k = 0; k <= dim - 1; mask ^= (1 << k), ++k) {
     if ((virtual_rank & mask) == 0) {
@@ -465,16 +878,108 @@ void DataChannelTCP::reduce(thpp::Tensor& data, THDReduceOp operation,
 
       partner = group.mustGetGlobalRank((partner + group_dst_rank) % group.size());
       if ((virtual_rank & (1 << k)) != 0) {
-        send(*result_tensor, partner);
+        send(data, partner);
       } else {
-        receive(data, partner);
-        _reduce(*result_tensor, data, operation);
+        _receiveReduce(data, partner, operation);
       }
     }
   }
+}
+
+
+void DataChannelTCP::reduceScatter(thpp::Tensor& output,
+                                   std::vector<thpp::Tensor*>& input,
+                                   THDReduceOp operation, THDGroup group_id) {
+  /*
+   * Reduce-scatter is the first half of the ring allreduce: at every step a
+   * process adds its own contribution to the partial result it received from
+   * the left neighbour and passes it on to the right one. After p - 1 steps
+   * the partial result for `input[group_rank]` has visited every process.
+   * Each process sends (p - 1) / p of its input in total.
+   *
+   * Partial results alternate between `output` and a temporary tensor,
+   * so that one of them can be sent while the other is being received.
+   */
+
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  const auto& group = _groups.at(group_id);
+  rank_type group_rank;
+  bool exists;
+
+  std::tie(group_rank, exists) = group.getGroupRank(_rank);
+  if (!exists)
+    return;
+
+  if (input.size() != group.size())
+    throw std::logic_error("reduceScatter: number of input tensors and group size does not match");
+
+  for (auto in_tensor : input)
+    assertSameSizeAndType(*in_tensor, output, "reduceScatter");
+
+  rank_type size = group.size();
+  if (size == 1) {
+    output.copy(*input[0]);
+    return;
+  }
+
+  auto left = group.mustGetGlobalRank((size + group_rank - 1) % size);
+  auto right = group.mustGetGlobalRank((group_rank + 1) % size);
+  std::unique_ptr<thpp::Tensor> tmp_tensor(output.clone());
+
+  thpp::Tensor* partial = input[(group_rank + size - 1) % size];
+  for (rank_type step = 0; step < size - 1; ++step) {
+    // the last step has to leave its result in `output`
+    auto& result = ((size - 2 - step) % 2 == 0) ? output : *tmp_tensor;
+    auto chunk = (group_rank + 2 * size - step - 2) % size;
+
+    req_ptr send_request {isend(*partial, right)};
+    result.copy(*input[chunk]);
+    _receiveReduce(result, left, operation);
+    send_request->wait();
+
+    partial = &result;
+  }
+}
+
+
+void DataChannelTCP::allToAll(std::vector<thpp::Tensor*>& output,
+                              std::vector<thpp::Tensor*>& input,
+                              THDGroup group_id) {
+  /*
+   * All-to-all is a pairwise exchange: at step `k` every process sends to
+   * the process `k` ranks to its right and receives from the one `k` ranks
+   * to its left, so every link carries exactly one message per step.
+   */
+
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  const auto& group = _groups.at(group_id);
+  rank_type group_rank;
+  bool exists;
+
+  std::tie(group_rank, exists) = group.getGroupRank(_rank);
+  if (!exists)
+    return;
+
+  if (input.size() != group.size() || output.size() != group.size())
+    throw std::logic_error("allToAll: number of tensors and group size does not match");
+
+  for (std::size_t i = 0; i < group.size(); ++i) {
+    assertSameSizeAndType(*input[i], *input[0], "allToAll");
+    assertSameSizeAndType(*output[i], *input[0], "allToAll");
+  }
+
+  rank_type size = group.size();
+  output[group_rank]->copy(*input[group_rank]);
+  for (rank_type step = 1; step < size; ++step) {
+    auto dst = (group_rank + step) % size;
+    auto src = (group_rank + size - step) % size;
 
-  if (_rank == dst_rank)
-    std::memcpy(data.data(), result_tensor->data(), data.elementSize() * data.numel());
+    req_ptr send_request {isend(*input[dst], group.mustGetGlobalRank(dst))};
+    receive(*output[src], group.mustGetGlobalRank(src));
+    send_request->wait();
+  }
 }
 
 
@@ -629,10 +1134,12 @@ void DataChannelTCP::barrier(THDGroup group_id) {
     return;
 
   std::uint8_t byte = 1;
+  auto trace_scope = Tracer::currentScope();
   for (rank_type distance = 1; distance < group.size(); distance <<= 1) {
     rank_type recv_partner = (group_rank + group.size() - distance) % group.size();
     const auto& recv_process = _processes.at(group.mustGetGlobalRank(recv_partner));
-    auto recv_request = _receive_worker.push([&recv_process, &byte]{
+    auto recv_request = _receive_worker.push([&recv_process, &byte, trace_scope]{
+      WaitTimer wait_timer(trace_scope);
       recv_bytes<std::uint8_t>(recv_process.socket, &byte, 1);
     });
 
@@ -657,6 +1164,11 @@ THDGroup DataChannelTCP::newGroup(const std::vector<rank_type>& ranks) {
 }
 
 
+const DataChannel::Group& DataChannelTCP::_getGroup(THDGroup group_id) {
+  return _groups.at(group_id);
+}
+
+
 void DataChannelTCP::_send(const Scalar& data, rank_type dst_rank) {
   /*
    * We have to check if dst_rank is positive to properly use `.at` function in vector.
@@ -690,18 +1202,16 @@ void DataChannelTCP::_send(thpp::Tensor& data, rank_type dst_rank) {
   if (process_dst.rank == _rank)
     throw std::logic_error("cannot send tensor to process with same rank");
 
-  if (!data.isContiguous())
-    throw std::logic_error("tensor to send is not contiguous");
-
   // send size of tensor data in bytes
   std::uint64_t tensor_bytes = data.elementSize() * data.numel();
   send_bytes<std::uint64_t>(process_dst.socket, &tensor_bytes, 1, true);
 
-  // send data (bytes)
-  send_bytes<std::uint8_t>(
-    process_dst.socket,
-    reinterpret_cast<const std::uint8_t*>(data.data()),
-    tensor_bytes
+  // send data (bytes), strided tensors are sent straight from their memory
+  TensorBlocks blocks(data);
+  _stripe(process_dst, tensor_bytes, _stream_send_workers,
+    [&blocks](int socket, std::uint64_t offset, std::uint64_t length) {
+      transferBlocks(socket, blocks, offset, length, true);
+    }
   );
 }
 
@@ -718,7 +1228,10 @@ void DataChannelTCP::_receive(Scalar& data, rank_type src_rank) {
 
   // get size of scalar in bytes
   std::uint64_t scalar_bytes;
-  recv_bytes<std::uint64_t>(process_src.socket, &scalar_bytes, 1);
+  {
+    WaitTimer wait_timer;
+    recv_bytes<std::uint64_t>(process_src.socket, &scalar_bytes, 1);
+  }
 
   std::uint64_t actual_scalar_bytes = data.elementSize();
   if (actual_scalar_bytes == scalar_bytes) {
@@ -746,28 +1259,374 @@ void DataChannelTCP::_receive(thpp::Tensor& data, rank_type src_rank) {
   if (process_src.rank == _rank)
     throw std::logic_error("cannot receive tensor from process with same rank");
 
-  if (!data.isContiguous())
-    throw std::logic_error("tensor to receive is not contiguous");
-
-  // get size of tensor data in bytes
+  // get size of tensor data in bytes, it arrives once the sender is ready
   std::uint64_t tensor_bytes;
-  recv_bytes<std::uint64_t>(process_src.socket, &tensor_bytes, 1);
+  {
+    WaitTimer wait_timer;
+    recv_bytes<std::uint64_t>(process_src.socket, &tensor_bytes, 1);
+  }
 
   std::uint64_t actual_tensor_bytes = data.elementSize() * data.numel();
-  if (actual_tensor_bytes == tensor_bytes) {
-    recv_bytes<std::uint8_t>(
-      process_src.socket,
-      reinterpret_cast<std::uint8_t*>(data.data()),
-      tensor_bytes
-    );
-  } else {
+  if (actual_tensor_bytes != tensor_bytes) {
     // remove invalid data from recv buffer
     std::unique_ptr<std::uint8_t[]> bytes(new std::uint8_t[tensor_bytes]);
-    recv_bytes<std::uint8_t>(process_src.socket, bytes.get(), tensor_bytes);
+    _stripe(process_src, tensor_bytes, _stream_receive_workers,
+      [&bytes](int socket, std::uint64_t offset, std::uint64_t length) {
+        recv_bytes<std::uint8_t>(socket, bytes.get() + offset, length);
+      }
+    );
     throw std::logic_error("tensor sizes do not match");
   }
+
+  // strided tensors are received straight into their memory
+  TensorBlocks blocks(data);
+  _stripe(process_src, tensor_bytes, _stream_receive_workers,
+    [&blocks](int socket, std::uint64_t offset, std::uint64_t length) {
+      transferBlocks(socket, blocks, offset, length, false);
+    }
+  );
 }
 
+std::vector<QueueWorker::Request> DataChannelTCP::_isendSegments(
+    thpp::Tensor& data, rank_type dst_rank) {
+  /*
+   * Sends `data` as a single message (same wire format as `_send`), but
+   * queues every segment separately, so the caller can tell which parts of
+   * `data` have already left and may be overwritten. All returned requests
+   * have to be waited for before `data` goes away.
+   *
+   * Like `_send`, strided tensors are sent straight from their memory.
+   */
+
+  const auto& process_dst = _processes.at(dst_rank);
+  if (process_dst.rank == _rank)
+    throw std::logic_error("cannot send tensor to process with same rank");
+
+  int socket = process_dst.socket;
+  std::uint64_t tensor_bytes = data.elementSize() * data.numel();
+  std::uint64_t segment_bytes = segmentNumel(data) * data.elementSize();
+  auto blocks = std::make_shared<TensorBlocks>(data);
+
+  std::vector<QueueWorker::Request> requests;
+  requests.push_back(_send_worker.push([socket, tensor_bytes]{
+    send_bytes<std::uint64_t>(socket, &tensor_bytes, 1, true);
+  }));
+
+  for (std::uint64_t offset = 0; offset < tensor_bytes; offset += segment_bytes) {
+    auto length = std::min(segment_bytes, tensor_bytes - offset);
+    requests.push_back(_send_worker.push([this, &process_dst, blocks, offset, length]{
+      this->_stripe(process_dst, length, this->_stream_send_workers,
+        [&blocks, offset](int socket, std::uint64_t part_offset, std::uint64_t part_length) {
+          transferBlocks(socket, *blocks, offset + part_offset, part_length, true);
+        }
+      );
+    }));
+  }
+
+  return requests;
+}
+
+
+void DataChannelTCP::_receiveReduce(thpp::Tensor& result, rank_type src_rank,
+                                    THDReduceOp operation, bool received_first,
+                                    std::vector<QueueWorker::Request>* send_requests) {
+  /*
+   * Receives a tensor of the same size as `result` and reduces it into
+   * `result`. The receive worker reads the message one segment at a time,
+   * so segment `k` is reduced while segment `k + 1` is still in flight and
+   * the reduction is mostly hidden behind the transfer.
+   *
+   * With `received_first` the received data is the left operand of the
+   * reduction. When `result` is concurrently sent out by `_isendSegments`,
+   * `send_requests` makes every segment wait for its own send to finish
+   * before it is overwritten. All of them are done when this returns,
+   * also when it throws.
+   *
+   * Strided results are reduced in place one slice at a time (see
+   * `TensorSlices`), as soon as all elements of a slice have arrived.
+   */
+
+  // queued transfers use both, so they have to outlive the requests
+  std::vector<QueueWorker::Request> requests;
+  std::unique_ptr<thpp::Tensor> buffer;
+  try {
+    const auto& process_src = _processes.at(src_rank);
+    if (process_src.rank == _rank)
+      throw std::logic_error("cannot receive tensor from process with same rank");
+
+    long numel = result.numel();
+    if (numel == 0) {
+      receive(result, src_rank);
+      if (send_requests) {
+        for (auto& request : *send_requests)
+          request.wait();
+      }
+      return;
+    }
+
+    int socket = process_src.socket;
+    std::uint64_t tensor_bytes = result.elementSize() * numel;
+    long segment_numel = segmentNumel(result);
+    buffer = _getBuffer(result, numel);
+    TensorSlices slices(result);
+    auto bytes = reinterpret_cast<std::uint8_t*>(buffer->data());
+
+    // once a read fails the stream is out of sync, so skip remaining segments
+    auto failed = std::make_shared<std::atomic<bool>>(false);
+    auto trace_scope = Tracer::currentScope();
+    requests.push_back(_receive_worker.push([this, &process_src, socket, tensor_bytes,
+                                             failed, trace_scope]{
+      try {
+        std::uint64_t message_bytes;
+        {
+          WaitTimer wait_timer(trace_scope);
+          recv_bytes<std::uint64_t>(socket, &message_bytes, 1);
+        }
+        if (message_bytes != tensor_bytes) {
+          // remove invalid data from recv buffer
+          std::unique_ptr<std::uint8_t[]> bytes(new std::uint8_t[message_bytes]);
+          this->_stripe(process_src, message_bytes, this->_stream_receive_workers,
+            [&bytes](int socket, std::uint64_t offset, std::uint64_t length) {
+              recv_bytes<std::uint8_t>(socket, bytes.get() + offset, length);
+            }
+          );
+          throw std::logic_error("tensor sizes do not match");
+        }
+      } catch (...) {
+        *failed = true;
+        throw;
+      }
+    }));
+
+    std::uint64_t segment_bytes = segment_numel * result.elementSize();
+    for (std::uint64_t offset = 0; offset < tensor_bytes; offset += segment_bytes) {
+      auto length = std::min(segment_bytes, tensor_bytes - offset);
+      requests.push_back(_receive_worker.push([this, &process_src, bytes, offset, length, failed]{
+        if (*failed)
+          return;
+
+        try {
+          this->_stripe(process_src, length, this->_stream_receive_workers,
+            [bytes, offset](int socket, std::uint64_t part_offset, std::uint64_t part_length) {
+              recv_bytes<std::uint8_t>(socket, bytes + offset + part_offset, part_length);
+            }
+          );
+        } catch (...) {
+          *failed = true;
+          throw;
+        }
+      }));
+    }
+
+    requests[0].wait();
+    if (send_requests)
+      (*send_requests)[0].wait();
+
+    long reduced = 0; // slices
+    for (std::size_t k = 1; k < requests.size(); ++k) {
+      requests[k].wait();
+      if (send_requests)
+        (*send_requests)[k].wait();
+
+      long received_numel = std::min<long>(numel, k * segment_numel);
+      long end = received_numel / slices.slice_numel;
+      if (end == reduced)
+        continue;
+
+      auto result_part = slices.get(reduced, end - reduced);
+      std::unique_ptr<thpp::Tensor> buffer_flat(buffer->newNarrow(
+        0, reduced * slices.slice_numel, (end - reduced) * slices.slice_numel));
+      std::unique_ptr<thpp::Tensor> buffer_part(buffer_flat->newView(result_part->sizes()));
+      if (received_first) {
+        _reduce(*buffer_part, *result_part, operation);
+        result_part->copy(*buffer_part);
+      } else {
+        _reduce(*result_part, *buffer_part, operation);
+      }
+      reduced = end;
+    }
+  } catch (...) {
+    for (auto& request : requests) {
+      try { request.wait(); } catch (...) {}
+    }
+    if (send_requests) {
+      for (auto& request : *send_requests) {
+        try { request.wait(); } catch (...) {}
+      }
+    }
+    throw;
+  }
+}
+
+
+void DataChannelTCP::_exchangeHostnames() {
+  _hostnames.assign(_processes.size(), "");
+  _hostnames[_rank] = getHostname();
+
+  // hostnames are small enough to never block on send
+  for (const auto& process : _processes) {
+    if (process.rank != _rank)
+      send_string(process.socket, _hostnames[_rank]);
+  }
+
+  for (const auto& process : _processes) {
+    if (process.rank != _rank)
+      _hostnames[process.rank] = recv_string(process.socket);
+  }
+}
+
+
+auto DataChannelTCP::_getHostTopology(THDGroup group_id,
+                                      const DataChannel::Group& group)
+    -> HostTopology& {
+  auto it = _host_topologies.find(group_id);
+  if (it != _host_topologies.end())
+    return it->second;
+
+  // the first process of the group on every host becomes its leader
+  HostTopology topology {};
+  std::vector<rank_type> leaders;
+  for (rank_type group_rank = 0; group_rank < group.size(); ++group_rank) {
+    auto rank = group.mustGetGlobalRank(group_rank);
+    const auto& host = _hostnames[rank];
+    if (host == _hostnames[_rank])
+      topology.local_ranks.push_back(rank);
+
+    bool has_leader = std::any_of(leaders.begin(), leaders.end(),
+      [this, &host](rank_type leader) { return _hostnames[leader] == host; });
+    if (!has_leader)
+      leaders.push_back(rank);
+  }
+
+  topology.leaders = DataChannel::Group(leaders, _processes.size() - 1);
+  return _host_topologies.emplace(group_id, std::move(topology)).first->second;
+}
+
+
+void DataChannelTCP::_mapSegment(HostTopology& topology, std::size_t slot_bytes) {
+  /*
+   * The leader creates a new segment and tells other local processes its
+   * name. Segments are reference counted by `THRefcountedMapAllocator`, so
+   * the old one is unlinked as soon as the last process unmaps it.
+   */
+
+  const auto& local_ranks = topology.local_ranks;
+  bool is_leader = (local_ranks[0] == _rank);
+  std::size_t segment_bytes = slot_bytes * (local_ranks.size() + 1);
+
+  std::string name;
+  int flags = TH_ALLOCATOR_MAPPED_SHAREDMEM;
+  if (is_leader) {
+    name = "/thd_" + std::to_string(::getpid()) + "_" +
+      std::to_string(segment_counter++);
+    flags |= TH_ALLOCATOR_MAPPED_EXCLUSIVE;
+  } else {
+    name = recv_string(_processes[local_ranks[0]].socket);
+    flags |= TH_ALLOCATOR_MAPPED_NOCREATE;
+  }
+
+  auto context = THMapAllocatorContext_new(name.c_str(), flags);
+  auto segment = THRefcountedMapAllocator.malloc(context, segment_bytes);
+
+  if (is_leader) {
+    for (std::size_t i = 1; i < local_ranks.size(); ++i)
+      send_string(_processes[local_ranks[i]].socket, name);
+  }
+
+  if (topology.segment)
+    THRefcountedMapAllocator.free(topology.segment_context, topology.segment);
+
+  topology.segment_context = context;
+  topology.segment = reinterpret_cast<std::uint8_t*>(segment);
+  topology.slot_bytes = slot_bytes;
+}
+
+
+void DataChannelTCP::_localBarrier(const std::vector<rank_type>& local_ranks) {
+  WaitTimer wait_timer;
+  std::uint8_t token = 0;
+  if (local_ranks[0] == _rank) {
+    for (std::size_t i = 1; i < local_ranks.size(); ++i)
+      recv_value<std::uint8_t>(_processes[local_ranks[i]].socket);
+    for (std::size_t i = 1; i < local_ranks.size(); ++i)
+      send_value<std::uint8_t>(_processes[local_ranks[i]].socket, token);
+  } else {
+    send_value<std::uint8_t>(_processes[local_ranks[0]].socket, token);
+    recv_value<std::uint8_t>(_processes[local_ranks[0]].socket);
+  }
+}
+
+
+std::unique_ptr<thpp::Tensor> DataChannelTCP::_getBuffer(const thpp::Tensor& like,
+                                                         long numel) {
+  auto& buffer = _buffers[like.type()];
+  if (!buffer)
+    buffer = like.newTensor();
+
+  if (buffer->numel() < numel)
+    buffer->resize({numel});
+
+  return std::unique_ptr<thpp::Tensor>(buffer->newNarrow(0, 0, numel));
+}
+
+
+void DataChannelTCP::_stripe(const Process& process, std::uint64_t length,
+                             std::vector<std::unique_ptr<QueueWorker>>& workers,
+                             const std::function<void (int, std::uint64_t, std::uint64_t)>& transfer) {
+  /*
+   * Transfers `length` bytes of message data over all connections to
+   * `process`. Every segment of PIPELINE_SEGMENT_BYTES is split between the
+   * connections by `stripePart`, so the layout only depends on the message
+   * size and a message can be sent whole and received segment by segment.
+   *
+   * `transfer(socket, offset, length)` moves a single part. The first
+   * connection is served by the calling thread and the other ones by
+   * `workers`, which are always waited for before returning, also on error.
+   */
+
+  std::size_t count = process.streams.size() + 1;
+  if (count == 1 || length < STRIPE_MIN_BYTES) {
+    transfer(process.socket, 0, length);
+    return;
+  }
+
+  auto transfer_parts = [&transfer, length, count](int socket, std::size_t index) {
+    for (std::uint64_t offset = 0; offset < length; offset += PIPELINE_SEGMENT_BYTES) {
+      auto segment_bytes = std::min(PIPELINE_SEGMENT_BYTES, length - offset);
+      auto part = stripePart(segment_bytes, count, index);
+      transfer(socket, offset + part.first, part.second);
+    }
+  };
+
+  std::vector<QueueWorker::Request> requests;
+  for (std::size_t index = 1; index < count; ++index) {
+    int socket = process.streams[index - 1];
+    requests.push_back(workers[index - 1]->push([&transfer_parts, socket, index]{
+      transfer_parts(socket, index);
+    }));
+  }
+
+  std::exception_ptr error;
+  try {
+    transfer_parts(process.socket, 0);
+  } catch (...) {
+    error = std::current_exception();
+  }
+
+  for (auto& request : requests) {
+    try {
+      request.wait();
+    } catch (...) {
+      if (!error)
+        error = std::current_exception();
+    }
+  }
+
+  if (error)
+    std::rethrow_exception(error);
+}
+
+
 void DataChannelTCP::_reduce(thpp::Tensor& result, thpp::Tensor& data,
                              THDReduceOp operation) const {
   assertSameSizeAndType(result, data, "reduce");
@@ -5,6 +5,7 @@
 
 #include <sys/poll.h>
 #include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
@@ -45,6 +46,10 @@ struct DataChannelTCP : DataChannel {
                  THDGroup group_id = THDGroupWORLD) override;
   void reduce(thpp::Tensor& data, THDReduceOp operation, rank_type dst_rank,
               THDGroup group_id = THDGroupWORLD) override;
+  void reduceScatter(thpp::Tensor& output, std::vector<thpp::Tensor*>& input,
+                     THDReduceOp operation, THDGroup group_id = THDGroupWORLD) override;
+  void allToAll(std::vector<thpp::Tensor*>& output, std::vector<thpp::Tensor*>& input,
+                THDGroup group_id = THDGroupWORLD) override;
   void broadcast(thpp::Tensor& data, rank_type src_id,
                  THDGroup group_id = THDGroupWORLD) override;
   void send(Scalar& data, rank_type dst_id) override;
@@ -59,6 +64,9 @@ struct DataChannelTCP : DataChannel {
 
   THDGroup newGroup(const std::vector<rank_type>& ranks) override;
 
+protected:
+  const DataChannel::Group& _getGroup(THDGroup group_id) override;
+
 private:
   using req_ptr = std::unique_ptr<RequestTCP>;
   // Defines process to which master or worker is connected
@@ -67,10 +75,22 @@ private:
     std::string address;
     port_type port;
     int socket;
+    std::vector<int> streams; // additional connections, large transfers are striped across them
+  };
+
+  // Processes of a group that share a host with this one, and the shared
+  // memory segment they use for allreduce
+  struct HostTopology {
+    std::vector<rank_type> local_ranks; // global ranks, host leader first
+    DataChannel::Group leaders; // one process per host
+    THMapAllocatorContext* segment_context;
+    std::uint8_t* segment; // one slot per local process and one for result
+    std::size_t slot_bytes;
   };
 
   bool initMaster();
   bool initWorker();
+  void _tuneSockets();
 
   void _send(const Scalar& data, rank_type dst_id);
   void _send(thpp::Tensor& data, rank_type dst_id);
@@ -78,14 +98,38 @@ private:
   void _receive(thpp::Tensor& data, rank_type src_id);
   void _reduce(thpp::Tensor& result, thpp::Tensor& data,
                THDReduceOp operation) const;
+  void _allReduceFlat(thpp::Tensor& data, THDReduceOp operation,
+                      const DataChannel::Group& group, rank_type group_rank);
+  void _allReduceRing(thpp::Tensor& data, THDReduceOp operation,
+                      const DataChannel::Group& group, rank_type group_rank);
+  void _allReduceHierarchical(thpp::Tensor& data, THDReduceOp operation,
+                              HostTopology& topology);
+
+  void _exchangeHostnames();
+  HostTopology& _getHostTopology(THDGroup group_id, const DataChannel::Group& group);
+  void _mapSegment(HostTopology& topology, std::size_t slot_bytes);
+  void _localBarrier(const std::vector<rank_type>& local_ranks);
+
+  std::vector<QueueWorker::Request> _isendSegments(thpp::Tensor& data,
+                                                   rank_type dst_rank);
+  void _receiveReduce(thpp::Tensor& result, rank_type src_rank,
+                      THDReduceOp operation, bool received_first = false,
+                      std::vector<QueueWorker::Request>* send_requests = nullptr);
+  std::unique_ptr<thpp::Tensor> _getBuffer(const thpp::Tensor& like, long numel);
+  void _stripe(const Process& process, std::uint64_t length,
+               std::vector<std::unique_ptr<QueueWorker>>& workers,
+               const std::function<void (int, std::uint64_t, std::uint64_t)>& transfer);
 
 
   rank_type _rank; // Rank of current process, range: [0.._processes.size()-1]
   int _socket; // Socket on which process is listening
   port_type _port; // Port on which process is listening
   int _timeout; // Accept waiting timeout in milliseconds (it is optional, default = infinity)
+  std::uint32_t _connections; // Number of connections to every other process (chosen by master)
+  bool _shared_memory; // Whether processes sharing a host reduce through shared memory (chosen by master)
 
   std::vector<Process> _processes; // Other processes in network
+  std::vector<std::string> _hostnames; // Hostname of every process, indexed by rank
   std::unique_ptr<struct pollfd[]> _poll_events; // Events array for `poll`
 
   // General mutex for methods - to protect access to the TCP data channel.
@@ -94,8 +138,22 @@ private:
   // Existing groups of processes and corresponding group ids
   std::unordered_map<THDGroup, DataChannel::Group> _groups;
 
+  // Receive buffers for reductions (one per tensor type), reused between calls
+  std::unordered_map<thpp::Type, std::unique_ptr<thpp::Tensor>> _buffers;
+
+  // Processes sharing a host with this one, for every group used in allreduce
+  std::unordered_map<THDGroup, HostTopology> _host_topologies;
+
   // Workers
   QueueWorker _send_worker, _receive_worker;
+  // Workers serving additional connections (one per connection index).
+  // `_stripe` queues parts of a message on them from the thread that runs
+  // the transfer. Every transfer is a task of `_send_worker` or
+  // `_receive_worker`, even for the blocking `send` and `receive`, which
+  // queue `_send` or `_receive` and wait for it. So the send and receive
+  // stream workers are each fed by a single thread and never mix messages.
+  std::vector<std::unique_ptr<QueueWorker>> _stream_send_workers;
+  std::vector<std::unique_ptr<QueueWorker>> _stream_receive_workers;
 };
 
 } // namespace thd
@@ -2,14 +2,22 @@
 
 #include "../DataChannel.hpp"
 
+#include <unistd.h>
+#include <algorithm>
 #include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
 #include <condition_variable>
+#include <cstdlib>
 #include <memory>
 #include <mutex>
 #include <queue>
 #include <string>
 #include <stdexcept>
+#include <system_error>
 #include <thread>
+#include <vector>
 
 namespace thd {
 
@@ -27,6 +35,149 @@ inline void assertSameSizeAndType(const thpp::Tensor& tensor1,
     throw std::logic_error(prefix + "tensors are not equal in size or data type");
 }
 
+inline std::string getHostname() {
+  char hostname[HOST_NAME_MAX + 1];
+  if (::gethostname(hostname, sizeof(hostname)) != 0)
+    throw std::system_error(errno, std::system_category());
+
+  hostname[HOST_NAME_MAX] = '\0';
+  return std::string(hostname);
+}
+
+/*
+ * Reduces elements [`begin`, `end`) of `slot_count` consecutive slots of
+ * `slot_bytes` bytes each into `result`.
+ */
+template<typename T>
+void reduceSlots(std::uint8_t* result, const std::uint8_t* slots,
+                 std::size_t slot_bytes, std::size_t slot_count,
+                 long begin, long end, THDReduceOp operation) {
+  auto output = reinterpret_cast<T*>(result);
+  auto input = reinterpret_cast<const T*>(slots);
+  std::copy(input + begin, input + end, output + begin);
+
+  for (std::size_t slot = 1; slot < slot_count; ++slot) {
+    input = reinterpret_cast<const T*>(slots + slot * slot_bytes);
+    switch (operation) {
+      case THDReduceOp::THDReduceMIN:
+        for (long i = begin; i < end; ++i)
+          output[i] = std::min(output[i], input[i]);
+        break;
+      case THDReduceOp::THDReduceMAX:
+        for (long i = begin; i < end; ++i)
+          output[i] = std::max(output[i], input[i]);
+        break;
+      case THDReduceOp::THDReduceSUM:
+        for (long i = begin; i < end; ++i)
+          output[i] += input[i];
+        break;
+      case THDReduceOp::THDReducePRODUCT:
+        for (long i = begin; i < end; ++i)
+          output[i] *= input[i];
+        break;
+      default:
+        throw std::logic_error("unsupported reduce operation");
+    }
+  }
+}
+
+inline void reduceSlots(thpp::Type type, std::uint8_t* result,
+                        const std::uint8_t* slots, std::size_t slot_bytes,
+                        std::size_t slot_count, long begin, long end,
+                        THDReduceOp operation) {
+  if (type == thpp::Type::UCHAR)
+    reduceSlots<unsigned char>(result, slots, slot_bytes, slot_count, begin, end, operation);
+  else if (type == thpp::Type::CHAR)
+    reduceSlots<char>(result, slots, slot_bytes, slot_count, begin, end, operation);
+  else if (type == thpp::Type::SHORT)
+    reduceSlots<short>(result, slots, slot_bytes, slot_count, begin, end, operation);
+  else if (type == thpp::Type::INT)
+    reduceSlots<int>(result, slots, slot_bytes, slot_count, begin, end, operation);
+  else if (type == thpp::Type::LONG)
+    reduceSlots<long>(result, slots, slot_bytes, slot_count, begin, end, operation);
+  else if (type == thpp::Type::FLOAT)
+    reduceSlots<float>(result, slots, slot_bytes, slot_count, begin, end, operation);
+  else if (type == thpp::Type::DOUBLE)
+    reduceSlots<double>(result, slots, slot_bytes, slot_count, begin, end, operation);
+  else
+    throw std::invalid_argument("unsupported tensor type in shared memory reduction");
+}
+
+/*
+ * Memory of a tensor seen as `count` blocks of `block_bytes` contiguous bytes,
+ * in the order of tensor elements. Contiguous tensors are a single block.
+ */
+struct TensorBlocks {
+  explicit TensorBlocks(thpp::Tensor& tensor)
+    : data(static_cast<std::uint8_t*>(tensor.data()))
+    , block_bytes(tensor.elementSize())
+    , count(tensor.numel() > 0 ? 1 : 0)
+  {
+    auto sizes = tensor.sizes();
+    auto strides = tensor.strides();
+
+    // merge innermost dimensions as long as they are laid out contiguously
+    long dim = static_cast<long>(sizes.size()) - 1;
+    long block_numel = 1;
+    for (; dim >= 0 && (sizes[dim] == 1 || strides[dim] == block_numel); --dim)
+      block_numel *= sizes[dim];
+    block_bytes *= block_numel;
+
+    for (; dim >= 0; --dim) {
+      if (sizes[dim] == 1)
+        continue;
+
+      outer_sizes.insert(outer_sizes.begin(), sizes[dim]);
+      outer_strides.insert(outer_strides.begin(), strides[dim] * tensor.elementSize());
+      count *= sizes[dim];
+    }
+  }
+
+  std::uint8_t* block(std::uint64_t index) const {
+    std::uint8_t* ptr = data;
+    for (long dim = static_cast<long>(outer_sizes.size()) - 1; dim >= 0; --dim) {
+      ptr += (index % outer_sizes[dim]) * outer_strides[dim];
+      index /= outer_sizes[dim];
+    }
+    return ptr;
+  }
+
+  std::uint8_t* data;
+  std::uint64_t block_bytes;
+  std::uint64_t count;
+  std::vector<long> outer_sizes;
+  std::vector<long> outer_strides; // in bytes
+};
+
+// Calls `fn(pointer, length)` for consecutive pieces of memory holding bytes
+// [`offset`, `offset + length`) of `blocks`
+template<typename F>
+inline void forEachPiece(const TensorBlocks& blocks, std::uint64_t offset,
+                         std::uint64_t length, F fn) {
+  std::uint64_t index = offset / blocks.block_bytes;
+  std::uint64_t skip = offset % blocks.block_bytes;
+  while (length > 0) {
+    auto piece_bytes = std::min(blocks.block_bytes - skip, length);
+    fn(blocks.block(index) + skip, piece_bytes);
+    length -= piece_bytes;
+    skip = 0;
+    ++index;
+  }
+}
+
+// Reads an integer setting from the environment, `default_value` if unset
+inline long loadEnv(const char* env, long default_value, long min) {
+  const char* value = std::getenv(env);
+  if (value == nullptr)
+    return default_value;
+
+  long result = std::stol(value);
+  if (result < min)
+    throw std::domain_error(std::string(env) + " has to be at least " +
+                            std::to_string(min));
+  return result;
+}
+
 struct QueueWorker {
 private:
   struct Task {
@@ -50,6 +201,14 @@ private:
       _cond.notify_all();
     }
 
+    void fail(std::exception_ptr exception) {
+      std::unique_lock<std::mutex> ulock(_mutex);
+      _exception = exception;
+      _completed = true;
+      ulock.unlock();
+      _cond.notify_all();
+    }
+
     bool isCompleted() {
       std::unique_lock<std::mutex> ulock(_mutex);
       _validate();
@@ -58,7 +217,7 @@ private:
 
     void wait() {
       std::unique_lock<std::mutex> ulock(_mutex);
-      if (!_completed)
+      while (!_completed)
         _cond.wait(ulock);
 
       _validate();
@@ -93,9 +252,18 @@ public:
   }
 
   ~QueueWorker() {
-    _exiting = true;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _exiting = true;
+    }
     _cond.notify_one();
     _main_thread.join();
+
+    // Tasks that never ran fail, so that nobody waits for them forever.
+    auto error = std::make_exception_ptr(std::runtime_error(
+        "worker was destroyed before the task was started"));
+    for (; !_queue.empty(); _queue.pop())
+      _queue.front()->fail(error);
   }
 
   QueueWorker(const QueueWorker&) = delete;
@@ -109,7 +277,7 @@ public:
 private:
   std::shared_ptr<Task> _pop() {
     std::unique_lock<std::mutex> ulock(_mutex);
-    if (_queue.empty())
+    while (_queue.empty() && !_exiting)
       _cond.wait(ulock);
 
     if (_exiting) // check if we were woken up by destructor
@@ -19,11 +19,14 @@
 #include "gloo/rendezvous/store.h"
 #include "gloo/rendezvous/prefix_store.h"
 
+#include <THPP/Traits.hpp>
+
 #ifdef WITH_CUDA
 #include <cuda.h>
 #include <THC/THC.h>
 #endif
 #include <cstdint>
+#include <list>
 #include <memory>
 #include <tuple>
 #include <vector>
@@ -37,6 +40,7 @@ using key_type = std::tuple<
   THDGroup,       // group
   DeviceType,     // tensors device type
   int,            // CUDA stream id used in the algorithm
+  thpp::Type,     // type of buffer elements
   std::size_t,    // input buffer bytes
   std::size_t,    // output buffer bytes
   THDReduceOp,    // reduce op
@@ -48,6 +52,28 @@ const THDReduceOp UNUSED_OP = THDReduceMIN;
 const int UNUSED_STREAM = -1;
 const rank_type UNUSED_RANK = -1;
 const std::size_t UNUSED_BYTES = 0;
+const thpp::Type UNUSED_TYPE = thpp::Type::CHAR;
+
+// Buffers are never smaller than this many bytes
+const std::size_t MIN_BUCKET_BYTES = 256;
+// Number of size classes between two consecutive powers of two
+const std::size_t BUCKETS_PER_POWER = 4;
+
+/*
+ * Rounds `bytes` up to its size class. Tensors of nearby sizes share an
+ * algorithm and its (padded) buffers, at most 1/BUCKETS_PER_POWER of which
+ * is padding. Every class is a multiple of the size of any element type.
+ */
+inline std::size_t bucketBytes(std::size_t bytes) {
+  if (bytes <= MIN_BUCKET_BYTES)
+    return MIN_BUCKET_BYTES;
+
+  std::size_t power = MIN_BUCKET_BYTES;
+  while (power * 2 < bytes)
+    power *= 2;
+  std::size_t step = power / BUCKETS_PER_POWER;
+  return (bytes + step - 1) / step * step;
+}
 
 // Forward declaration
 template<CollectiveType D, typename T>
@@ -60,7 +86,8 @@ struct algorithm_spec;
 MAKE_HASHABLE(
   thd::gloo_cache::key_type,
   std::get<0>(t), std::get<1>(t), std::get<2>(t), std::get<3>(t),
-  std::get<4>(t), std::get<5>(t), std::get<6>(t), std::get<7>(t)
+  static_cast<std::uint8_t>(std::get<4>(t)), std::get<5>(t), std::get<6>(t),
+  std::get<7>(t), std::get<8>(t)
 );
 
 
@@ -78,13 +105,26 @@ struct GlooCache {
     std::shared_ptr<algorithm_type>, // algorithm
     std::shared_ptr<buffer_type>,    // input buffer (nullptr if not used)
     std::shared_ptr<buffer_type>,    // output buffer (nullptr if not used)
-    std::shared_ptr<std::mutex>      // mutex to protect same algorithm from running concurrently
+    std::shared_ptr<std::mutex>,     // mutex to protect same algorithm from running concurrently
+    std::size_t                      // bytes of input buffer (size class of the tensor)
   >;
 
-  GlooCache(rank_type rank, std::shared_ptr<::gloo::transport::Device> device)
+  /*
+   * At most `capacity` algorithms are kept for every group; the least
+   * recently used one is dropped to make room for a new one. Collectives of
+   * a group are issued in the same order by all its members, so they all
+   * evict the same algorithms. Capacity has to be at least 2, so that
+   * an evicted algorithm is never still running in other processes.
+   */
+  GlooCache(rank_type rank, std::shared_ptr<::gloo::transport::Device> device,
+            std::size_t capacity)
    : _rank(rank)
    , _device(device)
-  {}
+   , _capacity(capacity)
+  {
+    if (_capacity < 2)
+      throw std::domain_error("GlooCache has to hold at least 2 algorithms");
+  }
 
   GlooCache(GlooCache const&)      = delete;
   void operator=(GlooCache const&) = delete;
@@ -107,6 +147,10 @@ struct GlooCache {
     return std::get<3>(t);
   }
 
+  static inline std::size_t buffer_bytes(const value_type& t) {
+    return std::get<4>(t);
+  }
+
 
   // NOTE: this function needs to be thread safe
   std::shared_ptr<context_type> createContext(
@@ -123,7 +167,8 @@ struct GlooCache {
   // NOTE: this function needs to be thread safe
   std::shared_ptr<buffer_type> createBuffer(std::size_t bytes, DeviceType device) const {
     if (device == DeviceType::CPU) {
-      return std::shared_ptr<buffer_type>(new char[bytes],
+      // zeroed, so that padding never holds stale values
+      return std::shared_ptr<buffer_type>(new char[bytes](),
                                           std::default_delete<char[]>());
 #ifdef WITH_CUDA
     } else if (device == DeviceType::CUDA) {
@@ -142,23 +187,42 @@ struct GlooCache {
     auto key = gloo_cache::algorithm_spec<D, T>::key(group_id, args...);
 
     std::unique_lock<std::mutex> lock(_mutex);
+    auto& lru = _lru[group_id];
     auto it = _algorithms.find(key);
-    if (it == _algorithms.end()) {
-      lock.unlock();
+    if (it != _algorithms.end()) {
+      lru.splice(lru.begin(), lru, it->second.lru_position);
+      return it->second.value;
+    }
 
-      auto algorithm = gloo_cache::algorithm_spec<D, T>::create(*this, group,
-              print_key(key), std::forward<Args>(args)...);
+    // Algorithms recreated after an eviction need fresh keys in the store
+    std::string prefix = print_key(key) + "-" + std::to_string(_generations[key]++);
+    lock.unlock();
 
-      lock.lock();
+    auto algorithm = gloo_cache::algorithm_spec<D, T>::create(*this, group,
+            prefix, std::forward<Args>(args)...);
 
-      bool inserted;
-      std::tie(it, inserted) = _algorithms.emplace(
-        std::move(key), std::move(algorithm));
-      if (!inserted)
-          throw std::runtime_error("detected a race when creating Gloo algorithm");
+    lock.lock();
+
+    bool inserted;
+    std::tie(it, inserted) = _algorithms.emplace(
+      key, entry_type{std::move(algorithm), lru.end()});
+    if (!inserted)
+        throw std::runtime_error("detected a race when creating Gloo algorithm");
+    it->second.lru_position = lru.insert(lru.begin(), std::move(key));
+
+    // Running algorithms are kept alive by the value returned to their callers
+    while (lru.size() > _capacity) {
+      _algorithms.erase(lru.back());
+      lru.pop_back();
     }
 
-    return it->second;
+    return it->second.value;
+  }
+
+  // Number of algorithms currently cached for all groups
+  std::size_t size() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _algorithms.size();
   }
 
   static void memcpy_input(value_type& info, thpp::Tensor& t) {
@@ -203,19 +267,28 @@ private:
       + std::to_string(std::get<1>(k)) + "-"
       + std::to_string(static_cast<uint8_t>(std::get<2>(k))) + "-"
       + std::to_string(std::get<3>(k)) + "-"
-      + std::to_string(std::get<4>(k)) + "-"
+      + std::to_string(static_cast<uint8_t>(std::get<4>(k))) + "-"
       + std::to_string(std::get<5>(k)) + "-"
       + std::to_string(std::get<6>(k)) + "-"
-      + std::to_string(std::get<7>(k));
+      + std::to_string(std::get<7>(k)) + "-"
+      + std::to_string(std::get<8>(k));
   }
 
+  struct entry_type {
+    value_type value;
+    std::list<key_type>::iterator lru_position;
+  };
+
   rank_type _rank;
   std::shared_ptr<::gloo::transport::Device> _device;
   std::shared_ptr<store_type> _store;
+  std::size_t _capacity; // maximal number of algorithms cached for a group
 
   std::mutex _mutex;
 
-  std::unordered_map<key_type, value_type> _algorithms;
+  std::unordered_map<key_type, entry_type> _algorithms;
+  std::unordered_map<THDGroup, std::list<key_type>> _lru; // most recently used first
+  std::unordered_map<key_type, std::size_t> _generations; // times each key was created
 };
 
 namespace gloo_cache {
@@ -239,19 +312,24 @@ const ::gloo::ReductionFunction<T>* THDToGlooReduceOp(THDReduceOp op) {
 template<typename T>
 struct algorithm_spec<CollectiveType::ALL_GATHER, T> {
   static GlooCache::key_type key(
-    THDGroup group_id, DeviceType device, std::size_t input_bytes, std::size_t output_bytes, std::size_t unused_count
+    THDGroup group_id, DeviceType device, std::size_t input_bytes
   ) {
+    thpp::Type type = thpp::type_traits<T>::type;
     return std::make_tuple(CollectiveType::ALL_GATHER, group_id, device, UNUSED_STREAM,
-                           input_bytes, output_bytes, UNUSED_OP, UNUSED_RANK);
+                           type, bucketBytes(input_bytes),
+                           UNUSED_BYTES, UNUSED_OP, UNUSED_RANK);
   }
 
+  // Output buffer holds inputs of all processes, each padded to the size class
   static GlooCache::value_type create(GlooCache& cache,
     const DataChannelGloo::Group& group, const std::string& store_prefix,
-    DeviceType device, std::size_t input_bytes, std::size_t output_bytes, std::size_t count
+    DeviceType device, std::size_t input_bytes
   ) {
+    std::size_t bucket_bytes = bucketBytes(input_bytes);
+    std::size_t count = bucket_bytes / sizeof(T);
     auto context = cache.createContext(group, store_prefix);
-    auto input_buffer = cache.createBuffer(input_bytes, device);
-    auto output_buffer = cache.createBuffer(output_bytes, device);
+    auto input_buffer = cache.createBuffer(bucket_bytes, device);
+    auto output_buffer = cache.createBuffer(bucket_bytes * group.size(), device);
 
     std::shared_ptr<GlooCache::algorithm_type> algo;
     if (device == DeviceType::CPU) {
@@ -268,7 +346,8 @@ struct algorithm_spec<CollectiveType::ALL_GATHER, T> {
       algo,
       input_buffer,
       output_buffer,
-      std::make_shared<std::mutex>()
+      std::make_shared<std::mutex>(),
+      bucket_bytes
     );
   }
 };
@@ -276,24 +355,29 @@ struct algorithm_spec<CollectiveType::ALL_GATHER, T> {
 template<typename T>
 struct algorithm_spec<CollectiveType::ALL_REDUCE, T> {
   static GlooCache::key_type key(
-    THDGroup group_id, DeviceType device, std::size_t input_bytes,
-    std::size_t unused_count, THDReduceOp op
+    THDGroup group_id, DeviceType device, std::size_t input_bytes, THDReduceOp op
   ) {
     int stream = UNUSED_STREAM;
     if (device == DeviceType::CUDA) {
       auto cuda_stream = THCState_getCurrentStream(THDGetCudaState());
       stream = THDGetStreamId(cuda_stream);
     }
+    thpp::Type type = thpp::type_traits<T>::type;
+    std::size_t bucket_bytes = bucketBytes(input_bytes);
     return std::make_tuple(CollectiveType::ALL_REDUCE, group_id, device, stream,
-                           input_bytes, input_bytes, op, UNUSED_RANK);
+                           type, bucket_bytes, bucket_bytes,
+                           op, UNUSED_RANK);
   }
 
+  // Padding is reduced too, but never copied back to the tensor
   static GlooCache::value_type create(GlooCache& cache,
     const DataChannelGloo::Group& group, const std::string& store_prefix,
-    DeviceType device, std::size_t input_bytes, std::size_t count, THDReduceOp op
+    DeviceType device, std::size_t input_bytes, THDReduceOp op
   ) {
+    std::size_t bucket_bytes = bucketBytes(input_bytes);
+    std::size_t count = bucket_bytes / sizeof(T);
     auto context = cache.createContext(group, store_prefix);
-    auto input_buffer = cache.createBuffer(input_bytes, device);
+    auto input_buffer = cache.createBuffer(bucket_bytes, device);
 
     std::shared_ptr<GlooCache::algorithm_type> algo;
     if (device == DeviceType::CPU) {
@@ -322,7 +406,8 @@ struct algorithm_spec<CollectiveType::ALL_REDUCE, T> {
       algo,
       input_buffer,
       input_buffer, // we get the result in same buffer
-      std::make_shared<std::mutex>()
+      std::make_shared<std::mutex>(),
+      bucket_bytes
     );
   }
 };
@@ -330,24 +415,28 @@ struct algorithm_spec<CollectiveType::ALL_REDUCE, T> {
 template<typename T>
 struct algorithm_spec<CollectiveType::BROADCAST, T> {
   static GlooCache::key_type key(
-    THDGroup group_id, DeviceType device, std::size_t input_bytes,
-    std::size_t unused_count, rank_type src_rank
+    THDGroup group_id, DeviceType device, std::size_t input_bytes, rank_type src_rank
   ) {
     int stream = UNUSED_STREAM;
     if (device == DeviceType::CUDA) {
       auto cuda_stream = THCState_getCurrentStream(THDGetCudaState());
       stream = THDGetStreamId(cuda_stream);
     }
+    thpp::Type type = thpp::type_traits<T>::type;
+    std::size_t bucket_bytes = bucketBytes(input_bytes);
     return std::make_tuple(CollectiveType::BROADCAST, group_id, device, stream,
-                           input_bytes, input_bytes, UNUSED_OP, src_rank);
+                           type, bucket_bytes, bucket_bytes,
+                           UNUSED_OP, src_rank);
   }
 
   static GlooCache::value_type create(GlooCache& cache,
     const DataChannelGloo::Group& group, const std::string& store_prefix,
-    DeviceType device, std::size_t input_bytes, std::size_t count, rank_type src_rank
+    DeviceType device, std::size_t input_bytes, rank_type src_rank
   ) {
+    std::size_t bucket_bytes = bucketBytes(input_bytes);
+    std::size_t count = bucket_bytes / sizeof(T);
     auto context = cache.createContext(group, store_prefix);
-    auto input_buffer = cache.createBuffer(input_bytes, device);
+    auto input_buffer = cache.createBuffer(bucket_bytes, device);
 
     std::shared_ptr<GlooCache::algorithm_type> algo;
     if (device == DeviceType::CPU) {
@@ -375,7 +464,8 @@ struct algorithm_spec<CollectiveType::BROADCAST, T> {
       algo,
       input_buffer,
       input_buffer, // we get the result in same buffer
-      std::make_shared<std::mutex>()
+      std::make_shared<std::mutex>(),
+      bucket_bytes
     );
   }
 };
@@ -384,7 +474,7 @@ template<typename T> // unused
 struct algorithm_spec<CollectiveType::BARRIER, T> {
   static GlooCache::key_type key(THDGroup group_id) {
     return std::make_tuple(CollectiveType::BARRIER, group_id, UNUSED_DEVICE, UNUSED_STREAM,
-                           UNUSED_BYTES, UNUSED_BYTES, UNUSED_OP, UNUSED_RANK);
+                           UNUSED_TYPE, UNUSED_BYTES, UNUSED_BYTES, UNUSED_OP, UNUSED_RANK);
   }
 
   static GlooCache::value_type create(GlooCache& cache,
@@ -395,7 +485,8 @@ struct algorithm_spec<CollectiveType::BARRIER, T> {
       std::make_shared<::gloo::BarrierAllToAll>(context),
       nullptr,
       nullptr,
-      std::make_shared<std::mutex>()
+      std::make_shared<std::mutex>(),
+      UNUSED_BYTES
     );
   }
 };
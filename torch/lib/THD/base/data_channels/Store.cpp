@@ -1,9 +1,12 @@
 #include "Store.hpp"
 #include "../ChannelUtils.hpp"
 
-#include <poll.h>
-#include <system_error>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <system_error>
 
 namespace thd {
 
@@ -13,17 +16,60 @@ enum class QueryType : std::uint8_t {
   SET,
   GET,
   WAIT,
-  STOP_WAITING
+  STOP_WAITING,
+  MULTI_SET,
+  MULTI_GET,
+  WAIT_PREFIX,
+  ADD,
+  COMPARE_SET
 };
 
+constexpr std::size_t MAX_IO_THREADS = 4;
+constexpr int MAX_EVENTS = 64;
+
+std::vector<char> encodeCounter(std::int64_t value) {
+  std::vector<char> data(sizeof(value));
+  std::memcpy(data.data(), &value, sizeof(value));
+  return data;
+}
+
+std::int64_t decodeCounter(const std::vector<char>& data) {
+  if (data.size() != sizeof(std::int64_t))
+    throw std::runtime_error("value in the store is not a counter");
+  std::int64_t value;
+  std::memcpy(&value, data.data(), sizeof(value));
+  return value;
+}
+
 } // anonymous namespace
 
 Store::StoreDeamon::StoreDeamon(int listen_socket)
  : _listen_socket(listen_socket)
- , _keys_awaited()
+ , _stop_event(-1)
+ , _finished(false)
+ , _next_thread(0)
  , _sockets()
 {
-  _deamon = std::thread(&Store::StoreDeamon::deamon, this);
+  std::size_t num_threads = std::max<std::size_t>(1,
+    std::min<std::size_t>(std::thread::hardware_concurrency(), MAX_IO_THREADS));
+
+  SYSCHECK(_stop_event = ::eventfd(0, 0));
+  for (std::size_t i = 0; i < num_threads; i++) {
+    int epoll_fd;
+    SYSCHECK(epoll_fd = ::epoll_create1(0));
+    _epoll_fds.push_back(epoll_fd);
+
+    struct epoll_event event = { .events = EPOLLIN, .data = { .fd = _stop_event } };
+    SYSCHECK(::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, _stop_event, &event));
+  }
+
+  // first thread accepts new connections and hands them to all threads in turn
+  struct epoll_event event = { .events = EPOLLIN, .data = { .fd = _listen_socket } };
+  SYSCHECK(::epoll_ctl(_epoll_fds[0], EPOLL_CTL_ADD, _listen_socket, &event));
+
+  for (std::size_t i = 0; i < num_threads; i++) {
+    _threads.emplace_back(&Store::StoreDeamon::ioLoop, this, i);
+  }
 }
 
 Store::StoreDeamon::~StoreDeamon()
@@ -33,50 +79,67 @@ Store::StoreDeamon::~StoreDeamon()
     if (socket != -1)
       ::close(socket);
   }
+  for (auto epoll_fd : _epoll_fds) {
+    ::close(epoll_fd);
+  }
+  ::close(_stop_event);
 }
 
 void Store::StoreDeamon::join() {
-  _deamon.join();
+  for (auto& thread : _threads) {
+    thread.join();
+  }
+}
+
+void Store::StoreDeamon::finish() {
+  _finished = true;
+  std::uint64_t one = 1;
+  if (::write(_stop_event, &one, sizeof(one)) != sizeof(one))
+    throw std::system_error(errno, std::system_category());
 }
 
-void Store::StoreDeamon::deamon() {
-  std::vector<struct pollfd> fds;
-  fds.push_back({ .fd = _listen_socket, .events = POLLIN });
+void Store::StoreDeamon::ioLoop(std::size_t thread) {
+  struct epoll_event events[MAX_EVENTS];
 
   // receive the queries
-  bool finished = false;
-  while (!finished) {
-    for (std::size_t i = 0; i < _sockets.size(); i++) {
-      fds[i].revents = 0;
+  while (!_finished) {
+    int num_events = ::epoll_wait(_epoll_fds[thread], events, MAX_EVENTS, -1);
+    if (num_events < 0) {
+      if (errno == EINTR) continue;
+      throw std::system_error(errno, std::system_category());
     }
 
-    SYSCHECK(::poll(fds.data(), fds.size(), -1));
-    if (fds[0].revents != 0) {
-      if (fds[0].revents ^ POLLIN)
-        throw std::system_error(ECONNABORTED, std::system_category());
+    for (int i = 0; i < num_events && !_finished; i++) {
+      int fd = events[i].data.fd;
+      if (fd == _stop_event)
+        break;
 
-      int sock_fd = std::get<0>(accept(_listen_socket));
-      _sockets.push_back(sock_fd);
-      _keys_awaited.push_back(0);
-      fds.push_back({ .fd = sock_fd, .events = POLLIN });
-    }
-    for (std::size_t rank = 0; rank < _sockets.size(); rank++) {
-      if (fds[rank + 1].revents == 0)
-        continue;
+      if (fd == _listen_socket) {
+        if (events[i].events ^ EPOLLIN)
+          throw std::system_error(ECONNABORTED, std::system_category());
 
-      if (fds[rank + 1].revents ^ POLLIN)
-        throw std::system_error(ECONNABORTED, std::system_category());
+        int sock_fd = std::get<0>(accept(_listen_socket));
+        {
+          std::lock_guard<std::mutex> lock(_mutex);
+          _sockets.push_back(sock_fd);
+        }
+        struct epoll_event event = { .events = EPOLLIN, .data = { .fd = sock_fd } };
+        SYSCHECK(::epoll_ctl(_epoll_fds[_next_thread], EPOLL_CTL_ADD, sock_fd, &event));
+        _next_thread = (_next_thread + 1) % _epoll_fds.size();
+        continue;
+      }
 
       try {
-        query(rank);
+        if (events[i].events ^ EPOLLIN)
+          throw std::system_error(ECONNABORTED, std::system_category());
+        query(fd);
       } catch (...) {
         // There was an error when processing query. Probably an exception occurred in
         // recv/send what would indicate that socket on the other side has been closed.
         // If the closing was due to normal exit, then the store should exit too.
         // Otherwise, if it was different exception, other processes will get
         // an exception once they try to use the store.
-        finished = true;
-        break;
+        finish();
       }
     }
   }
@@ -86,61 +149,184 @@ void Store::StoreDeamon::deamon() {
  * query communicates with the worker. The format
  * of the query is as follows:
  * type of query | size of arg1 | arg1 | size of arg2 | arg2 | ...
- * or, in the case of wait
- * type of query | number of args | size of arg1 | arg1 | ...
+ * or, in the case of queries with a variable number of keys
+ * type of query | number of keys | size of key1 | key1 | ...
  */
-void Store::StoreDeamon::query(rank_type rank) {
-  int socket = _sockets[rank];
+void Store::StoreDeamon::query(int socket) {
   QueryType qt;
   recv_bytes<QueryType>(socket, &qt, 1);
+  std::vector<Reply> replies;
   if (qt == QueryType::SET) {
     std::string key = recv_string(socket);
-    _store[key] = recv_vector<char>(socket);
-    // On "set", wake up all of the processes that wait
-    // for keys already in the store
-    auto to_wake = _waiting.find(key);
-    if (to_wake != _waiting.end()) {
-      for (int proc : to_wake->second) {
-        if (--_keys_awaited[proc] == 0)
-          send_value<QueryType>(_sockets[proc], QueryType::STOP_WAITING);
-      }
-      _waiting.erase(to_wake);
-    }
-  } else if (qt == QueryType::GET) {
-    std::string key = recv_string(socket);
-    std::vector<char> data = _store.at(key);
-    send_vector(socket, data);
-  } else if (qt == QueryType::WAIT) {
+    std::vector<char> data = recv_vector<char>(socket);
+    std::lock_guard<std::mutex> lock(_mutex);
+    setKey(key, std::move(data), replies);
+  } else if (qt == QueryType::MULTI_SET) {
     size_type nargs;
     recv_bytes<size_type>(socket, &nargs, 1);
-    std::vector<std::string> keys(nargs);
+    std::vector<std::pair<std::string, std::vector<char>>> items(nargs);
+    for (auto& item : items) {
+      item.first = recv_string(socket);
+      item.second = recv_vector<char>(socket);
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto& item : items) {
+      setKey(item.first, std::move(item.second), replies);
+    }
+  } else if (qt == QueryType::GET || qt == QueryType::MULTI_GET ||
+             qt == QueryType::WAIT) {
+    PendingQuery query;
+    query.type = static_cast<std::uint8_t>(qt);
+    size_type nargs = 1;
+    if (qt != QueryType::GET)
+      recv_bytes<size_type>(socket, &nargs, 1);
+    query.keys.resize(nargs);
     for (std::size_t i = 0; i < nargs; i++) {
-      keys[i] = recv_string(socket);
+      query.keys[i] = recv_string(socket);
     }
-    if (checkAndUpdate(keys)) {
-      send_value<QueryType>(socket, QueryType::STOP_WAITING);
-    } else {
-      for (auto& key : keys) {
-        _waiting[key].push_back(rank);
+    query.prefix_awaited = 0;
+    std::lock_guard<std::mutex> lock(_mutex);
+    enqueue(socket, std::move(query), replies);
+  } else if (qt == QueryType::WAIT_PREFIX) {
+    PendingQuery query;
+    query.type = static_cast<std::uint8_t>(qt);
+    query.prefix = recv_string(socket);
+    size_type count;
+    recv_bytes<size_type>(socket, &count, 1);
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::size_t present = 0;
+    for (auto& item : _store) {
+      if (item.first.compare(0, query.prefix.size(), query.prefix) == 0)
+        present++;
+    }
+    query.prefix_awaited = present < count ? count - present : 0;
+    enqueue(socket, std::move(query), replies);
+  } else if (qt == QueryType::ADD) {
+    std::string key = recv_string(socket);
+    std::int64_t value;
+    recv_bytes<std::int64_t>(socket, &value, 1);
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      auto it = _store.find(key);
+      if (it != _store.end())
+        value += decodeCounter(it->second);
+      setKey(key, encodeCounter(value), replies);
+    }
+    send_value<std::int64_t>(socket, value);
+  } else if (qt == QueryType::COMPARE_SET) {
+    std::string key = recv_string(socket);
+    std::vector<char> expected = recv_vector<char>(socket);
+    std::vector<char> desired = recv_vector<char>(socket);
+    std::vector<char> result;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      auto it = _store.find(key);
+      if ((it == _store.end() && expected.empty()) ||
+          (it != _store.end() && it->second == expected)) {
+        setKey(key, std::move(desired), replies);
+        it = _store.find(key);
       }
-      _keys_awaited[rank] = keys.size();
+      if (it != _store.end())
+        result = it->second;
     }
+    send_vector<char>(socket, result);
   } else {
     throw std::runtime_error("expected a query type");
   }
+
+  sendReplies(replies);
+}
+
+bool Store::StoreDeamon::isSet(const std::string& key) const {
+  return _store.count(key) > 0;
+}
+
+void Store::StoreDeamon::setKey(const std::string& key, std::vector<char> data,
+                                std::vector<Reply>& replies) {
+  bool is_new = !isSet(key);
+  _store[key] = std::move(data);
+  if (!is_new)
+    return;
+
+  // On "set" of a new key, wake up all of the processes that wait for it
+  std::vector<int> to_wake;
+  auto waiting = _waiting.find(key);
+  if (waiting != _waiting.end()) {
+    for (int socket : waiting->second) {
+      if (--_pending.at(socket).keys_awaited == 0)
+        to_wake.push_back(socket);
+    }
+    _waiting.erase(waiting);
+  }
+  for (int socket : _waiting_prefix) {
+    auto& query = _pending.at(socket);
+    if (query.prefix_awaited > 0 &&
+        key.compare(0, query.prefix.size(), query.prefix) == 0 &&
+        --query.prefix_awaited == 0)
+      to_wake.push_back(socket);
+  }
+
+  for (int socket : to_wake) {
+    auto& query = _pending.at(socket);
+    if (query.keys_awaited > 0 || query.prefix_awaited > 0)
+      continue;
+    respond(socket, query, replies);
+    if (query.type == static_cast<std::uint8_t>(QueryType::WAIT_PREFIX)) {
+      _waiting_prefix.erase(
+        std::remove(_waiting_prefix.begin(), _waiting_prefix.end(), socket),
+        _waiting_prefix.end());
+    }
+    _pending.erase(socket);
+  }
 }
 
-bool Store::StoreDeamon::checkAndUpdate(std::vector<std::string>& keys) const {
-  bool ret = true;
-  for (auto it = keys.begin(); it != keys.end();) {
-    if (_store.count(*it) == 0) {
-      ret = false;
-      it++;
+void Store::StoreDeamon::enqueue(int socket, PendingQuery query,
+                                 std::vector<Reply>& replies) {
+  query.keys_awaited = 0;
+  for (auto& key : query.keys) {
+    if (!isSet(key)) {
+      _waiting[key].push_back(socket);
+      query.keys_awaited++;
+    }
+  }
+
+  if (query.keys_awaited == 0 && query.prefix_awaited == 0) {
+    respond(socket, query, replies);
+    return;
+  }
+
+  if (query.type == static_cast<std::uint8_t>(QueryType::WAIT_PREFIX))
+    _waiting_prefix.push_back(socket);
+  _pending[socket] = std::move(query);
+}
+
+void Store::StoreDeamon::respond(int socket, const PendingQuery& query,
+                                 std::vector<Reply>& replies) {
+  Reply reply = { socket, query.type, {} };
+  auto type = static_cast<QueryType>(query.type);
+  if (type == QueryType::GET || type == QueryType::MULTI_GET) {
+    for (auto& key : query.keys) {
+      reply.values.push_back(_store.at(key));
+    }
+  }
+  replies.push_back(std::move(reply));
+}
+
+void Store::StoreDeamon::sendReplies(const std::vector<Reply>& replies) {
+  /*
+   * Every client waits for the answer to its only query, so no other thread
+   * writes to these sockets until they are sent.
+   */
+  for (auto& reply : replies) {
+    auto type = static_cast<QueryType>(reply.type);
+    if (type == QueryType::GET || type == QueryType::MULTI_GET) {
+      for (std::size_t i = 0; i < reply.values.size(); i++) {
+        send_vector<char>(reply.socket, reply.values[i], i + 1 < reply.values.size());
+      }
     } else {
-      it = keys.erase(it);
+      send_value<QueryType>(reply.socket, QueryType::STOP_WAITING);
     }
   }
-  return ret;
 }
 
 
@@ -171,20 +357,20 @@ Store::~Store() {
 }
 
 void Store::set(const std::string& key, const std::vector<char>& data) {
-  send_value<QueryType>(_socket, QueryType::SET);
+  send_value<QueryType>(_socket, QueryType::SET, true);
   send_string(_socket, key, true);
   send_vector<char>(_socket, data);
 }
 
 std::vector<char> Store::get(const std::string& key) {
-  wait({key});
-  send_value<QueryType>(_socket, QueryType::GET);
+  // the deamon answers once the key is set
+  send_value<QueryType>(_socket, QueryType::GET, true);
   send_string(_socket, key);
   return recv_vector<char>(_socket);
 }
 
 void Store::wait(const std::vector<std::string>& keys) {
-  send_value<QueryType>(_socket, QueryType::WAIT);
+  send_value<QueryType>(_socket, QueryType::WAIT, true);
   size_type nkeys = keys.size();
   send_bytes<size_type>(_socket, &nkeys, 1, (nkeys > 0));
   for (std::size_t i = 0; i < nkeys; i++) {
@@ -197,4 +383,61 @@ void Store::wait(const std::vector<std::string>& keys) {
     throw std::runtime_error("stop_waiting response expected");
 }
 
+void Store::set(const std::vector<std::string>& keys,
+                const std::vector<std::vector<char>>& data) {
+  if (keys.size() != data.size())
+    throw std::invalid_argument("number of keys and values differs");
+  send_value<QueryType>(_socket, QueryType::MULTI_SET, true);
+  size_type nkeys = keys.size();
+  send_bytes<size_type>(_socket, &nkeys, 1, (nkeys > 0));
+  for (std::size_t i = 0; i < nkeys; i++) {
+    send_string(_socket, keys[i], true);
+    send_vector<char>(_socket, data[i], (i != (nkeys - 1)));
+  }
+}
+
+std::vector<std::vector<char>> Store::get(const std::vector<std::string>& keys) {
+  send_value<QueryType>(_socket, QueryType::MULTI_GET, true);
+  size_type nkeys = keys.size();
+  send_bytes<size_type>(_socket, &nkeys, 1, (nkeys > 0));
+  for (std::size_t i = 0; i < nkeys; i++) {
+    send_string(_socket, keys[i], (i != (nkeys - 1)));
+  }
+  std::vector<std::vector<char>> data(nkeys);
+  for (auto& value : data) {
+    value = recv_vector<char>(_socket);
+  }
+  return data;
+}
+
+void Store::waitPrefix(const std::string& prefix, std::size_t count) {
+  send_value<QueryType>(_socket, QueryType::WAIT_PREFIX, true);
+  send_string(_socket, prefix, true);
+  size_type size = count;
+  send_bytes<size_type>(_socket, &size, 1);
+  QueryType qr;
+  recv_bytes<QueryType>(_socket, &qr, 1);
+  if (qr != QueryType::STOP_WAITING)
+    throw std::runtime_error("stop_waiting response expected");
+}
+
+std::int64_t Store::add(const std::string& key, std::int64_t value) {
+  send_value<QueryType>(_socket, QueryType::ADD, true);
+  send_string(_socket, key, true);
+  send_value<std::int64_t>(_socket, value);
+  std::int64_t result;
+  recv_bytes<std::int64_t>(_socket, &result, 1);
+  return result;
+}
+
+std::vector<char> Store::compareSet(const std::string& key,
+                                    const std::vector<char>& expected,
+                                    const std::vector<char>& desired) {
+  send_value<QueryType>(_socket, QueryType::COMPARE_SET, true);
+  send_string(_socket, key, true);
+  send_vector<char>(_socket, expected, true);
+  send_vector<char>(_socket, desired);
+  return recv_vector<char>(_socket);
+}
+
 } // namespace thd
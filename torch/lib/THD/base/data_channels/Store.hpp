@@ -3,7 +3,10 @@
 #include "../ChannelUtils.hpp"
 #include "gloo/rendezvous/store.h"
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <unordered_map>
@@ -13,6 +16,12 @@ namespace thd {
 
 struct Store : public ::gloo::rendezvous::Store {
 private:
+  /*
+   * Connections are spread over a few threads, each waiting on its own
+   * epoll set. Queries that can't be answered yet (waits and gets of
+   * missing keys) are kept until a `set` makes them complete, so no
+   * client ever polls the store.
+   */
   struct StoreDeamon {
     StoreDeamon() = delete;
     StoreDeamon(int listen_socket);
@@ -23,16 +32,50 @@ private:
   private:
     using store_type = std::unordered_map<std::string, std::vector<char>>;
 
-    void deamon();
-    void query(rank_type rank);
-    bool checkAndUpdate(std::vector<std::string>& keys) const;
+    // query of a single client that waits for some keys to be set
+    struct PendingQuery {
+      std::uint8_t type;
+      std::vector<std::string> keys;
+      std::size_t keys_awaited;
+      std::string prefix;
+      std::size_t prefix_awaited; // number of keys with `prefix` still missing
+    };
+
+    // answer to a query, sent only after `_mutex` is released so that a slow
+    // client can't stall the other threads
+    struct Reply {
+      int socket;
+      std::uint8_t type;
+      std::vector<std::vector<char>> values; // for gets
+    };
+
+    void ioLoop(std::size_t thread);
+    void query(int socket);
+    void finish();
+
+    // all of these require `_mutex` to be locked, and add the answers to
+    // completed queries to `replies`
+    bool isSet(const std::string& key) const;
+    void setKey(const std::string& key, std::vector<char> data,
+                std::vector<Reply>& replies);
+    void enqueue(int socket, PendingQuery query, std::vector<Reply>& replies);
+    void respond(int socket, const PendingQuery& query,
+                 std::vector<Reply>& replies);
+
+    void sendReplies(const std::vector<Reply>& replies);
 
     int _listen_socket;
+    int _stop_event; // wakes up all threads when the store is closing
+    std::atomic<bool> _finished;
+    std::vector<int> _epoll_fds; // one per thread
+    std::vector<std::thread> _threads;
+    std::size_t _next_thread; // thread that gets the next connection
 
-    std::thread _deamon;
+    std::mutex _mutex;
     store_type _store;
-    std::unordered_map<std::string, std::vector<rank_type>> _waiting;
-    std::vector<std::size_t> _keys_awaited;
+    std::unordered_map<int, PendingQuery> _pending;
+    std::unordered_map<std::string, std::vector<int>> _waiting; // key -> sockets
+    std::vector<int> _waiting_prefix; // sockets waiting for a prefix
     std::vector<int> _sockets;
   };
 
@@ -47,6 +90,27 @@ public:
   std::vector<char> get(const std::string& key) override;
   void wait(const std::vector<std::string>& keys) override;
 
+  /*
+   * Batched versions of the operations above take a single round trip.
+   * `get` blocks until all keys are set.
+   */
+  void set(const std::vector<std::string>& keys,
+           const std::vector<std::vector<char>>& data);
+  std::vector<std::vector<char>> get(const std::vector<std::string>& keys);
+  // Blocks until at least `count` keys starting with `prefix` are set.
+  void waitPrefix(const std::string& prefix, std::size_t count);
+
+  // Atomically adds `value` to a counter (0 if it's not set), returns the result.
+  std::int64_t add(const std::string& key, std::int64_t value);
+  /*
+   * Atomically replaces the value of `key` with `desired` if it is equal to
+   * `expected`, an empty `expected` matches a key that is not set. Returns
+   * the value after the operation.
+   */
+  std::vector<char> compareSet(const std::string& key,
+                               const std::vector<char>& expected,
+                               const std::vector<char>& desired);
+
 private:
   int _listen_socket;
   int _socket;
@@ -46,6 +46,10 @@ std::vector<std::string> getInterfaceAddresses() {
 }
 
 std::string discoverWorkers(int listen_socket, rank_type world_size) {
+  // a process without workers has no peer that could tell its address
+  if (world_size == 1)
+    return "127.0.0.1";
+
   // accept connections from workers so they can know our address
   std::vector<int> sockets(world_size - 1);
   for (rank_type i = 0; i < world_size - 1; ++i) {
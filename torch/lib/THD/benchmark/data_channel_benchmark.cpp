@@ -0,0 +1,427 @@
+/*
+ * Native benchmark of THD data channels.
+ *
+ * Every collective is run on tensors of a range of sizes, on the whole world
+ * and optionally on a group made of the even ranks. Every configuration is
+ * reported by rank 0 as a single line of JSON with latency percentiles and
+ * bandwidth. Latency of an iteration is the maximum over all processes.
+ *
+ * TCP, Gloo and SHM processes are forked on localhost, once for every process
+ * count given in --processes. MPI processes have to be launched by mpirun:
+ *
+ *   mpirun -n 4 ./benchmark_data_channel --backend mpi
+ */
+#include "../base/DataChannel.hpp"
+
+#include <THPP/tensors/THTensor.hpp>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+enum class Collective {
+  BROADCAST,
+  ALL_REDUCE,
+  REDUCE,
+  ALL_GATHER,
+  GATHER,
+  SCATTER,
+  REDUCE_SCATTER,
+  ALL_TO_ALL,
+  BARRIER,
+};
+
+const std::vector<std::pair<Collective, std::string>> COLLECTIVES = {
+  {Collective::BROADCAST, "broadcast"},
+  {Collective::ALL_REDUCE, "all_reduce"},
+  {Collective::REDUCE, "reduce"},
+  {Collective::ALL_GATHER, "all_gather"},
+  {Collective::GATHER, "gather"},
+  {Collective::SCATTER, "scatter"},
+  {Collective::REDUCE_SCATTER, "reduce_scatter"},
+  {Collective::ALL_TO_ALL, "all_to_all"},
+  {Collective::BARRIER, "barrier"},
+};
+
+struct Options {
+  std::string backend = "tcp";
+  std::vector<int> processes = {2, 4};
+  std::vector<std::string> collectives;
+  int min_bytes = 3;  // 2**3 = 8 B
+  int max_bytes = 22; // 2**22 = 4 MB
+  int iterations = 100;
+  int warmup = 10;
+  bool groups = false;
+  int port = 29500;
+};
+
+void usage() {
+  std::cout <<
+    "Usage: benchmark_data_channel [ OPTIONS ]\n"
+    "\n"
+    "    --backend BACKEND       tcp, gloo, shm or mpi. Default: 'tcp'.\n"
+    "    --processes LIST        process counts, e.g. '2,4,8'. Default: '2,4'.\n"
+    "                            Ignored by mpi, which uses all processes.\n"
+    "    --collectives LIST      collectives to run, e.g. 'broadcast,all_reduce'.\n"
+    "                            Default: all of them.\n"
+    "    --min-bytes N           smallest tensor is 2**N bytes. Default: 3.\n"
+    "    --max-bytes N           largest tensor is 2**N bytes. Default: 22.\n"
+    "    --iterations N          timed iterations of every run. Default: 100.\n"
+    "    --warmup N              untimed iterations of every run. Default: 10.\n"
+    "    --groups                also run on a group of the even ranks.\n"
+    "    --port PORT             first port used by the master. Default: 29500.\n";
+}
+
+template<typename T>
+std::vector<T> splitList(const std::string& list, T (*convert)(const std::string&)) {
+  std::vector<T> result;
+  std::stringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ','))
+    result.push_back(convert(item));
+  return result;
+}
+
+int toInt(const std::string& s) { return std::stoi(s); }
+std::string toString(const std::string& s) { return s; }
+
+Options parseOptions(int argc, char** argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--help") {
+      usage();
+      std::exit(0);
+    } else if (arg == "--groups") {
+      options.groups = true;
+      continue;
+    }
+
+    if (i + 1 == argc)
+      throw std::invalid_argument("missing value of " + arg);
+    std::string value = argv[++i];
+    if (arg == "--backend") {
+      options.backend = value;
+    } else if (arg == "--processes") {
+      options.processes = splitList(value, toInt);
+    } else if (arg == "--collectives") {
+      options.collectives = splitList(value, toString);
+    } else if (arg == "--min-bytes") {
+      options.min_bytes = std::stoi(value);
+    } else if (arg == "--max-bytes") {
+      options.max_bytes = std::stoi(value);
+    } else if (arg == "--iterations") {
+      options.iterations = std::stoi(value);
+    } else if (arg == "--warmup") {
+      options.warmup = std::stoi(value);
+    } else if (arg == "--port") {
+      options.port = std::stoi(value);
+    } else {
+      throw std::invalid_argument("unknown option " + arg);
+    }
+  }
+
+  for (const auto& name : options.collectives) {
+    auto it = std::find_if(COLLECTIVES.begin(), COLLECTIVES.end(),
+      [&name](const std::pair<Collective, std::string>& c) { return c.second == name; });
+    if (it == COLLECTIVES.end())
+      throw std::invalid_argument("unknown collective " + name);
+  }
+  if (options.min_bytes < 2 || options.max_bytes < options.min_bytes)
+    throw std::invalid_argument("invalid range of tensor sizes");
+  if (options.iterations < 1 || options.warmup < 0)
+    throw std::invalid_argument("invalid number of iterations");
+  return options;
+}
+
+/*
+ * Factor converting algorithm bandwidth (bytes of a single tensor over time)
+ * to bus bandwidth, which doesn't depend on the number of processes for
+ * optimal algorithms and can be compared with the speed of the links.
+ */
+double busFactor(Collective collective, double group_size) {
+  switch (collective) {
+    case Collective::ALL_REDUCE:
+      return 2 * (group_size - 1) / group_size;
+    case Collective::ALL_GATHER:
+    case Collective::GATHER:
+    case Collective::SCATTER:
+    case Collective::REDUCE_SCATTER:
+    case Collective::ALL_TO_ALL:
+      return group_size - 1;
+    default:
+      return 1;
+  }
+}
+
+struct Buffers {
+  Buffers(std::size_t bytes, std::size_t group_size) {
+    long numel = bytes / sizeof(float);
+    tensor.resize({numel});
+    tensor.fill(1);
+    for (std::size_t i = 0; i < group_size; ++i) {
+      inputs.emplace_back(new thpp::THTensor<float>());
+      inputs.back()->resize({numel});
+      inputs.back()->fill(1);
+      outputs.emplace_back(new thpp::THTensor<float>());
+      outputs.back()->resize({numel});
+      input_ptrs.push_back(inputs.back().get());
+      output_ptrs.push_back(outputs.back().get());
+    }
+  }
+
+  thpp::THTensor<float> tensor;
+  std::vector<std::unique_ptr<thpp::THTensor<float>>> inputs, outputs;
+  std::vector<thpp::Tensor*> input_ptrs, output_ptrs;
+  std::vector<thpp::Tensor*> none;
+};
+
+void runCollective(thd::DataChannel& channel, Collective collective,
+                   Buffers& buffers, THDGroup group, bool is_root) {
+  switch (collective) {
+    case Collective::BROADCAST:
+      channel.broadcast(buffers.tensor, 0, group);
+      break;
+    case Collective::ALL_REDUCE:
+      channel.allReduce(buffers.tensor, THDReduceSUM, group);
+      break;
+    case Collective::REDUCE:
+      channel.reduce(buffers.tensor, THDReduceSUM, 0, group);
+      break;
+    case Collective::ALL_GATHER:
+      channel.allGather(buffers.output_ptrs, buffers.tensor, group);
+      break;
+    case Collective::GATHER:
+      channel.gather(is_root ? buffers.output_ptrs : buffers.none,
+                     buffers.tensor, 0, group);
+      break;
+    case Collective::SCATTER:
+      channel.scatter(is_root ? buffers.input_ptrs : buffers.none,
+                      buffers.tensor, 0, group);
+      break;
+    case Collective::REDUCE_SCATTER:
+      channel.reduceScatter(buffers.tensor, buffers.input_ptrs, THDReduceSUM, group);
+      break;
+    case Collective::ALL_TO_ALL:
+      channel.allToAll(buffers.output_ptrs, buffers.input_ptrs, group);
+      break;
+    case Collective::BARRIER:
+      channel.barrier(group);
+      break;
+  }
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+  std::size_t rank = static_cast<std::size_t>(p / 100 * sorted.size() + 0.5);
+  rank = std::min(std::max<std::size_t>(rank, 1), sorted.size());
+  return sorted[rank - 1];
+}
+
+// Quotes a string for JSON, escaping quotes, backslashes and control characters
+std::string jsonString(const std::string& value) {
+  std::string result = "\"";
+  for (unsigned char c : value) {
+    if (c == '"' || c == '\\') {
+      result += '\\';
+      result += c;
+    } else if (c < 0x20) {
+      char escaped[8];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      result += escaped;
+    } else {
+      result += c;
+    }
+  }
+  return result + "\"";
+}
+
+void report(const Options& options, const std::string& name, Collective collective,
+            int processes, std::size_t group_size, std::size_t bytes,
+            std::vector<double> times, const std::string& error) {
+  char line[1024];
+  int length = std::snprintf(line, sizeof(line),
+    "{\"backend\": \"%s\", \"collective\": \"%s\", \"processes\": %d, "
+    "\"group_size\": %zu, \"bytes\": %zu",
+    options.backend.c_str(), name.c_str(), processes, group_size, bytes);
+
+  if (!error.empty()) {
+    // messages can be of any length, so they don't go through `line`
+    std::cout << line << ", \"error\": " << jsonString(error) << "}" << std::endl;
+    return;
+  }
+
+  std::sort(times.begin(), times.end());
+  double mean = 0;
+  for (auto t : times)
+    mean += t;
+  mean /= times.size();
+  double algbw = collective == Collective::BARRIER ? 0 : bytes / mean / 1e9;
+  std::snprintf(line + length, sizeof(line) - length,
+    ", \"iterations\": %zu, \"min_us\": %.2f, \"mean_us\": %.2f, "
+    "\"p50_us\": %.2f, \"p90_us\": %.2f, \"p99_us\": %.2f, \"max_us\": %.2f, "
+    "\"algbw_gbps\": %.4f, \"busbw_gbps\": %.4f}",
+    times.size(), times.front() * 1e6, mean * 1e6, percentile(times, 50) * 1e6,
+    percentile(times, 90) * 1e6, percentile(times, 99) * 1e6,
+    times.back() * 1e6, algbw, algbw * busFactor(collective, group_size));
+  std::cout << line << std::endl;
+}
+
+void benchmark(const Options& options, thd::DataChannel& channel) {
+  thd::rank_type rank = channel.getRank();
+  thd::rank_type processes = channel.getNumProcesses();
+
+  std::vector<std::pair<THDGroup, std::vector<thd::rank_type>>> groups;
+  std::vector<thd::rank_type> world;
+  for (thd::rank_type r = 0; r < processes; ++r)
+    world.push_back(r);
+  groups.emplace_back(THDGroupWORLD, world);
+  if (options.groups && processes >= 4) {
+    std::vector<thd::rank_type> even;
+    for (thd::rank_type r = 0; r < processes; r += 2)
+      even.push_back(r);
+    groups.emplace_back(channel.newGroup(even), even);
+  }
+
+  for (const auto& entry : COLLECTIVES) {
+    if (!options.collectives.empty() &&
+        std::find(options.collectives.begin(), options.collectives.end(),
+                  entry.second) == options.collectives.end())
+      continue;
+
+    for (const auto& group : groups) {
+      bool is_member = std::find(group.second.begin(), group.second.end(), rank)
+        != group.second.end();
+      int max_bytes = entry.first == Collective::BARRIER ? options.min_bytes
+                                                          : options.max_bytes;
+
+      for (int power = options.min_bytes; power <= max_bytes; ++power) {
+        std::size_t bytes = entry.first == Collective::BARRIER ? 0 : 1ul << power;
+        Buffers buffers(std::max<std::size_t>(bytes, sizeof(float)), group.second.size());
+
+        // Backends throw before communicating if they don't support a collective
+        std::string error;
+        if (is_member) {
+          try {
+            runCollective(channel, entry.first, buffers, group.first, rank == 0);
+          } catch (const std::exception& e) {
+            error = e.what();
+          }
+        }
+
+        // The last element tells all processes whether any of them failed
+        thpp::THTensor<double> times;
+        times.resize({options.iterations + 1});
+        times.zero();
+        auto data = static_cast<double*>(times.data());
+        data[options.iterations] = error.empty() ? 0 : 1;
+        channel.barrier();
+        if (is_member && error.empty()) {
+          for (int i = 1; i < options.warmup; ++i)
+            runCollective(channel, entry.first, buffers, group.first, rank == 0);
+          for (int i = 0; i < options.iterations; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            runCollective(channel, entry.first, buffers, group.first, rank == 0);
+            data[i] = std::chrono::duration<double>(
+              std::chrono::steady_clock::now() - start).count();
+          }
+        }
+        channel.allReduce(times, THDReduceMAX);
+
+        bool failed = data[options.iterations] != 0;
+        if (rank == 0) {
+          report(options, entry.second, entry.first, processes, group.second.size(),
+                 bytes, std::vector<double>(data, data + options.iterations),
+                 failed && error.empty() ? "failed in another process" : error);
+        }
+        if (failed)
+          break;
+      }
+    }
+  }
+}
+
+THDChannelType channelType(const std::string& backend) {
+  if (backend == "tcp") return THDChannelTCP;
+  if (backend == "gloo") return THDChannelGloo;
+  if (backend == "shm") return THDChannelSHM;
+  if (backend == "mpi") return THDChannelMPI;
+  throw std::invalid_argument("unknown backend " + backend);
+}
+
+int runProcess(const Options& options, int rank, int processes, int port) {
+  if (options.backend != "mpi") {
+    setenv("RANK", std::to_string(rank).c_str(), 1);
+    setenv("WORLD_SIZE", std::to_string(processes).c_str(), 1);
+    setenv("MASTER_PORT", std::to_string(port).c_str(), 1);
+    setenv("MASTER_ADDR", "127.0.0.1", 1);
+  }
+
+  try {
+    std::unique_ptr<thd::DataChannel> channel(thd::DataChannel::newChannel(
+      channelType(options.backend), "env://", -1, "", -1));
+    if (!channel->init())
+      throw std::runtime_error("failed to initialize the data channel");
+    benchmark(options, *channel);
+  } catch (const std::exception& e) {
+    std::cerr << "rank " << rank << ": " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  try {
+    options = parseOptions(argc, argv);
+    channelType(options.backend);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    usage();
+    return 2;
+  }
+
+  if (options.backend == "mpi")
+    return runProcess(options, -1, -1, options.port);
+
+  int port = options.port;
+  for (int processes : options.processes) {
+    std::vector<pid_t> children;
+    for (int rank = 0; rank < processes; ++rank) {
+      pid_t pid = fork();
+      if (pid < 0) {
+        std::perror("fork");
+        return 1;
+      } else if (pid == 0) {
+        _exit(runProcess(options, rank, processes, port));
+      }
+      children.push_back(pid);
+    }
+
+    bool failed = false;
+    for (auto pid : children) {
+      int status;
+      waitpid(pid, &status, 0);
+      failed |= !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    }
+    if (failed)
+      return 1;
+    // Ports of finished runs might still be in TIME_WAIT
+    ++port;
+  }
+  return 0;
+}
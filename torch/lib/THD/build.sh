@@ -25,5 +25,6 @@ cmake .. -DCMAKE_CXX_FLAGS=" -I${lib_dir}/tmp_install/include -pthread \
          -DTHC_LIBRARIES="${lib_dir}/libTHC$LD_POSTFIX" \
          -DTHPP_LIBRARIES="${lib_dir}/libTHPP$LD_POSTFIX" \
          -DTHD_WITH_TESTS="1" \
+         -DTHD_WITH_BENCHMARKS="1" \
          -DTorch_FOUND="1"
 make
@@ -16,28 +16,37 @@
 namespace thd {
 namespace {
 
-void sendMessage(int socket, std::unique_ptr<rpc::RPCMessage> msg) {
-  auto& bytes = msg.get()->bytes();
-  std::uint64_t msg_length = static_cast<std::uint64_t>(bytes.length());
-
-  send_bytes<std::uint64_t>(socket, &msg_length, 1, true);
-  send_bytes<std::uint8_t>(
-    socket,
-    reinterpret_cast<const std::uint8_t*>(bytes.data()),
-    msg_length
-  );
+/*
+ * Master sends commands in frames: `[u64 frame length][messages...]`, where
+ * every message is `[u64 message length][message bytes]`. A frame is sent
+ * once it reaches COMMAND_BATCH_BYTES, or when it is older than
+ * COMMAND_BATCH_DELAY.
+ */
+constexpr std::size_t COMMAND_BATCH_BYTES = 1 << 16;
+constexpr auto COMMAND_BATCH_DELAY = std::chrono::microseconds(500);
+constexpr std::size_t FRAME_HEADER_BYTES = sizeof(std::uint64_t);
+
+// Everything workers send to master starts with one of these.
+enum WorkerMessageType : std::uint8_t {
+  WORKER_ERROR = 0,
+  WORKER_INT_RESPONSE = 1,
+  WORKER_FLOAT_RESPONSE = 2,
+};
+
+template<typename T>
+void sendWorkerMessage(int socket, WorkerMessageType type, const T& value) {
+  std::uint8_t buffer[sizeof(std::uint8_t) + sizeof(T)];
+  buffer[0] = type;
+  std::memcpy(buffer + 1, &value, sizeof(T));
+  send_bytes<std::uint8_t>(socket, buffer, sizeof(buffer));
 }
 
-std::unique_ptr<rpc::RPCMessage> receiveMessage(int socket) {
-  std::uint64_t msg_length;
-  recv_bytes<std::uint64_t>(socket, &msg_length, 1);
-
-  std::unique_ptr<std::uint8_t[]> bytes(new std::uint8_t[msg_length]);
-  recv_bytes<std::uint8_t>(socket, bytes.get(), msg_length);
+void appendMessage(std::string& batch, rpc::RPCMessage& msg) {
+  auto& bytes = msg.bytes();
+  std::uint64_t msg_length = static_cast<std::uint64_t>(bytes.length());
 
-  return std::unique_ptr<rpc::RPCMessage>(
-    new rpc::RPCMessage(reinterpret_cast<char*>(bytes.get()), msg_length)
-  );
+  batch.append(reinterpret_cast<const char*>(&msg_length), sizeof(msg_length));
+  batch.append(bytes.data(), msg_length);
 }
 
 } // anonymous namespace
@@ -49,11 +58,26 @@ MasterCommandChannel::MasterCommandChannel(InitMethod::Config config)
   , _error_pipe(-1)
   , _error(nullptr)
   , _mutexes(config.world_size)
+  , _responses(config.world_size)
+  , _worker_errors(config.world_size)
+  , _batches(config.world_size, std::string(FRAME_HEADER_BYTES, '\0'))
+  , _batch_start(config.world_size)
+  , _pending(false)
+  , _exiting(false)
 {
   _sockets[0] = config.master.listen_socket;
 }
 
 MasterCommandChannel::~MasterCommandChannel() {
+  if (_flush_thread.joinable()) {
+    {
+      std::lock_guard<std::mutex> guard(_flush_mutex);
+      _exiting = true;
+    }
+    _flush_cond.notify_one();
+    _flush_thread.join();
+  }
+
   if (_error_thread.joinable()) {
     if (::write(_error_pipe, "exit", 4) != 4) {
       std::cerr << "Failed to notify error thread" << std::endl;
@@ -67,9 +91,13 @@ MasterCommandChannel::~MasterCommandChannel() {
   for (std::size_t i = 0; i < world_size; ++i) {
     auto socket = _sockets[i];
     if (socket == -1) continue;
-    try {
-      sendMessage(rpc::packMessage(Functions::exit), i);
-    } catch(...) {}
+    if (i > 0) {
+      try {
+        std::lock_guard<std::mutex> guard(_mutexes[i]);
+        appendMessage(_batches[i], *rpc::packMessage(Functions::exit));
+        _flush(i);
+      } catch(...) {}
+    }
     ::close(socket);
   }
 
@@ -100,6 +128,7 @@ bool MasterCommandChannel::init() {
   _sockets[0] = fd[0];
   _error_pipe = fd[1];
   _error_thread = std::thread(&MasterCommandChannel::errorHandler, this);
+  _flush_thread = std::thread(&MasterCommandChannel::flushHandler, this);
   return true;
 }
 
@@ -113,7 +142,36 @@ void MasterCommandChannel::errorHandler() {
     _error.reset(new std::string(
       "error (rank " + std::to_string(std::get<0>(error)) + "): " + std::get<1>(error)
     ));
+    failResponses(std::get<0>(error), *_error);
+  }
+}
+
+void MasterCommandChannel::recvResponse(rank_type rank, int socket, std::uint8_t type) {
+  WorkerResponse response;
+  response.is_float = (type == WORKER_FLOAT_RESPONSE);
+  if (response.is_float) {
+    recv_bytes<double>(socket, &response.float_value, 1);
+    response.int_value = static_cast<long long>(response.float_value);
+  } else {
+    recv_bytes<long long>(socket, &response.int_value, 1);
+    response.float_value = static_cast<double>(response.int_value);
+  }
+
+  std::lock_guard<std::mutex> guard(_responses_mutex);
+  auto& responses = _responses[rank];
+  if (responses.empty())
+    throw std::runtime_error("received a response that was not requested");
+  responses.front().set_value(response);
+  responses.pop_front();
+}
+
+void MasterCommandChannel::failResponses(rank_type rank, const std::string& error) {
+  std::lock_guard<std::mutex> guard(_responses_mutex);
+  _worker_errors[rank].reset(new std::string(error));
+  for (auto& response : _responses[rank]) {
+    response.set_exception(std::make_exception_ptr(std::runtime_error(error)));
   }
+  _responses[rank].clear();
 }
 
 void MasterCommandChannel::sendMessage(std::unique_ptr<rpc::RPCMessage> msg, int rank) {
@@ -122,12 +180,110 @@ void MasterCommandChannel::sendMessage(std::unique_ptr<rpc::RPCMessage> msg, int
     throw std::runtime_error(*_error);
   }
 
-  if ((rank <= 0) || (rank >= _sockets.size())) {
+  if ((rank <= 0) || (static_cast<std::size_t>(rank) >= _sockets.size())) {
     throw std::domain_error("sendMessage received invalid rank as parameter");
   }
 
   std::lock_guard<std::mutex> guard(_mutexes[rank]);
-  ::thd::sendMessage(_sockets[rank], std::move(msg));
+  appendToBatch(std::move(msg), rank);
+}
+
+std::future<WorkerResponse> MasterCommandChannel::sendRequest(
+    std::unique_ptr<rpc::RPCMessage> msg, int rank) {
+  if (_error) {
+    throw std::runtime_error(*_error);
+  }
+
+  if ((rank <= 0) || (static_cast<std::size_t>(rank) >= _sockets.size())) {
+    throw std::domain_error("sendRequest received invalid rank as parameter");
+  }
+
+  std::lock_guard<std::mutex> guard(_mutexes[rank]);
+  std::promise<WorkerResponse> response;
+  auto future = response.get_future();
+  {
+    std::lock_guard<std::mutex> responses_guard(_responses_mutex);
+    if (_worker_errors[rank]) {
+      response.set_exception(std::make_exception_ptr(
+        std::runtime_error(*_worker_errors[rank])));
+      return future;
+    }
+    _responses[rank].push_back(std::move(response));
+  }
+  appendToBatch(std::move(msg), rank);
+  return future;
+}
+
+void MasterCommandChannel::appendToBatch(std::unique_ptr<rpc::RPCMessage> msg, int rank) {
+  auto& batch = _batches[rank];
+  bool was_empty = batch.size() == FRAME_HEADER_BYTES;
+  appendMessage(batch, *msg);
+
+  if (batch.size() >= COMMAND_BATCH_BYTES) {
+    _flush(rank);
+  } else if (was_empty) {
+    _batch_start[rank] = std::chrono::steady_clock::now();
+    {
+      std::lock_guard<std::mutex> flush_guard(_flush_mutex);
+      _pending = true;
+    }
+    _flush_cond.notify_one();
+  }
+}
+
+void MasterCommandChannel::flush(int rank) {
+  if ((rank <= 0) || (static_cast<std::size_t>(rank) >= _sockets.size())) {
+    throw std::domain_error("flush received invalid rank as parameter");
+  }
+
+  std::lock_guard<std::mutex> guard(_mutexes[rank]);
+  _flush(rank);
+}
+
+void MasterCommandChannel::_flush(int rank) {
+  auto& batch = _batches[rank];
+  if (batch.size() == FRAME_HEADER_BYTES) return;
+
+  std::uint64_t frame_length = batch.size() - FRAME_HEADER_BYTES;
+  std::memcpy(&batch[0], &frame_length, sizeof(frame_length));
+  try {
+    send_bytes<char>(_sockets[rank], batch.data(), batch.size());
+  } catch (...) {
+    batch.resize(FRAME_HEADER_BYTES);
+    throw;
+  }
+  batch.resize(FRAME_HEADER_BYTES); // keeps the capacity for next batches
+}
+
+void MasterCommandChannel::flushHandler() {
+  std::unique_lock<std::mutex> lock(_flush_mutex);
+  while (true) {
+    _flush_cond.wait(lock, [this] { return _exiting || _pending; });
+    if (_exiting) return;
+
+    // let the batches grow before sending them
+    if (_flush_cond.wait_for(lock, COMMAND_BATCH_DELAY, [this] { return _exiting; }))
+      return;
+    _pending = false;
+    lock.unlock();
+
+    bool waiting = false;
+    auto now = std::chrono::steady_clock::now();
+    for (std::size_t rank = 1; rank < _sockets.size(); ++rank) {
+      std::lock_guard<std::mutex> guard(_mutexes[rank]);
+      if (_batches[rank].size() == FRAME_HEADER_BYTES) continue;
+      if (now - _batch_start[rank] < COMMAND_BATCH_DELAY) {
+        waiting = true;
+        continue;
+      }
+      try {
+        _flush(rank);
+      } catch (...) {} // lost connections are reported by the error thread
+    }
+
+    lock.lock();
+    _pending = _pending || waiting;
+  }
 }
 
 std::tuple<rank_type, std::string> MasterCommandChannel::recvError() {
@@ -146,41 +302,60 @@ std::tuple<rank_type, std::string> MasterCommandChannel::recvError() {
     _poll_events[rank].revents = 0;
   }
 
-  SYSCHECK(::poll(_poll_events.get(), _sockets.size(), -1))
-  for (std::size_t rank = 0; rank < _sockets.size(); ++rank) {
-    if (this->_poll_events[rank].revents == 0)
-      continue;
-
-    if (rank == 0) { // we are notified by master to end
-      return std::make_tuple(0, "");
+  while (true) {
+    SYSCHECK(::poll(_poll_events.get(), _sockets.size(), -1))
+    bool received = false;
+    for (std::size_t rank = 0; rank < _sockets.size(); ++rank) {
+      if (this->_poll_events[rank].revents == 0)
+        continue;
+
+      if (rank == 0) { // we are notified by master to end
+        return std::make_tuple(0, "");
+      }
+
+      if (_poll_events[rank].revents ^ POLLIN) {
+        _poll_events[rank].fd = -1; // mark worker as ignored
+        return std::make_tuple(rank, "connection with worker has been closed");
+      }
+
+      try {
+        std::uint8_t type;
+        recv_bytes<std::uint8_t>(_poll_events[rank].fd, &type, 1);
+        if (type != WORKER_ERROR) {
+          recvResponse(rank, _poll_events[rank].fd, type);
+          received = true;
+          continue;
+        }
+
+        // receive error
+        std::uint64_t error_length;
+        recv_bytes<std::uint64_t>(_poll_events[rank].fd, &error_length, 1);
+
+        std::unique_ptr<char[]> error(new char[error_length]);
+        recv_bytes<char>(_poll_events[rank].fd, error.get(), error_length);
+        return std::make_tuple(rank, std::string(error.get(), error_length));
+      } catch (const std::exception& e) {
+        _poll_events[rank].fd = -1; // the stream can't be trusted anymore
+        return std::make_tuple(rank, "recv: " + std::string(e.what()));
+      }
     }
 
-    if (_poll_events[rank].revents ^ POLLIN) {
-      _poll_events[rank].fd = -1; // mark worker as ignored
-      return std::make_tuple(rank, "connection with worker has been closed");
+    if (!received) {
+      // We did not receive anything from any worker despite being notified.
+      return std::make_tuple(0, "failed to receive error from worker");
     }
 
-    try {
-      // receive error
-      std::uint64_t error_length;
-      recv_bytes<std::uint64_t>(_poll_events[rank].fd, &error_length, 1);
-
-      std::unique_ptr<char[]> error(new char[error_length]);
-      recv_bytes<char>(_poll_events[rank].fd, error.get(), error_length);
-      return std::make_tuple(rank, std::string(error.get(), error_length));
-    } catch (const std::exception& e) {
-      return std::make_tuple(rank, "recv: " + std::string(e.what()));
+    for (std::size_t rank = 0; rank < _sockets.size(); ++rank) {
+      _poll_events[rank].revents = 0;
     }
   }
-
-  // We did not receive error from any worker despite being notified.
-  return std::make_tuple(0, "failed to receive error from worker");
 }
 
 
 WorkerCommandChannel::WorkerCommandChannel(InitMethod::Config config)
   : _rank(config.rank)
   , _socket(-1)
+  , _frame_offset(0)
   , _master_addr(config.worker.master_addr)
   , _master_port(config.worker.master_port)
 {}
@@ -200,13 +375,40 @@ bool WorkerCommandChannel::init() {
 }
 
 std::unique_ptr<rpc::RPCMessage> WorkerCommandChannel::recvMessage() {
-  return ::thd::receiveMessage(_socket);
+  // messages from one frame are returned back to back, without touching the socket
+  while (_frame_offset == _frame.size()) {
+    std::uint64_t frame_length;
+    recv_bytes<std::uint64_t>(_socket, &frame_length, 1);
+    _frame.resize(frame_length); // keeps the capacity of previous frames
+    recv_bytes<char>(_socket, _frame.data(), frame_length);
+    _frame_offset = 0;
+  }
+
+  std::uint64_t msg_length;
+  if (_frame.size() - _frame_offset < sizeof(msg_length))
+    throw std::runtime_error("received malformed command frame");
+  std::memcpy(&msg_length, _frame.data() + _frame_offset, sizeof(msg_length));
+  _frame_offset += sizeof(msg_length);
+
+  if (_frame.size() - _frame_offset < msg_length)
+    throw std::runtime_error("received malformed command frame");
+  auto msg = rpc::RPCMessage::borrow(_frame.data() + _frame_offset, msg_length);
+  _frame_offset += msg_length;
+  return msg;
 }
 
 void WorkerCommandChannel::sendError(const std::string& error) {
   std::uint64_t error_length = static_cast<std::uint64_t>(error.size());
-  send_bytes<std::uint64_t>(_socket, &error_length, 1, true);
+  sendWorkerMessage(_socket, WORKER_ERROR, error_length);
   send_bytes<char>(_socket, error.data(), error_length);
 }
 
+void WorkerCommandChannel::sendResponse(long long value) {
+  sendWorkerMessage(_socket, WORKER_INT_RESPONSE, value);
+}
+
+void WorkerCommandChannel::sendResponse(double value) {
+  sendWorkerMessage(_socket, WORKER_FLOAT_RESPONSE, value);
+}
+
 } // namespace thd
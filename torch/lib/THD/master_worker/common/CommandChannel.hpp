@@ -4,6 +4,11 @@
 
 #include <sys/poll.h>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <cstddef>
+#include <future>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -13,17 +18,43 @@
 
 namespace thd {
 
+// Scalar sent by a worker in response to a command.
+struct WorkerResponse {
+  bool is_float;
+  long long int_value;
+  double float_value;
+};
+
 struct MasterCommandChannel {
   MasterCommandChannel(InitMethod::Config config);
   ~MasterCommandChannel();
 
   bool init();
 
+  /*
+   * Messages are not sent right away, but appended to a batch of the
+   * worker. Batches are sent when they grow large, when they get old, or
+   * when `flush` is called - which has to happen before master waits for
+   * anything a worker does in response to the commands.
+   */
   void sendMessage(std::unique_ptr<rpc::RPCMessage> msg, int rank);
+  /*
+   * Sends a command that makes the worker respond with a value. Workers
+   * respond in the order of commands, so any number of requests can be in
+   * flight. The future fails if the worker reports an error first.
+   */
+  std::future<WorkerResponse> sendRequest(std::unique_ptr<rpc::RPCMessage> msg, int rank);
+  void flush(int rank);
 
 private:
   std::tuple<rank_type, std::string> recvError();
+  void recvResponse(rank_type rank, int socket, std::uint8_t type);
+  void failResponses(rank_type rank, const std::string& error);
   void errorHandler();
+  void flushHandler();
+  // both require `_mutexes[rank]` to be locked
+  void appendToBatch(std::unique_ptr<rpc::RPCMessage> msg, int rank);
+  void _flush(int rank);
 
   rank_type _rank;
   std::vector<int> _sockets;
@@ -33,6 +64,19 @@ private:
   std::unique_ptr<std::string> _error;
   std::thread _error_thread;
   std::vector<std::mutex> _mutexes;
+
+  // requests waiting for a response, one queue per worker
+  std::vector<std::deque<std::promise<WorkerResponse>>> _responses;
+  std::vector<std::unique_ptr<std::string>> _worker_errors;
+  std::mutex _responses_mutex;
+
+  std::vector<std::string> _batches; // frames waiting to be sent, one per worker
+  std::vector<std::chrono::steady_clock::time_point> _batch_start;
+  std::thread _flush_thread; // sends batches that are waiting for too long
+  std::mutex _flush_mutex;
+  std::condition_variable _flush_cond;
+  bool _pending; // some batch has not been sent yet
+  bool _exiting;
 };
 
 struct WorkerCommandChannel {
@@ -41,12 +85,17 @@ struct WorkerCommandChannel {
 
   bool init();
 
+  // Returned message is valid until the next call, it points into the received frame.
   std::unique_ptr<rpc::RPCMessage> recvMessage();
   void sendError(const std::string& error);
+  void sendResponse(long long value);
+  void sendResponse(double value);
 
 private:
   rank_type _rank;
   int _socket;
+  std::vector<char> _frame; // last received frame, reused for the next ones
+  std::size_t _frame_offset; // start of the next message in `_frame`
 
   std::string _master_addr;
   port_type _master_port;
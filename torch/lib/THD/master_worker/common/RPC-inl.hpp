@@ -6,8 +6,6 @@
 namespace thd { namespace rpc { namespace detail {
 ////////////////////////////////////////////////////////////////////////////////
 
-constexpr size_t INITIAL_BUFFER_SIZE = 256;
-
 template<typename real,
          typename = typename std::enable_if<std::is_arithmetic<real>::value>::type>
 inline void _appendScalar(ByteArray& str, real data) {
@@ -85,6 +83,68 @@ inline void _appendData(ByteArray& str, thpp::Type type) {
   _appendType(str, type);
 }
 
+/*
+ * Sizes of packed arguments, so that a message can be allocated at once.
+ * They are known at compile time for everything except storages and vectors.
+ */
+template<typename T>
+constexpr std::size_t __packedSize(std::false_type is_generator,
+    std::false_type is_tensor, std::false_type is_storage) {
+  return sizeof(char) + sizeof(T);
+}
+
+template<typename T>
+constexpr std::size_t __packedSize(std::true_type is_generator,
+    std::false_type is_tensor, std::false_type is_storage) {
+  return sizeof(char) + sizeof(object_id_type);
+}
+
+template<typename T>
+constexpr std::size_t __packedSize(std::false_type is_generator,
+    std::true_type is_tensor, std::false_type is_storage) {
+  return sizeof(char) + sizeof(object_id_type);
+}
+
+template<typename T>
+constexpr std::size_t __packedSize(std::false_type is_generator,
+    std::false_type is_tensor, std::true_type is_storage) {
+  return sizeof(char) + sizeof(object_id_type);
+}
+
+template<typename T>
+constexpr std::size_t _packedSize(const T& arg) {
+  return __packedSize<T>(
+      is_any_of<T, THDGeneratorPtrTypes>(),
+      is_any_of<T, THDTensorPtrTypes>(),
+      is_any_of<T, THDStoragePtrTypes>()
+  );
+}
+
+inline std::size_t _packedSize(THLongStorage* arg) {
+  std::size_t size = sizeof(char) + sizeof(char);
+  if (arg)
+    size += sizeof(ptrdiff_t) + arg->size * sizeof(long);
+  return size;
+}
+
+template<typename T>
+inline std::size_t _packedSize(const std::vector<T>& arg) {
+  return _packedSize(static_cast<int>(arg.size())) + arg.size() * _packedSize(T());
+}
+
+constexpr std::size_t _packedSize(thpp::Type type) {
+  return sizeof(char);
+}
+
+inline std::size_t _packedSizeOf() {
+  return 0;
+}
+
+template <typename T, typename ...Args>
+inline std::size_t _packedSizeOf(const T& arg, const Args&... args) {
+  return _packedSize(arg) + _packedSizeOf(args...);
+}
+
 inline void _packIntoString(ByteArray& str) {};
 
 template <typename T, typename ...Args>
@@ -101,7 +161,7 @@ inline std::unique_ptr<RPCMessage> packMessage(
     function_id_type fid,
     const Args&... args
 ) {
-  ByteArray msg(detail::INITIAL_BUFFER_SIZE);
+  ByteArray msg(sizeof(function_id_type) + detail::_packedSizeOf(args...));
   detail::_appendScalar<function_id_type>(msg, fid);
   detail::_packIntoString(msg, args...);
   return std::unique_ptr<RPCMessage>(new RPCMessage(std::move(msg)));
@@ -12,43 +12,70 @@ namespace thd { namespace rpc {
 RPCMessage::RPCMessage()
   : _msg(0)
   , _offset(0)
+  , _borrowed(nullptr)
+  , _borrowed_length(0)
 {}
 
 RPCMessage::RPCMessage(char* str, std::size_t size)
   : _msg(str, size)
   , _offset(0)
+  , _borrowed(nullptr)
+  , _borrowed_length(0)
 {}
 
 RPCMessage::RPCMessage(const ByteArray& str)
   : _msg(str)
   , _offset(0)
+  , _borrowed(nullptr)
+  , _borrowed_length(0)
 {}
 
 RPCMessage::RPCMessage(ByteArray&& str)
   : _msg(std::move(str))
   , _offset(0)
+  , _borrowed(nullptr)
+  , _borrowed_length(0)
 {}
 
+std::unique_ptr<RPCMessage> RPCMessage::borrow(const char* str, std::size_t size) {
+  std::unique_ptr<RPCMessage> msg(new RPCMessage());
+  msg->_borrowed = str;
+  msg->_borrowed_length = size;
+  return msg;
+}
+
 ByteArray& RPCMessage::bytes() {
+  if (_borrowed) {
+    _msg.append(_borrowed, _borrowed_length);
+    _borrowed = nullptr;
+  }
   return _msg;
 }
 
+const char* RPCMessage::_begin() const {
+  return _borrowed ? _borrowed : _msg.data();
+}
+
+RPCMessage::size_type RPCMessage::_length() const {
+  return _borrowed ? _borrowed_length : _msg.length();
+}
+
 const char* RPCMessage::data() const {
-  return _msg.data() + _offset;
+  return _begin() + _offset;
 }
 
 bool RPCMessage::isEmpty() const {
-  return _offset >= _msg.length();
+  return _offset >= _length();
 }
 
 RPCMessage::size_type RPCMessage::remaining() const {
-  return _msg.length() - _offset;
+  return _length() - _offset;
 }
 
 const char* RPCMessage::read(std::size_t num_bytes) {
-  if (_offset + num_bytes > _msg.length())
+  if (_offset + num_bytes > _length())
     throw std::out_of_range("invalid access: out of bounds");
-  const char* ret_val = _msg.data() + _offset;
+  const char* ret_val = _begin() + _offset;
   _offset += num_bytes;
   return ret_val;
 }
@@ -24,15 +24,26 @@ public:
   RPCMessage(const ByteArray& str);
   RPCMessage(ByteArray&& str);
 
-  ByteArray& bytes(); // Raw data.
+  /*
+   * Creates a message that reads `size` bytes at `str` in place. They have
+   * to stay valid for as long as the message is used.
+   */
+  static std::unique_ptr<RPCMessage> borrow(const char* str, std::size_t size);
+
+  ByteArray& bytes(); // Raw data, borrowed messages copy it on first access.
   const char* data() const; // Offset data.
   bool isEmpty() const;
   size_type remaining() const; // Length of the msg left to read.
   const char* read(std::size_t num_bytes);
 
 private:
+  const char* _begin() const;
+  size_type _length() const;
+
   ByteArray _msg;
   std::size_t _offset;
+  const char* _borrowed; // data of a borrowed message, nullptr otherwise
+  size_type _borrowed_length;
 };
 
 template <typename ...Args>
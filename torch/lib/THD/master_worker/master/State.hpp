@@ -24,5 +24,19 @@ struct THDState {
   static std::uint64_t s_nextId;
 };
 
+// Routes commands issued by this thread to `worker` until it goes out of scope.
+struct WorkerGuard {
+  WorkerGuard(rank_type worker) : _previous(THDState::s_current_worker) {
+    THDState::s_current_worker = worker;
+  }
+
+  ~WorkerGuard() {
+    THDState::s_current_worker = _previous;
+  }
+
+private:
+  rank_type _previous;
+};
+
 } // namespace master
 } // namespace thd
@@ -0,0 +1,18 @@
+#include "THDFuture.h"
+#include "Utils.hpp"
+
+int THDFuture_isReady(THDFuture *future) {
+  return future->response.ready();
+}
+
+double THDFuture_getDouble(THDFuture *future) {
+  return future->response.get<double>();
+}
+
+long long THDFuture_getLong(THDFuture *future) {
+  return future->response.get<long long>();
+}
+
+void THDFuture_free(THDFuture *future) {
+  delete future;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+/* Value that a worker computes in response to a deferred call. Reading it
+blocks until the worker answers, so many calls can be in flight at once. */
+typedef struct THDFuture THDFuture;
+
+#include "../../THD.h"
+
+THD_API int THDFuture_isReady(THDFuture *future);
+THD_API double THDFuture_getDouble(THDFuture *future);
+THD_API long long THDFuture_getLong(THDFuture *future);
+THD_API void THDFuture_free(THDFuture *future);
@@ -50,12 +50,10 @@ void THDGenerator_free(THDGenerator *self) {
 }
 
 unsigned long THDRandom_seed(THDGenerator *_generator) {
-  masterCommandChannel->sendMessage(
+  return receiveValueFromWorker<unsigned long>(
     packMessage(Functions::generatorSeed, _generator),
     THDState::s_current_worker
   );
-
-  return receiveValueFromWorker<unsigned long>(THDState::s_current_worker);
 }
 
 void THDRandom_manualSeed(THDGenerator *_generator, unsigned long the_seed_) {
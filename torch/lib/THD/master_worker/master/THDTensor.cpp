@@ -8,8 +8,10 @@
 
 #include <THPP/Traits.hpp>
 
+#include <algorithm>
 #include <cstring>
 #include <memory>
+#include <vector>
 
 #include "master_worker/master/generic/THDTensorMeta.cpp"
 #include "TH/THGenerateAllTypes.h"
@@ -28,3 +30,6 @@
 
 #include "master_worker/master/generic/THDTensorLapack.cpp"
 #include "TH/THGenerateFloatTypes.h"
+
+#include "master_worker/master/generic/THDShardedTensor.cpp"
+#include "TH/THGenerateAllTypes.h"
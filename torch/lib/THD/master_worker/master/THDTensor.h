@@ -2,6 +2,7 @@
 
 #include <TH/TH.h>
 #include "../../THD.h"
+#include "THDFuture.h"
 
 #define THDTensor         TH_CONCAT_3(THD,Real,Tensor)
 #define THDTensor_(NAME)  TH_CONCAT_4(THD,Real,Tensor_,NAME)
@@ -25,3 +26,9 @@ typedef struct {
 
 #include "generic/THDTensorLapack.h"
 #include <TH/THGenerateFloatTypes.h>
+
+#define THDShardedTensor         TH_CONCAT_3(THD,Real,ShardedTensor)
+#define THDShardedTensor_(NAME)  TH_CONCAT_4(THD,Real,ShardedTensor_,NAME)
+
+#include "generic/THDShardedTensor.h"
+#include <TH/THGenerateAllTypes.h>
@@ -1,21 +1,62 @@
 #pragma once
 
+#include "master_worker/master/Master.hpp"
 #include "process_group/General.hpp"
 
 #include <THPP/Traits.hpp>
 
-template<typename T>
-T receiveValueFromWorker(int worker_id) {
-  thpp::Type type = thpp::type_traits<T>::type;
-  if (thpp::isInteger(type)) {
-    thd::IntScalar wrapped_value;
-    thd::dataChannel->receive(wrapped_value, worker_id);
-    return static_cast<T>(wrapped_value.value());
-  } else if (thpp::isFloat(type)) {
-    thd::FloatScalar wrapped_value;
-    thd::dataChannel->receive(wrapped_value, worker_id);
-    return static_cast<T>(wrapped_value.value());
-  } else {
-    throw std::invalid_argument("expected scalar type");
+#include <chrono>
+#include <future>
+
+namespace thd { namespace master {
+
+/*
+ * Value that a worker sends back in response to a command. Reading it
+ * blocks until the response arrives, so many requests can be in flight
+ * before the master needs any of their results.
+ */
+struct ResponseFuture {
+  ResponseFuture(std::future<WorkerResponse> response, int worker_id)
+    : _response(response.share())
+    , _worker_id(worker_id) {}
+
+  bool ready() const {
+    return _response.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
   }
+
+  template<typename T>
+  T get() {
+    if (!ready()) {
+      // the worker can't answer until it gets the command
+      masterCommandChannel->flush(_worker_id);
+    }
+    const WorkerResponse& response = _response.get();
+    return response.is_float ? static_cast<T>(response.float_value)
+                             : static_cast<T>(response.int_value);
+  }
+
+private:
+  std::shared_future<WorkerResponse> _response;
+  int _worker_id;
+};
+
+}} // namespace master, thd
+
+struct THDFuture {
+  THDFuture(thd::master::ResponseFuture response) : response(response) {}
+
+  thd::master::ResponseFuture response;
+};
+
+inline thd::master::ResponseFuture requestValueFromWorker(
+    std::unique_ptr<thd::rpc::RPCMessage> msg, int worker_id) {
+  return thd::master::ResponseFuture(
+    thd::master::masterCommandChannel->sendRequest(std::move(msg), worker_id),
+    worker_id
+  );
+}
+
+template<typename T>
+T receiveValueFromWorker(std::unique_ptr<thd::rpc::RPCMessage> msg, int worker_id) {
+  return requestValueFromWorker(std::move(msg), worker_id).get<T>();
 }
@@ -0,0 +1,209 @@
+#ifndef TH_GENERIC_FILE
+#define TH_GENERIC_FILE "master_worker/master/generic/THDShardedTensor.cpp"
+#else
+
+static rank_type THDShardedTensor_(worker)(const THDShardedTensor *self, int index) {
+  return self->shards[index]->storage->node_id;
+}
+
+static void THDShardedTensor_(checkSameSharding)(const THDShardedTensor *self,
+                                                 const THDShardedTensor *src) {
+  THArgCheck(self->numShards == src->numShards && self->dim == src->dim, 2,
+             "sharded tensors have to be split in the same way");
+  for (int i = 0; i < self->numShards; i++) {
+    THArgCheck(THDTensor_(isSameSizeAs)(self->shards[i], src->shards[i]) &&
+               THDShardedTensor_(worker)(self, i) == THDShardedTensor_(worker)(src, i),
+               2, "sharded tensors have to be split in the same way");
+  }
+}
+
+THDShardedTensor *THDShardedTensor_(newWithSize)(THLongStorage *size, int dim) {
+  THArgCheck(dim >= 0 && dim < size->size, 2, "dimension %d out of range",
+             dim + TH_INDEX_BASE);
+  long dim_size = size->data[dim];
+  THArgCheck(dim_size > 0, 1, "can't shard an empty dimension");
+  int num_workers = THDState::s_workers.size() - 1;
+  THArgCheck(num_workers > 0, 1, "there are no workers to hold the shards");
+
+  THDShardedTensor *self = new THDShardedTensor();
+  self->numShards = std::min<long>(num_workers, dim_size);
+  self->dim = dim;
+  self->shards = new THDTensor*[self->numShards];
+
+  THLongStorage *shard_size = THLongStorage_newWithSize(size->size);
+  THLongStorage_rawCopy(shard_size, size->data);
+  for (int i = 0; i < self->numShards; i++) {
+    // the first shards get one more slice, if the dimension doesn't split evenly
+    shard_size->data[dim] = dim_size / self->numShards +
+                            (i < dim_size % self->numShards ? 1 : 0);
+    WorkerGuard guard(i + 1);
+    self->shards[i] = THDTensor_(newWithSize)(shard_size, NULL);
+  }
+  THLongStorage_free(shard_size);
+  return self;
+}
+
+void THDShardedTensor_(free)(THDShardedTensor *self) {
+  if (!self)
+    return;
+  for (int i = 0; i < self->numShards; i++) {
+    WorkerGuard guard(THDShardedTensor_(worker)(self, i));
+    THDTensor_(free)(self->shards[i]);
+  }
+  delete[] self->shards;
+  delete self;
+}
+
+THDTensor *THDShardedTensor_(shard)(THDShardedTensor *self, int index) {
+  THArgCheck(index >= 0 && index < self->numShards, 2, "shard index out of range");
+  return self->shards[index];
+}
+
+long THDShardedTensor_(size)(const THDShardedTensor *self, int dim) {
+  long size = THDTensor_(size)(self->shards[0], dim);
+  if (dim != self->dim)
+    return size;
+  for (int i = 1; i < self->numShards; i++)
+    size += THDTensor_(size)(self->shards[i], dim);
+  return size;
+}
+
+ptrdiff_t THDShardedTensor_(nElement)(const THDShardedTensor *self) {
+  ptrdiff_t numel = 0;
+  for (int i = 0; i < self->numShards; i++)
+    numel += THDTensor_(nElement)(self->shards[i]);
+  return numel;
+}
+
+void THDShardedTensor_(copyFromMaster)(THDShardedTensor *to, THDTensorDescriptor *from) {
+  THArgCheck(from->sizes().size() == static_cast<std::size_t>(to->shards[0]->nDimension), 2,
+             "tensors have different number of dimensions");
+  THArgCheck(from->sizes()[to->dim] == THDShardedTensor_(size)(to, to->dim), 2,
+             "tensors have different sizes");
+  long offset = 0;
+  for (int i = 0; i < to->numShards; i++) {
+    long length = THDTensor_(size)(to->shards[i], to->dim);
+    std::unique_ptr<THDTensorDescriptor> part(from->newTensor());
+    part->narrow(*from, to->dim, offset, length);
+    // data channels only send contiguous tensors
+    if (!part->isContiguous())
+      part = part->contiguous();
+    WorkerGuard guard(THDShardedTensor_(worker)(to, i));
+    THDTensor_(copyFromMaster)(to->shards[i], part.get());
+    offset += length;
+  }
+}
+
+void THDShardedTensor_(copyFromWorkers)(THDTensorDescriptor *to, THDShardedTensor *from) {
+  THArgCheck(to->sizes().size() == static_cast<std::size_t>(from->shards[0]->nDimension), 1,
+             "tensors have different number of dimensions");
+  THArgCheck(to->sizes()[from->dim] == THDShardedTensor_(size)(from, from->dim), 1,
+             "tensors have different sizes");
+  long offset = 0;
+  for (int i = 0; i < from->numShards; i++) {
+    long length = THDTensor_(size)(from->shards[i], from->dim);
+    std::unique_ptr<THDTensorDescriptor> part(to->newTensor());
+    part->narrow(*to, from->dim, offset, length);
+    WorkerGuard guard(THDShardedTensor_(worker)(from, i));
+    // data channels only receive into contiguous tensors
+    if (part->isContiguous()) {
+      THDTensor_(copyFromWorker)(part.get(), from->shards[i]);
+    } else {
+      auto buffer = part->contiguous();
+      THDTensor_(copyFromWorker)(buffer.get(), from->shards[i]);
+      part->copy(*buffer);
+    }
+    offset += length;
+  }
+}
+
+void THDShardedTensor_(fill)(THDShardedTensor *r_, real value) {
+  for (int i = 0; i < r_->numShards; i++) {
+    WorkerGuard guard(THDShardedTensor_(worker)(r_, i));
+    THDTensor_(fill)(r_->shards[i], value);
+  }
+}
+
+void THDShardedTensor_(add)(THDShardedTensor *r_, THDShardedTensor *t, real value) {
+  THDShardedTensor_(checkSameSharding)(r_, t);
+  for (int i = 0; i < r_->numShards; i++) {
+    WorkerGuard guard(THDShardedTensor_(worker)(r_, i));
+    THDTensor_(add)(r_->shards[i], t->shards[i], value);
+  }
+}
+
+void THDShardedTensor_(mul)(THDShardedTensor *r_, THDShardedTensor *t, real value) {
+  THDShardedTensor_(checkSameSharding)(r_, t);
+  for (int i = 0; i < r_->numShards; i++) {
+    WorkerGuard guard(THDShardedTensor_(worker)(r_, i));
+    THDTensor_(mul)(r_->shards[i], t->shards[i], value);
+  }
+}
+
+void THDShardedTensor_(cadd)(THDShardedTensor *r_, THDShardedTensor *t, real value,
+                             THDShardedTensor *src) {
+  THDShardedTensor_(checkSameSharding)(r_, t);
+  THDShardedTensor_(checkSameSharding)(r_, src);
+  for (int i = 0; i < r_->numShards; i++) {
+    WorkerGuard guard(THDShardedTensor_(worker)(r_, i));
+    THDTensor_(cadd)(r_->shards[i], t->shards[i], value, src->shards[i]);
+  }
+}
+
+void THDShardedTensor_(cmul)(THDShardedTensor *r_, THDShardedTensor *t,
+                             THDShardedTensor *src) {
+  THDShardedTensor_(checkSameSharding)(r_, t);
+  THDShardedTensor_(checkSameSharding)(r_, src);
+  for (int i = 0; i < r_->numShards; i++) {
+    WorkerGuard guard(THDShardedTensor_(worker)(r_, i));
+    THDTensor_(cmul)(r_->shards[i], t->shards[i], src->shards[i]);
+  }
+}
+
+// Requests a partial result from every shard before waiting for any of them.
+static std::vector<ResponseFuture> THDShardedTensor_(requestPartials)(
+    THDShardedTensor *self, Functions function, THDShardedTensor *src) {
+  std::vector<ResponseFuture> partials;
+  for (int i = 0; i < self->numShards; i++) {
+    auto msg = src ? packMessage(function, self->shards[i], src->shards[i])
+                   : packMessage(function, self->shards[i]);
+    partials.push_back(requestValueFromWorker(std::move(msg),
+                                              THDShardedTensor_(worker)(self, i)));
+  }
+  return partials;
+}
+
+accreal THDShardedTensor_(sumall)(THDShardedTensor *self) {
+  auto partials = THDShardedTensor_(requestPartials)(self, Functions::tensorSumall, nullptr);
+  accreal result = 0;
+  for (auto& partial : partials)
+    result += partial.get<accreal>();
+  return result;
+}
+
+accreal THDShardedTensor_(dot)(THDShardedTensor *self, THDShardedTensor *src) {
+  THDShardedTensor_(checkSameSharding)(self, src);
+  auto partials = THDShardedTensor_(requestPartials)(self, Functions::tensorDot, src);
+  accreal result = 0;
+  for (auto& partial : partials)
+    result += partial.get<accreal>();
+  return result;
+}
+
+real THDShardedTensor_(minall)(THDShardedTensor *self) {
+  auto partials = THDShardedTensor_(requestPartials)(self, Functions::tensorMinall, nullptr);
+  real result = partials[0].get<real>();
+  for (std::size_t i = 1; i < partials.size(); i++)
+    result = std::min(result, partials[i].get<real>());
+  return result;
+}
+
+real THDShardedTensor_(maxall)(THDShardedTensor *self) {
+  auto partials = THDShardedTensor_(requestPartials)(self, Functions::tensorMaxall, nullptr);
+  real result = partials[0].get<real>();
+  for (std::size_t i = 1; i < partials.size(); i++)
+    result = std::max(result, partials[i].get<real>());
+  return result;
+}
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef TH_GENERIC_FILE
+#define TH_GENERIC_FILE "master_worker/master/generic/THDShardedTensor.h"
+#else
+
+/* Tensor split into consecutive slices along one dimension, with a slice on
+every worker. Operations are sent to all shards at once and the workers run
+them in parallel. */
+typedef struct {
+  THDTensor **shards;
+  int numShards;
+  int dim; // dimension along which the tensor is split
+} THDShardedTensor;
+
+/**** creation methods ****/
+THD_API THDShardedTensor *THDShardedTensor_(newWithSize)(THLongStorage *size, int dim);
+THD_API void THDShardedTensor_(free)(THDShardedTensor *self);
+
+/**** access methods ****/
+THD_API THDTensor *THDShardedTensor_(shard)(THDShardedTensor *self, int index);
+THD_API long THDShardedTensor_(size)(const THDShardedTensor *self, int dim);
+THD_API ptrdiff_t THDShardedTensor_(nElement)(const THDShardedTensor *self);
+
+/**** copy methods ****/
+THD_API void THDShardedTensor_(copyFromMaster)(THDShardedTensor *to, THDTensorDescriptor *from);
+THD_API void THDShardedTensor_(copyFromWorkers)(THDTensorDescriptor *to, THDShardedTensor *from);
+
+/**** pointwise math, all arguments have to be sharded the same way ****/
+THD_API void THDShardedTensor_(fill)(THDShardedTensor *r_, real value);
+THD_API void THDShardedTensor_(add)(THDShardedTensor *r_, THDShardedTensor *t, real value);
+THD_API void THDShardedTensor_(mul)(THDShardedTensor *r_, THDShardedTensor *t, real value);
+THD_API void THDShardedTensor_(cadd)(THDShardedTensor *r_, THDShardedTensor *t, real value,
+                                     THDShardedTensor *src);
+THD_API void THDShardedTensor_(cmul)(THDShardedTensor *r_, THDShardedTensor *t,
+                                     THDShardedTensor *src);
+
+/**** reductions ****/
+THD_API accreal THDShardedTensor_(sumall)(THDShardedTensor *self);
+THD_API accreal THDShardedTensor_(dot)(THDShardedTensor *self, THDShardedTensor *src);
+THD_API real THDShardedTensor_(minall)(THDShardedTensor *self);
+THD_API real THDShardedTensor_(maxall)(THDShardedTensor *self);
+
+#endif
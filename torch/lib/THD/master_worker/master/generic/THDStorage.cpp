@@ -51,7 +51,7 @@ void THDStorage_(set)(THDStorage* storage, ptrdiff_t offset, real value) {
 }
 
 real THDStorage_(get)(const THDStorage* storage, ptrdiff_t offset) {
-  masterCommandChannel->sendMessage(
+  return receiveValueFromWorker<real>(
     packMessage(
       Functions::storageGet,
       storage,
@@ -60,7 +60,6 @@ real THDStorage_(get)(const THDStorage* storage, ptrdiff_t offset) {
     ),
     THDState::s_current_worker
   );
-  return receiveValueFromWorker<real>(storage->node_id);
 }
 
 THDStorage* THDStorage_(newWithSize)(ptrdiff_t size) {
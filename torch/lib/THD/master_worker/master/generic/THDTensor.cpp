@@ -850,57 +850,59 @@ void THDTensor_(free)(THDTensor *tensor) {
 }
 
 accreal THDTensor_(dot)(THDTensor *self, THDTensor *src) {
-  masterCommandChannel->sendMessage(
+  return receiveValueFromWorker<accreal>(
     packMessage(Functions::tensorDot, self, src),
     THDState::s_current_worker
   );
-
-  return receiveValueFromWorker<accreal>(THDState::s_current_worker);
 }
 
 real THDTensor_(minall)(THDTensor *self) {
-  masterCommandChannel->sendMessage(
+  return receiveValueFromWorker<real>(
     packMessage(Functions::tensorMinall, self),
     THDState::s_current_worker
   );
-
-  return receiveValueFromWorker<real>(THDState::s_current_worker);
 }
 
 real THDTensor_(maxall)(THDTensor *self) {
-  masterCommandChannel->sendMessage(
+  return receiveValueFromWorker<real>(
     packMessage(Functions::tensorMaxall, self),
     THDState::s_current_worker
   );
-
-  return receiveValueFromWorker<real>(THDState::s_current_worker);
 }
 
 real THDTensor_(medianall)(THDTensor *self) {
-  masterCommandChannel->sendMessage(
+  return receiveValueFromWorker<real>(
     packMessage(Functions::tensorMedianall, self),
     THDState::s_current_worker
   );
-
-  return receiveValueFromWorker<real>(THDState::s_current_worker);
 }
 
 accreal THDTensor_(sumall)(THDTensor *self) {
-  masterCommandChannel->sendMessage(
+  return receiveValueFromWorker<accreal>(
     packMessage(Functions::tensorSumall, self),
     THDState::s_current_worker
   );
+}
 
-  return receiveValueFromWorker<accreal>(THDState::s_current_worker);
+THDFuture *THDTensor_(dotAsync)(THDTensor *self, THDTensor *src) {
+  return new THDFuture(requestValueFromWorker(
+    packMessage(Functions::tensorDot, self, src),
+    THDState::s_current_worker
+  ));
+}
+
+THDFuture *THDTensor_(sumallAsync)(THDTensor *self) {
+  return new THDFuture(requestValueFromWorker(
+    packMessage(Functions::tensorSumall, self),
+    THDState::s_current_worker
+  ));
 }
 
 accreal THDTensor_(prodall)(THDTensor *self) {
-  masterCommandChannel->sendMessage(
+  return receiveValueFromWorker<accreal>(
     packMessage(Functions::tensorProdall, self),
     THDState::s_current_worker
   );
-
-  return receiveValueFromWorker<accreal>(THDState::s_current_worker);
 }
 
 void THDTensor_(add)(THDTensor *self, THDTensor *src, real value) {
@@ -1249,12 +1251,10 @@ void THDTensor_(sign)(THDTensor *self, THDTensor *src) {
 accreal THDTensor_(trace)(THDTensor *self) {
   THArgCheck(self->nDimension == 2, 1, "expected a matrix");
 
-  masterCommandChannel->sendMessage(
+  return receiveValueFromWorker<accreal>(
     packMessage(Functions::tensorTrace, self),
     THDState::s_current_worker
   );
-
-  return receiveValueFromWorker<accreal>(THDState::s_current_worker);
 }
 
 void THDTensor_(cross)(THDTensor *self, THDTensor *src1, THDTensor *src2, int dimension) {
@@ -162,6 +162,10 @@ THD_API real THDTensor_(minall)(THDTensor *self);
 THD_API real THDTensor_(maxall)(THDTensor *self);
 THD_API real THDTensor_(medianall)(THDTensor *self);
 THD_API accreal THDTensor_(sumall)(THDTensor *self);
+/* Deferred versions don't wait for the worker, the result has to be read
+from the returned future and the future freed. */
+THD_API THDFuture *THDTensor_(dotAsync)(THDTensor *self, THDTensor *src);
+THD_API THDFuture *THDTensor_(sumallAsync)(THDTensor *self);
 THD_API accreal THDTensor_(prodall)(THDTensor *self);
 THD_API void THDTensor_(neg)(THDTensor *self, THDTensor *src);
 THD_API void THDTensor_(cinv)(THDTensor *self, THDTensor *src);
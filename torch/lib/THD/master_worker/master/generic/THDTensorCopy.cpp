@@ -13,6 +13,7 @@ void THDTensor_(copyFromMaster)(THDTensor* to, THDTensorDescriptor* from) {
     packMessage(Functions::tensorCopyFromMaster, to),
     THDState::s_current_worker
   );
+  masterCommandChannel->flush(THDState::s_current_worker);
 
   thd::dataChannel->send(*from, THDState::s_current_worker);
 }
@@ -23,6 +24,7 @@ void THDTensor_(copyFromWorker)(THDTensorDescriptor* to, THDTensor* from) {
     packMessage(Functions::tensorCopyFromWorker, from),
     THDState::s_current_worker
   );
+  masterCommandChannel->flush(THDState::s_current_worker);
 
   thd::dataChannel->receive(*to, THDState::s_current_worker);
 }
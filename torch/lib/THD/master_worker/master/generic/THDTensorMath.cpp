@@ -215,7 +215,7 @@ void THDTensor_(maskedSelect)(THDTensor *tensor, THDTensor* src, THDByteTensor *
 }
 
 void THDTensor_(nonzero)(THDLongTensor *subscript, THDTensor *tensor) {
-  masterCommandChannel->sendMessage(
+  long long numel = receiveValueFromWorker<long long>(
     packMessage(
       Functions::tensorNonzero,
       subscript,
@@ -223,7 +223,6 @@ void THDTensor_(nonzero)(THDLongTensor *subscript, THDTensor *tensor) {
     ),
     THDState::s_current_worker
   );
-  long long numel = receiveValueFromWorker<long long>(tensor->storage->node_id);
   THDLongTensor__resize2d(subscript, numel, tensor->nDimension);
 }
 
@@ -518,11 +517,18 @@ void THDTensor_(catArray)(THDTensor *result, THDTensor **inputs,
 int THDTensor_(equal)(THDTensor *ta, THDTensor *tb) {
   if (!THDTensor_(isSameSizeAs)(ta, tb))
     return 0;
-  masterCommandChannel->sendMessage(
+  return receiveValueFromWorker<int>(
     packMessage(Functions::tensorEqual, ta, tb),
     THDState::s_current_worker
   );
-  return receiveValueFromWorker<int>(ta->storage->node_id);
+}
+
+THDFuture *THDTensor_(equalAsync)(THDTensor *ta, THDTensor *tb) {
+  THArgCheck(THDTensor_(isSameSizeAs)(ta, tb), 2, "tensors have different sizes");
+  return new THDFuture(requestValueFromWorker(
+    packMessage(Functions::tensorEqual, ta, tb),
+    THDState::s_current_worker
+  ));
 }
 
 void THDTensor_(tpow)(THDTensor *r_, real value, THDTensor *t) {
@@ -723,12 +729,10 @@ void THDTensor_(norm)(THDTensor *r_, THDTensor *t, real value, int dimension, in
 }
 
 accreal THDTensor_(normall)(THDTensor *tensor, real value) {
-  masterCommandChannel->sendMessage(
+  return receiveValueFromWorker<accreal>(
     packMessage(Functions::tensorNormall, tensor, value),
     THDState::s_current_worker
   );
-
-  return receiveValueFromWorker<accreal>(THDState::s_current_worker);
 }
 
 void THDTensor_(renorm)(THDTensor *res, THDTensor *src, real value,
@@ -749,40 +753,32 @@ void THDTensor_(renorm)(THDTensor *res, THDTensor *src, real value,
 }
 
 accreal THDTensor_(dist)(THDTensor *tensor, THDTensor *src, real value) {
-  masterCommandChannel->sendMessage(
+  return receiveValueFromWorker<accreal>(
     packMessage(Functions::tensorDist, tensor, src, value),
     THDState::s_current_worker
   );
-
-  return receiveValueFromWorker<accreal>(THDState::s_current_worker);
 }
 
 accreal THDTensor_(meanall)(THDTensor *tensor) {
   THArgCheck(tensor->nDimension > 0, 1, "empty Tensor");
-  masterCommandChannel->sendMessage(
+  return receiveValueFromWorker<accreal>(
     packMessage(Functions::tensorMeanall, tensor),
     THDState::s_current_worker
   );
-
-  return receiveValueFromWorker<accreal>(THDState::s_current_worker);
 }
 
 accreal THDTensor_(varall)(THDTensor *tensor, int biased) {
-  masterCommandChannel->sendMessage(
+  return receiveValueFromWorker<accreal>(
     packMessage(Functions::tensorVarall, tensor, biased),
     THDState::s_current_worker
   );
-
-  return receiveValueFromWorker<accreal>(THDState::s_current_worker);
 }
 
 accreal THDTensor_(stdall)(THDTensor *tensor, int biased) {
-  masterCommandChannel->sendMessage(
+  return receiveValueFromWorker<accreal>(
     packMessage(Functions::tensorStdall, tensor, biased),
     THDState::s_current_worker
   );
-
-  return receiveValueFromWorker<accreal>(THDState::s_current_worker);
 }
 
 void THDTensor_(linspace)(THDTensor *r_, real a, real b, long n) {
@@ -866,23 +862,19 @@ void THDTensor_(bhistc)(THDTensor *hist, THDTensor *tensor, long nbins,
 int THDTensor_(logicalall)(THDTensor *tensor) {
   THArgCheck(tensor->nDimension > 0, 1, "empty Tensor");
 
-  masterCommandChannel->sendMessage(
+  return receiveValueFromWorker<int>(
     packMessage(Functions::tensorLogicalall, tensor),
     THDState::s_current_worker
   );
-
-  return receiveValueFromWorker<int>(THDState::s_current_worker);
 }
 
 int THDTensor_(logicalany)(THDTensor *tensor) {
   THArgCheck(tensor->nDimension > 0, 1, "empty Tensor");
 
-  masterCommandChannel->sendMessage(
+  return receiveValueFromWorker<int>(
     packMessage(Functions::tensorLogicalany, tensor),
     THDState::s_current_worker
   );
-
-  return receiveValueFromWorker<int>(THDState::s_current_worker);
 }
 
 #endif // defined(TH_REAL_IS_BYTE)
@@ -57,6 +57,7 @@ THD_API void THDTensor_(cat)(THDTensor *r_, THDTensor *ta,
 THD_API void THDTensor_(catArray)(THDTensor *result, THDTensor **inputs,
                                   int numInputs, int dimension);
 THD_API int THDTensor_(equal)(THDTensor *ta, THDTensor *tb);
+THD_API THDFuture *THDTensor_(equalAsync)(THDTensor *ta, THDTensor *tb);
 THD_API void THDTensor_(ltValue)(THDByteTensor *r_, THDTensor *t, real value);
 THD_API void THDTensor_(leValue)(THDByteTensor *r_, THDTensor *t, real value);
 THD_API void THDTensor_(gtValue)(THDByteTensor *r_, THDTensor *t, real value);
@@ -21,13 +21,11 @@ namespace worker {
 namespace detail {
 
 void sendValueToMaster(long long value) {
-  IntScalar scalar(value);
-  dataChannel->send(scalar, 0);
+  workerCommandChannel->sendResponse(value);
 }
 
 void sendValueToMaster(double value) {
-  FloatScalar scalar(value);
-  dataChannel->send(scalar, 0);
+  workerCommandChannel->sendResponse(value);
 }
 
 thpp::Tensor* unpackRetrieveTensor(rpc::RPCMessage& message) {
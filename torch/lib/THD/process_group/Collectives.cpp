@@ -1,11 +1,28 @@
 #include "Collectives.hpp"
 #include "General.hpp"
 #include "../base/ChannelUtils.hpp"
+#include "../base/Tracing.hpp"
 
+#include <cstdint>
 #include <vector>
 
 using namespace thd;
 
+namespace {
+
+std::uint64_t tensorBytes(const thpp::Tensor& tensor) {
+  return tensor.elementSize() * tensor.numel();
+}
+
+std::uint64_t tensorBytes(THDTensorDescriptor** tensors, size_t len) {
+  std::uint64_t bytes = 0;
+  for (std::size_t i = 0; i < len; ++i)
+    bytes += tensorBytes(*tensors[i]);
+  return bytes;
+}
+
+} // anonymous namespace
+
 int THDGetRank() {
   return static_cast<int>(dataChannel->getRank());
 }
@@ -15,18 +32,76 @@ int THDGetNumProcesses() {
 }
 
 void THDAllReduce(THDTensorDescriptor* desc, THDReduceOp operation, THDGroup group) {
+  Tracer::Scope trace("all_reduce", tensorBytes(*desc), group);
   dataChannel->allReduce(*desc, operation, group);
 }
 
+void THDAllReduceCoalesced(THDTensorDescriptor** desc, size_t len,
+                           THDReduceOp operation, THDGroup group) {
+  Tracer::Scope trace("all_reduce_coalesced", tensorBytes(desc, len), group);
+  std::vector<thpp::Tensor*> v_desc(desc, desc + len);
+  dataChannel->allReduceCoalesced(v_desc, operation, group);
+}
+
+void THDAllReduceCompressed(THDTensorDescriptor* desc, THDReduceOp operation,
+                           THDCompression compression, long k,
+                           THDTensorDescriptor* residual, THDGroup group) {
+  Tracer::Scope trace("all_reduce_compressed", tensorBytes(*desc), group);
+  dataChannel->allReduceCompressed(*desc, operation, compression, k, residual, group);
+}
+
 void THDReduce(THDTensorDescriptor* desc, THDReduceOp operation,
                int dst_rank, THDGroup group) {
+  Tracer::Scope trace("reduce", tensorBytes(*desc), group);
   dataChannel->reduce(*desc, operation, convertToRank(dst_rank), group);
 }
 
 void THDBroadcast(THDTensorDescriptor* desc, int src_rank, THDGroup group) {
+  Tracer::Scope trace("broadcast", tensorBytes(*desc), group);
   dataChannel->broadcast(*desc, convertToRank(src_rank), group);
 }
 
+void THDReduceScatter(THDTensorDescriptor* output, THDTensorDescriptor** input,
+                      size_t len, THDReduceOp operation, THDGroup group) {
+  Tracer::Scope trace("reduce_scatter", tensorBytes(input, len), group);
+  std::vector<thpp::Tensor*> v_input(input, input + len);
+  dataChannel->reduceScatter(*output, v_input, operation, group);
+}
+
+void THDAllToAll(THDTensorDescriptor** output, THDTensorDescriptor** input,
+                 size_t len, THDGroup group) {
+  Tracer::Scope trace("all_to_all", tensorBytes(input, len), group);
+  std::vector<thpp::Tensor*> v_output(output, output + len);
+  std::vector<thpp::Tensor*> v_input(input, input + len);
+  dataChannel->allToAll(v_output, v_input, group);
+}
+
+THDRequest* THDIAllReduce(THDTensorDescriptor* desc, THDReduceOp operation,
+                          THDGroup group) {
+  return dataChannel->iallReduce(*desc, operation, group);
+}
+
+THDRequest* THDIAllReduceCoalesced(THDTensorDescriptor** desc, size_t len,
+                                   THDReduceOp operation, THDGroup group) {
+  std::vector<thpp::Tensor*> v_desc(desc, desc + len);
+  return dataChannel->iallReduceCoalesced(v_desc, operation, group);
+}
+
+THDRequest* THDIReduce(THDTensorDescriptor* desc, THDReduceOp operation,
+                       int dst_rank, THDGroup group) {
+  return dataChannel->ireduce(*desc, operation, convertToRank(dst_rank), group);
+}
+
+THDRequest* THDIBroadcast(THDTensorDescriptor* desc, int src_rank, THDGroup group) {
+  return dataChannel->ibroadcast(*desc, convertToRank(src_rank), group);
+}
+
+THDRequest* THDIAllGather(THDTensorDescriptor** output, size_t len,
+                          THDTensorDescriptor* input, THDGroup group) {
+  std::vector<thpp::Tensor*> v_output(output, output + len);
+  return dataChannel->iallGather(v_output, *input, group);
+}
+
 THDRequest* THDIsend(THDTensorDescriptor* desc, int dst_rank) {
   return dataChannel->isend(*desc, convertToRank(dst_rank));
 }
@@ -36,36 +111,43 @@ THDRequest* THDIrecv(THDTensorDescriptor* desc, int src_rank) {
 }
 
 void THDSend(THDTensorDescriptor* desc, int dst_rank) {
+  Tracer::Scope trace("send", tensorBytes(*desc));
   dataChannel->send(*desc, convertToRank(dst_rank));
 }
 
 void THDRecvAnySource(THDTensorDescriptor* desc) {
+  Tracer::Scope trace("recv", tensorBytes(*desc));
   dataChannel->receive(*desc);
 }
 
 void THDRecv(THDTensorDescriptor* desc, int src_rank) {
+  Tracer::Scope trace("recv", tensorBytes(*desc));
   dataChannel->receive(*desc, convertToRank(src_rank));
 }
 
 void THDAllGather(THDTensorDescriptor** output, size_t len,
                   THDTensorDescriptor* input, THDGroup group) {
+  Tracer::Scope trace("all_gather", tensorBytes(*input), group);
   std::vector<thpp::Tensor*> v_output(output, output + len);
   dataChannel->allGather(v_output, *input, group);
 }
 
 void THDGatherSend(THDTensorDescriptor* input, int dst_rank, THDGroup group) {
+  Tracer::Scope trace("gather", tensorBytes(*input), group);
   std::vector<thpp::Tensor*> v_output;
   dataChannel->gather(v_output, *input, convertToRank(dst_rank), group);
 }
 
 void THDGatherRecv(THDTensorDescriptor** output, size_t len,
                    THDTensorDescriptor* input, THDGroup group) {
+  Tracer::Scope trace("gather", tensorBytes(*input), group);
   std::vector<thpp::Tensor*> v_output(output, output + len);
   dataChannel->gather(v_output, *input, dataChannel->getRank(), group);
 }
 
 void THDScatterSend(THDTensorDescriptor** input, size_t len,
                     THDTensorDescriptor* output, THDGroup group) {
+  Tracer::Scope trace("scatter", tensorBytes(*output), group);
   std::vector<thpp::Tensor*> v_input(input, input + len);
   dataChannel->scatter(v_input, *output, dataChannel->getRank(), group);
 }
@@ -74,11 +156,13 @@ void THDScatterRecv(THDTensorDescriptor* output, int src_rank, THDGroup group) {
   if (src_rank < 0)
     throw std::domain_error("src_rank should not be negative");
 
+  Tracer::Scope trace("scatter", tensorBytes(*output), group);
   std::vector<thpp::Tensor*> v_input;
   dataChannel->scatter(v_input, *output, convertToRank(src_rank), group);
 }
 
 void THDBarrier(THDGroup group) {
+  Tracer::Scope trace("barrier", 0, group);
   dataChannel->barrier(group);
 }
 
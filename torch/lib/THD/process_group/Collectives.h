@@ -7,9 +7,28 @@ THD_API int THDGetRank();
 THD_API int THDGetNumProcesses();
 THD_API void THDAllReduce(THDTensorDescriptor* desc, THDReduceOp operation,
                           THDGroup group);
+THD_API void THDAllReduceCoalesced(THDTensorDescriptor** desc, size_t len,
+                                   THDReduceOp operation, THDGroup group);
+THD_API void THDAllReduceCompressed(THDTensorDescriptor* desc, THDReduceOp operation,
+                                   THDCompression compression, long k,
+                                   THDTensorDescriptor* residual, THDGroup group);
 THD_API void THDReduce(THDTensorDescriptor* desc, THDReduceOp operation,
                        int dst_rank, THDGroup group);
 THD_API void THDBroadcast(THDTensorDescriptor* desc, int src_rank, THDGroup group);
+THD_API void THDReduceScatter(THDTensorDescriptor* output, THDTensorDescriptor** input,
+                              size_t len, THDReduceOp operation, THDGroup group);
+THD_API void THDAllToAll(THDTensorDescriptor** output, THDTensorDescriptor** input,
+                         size_t len, THDGroup group);
+THD_API THDRequest* THDIAllReduce(THDTensorDescriptor* desc, THDReduceOp operation,
+                                  THDGroup group);
+THD_API THDRequest* THDIAllReduceCoalesced(THDTensorDescriptor** desc, size_t len,
+                                           THDReduceOp operation, THDGroup group);
+THD_API THDRequest* THDIReduce(THDTensorDescriptor* desc, THDReduceOp operation,
+                               int dst_rank, THDGroup group);
+THD_API THDRequest* THDIBroadcast(THDTensorDescriptor* desc, int src_rank,
+                                  THDGroup group);
+THD_API THDRequest* THDIAllGather(THDTensorDescriptor** output, size_t len,
+                                  THDTensorDescriptor* input, THDGroup group);
 THD_API THDRequest* THDIsend(THDTensorDescriptor* desc, int dst_rank);
 THD_API THDRequest* THDIrecv(THDTensorDescriptor* desc, int src_rank);
 THD_API void THDSend(THDTensorDescriptor* desc, int dst_rank);
@@ -3,8 +3,10 @@
 
 #include <cassert>
 #include <cerrno>
+#include <chrono>
 #include <cstdlib>
 #include <exception>
+#include <future>
 #include <mutex>
 #include <string>
 #include <system_error>
@@ -13,17 +15,23 @@
 using namespace thd;
 
 std::vector<std::thread> g_all_workers;
-std::mutex g_mutex;
 std::unique_ptr<Barrier> g_barrier;
 
-void init_worker(const int& rank, const std::string& master_addr) {
-  g_mutex.lock();
-  setenv(RANK_ENV, std::to_string(rank).data(), 1);
-  setenv(MASTER_ADDR_ENV, master_addr.data(), 1);
-  auto channel = std::make_shared<thd::WorkerCommandChannel>(thd::getInitConfig("env://")); // reads all env variable
-  g_mutex.unlock();
+// enough messages to fill several command batches
+constexpr int BATCHED_MESSAGES = 5000;
+
+std::unique_ptr<rpc::RPCMessage> make_message(const std::string& text) {
+  rpc::ByteArray arr(text.data(), text.size());
+  return std::unique_ptr<rpc::RPCMessage>(new rpc::RPCMessage(arr));
+}
+
+void init_worker(int rank, int world_size) {
+  // the master address and port are read from the environment
+  auto channel = std::make_shared<thd::WorkerCommandChannel>(
+      thd::getInitConfig("env://", world_size, "", rank));
 
-  assert(channel->init());
+  if (!channel->init())
+    throw std::runtime_error("failed to initialize the command channel");
 
   auto msg = channel->recvMessage();
   std::string expected = std::string("hello to worker ") +
@@ -32,6 +40,19 @@ void init_worker(const int& rank, const std::string& master_addr) {
       (int)msg.get()->bytes().length(), msg.get()->bytes().data());
   assert(expected.compare(msg.get()->bytes().to_string()) == 0);
 
+  for (int i = 0; i < BATCHED_MESSAGES; ++i) {
+    auto batched_msg = channel->recvMessage();
+    assert(std::to_string(i).compare(batched_msg.get()->bytes().to_string()) == 0);
+  }
+
+  // requests are answered in the order in which they were sent
+  msg = channel->recvMessage();
+  assert(msg.get()->bytes().to_string() == "int request");
+  channel->sendResponse(static_cast<long long>(rank));
+  msg = channel->recvMessage();
+  assert(msg.get()->bytes().to_string() == "float request");
+  channel->sendResponse(rank + 0.5);
+
   /*
    * We need to wait until master will do all receiving and sending. This
    * is because when worker is destroyed it closes all sockets what results in
@@ -40,15 +61,12 @@ void init_worker(const int& rank, const std::string& master_addr) {
   g_barrier->wait();
 }
 
-void init_master(int world_size, const std::string& master_port) {
-  g_mutex.lock();
-  setenv(WORLD_SIZE_ENV, std::to_string(world_size).data(), 1);
-  setenv(RANK_ENV, "0", 1);
-  setenv(MASTER_PORT_ENV, master_port.data(), 1);
-  auto channel = std::make_shared<thd::MasterCommandChannel>(thd::getInitConfig("env://")); // reads all env variable
-  g_mutex.unlock();
+void init_master(int world_size) {
+  auto channel = std::make_shared<thd::MasterCommandChannel>(
+      thd::getInitConfig("env://", world_size, "", 0));
 
-  assert(channel->init());
+  if (!channel->init())
+    throw std::runtime_error("failed to initialize the command channel");
 
   for (int worker_rank = 1; worker_rank < world_size; ++worker_rank) {
     rpc::ByteArray arr;
@@ -61,6 +79,28 @@ void init_master(int world_size, const std::string& master_port) {
     channel->sendMessage(std::move(rpc_msg), worker_rank);
   }
 
+  // last batch isn't flushed explicitly, so it has to be sent after a delay
+  for (int i = 0; i < BATCHED_MESSAGES; ++i) {
+    for (int worker_rank = 1; worker_rank < world_size; ++worker_rank) {
+      channel->sendMessage(make_message(std::to_string(i)), worker_rank);
+    }
+  }
+
+  std::vector<std::future<WorkerResponse>> int_responses, float_responses;
+  for (int worker_rank = 1; worker_rank < world_size; ++worker_rank) {
+    int_responses.push_back(channel->sendRequest(make_message("int request"), worker_rank));
+    float_responses.push_back(channel->sendRequest(make_message("float request"), worker_rank));
+    channel->flush(worker_rank);
+  }
+
+  // responses are matched with requests no matter in which order they are read
+  for (int worker_rank = world_size - 1; worker_rank >= 1; --worker_rank) {
+    auto response = float_responses[worker_rank - 1].get();
+    assert(response.is_float && response.float_value == worker_rank + 0.5);
+    response = int_responses[worker_rank - 1].get();
+    assert(!response.is_float && response.int_value == worker_rank);
+  }
+
   g_barrier->wait();
 
   // wait for all workers to finish
@@ -71,14 +111,14 @@ void init_master(int world_size, const std::string& master_port) {
 
 void run_test_case(const std::string& name, int world_size,
                    const std::string& master_addr, const std::string& master_port) {
+  setenv(MASTER_ADDR_ENV, master_addr.data(), 1);
+  setenv(MASTER_PORT_ENV, master_port.data(), 1);
   g_barrier.reset(new Barrier(world_size));
   for (int rank = 1; rank < world_size; ++rank) {
-    g_all_workers.push_back(
-      std::thread(init_worker, rank, master_addr + ":" + master_port)
-    );
+    g_all_workers.push_back(std::thread(init_worker, rank, world_size));
   }
 
-  std::thread master_thread(init_master, world_size, master_port);
+  std::thread master_thread(init_master, world_size);
   master_thread.join();
   g_all_workers.clear();
 
@@ -90,6 +130,45 @@ void run_test_case(const std::string& name, int world_size,
       name.c_str(), world_size, master_addr.c_str(), master_port.c_str());
 }
 
+// A response nobody asked for breaks the stream, so the master stops.
+void test_unrequested_response(const std::string& master_port) {
+  setenv(MASTER_ADDR_ENV, "127.0.0.1", 1);
+  setenv(MASTER_PORT_ENV, master_port.data(), 1);
+  g_barrier.reset(new Barrier(2));
+  std::thread worker([]{
+    auto channel = std::make_shared<thd::WorkerCommandChannel>(
+        thd::getInitConfig("env://", 2, "", 1));
+    if (!channel->init())
+      throw std::runtime_error("failed to initialize the command channel");
+    channel->sendResponse(1ll);
+    g_barrier->wait();
+  });
+
+  auto channel = std::make_shared<thd::MasterCommandChannel>(
+      thd::getInitConfig("env://", 2, "", 0));
+  if (!channel->init())
+    throw std::runtime_error("failed to initialize the command channel");
+
+  bool failed = false;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (!failed && std::chrono::steady_clock::now() < deadline) {
+    try {
+      channel->sendMessage(make_message("ping"), 1);
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    } catch (const std::runtime_error& e) {
+      assert(std::string(e.what()).find("not requested") != std::string::npos);
+      failed = true;
+    }
+  }
+  assert(failed);
+  ASSERT_THROWS(std::runtime_error, channel->sendRequest(make_message("request"), 1))
+
+  g_barrier->wait();
+  worker.join();
+  fprintf(stderr, "\nPassed unrequested response test\n"
+      "----------------------------------------------------\n\n");
+}
+
 int main() {
   int world_size;
   std::string master_addr;
@@ -126,6 +205,12 @@ int main() {
     master_addr = "localhost";
     master_port = "55555";
     run_test_case(test_name, world_size, master_addr, master_port);
+
+    test_name = "Unrequested response test";
+    world_size = 2;
+    master_addr = "127.0.0.1";
+    master_port = "55555";
+    test_unrequested_response(master_port);
   } catch (const std::exception& e) {
     throw std::runtime_error(
         "test for world size = " + std::to_string(world_size) +
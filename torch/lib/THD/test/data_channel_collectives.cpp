@@ -4,7 +4,11 @@
 #ifdef WITH_MPI
 #include "../base/data_channels/DataChannelMPI.hpp"
 #endif // WITH_MPI
+#ifdef WITH_SHM
+#include "../base/data_channels/DataChannelSHM.hpp"
+#endif // WITH_SHM
 #include "../base/data_channels/DataChannelTCP.hpp"
+#include "../base/Tracing.hpp"
 #include "TestUtils.hpp"
 
 #include <THPP/tensors/THTensor.hpp>
@@ -13,9 +17,9 @@
 #include <cassert>
 #include <chrono>
 #include <cmath>
+#include <future>
 #include <iostream>
 #include <memory>
-#include <mutex>
 #include <set>
 #include <thread>
 #include <array>
@@ -25,8 +29,8 @@ constexpr int MASTER_PORT = 45678;
 constexpr int BARRIER_WAIT_TIME = 200; // milliseconds
 
 std::vector<std::thread> g_all_workers;
-std::mutex g_mutex;
 std::string g_data_channel_type;
+bool g_tcp_shared_memory = true; // whether TCP reduces on a host through shared memory
 std::unique_ptr<Barrier> g_barrier;
 
 
@@ -45,6 +49,129 @@ void test_send_recv_tensor(std::shared_ptr<thd::DataChannel> data_channel) {
   }
 }
 
+void test_send_recv_tensor_large(std::shared_ptr<thd::DataChannel> data_channel) {
+  if (g_data_channel_type == "gloo") {
+    return; // XXX: Gloo does not support send/recv
+  }
+
+  // spans many pipeline segments, the last one incomplete, so it is split
+  // between all connections to the peer when they are configured
+  const long numel = 300007;
+  auto int_tensor = buildTensor<int>({numel}, -1);
+  auto data = static_cast<int*>(int_tensor->data());
+  if (data_channel->getRank() == 0) {
+    for (long i = 0; i < numel; ++i)
+      data[i] = i;
+    data_channel->send(*int_tensor, 1);
+  } else if (data_channel->getRank() == 1) {
+    data_channel->receive(*int_tensor, 0);
+    for (long i = 0; i < numel; ++i)
+      assert(data[i] == i);
+  }
+}
+
+void test_strided_tensors(std::shared_ptr<thd::DataChannel> data_channel,
+                          int workers) {
+  if (g_data_channel_type != "tcp" && g_data_channel_type != "shm") {
+    return; // XXX: only TCP and SHM send and reduce non-contiguous tensors
+  }
+
+  // a transposed matrix is sent element by element and a slice of columns
+  // row by row, both straight from and into non-contiguous memory
+  auto matrix = buildTensor<int>({300, 200}, -1);
+  auto data = static_cast<int*>(matrix->data());
+  std::unique_ptr<thpp::Tensor> transposed(matrix->newTranspose(0, 1));
+  std::unique_ptr<thpp::Tensor> columns(matrix->newNarrow(1, 10, 50));
+  if (data_channel->getRank() == 0) {
+    for (long i = 0; i < 300 * 200; ++i)
+      data[i] = i;
+    data_channel->send(*transposed, 1);
+    data_channel->send(*columns, 1);
+  } else if (data_channel->getRank() == 1) {
+    auto received = buildTensor<int>({200, 300}, -1);
+    auto received_data = static_cast<int*>(received->data());
+    data_channel->receive(*received, 0);
+    for (long i = 0; i < 300; ++i) {
+      for (long j = 0; j < 200; ++j)
+        assert(received_data[j * 300 + i] == i * 200 + j);
+    }
+
+    data_channel->receive(*columns, 0);
+    for (long i = 0; i < 300; ++i) {
+      for (long j = 0; j < 200; ++j)
+        assert(data[i * 200 + j] == (j >= 10 && j < 60 ? i * 200 + j : -1));
+    }
+  }
+
+  auto float_tensor = buildTensor<float>({3, 4}, data_channel->getRank());
+  std::unique_ptr<thpp::Tensor> column(float_tensor->newSelect(1, 2));
+  data_channel->allReduce(*column, THDReduceOp::THDReduceSUM, 0);
+  for (long i = 0; i < 3; ++i) {
+    for (long j = 0; j < 4; ++j) {
+      float value = static_cast<float*>(float_tensor->data())[i * 4 + j];
+      assert(value == (j == 2 ? workers * (workers + 1) / 2 : data_channel->getRank()));
+    }
+  }
+
+  // only the root gets the result of reduce
+  float_tensor->fill(data_channel->getRank());
+  data_channel->reduce(*column, THDReduceOp::THDReduceSUM, 0, 0);
+  if (data_channel->getRank() == 0) {
+    for (long i = 0; i < 3; ++i) {
+      for (long j = 0; j < 4; ++j) {
+        float value = static_cast<float*>(float_tensor->data())[i * 4 + j];
+        assert(value == (j == 2 ? workers * (workers + 1) / 2 : 0));
+      }
+    }
+  }
+
+  std::vector<std::shared_ptr<thpp::FloatTensor>> matrices;
+  std::vector<std::unique_ptr<thpp::Tensor>> input_columns;
+  std::vector<thpp::Tensor*> raw_columns;
+  for (int i = 0; i <= workers; ++i) {
+    matrices.push_back(buildTensor<float>({3, 4}, 10 * i + data_channel->getRank()));
+    input_columns.emplace_back(matrices.back()->newSelect(1, 1));
+    raw_columns.push_back(input_columns.back().get());
+  }
+  float_tensor->fill(-1);
+  data_channel->reduceScatter(*column, raw_columns, THDReduceOp::THDReduceSUM, 0);
+  for (long i = 0; i < 3; ++i) {
+    for (long j = 0; j < 4; ++j) {
+      float value = static_cast<float*>(float_tensor->data())[i * 4 + j];
+      float expected = 10 * data_channel->getRank() * (workers + 1) + workers * (workers + 1) / 2;
+      assert(value == (j == 2 ? expected : -1));
+    }
+  }
+
+  // large enough for the ring algorithm and for pipelined segments, which
+  // cut a slice of columns between rows and a transposed matrix between
+  // its columns
+  std::vector<thd::rank_type> pair_ranks = {0, 1};
+  THDGroup pair = data_channel->newGroup(pair_ranks);
+  auto large = buildTensor<int>({1000, 400}, -1);
+  auto large_data = static_cast<int*>(large->data());
+  std::unique_ptr<thpp::Tensor> large_columns(large->newNarrow(1, 50, 300));
+  std::unique_ptr<thpp::Tensor> large_transposed(large->newTranspose(0, 1));
+  for (auto strided : {large_columns.get(), large_transposed.get()}) {
+    for (THDGroup group : {THDGroupWORLD, pair}) {
+      for (long i = 0; i < 1000 * 400; ++i)
+        large_data[i] = data_channel->getRank() + i % 7;
+      data_channel->allReduce(*strided, THDReduceOp::THDReduceSUM, group);
+
+      bool reduced = (group == THDGroupWORLD || contains(pair_ranks, data_channel->getRank()));
+      int processes = group == THDGroupWORLD ? workers + 1 : 2;
+      int rank_sum = group == THDGroupWORLD ? workers * (workers + 1) / 2 : 1;
+      for (long i = 0; i < 1000 * 400; ++i) {
+        long column = i % 400;
+        bool selected = (strided == large_transposed.get() || (column >= 50 && column < 350));
+        int expected = (reduced && selected) ? rank_sum + processes * (i % 7)
+                                             : data_channel->getRank() + i % 7;
+        assert(large_data[i] == expected);
+      }
+    }
+  }
+}
+
 void test_send_recv_tensor_any_source(std::shared_ptr<thd::DataChannel> data_channel,
                                       int workers) {
   if (g_data_channel_type == "gloo") {
@@ -143,6 +270,178 @@ void test_allReduce(std::shared_ptr<thd::DataChannel> data_channel, int workers)
                          -1, data_channel->getNumProcesses() - 1);
 }
 
+void test_allReduce_large(std::shared_ptr<thd::DataChannel> data_channel, int workers) {
+  thd::tracer.enable(true);
+  // big enough to use the ring algorithm in TCP when it doesn't reduce
+  // through shared memory, and not evenly divisible between processes
+  auto int_tensor = buildTensor<int>({3, 5, 7, 2500}, data_channel->getRank());
+  {
+    thd::Tracer::Scope trace("test_all_reduce_large", 0);
+    data_channel->allReduce(*int_tensor, THDReduceOp::THDReduceSUM, 0);
+  }
+  ASSERT_TENSOR_VALUE(int, *int_tensor, workers * (workers + 1) / 2)
+
+  int_tensor->fill(data_channel->getRank());
+  data_channel->allReduce(*int_tensor, THDReduceOp::THDReduceMAX, 0);
+  ASSERT_TENSOR_VALUE(int, *int_tensor, workers)
+
+  // pairs of processes use pipelined recursive doubling over TCP
+  std::vector<thd::rank_type> group_ranks = {0, 1};
+  THDGroup group = data_channel->newGroup(group_ranks);
+  int_tensor->fill(data_channel->getRank() + 1);
+  {
+    thd::Tracer::Scope trace("test_all_reduce_large_pair", 0);
+    data_channel->allReduce(*int_tensor, THDReduceOp::THDReducePRODUCT, group);
+  }
+  if (contains(group_ranks, data_channel->getRank())) {
+    ASSERT_TENSOR_VALUE(int, *int_tensor, 2)
+  } else {
+    ASSERT_TENSOR_VALUE(int, *int_tensor, data_channel->getRank() + 1)
+  }
+
+  if (g_data_channel_type == "tcp") {
+    for (const auto& event : thd::tracer.events()) {
+      std::string name = event.name, algorithm = event.algorithm;
+      if (name == "test_all_reduce_large") {
+        assert(algorithm == (g_tcp_shared_memory ? "shared_memory" : "ring"));
+      } else if (name == "test_all_reduce_large_pair" && !algorithm.empty()) {
+        assert(algorithm == (g_tcp_shared_memory ? "shared_memory" : "recursive_doubling"));
+      }
+    }
+  }
+  thd::tracer.enable(false);
+}
+
+// All processes of the test share a host, so TCP reduces through shared memory
+void test_allReduce_hierarchical(std::shared_ptr<thd::DataChannel> data_channel, int workers) {
+  if (g_data_channel_type != "tcp" || !g_tcp_shared_memory)
+    return;
+
+  thd::tracer.enable(true);
+  std::vector<thd::rank_type> group_ranks = {1, 2};
+  THDGroup group = data_channel->newGroup(group_ranks);
+  // segments are remapped as tensors grow, and the leader of the group maps
+  // its own while the other channels in this process still use theirs
+  for (long numel : {5l, 1l << 14, 1l << 18}) {
+    thd::Tracer::Scope trace("test_all_reduce", 0);
+    auto int_tensor = buildTensor<int>({numel}, data_channel->getRank());
+    data_channel->allReduce(*int_tensor, THDReduceOp::THDReduceSUM, 0);
+    ASSERT_TENSOR_VALUE(int, *int_tensor, workers * (workers + 1) / 2)
+
+    int_tensor->fill(data_channel->getRank());
+    data_channel->allReduce(*int_tensor, THDReduceOp::THDReduceSUM, group);
+    if (contains(group_ranks, data_channel->getRank())) {
+      ASSERT_TENSOR_VALUE(int, *int_tensor, 3)
+    } else {
+      ASSERT_TENSOR_VALUE(int, *int_tensor, data_channel->getRank())
+    }
+  }
+
+  for (const auto& event : thd::tracer.events()) {
+    if (std::string(event.name) == "test_all_reduce")
+      assert(std::string(event.algorithm) == "shared_memory");
+  }
+  thd::tracer.enable(false);
+}
+
+void test_allReduceCoalesced(std::shared_ptr<thd::DataChannel> data_channel, int workers) {
+  std::vector<std::shared_ptr<thpp::FloatTensor>> float_tensors;
+  std::vector<std::shared_ptr<thpp::FloatTensor>> double_tensors;
+  std::vector<thpp::Tensor*> raw_tensors;
+  for (long i = 1; i <= 5; ++i) {
+    float_tensors.push_back(buildTensor<float>({i, 3}, data_channel->getRank()));
+    raw_tensors.push_back(float_tensors.back().get());
+  }
+  for (long i = 1; i <= 3; ++i) {
+    double_tensors.push_back(buildTensor<double>({2, i}, data_channel->getRank()));
+    raw_tensors.push_back(double_tensors.back().get());
+  }
+  float_tensors.push_back(buildTensor<float>({1 << 23}, data_channel->getRank()));
+  raw_tensors.push_back(float_tensors.back().get());
+
+  data_channel->allReduceCoalesced(raw_tensors, THDReduceOp::THDReduceSUM, 0);
+  for (auto& tensor : float_tensors)
+    ASSERT_TENSOR_VALUE(float, *tensor, workers * (workers + 1) / 2)
+  for (auto& tensor : double_tensors)
+    ASSERT_TENSOR_VALUE(double, *tensor, workers * (workers + 1) / 2)
+}
+
+void test_allReduceCompressed(std::shared_ptr<thd::DataChannel> data_channel, int workers) {
+  if (g_data_channel_type == "gloo") {
+    // XXX: Gloo does not support allToAll and integer allGather, and the
+    // failed top-k exchange must not touch the error feedback
+    auto float_tensor = buildTensor<float>({10}, 1);
+    auto residual = buildTensor<float>({10}, 2);
+    ASSERT_THROWS(std::exception, data_channel->allReduceCompressed(
+      *float_tensor, THDReduceOp::THDReduceSUM, THDCompressionTOPK, 1, residual.get()))
+    ASSERT_TENSOR_VALUE(float, *float_tensor, 1)
+    ASSERT_TENSOR_VALUE(float, *residual, 2)
+    return;
+  }
+
+  // halves of small integers are exact in half precision
+  int rank = data_channel->getRank();
+  auto float_tensor = buildTensor<float>({1001}, 0.5 * (rank + 1));
+  auto double_tensor = buildTensor<double>({7, 3}, 0.5 * (rank + 1));
+  data_channel->allReduceCompressed(*float_tensor, THDReduceOp::THDReduceSUM,
+                                    THDCompressionFP16, 0, nullptr);
+  data_channel->allReduceCompressed(*double_tensor, THDReduceOp::THDReduceMAX,
+                                    THDCompressionFP16, 0, nullptr);
+  ASSERT_TENSOR_VALUE(float, *float_tensor, 0.25 * (workers + 1) * (workers + 2))
+  ASSERT_TENSOR_VALUE(double, *double_tensor, 0.5 * (workers + 1))
+
+  // every process sends only its largest element, the rest stays in residual
+  auto sparse_tensor = buildTensor<float>({2, 10}, 1);
+  auto residual = buildTensor<float>({2, 10}, 0);
+  reinterpret_cast<float*>(sparse_tensor->data())[rank] = 100;
+  data_channel->allReduceCompressed(*sparse_tensor, THDReduceOp::THDReduceSUM,
+                                    THDCompressionTOPK, 1, residual.get());
+  for (int i = 0; i < 20; ++i) {
+    float value = reinterpret_cast<float*>(sparse_tensor->data())[i];
+    float remaining = reinterpret_cast<float*>(residual->data())[i];
+    assert(value == (i <= workers ? 100 : 0));
+    assert(remaining == (i == rank ? 0 : 1));
+  }
+}
+
+void test_async_collectives(std::shared_ptr<thd::DataChannel> data_channel, int workers) {
+  std::vector<std::shared_ptr<thpp::IntTensor>> tensors;
+  std::vector<std::unique_ptr<thd::DataChannel::Request>> requests;
+  for (int i = 0; i < 5; ++i) {
+    tensors.push_back(buildTensor<int>({1, 2, 3, 4, 5}, data_channel->getRank() + i));
+    requests.emplace_back(
+      data_channel->iallReduce(*tensors.back(), THDReduceOp::THDReduceSUM, 0)
+    );
+  }
+
+  auto float_tensor = buildTensor<float>({1, 2, 3}, data_channel->getRank() == 0 ? 4.2 : -1.0);
+  requests.emplace_back(data_channel->ibroadcast(*float_tensor, 0));
+
+  // requests are executed in order, so all of them are done after the last one
+  requests.back()->wait();
+  for (int i = 0; i < 5; ++i) {
+    assert(requests[i]->isCompleted());
+    ASSERT_TENSOR_VALUE(int, *tensors[i], workers * (workers + 1) / 2 + (workers + 1) * i)
+  }
+  ASSERT_TENSOR_VALUE(float, *float_tensor, 4.2)
+}
+
+void test_queue_worker_shutdown() {
+  std::promise<void> started;
+  std::unique_ptr<thd::QueueWorker> worker(new thd::QueueWorker());
+  auto running = worker->push([&started]{
+    started.set_value();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  });
+  auto queued = worker->push([]{ assert(false); });
+
+  started.get_future().wait();
+  worker.reset();
+  // the running task is finished, the queued one fails instead of hanging
+  running.wait();
+  ASSERT_THROWS(std::runtime_error, queued.wait())
+}
+
 void test_scatter(std::shared_ptr<thd::DataChannel> data_channel) {
   if (g_data_channel_type == "gloo") {
     return; // XXX: Gloo does not support scatter
@@ -198,6 +497,42 @@ void test_allGather(std::shared_ptr<thd::DataChannel> data_channel) {
     ASSERT_TENSOR_VALUE(int, *(tensors[i]), i)
 }
 
+void test_reduceScatter(std::shared_ptr<thd::DataChannel> data_channel) {
+  std::vector<std::shared_ptr<thpp::IntTensor>> tensors;
+  std::vector<thpp::Tensor*> raw_tensors;
+  int rank = data_channel->getRank();
+  int size = data_channel->getNumProcesses();
+  for (int i = 0; i < size; ++i) {
+    tensors.push_back(buildTensor<int>({1, 2, 3, 4, 5}, rank + i));
+    raw_tensors.push_back(tensors.back().get());
+  }
+
+  auto int_tensor = buildTensor<int>({1, 2, 3, 4, 5}, -1);
+  data_channel->reduceScatter(*int_tensor, raw_tensors, THDReduceOp::THDReduceSUM);
+  ASSERT_TENSOR_VALUE(int, *int_tensor, size * (size - 1) / 2 + size * rank)
+}
+
+void test_allToAll(std::shared_ptr<thd::DataChannel> data_channel) {
+  if (g_data_channel_type == "gloo") {
+    return; // XXX: Gloo does not support allToAll
+  }
+
+  std::vector<std::shared_ptr<thpp::IntTensor>> tensors;
+  std::vector<thpp::Tensor*> raw_input, raw_output;
+  int rank = data_channel->getRank();
+  int size = data_channel->getNumProcesses();
+  for (int i = 0; i < size; ++i) {
+    tensors.push_back(buildTensor<int>({1, 2, 3, 4, 5}, 100 * rank + i));
+    raw_input.push_back(tensors.back().get());
+    tensors.push_back(buildTensor<int>({1, 2, 3, 4, 5}, -1));
+    raw_output.push_back(tensors.back().get());
+  }
+
+  data_channel->allToAll(raw_output, raw_input);
+  for (int i = 0; i < size; ++i)
+    ASSERT_TENSOR_VALUE(int, *raw_output[i], 100 * i + rank)
+}
+
 void test_barrier(std::shared_ptr<thd::DataChannel> data_channel) {
   for (int i = 0; i < data_channel->getNumProcesses(); ++i) {
     if (data_channel->getRank() == i) {
@@ -365,6 +700,29 @@ void test_allReduce_group(std::shared_ptr<thd::DataChannel> data_channel,
   }
 }
 
+void test_reduceScatter_group(std::shared_ptr<thd::DataChannel> data_channel,
+                              THDGroup group, std::vector<thd::rank_type> group_ranks) {
+  std::vector<std::shared_ptr<thpp::IntTensor>> tensors;
+  std::vector<thpp::Tensor*> raw_tensors;
+  if (contains(group_ranks, data_channel->getRank())) {
+    for (std::size_t i = 0; i < group_ranks.size(); ++i) {
+      tensors.push_back(buildTensor<int>({1, 2, 3, 4, 5}, 10 * i + data_channel->getRank()));
+      raw_tensors.push_back(tensors.back().get());
+    }
+
+    auto int_tensor = buildTensor<int>({1, 2, 3, 4, 5}, -1);
+    data_channel->reduceScatter(*int_tensor, raw_tensors, THDReduceOp::THDReduceMAX, group);
+    for (std::size_t i = 0; i < group_ranks.size(); ++i) {
+      if (group_ranks[i] == data_channel->getRank())
+        ASSERT_TENSOR_VALUE(int, *int_tensor, 10 * i + group_ranks.back())
+    }
+  } else {
+    auto int_tensor = buildTensor<int>({1, 2, 3, 4, 5}, 1000);
+    data_channel->reduceScatter(*int_tensor, raw_tensors, THDReduceOp::THDReduceMAX, group);
+    ASSERT_TENSOR_VALUE(int, *int_tensor, 1000)
+  }
+}
+
 void test_scatter_group(std::shared_ptr<thd::DataChannel> data_channel,
                         THDGroup group, std::vector<thd::rank_type> group_ranks) {
   if (g_data_channel_type == "gloo") {
@@ -495,7 +853,7 @@ void test_send_recv_invalid_rank(std::shared_ptr<thd::DataChannel> data_channel)
 // Cannot create empty group or group will be null
 void test_empty_group(std::shared_ptr<thd::DataChannel> data_channel) {
   // in MPI there will be created NULL_COMM
-  if (g_data_channel_type == "tcp" || g_data_channel_type == "gloo") {
+  if (g_data_channel_type != "mpi") {
     ASSERT_THROWS(std::logic_error, data_channel->newGroup({}))
   }
 }
@@ -560,7 +918,9 @@ void test_tensors_do_not_match_group_size(std::shared_ptr<thd::DataChannel> data
       return; // XXX: Gloo does not support scatter/gather
     }
 
-    if (data_channel->getRank() == 1) {
+    // SHM checks the root's arguments in a round all members take part in
+    bool shm = g_data_channel_type == "shm";
+    if (data_channel->getRank() == 1 || shm) {
       ASSERT_THROWS(
         std::logic_error,
         data_channel->scatter(raw_tensors, *int_tensor, 1, group)
@@ -571,6 +931,12 @@ void test_tensors_do_not_match_group_size(std::shared_ptr<thd::DataChannel> data
         data_channel->gather(raw_tensors, *int_tensor, 1, group)
       )
     }
+
+    if (shm) {
+      // the failed calls left the members in step
+      test_scatter_group(data_channel, group, {1, 2});
+      test_gather_group(data_channel, group, {1, 2});
+    }
   }
 }
 
@@ -597,7 +963,9 @@ void test_tensors_are_not_the_same(std::shared_ptr<thd::DataChannel> data_channe
       return; // XXX: Gloo does not support scatter/gather
     }
 
-    if (data_channel->getRank() == 1) {
+    // SHM checks the root's arguments in a round all members take part in
+    bool shm = g_data_channel_type == "shm";
+    if (data_channel->getRank() == 1 || shm) {
       ASSERT_THROWS(
         std::logic_error,
         data_channel->scatter(raw_tensors, *int_tensor, 1, group)
@@ -608,19 +976,34 @@ void test_tensors_are_not_the_same(std::shared_ptr<thd::DataChannel> data_channe
         data_channel->gather(raw_tensors, *int_tensor, 1, group)
       )
     }
+
+    if (shm) {
+      // the failed calls left the members in step
+      test_scatter_group(data_channel, group, {1, 2});
+      test_gather_group(data_channel, group, {1, 2});
+    }
   }
 }
 
 void run_all_tests(std::shared_ptr<thd::DataChannel> data_channel, int workers) {
   test_send_recv_tensor(data_channel);
+  test_send_recv_tensor_large(data_channel);
+  test_strided_tensors(data_channel, workers);
   test_send_recv_tensor_any_source(data_channel, workers);
   test_send_recv_scalar(data_channel);
   test_broadcast(data_channel);
   test_reduce(data_channel, workers);
   test_allReduce(data_channel, workers);
+  test_allReduce_large(data_channel, workers);
+  test_allReduce_hierarchical(data_channel, workers);
+  test_allReduceCoalesced(data_channel, workers);
+  test_allReduceCompressed(data_channel, workers);
+  test_async_collectives(data_channel, workers);
   test_scatter(data_channel);
   test_gather(data_channel);
   test_allGather(data_channel);
+  test_reduceScatter(data_channel);
+  test_allToAll(data_channel);
   test_barrier(data_channel);
   test_isend(data_channel);
   test_irecv(data_channel);
@@ -634,6 +1017,7 @@ void run_all_tests(std::shared_ptr<thd::DataChannel> data_channel, int workers)
   test_scatter_group(data_channel, group, group_ranks);
   test_gather_group(data_channel, group, group_ranks);
   test_allGather_group(data_channel, group, group_ranks);
+  test_reduceScatter_group(data_channel, group, group_ranks);
   test_barrier_group(data_channel, group, group_ranks);
 
   test_send_recv_invalid_rank(data_channel);
@@ -645,14 +1029,12 @@ void run_all_tests(std::shared_ptr<thd::DataChannel> data_channel, int workers)
 
 
 void init_tcp_master(int workers) {
-  g_mutex.lock();
-  setenv(WORLD_SIZE_ENV, std::to_string((workers + 1)).data(), 1);
-  setenv(RANK_ENV, "0", 1);
-  setenv(MASTER_PORT_ENV, std::to_string(MASTER_PORT).data(), 1);
-  auto masterChannel = std::make_shared<thd::DataChannelTCP>(thd::getInitConfig("env://")); // reads all env variable
-  g_mutex.unlock();
-
-  assert(masterChannel->init());
+  // the master address and port are read from the environment
+  auto masterChannel = std::make_shared<thd::DataChannelTCP>(
+      thd::getInitConfig("env://", workers + 1, "", 0));
+
+  if (!masterChannel->init())
+    throw std::runtime_error("failed to initialize the data channel");
   run_all_tests(masterChannel, workers);
 
   // wait for all workers to finish
@@ -663,49 +1045,69 @@ void init_tcp_master(int workers) {
 
 
 void init_tcp_worker(unsigned int id, int workers) {
-  g_mutex.lock();
-  setenv(RANK_ENV, std::to_string(id).data(), 1);
-  setenv(MASTER_ADDR_ENV, std::string("127.0.0.1:" + std::to_string(MASTER_PORT)).data(), 1);
-  auto worker_channel = std::make_shared<thd::DataChannelTCP>(thd::getInitConfig("env://")); // reads all env variable
-  g_mutex.unlock();
+  auto worker_channel = std::make_shared<thd::DataChannelTCP>(
+      thd::getInitConfig("env://", workers + 1, "", id));
 
-  assert(worker_channel->init());
+  if (!worker_channel->init())
+    throw std::runtime_error("failed to initialize the data channel");
   run_all_tests(worker_channel, workers);
 }
 
 #ifdef WITH_GLOO
 void init_gloo_master(int workers) {
-  g_mutex.lock();
-  setenv(WORLD_SIZE_ENV, std::to_string((workers + 1)).data(), 1);
-  setenv(RANK_ENV, "0", 1);
-  setenv(MASTER_PORT_ENV, std::to_string(MASTER_PORT).data(), 1);
-  auto masterChannel = std::make_shared<thd::DataChannelGloo>(thd::getInitConfig("env://")); // reads all env variable
-  g_mutex.unlock();
-
-  assert(masterChannel->init());
+  // the master address and port are read from the environment
+  auto masterChannel = std::make_shared<thd::DataChannelGloo>(
+      thd::getInitConfig("env://", workers + 1, "", 0));
+
+  if (!masterChannel->init())
+    throw std::runtime_error("failed to initialize the data channel");
   run_all_tests(masterChannel, workers);
 
   g_barrier->wait();
 }
 
 void init_gloo_worker(unsigned int id, int workers) {
-  g_mutex.lock();
-  setenv(RANK_ENV, std::to_string(id).data(), 1);
-  setenv(MASTER_ADDR_ENV, std::string("127.0.0.1:" + std::to_string(MASTER_PORT)).data(), 1);
-  auto worker_channel = std::make_shared<thd::DataChannelGloo>(thd::getInitConfig("env://")); // reads all env variable
-  g_mutex.unlock();
+  auto worker_channel = std::make_shared<thd::DataChannelGloo>(
+      thd::getInitConfig("env://", workers + 1, "", id));
 
-  assert(worker_channel->init());
+  if (!worker_channel->init())
+    throw std::runtime_error("failed to initialize the data channel");
   run_all_tests(worker_channel, workers);
 
   g_barrier->wait();
 }
 #endif // WITH_GLOO
 
+#ifdef WITH_SHM
+void init_shm_master(int workers) {
+  // the master address and port are read from the environment
+  auto masterChannel = std::make_shared<thd::DataChannelSHM>(
+      thd::getInitConfig("env://", workers + 1, "", 0));
+
+  if (!masterChannel->init())
+    throw std::runtime_error("failed to initialize the data channel");
+  run_all_tests(masterChannel, workers);
+
+  g_barrier->wait();
+}
+
+void init_shm_worker(unsigned int id, int workers) {
+  auto worker_channel = std::make_shared<thd::DataChannelSHM>(
+      thd::getInitConfig("env://", workers + 1, "", id));
+
+  if (!worker_channel->init())
+    throw std::runtime_error("failed to initialize the data channel");
+  run_all_tests(worker_channel, workers);
+
+  g_barrier->wait();
+}
+#endif // WITH_SHM
+
 #ifdef WITH_MPI
 void init_mpi_process() {
   auto data_channel = std::make_shared<thd::DataChannelMPI>();
-  assert(data_channel->init());
+  if (!data_channel->init())
+    throw std::runtime_error("failed to initialize the data channel");
   run_all_tests(data_channel, WORKERS_NUM[0]);
 
   std::cout << "MPI OK (id: " << data_channel->getRank() << ")" << std::endl;
@@ -717,22 +1119,36 @@ int main(int argc, char const *argv[]) {
 #ifdef WITH_MPI
   if (argc == 1) {
 #endif // WITH_MPI
-    g_data_channel_type = "tcp";
-    for (auto workers : WORKERS_NUM) {
-      std::cout << "TCP (workers: " << workers << "):" << std::endl;
-      // start tcp master
-      std::thread tcp_master_thread(init_tcp_master, workers);
-
-      // start tcp worker
-      for (int id = 1; id <= workers; ++id) {
-        g_all_workers.push_back(std::thread(init_tcp_worker, id, workers));
-      }
+    test_queue_worker_shutdown();
 
-      tcp_master_thread.join();
-      g_all_workers.clear();
+    setenv(MASTER_ADDR_ENV, "127.0.0.1", 1);
+    setenv(MASTER_PORT_ENV, std::to_string(MASTER_PORT).data(), 1);
 
-      std::cout << "TCP - OK" << std::endl;
+    g_data_channel_type = "tcp";
+    // without shared memory the ring and recursive doubling algorithms
+    // reduce between processes of this host too
+    for (bool shared_memory : {true, false}) {
+      g_tcp_shared_memory = shared_memory;
+      setenv("THD_TCP_SHARED_MEMORY", shared_memory ? "1" : "0", 1);
+      thd::tracer.clear();
+      for (auto workers : WORKERS_NUM) {
+        std::cout << "TCP (workers: " << workers << ", shared memory: "
+                  << shared_memory << "):" << std::endl;
+        // start tcp master
+        std::thread tcp_master_thread(init_tcp_master, workers);
+
+        // start tcp worker
+        for (int id = 1; id <= workers; ++id) {
+          g_all_workers.push_back(std::thread(init_tcp_worker, id, workers));
+        }
+
+        tcp_master_thread.join();
+        g_all_workers.clear();
+
+        std::cout << "TCP - OK" << std::endl;
+      }
     }
+    unsetenv("THD_TCP_SHARED_MEMORY");
 
 #ifdef WITH_GLOO
     g_data_channel_type = "gloo";
@@ -759,6 +1175,31 @@ int main(int argc, char const *argv[]) {
     }
 #endif // WITH_GLOO
 
+#ifdef WITH_SHM
+    g_data_channel_type = "shm";
+    for (auto workers : WORKERS_NUM) {
+      g_barrier.reset(new Barrier(workers + 1));
+      std::cout << "SHM (workers: " << workers << "):" << std::endl;
+      // start shm master
+      std::thread shm_master_thread(init_shm_master, workers);
+
+      // start shm worker
+      for (int id = 1; id <= workers; ++id) {
+        g_all_workers.push_back(std::thread(init_shm_worker, id, workers));
+      }
+
+      // wait for all workers to finish
+      for (auto& worker : g_all_workers) {
+        worker.join();
+      }
+
+      shm_master_thread.join();
+      g_all_workers.clear();
+
+      std::cout << "SHM - OK" << std::endl;
+    }
+#endif // WITH_SHM
+
 #ifdef WITH_MPI
     std::cout << "--------------------------" << std::endl;
 
@@ -32,12 +32,36 @@ void test(std::shared_ptr<thd::DataChannel> data_channel) {
   }
 }
 
+// Every size is different, but they fall into only a few size classes
+void test_variable_sizes(std::shared_ptr<thd::DataChannel> data_channel) {
+  for (long size = 1; size <= 1000; ++size) {
+    auto float_tensor = buildTensor<float>({size}, data_channel->getRank());
+    data_channel->allReduce(*float_tensor, THDReduceSUM);
+    auto processes = data_channel->getNumProcesses();
+    ASSERT_TENSOR_VALUE(float, *float_tensor, processes * (processes - 1) / 2)
+  }
+}
+
+void test_prewarm(std::shared_ptr<thd::DataChannel> data_channel) {
+  auto gloo_channel = std::static_pointer_cast<thd::DataChannelGloo>(data_channel);
+  gloo_channel->prewarm(thd::CollectiveType::BROADCAST, thpp::Type::FLOAT,
+                        {1 << 12, 1 << 16, 1 << 20}, thd::DeviceType::CPU,
+                        THDReduceSUM, 0);
+
+  auto float_tensor = buildTensor<float>({1 << 14}, data_channel->getRank() == 0 ? 2.5 : -1.0);
+  data_channel->broadcast(*float_tensor, 0);
+  ASSERT_TENSOR_VALUE(float, *float_tensor, 2.5)
+}
+
 void run_all_tests(std::shared_ptr<thd::DataChannel> data_channel, int workers) {
   // NOTE: without properly working GlooCache this test would create
   // about (1000 * WORKERS ^ 3) connections what is over 'normal' system configuration
   for (std::size_t i = 0; i < 1000; ++i) {
     test(data_channel);
   }
+
+  test_variable_sizes(data_channel);
+  test_prewarm(data_channel);
 }
 
 
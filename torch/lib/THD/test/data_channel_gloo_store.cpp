@@ -0,0 +1,170 @@
+#include "../base/data_channels/Store.hpp"
+#include "TestUtils.hpp"
+
+#include <cassert>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+constexpr int CLIENTS = 16;
+constexpr int KEYS_PER_CLIENT = 4;
+constexpr int ADDS_PER_CLIENT = 100;
+constexpr int PHASES = 6;
+
+std::vector<std::unique_ptr<Barrier>> g_barriers; // one per phase
+std::mutex g_mutex;
+std::set<std::int64_t> g_counter_values;
+std::set<std::vector<char>> g_leaders;
+
+std::vector<char> to_vector(const std::string& str) {
+  return std::vector<char>(str.begin(), str.end());
+}
+
+std::string batch_key(int client, int key) {
+  return "batch/" + std::to_string(client) + "/" + std::to_string(key);
+}
+
+// Every client sets its keys in one query and gets all of them in another,
+// which waits for the clients that didn't set theirs yet
+void test_batched_set_get(thd::Store& store, int client) {
+  std::vector<std::string> keys;
+  std::vector<std::vector<char>> values;
+  for (int key = 0; key < KEYS_PER_CLIENT; ++key) {
+    keys.push_back(batch_key(client, key));
+    values.push_back(to_vector(std::to_string(client * key)));
+  }
+  store.set(keys, values);
+
+  keys.clear();
+  for (int other = 0; other < CLIENTS; ++other) {
+    for (int key = 0; key < KEYS_PER_CLIENT; ++key)
+      keys.push_back(batch_key(other, key));
+  }
+  auto all_values = store.get(keys);
+  assert(all_values.size() == keys.size());
+  for (int other = 0; other < CLIENTS; ++other) {
+    for (int key = 0; key < KEYS_PER_CLIENT; ++key) {
+      assert(all_values[other * KEYS_PER_CLIENT + key] ==
+             to_vector(std::to_string(other * key)));
+    }
+  }
+
+  // single keys are answered by the same queries
+  assert(store.get(batch_key(CLIENTS - 1, 1)) ==
+         to_vector(std::to_string(CLIENTS - 1)));
+  store.wait({batch_key(0, 0), batch_key(CLIENTS - 1, KEYS_PER_CLIENT - 1)});
+}
+
+// The first client waits for keys set by all the others
+void test_wait_prefix(thd::Store& store, int client) {
+  if (client == 0) {
+    store.waitPrefix("late/", CLIENTS - 1);
+    assert(store.get("late/1") == to_vector("1"));
+  } else {
+    store.set("late/" + std::to_string(client), to_vector(std::to_string(client)));
+  }
+
+  // keys set before the query count too
+  store.waitPrefix("batch/", CLIENTS * KEYS_PER_CLIENT);
+  store.waitPrefix("batch/", 0);
+}
+
+// Every addition returns a different value of the counter
+void test_add(thd::Store& store, int client) {
+  std::vector<std::int64_t> values;
+  for (int i = 0; i < ADDS_PER_CLIENT; ++i)
+    values.push_back(store.add("counter", 1));
+
+  std::lock_guard<std::mutex> lock(g_mutex);
+  for (auto value : values) {
+    assert(g_counter_values.count(value) == 0);
+    g_counter_values.insert(value);
+  }
+}
+
+void check_add(thd::Store& store) {
+  assert(g_counter_values.size() == CLIENTS * ADDS_PER_CLIENT);
+  assert(*g_counter_values.begin() == 1);
+  assert(*g_counter_values.rbegin() == CLIENTS * ADDS_PER_CLIENT);
+  assert(store.add("counter", 0) == CLIENTS * ADDS_PER_CLIENT);
+}
+
+long parse_count(const std::vector<char>& value) {
+  return value.empty() ? 0 : std::stol(std::string(value.begin(), value.end()));
+}
+
+// Only one client sets a missing key, and increments that race are retried.
+// Every value names the client that wrote it, so a client can tell its own
+// swap from one that wrote the same count.
+void test_compare_set(thd::Store& store, int client) {
+  auto leader = store.compareSet("leader", {}, to_vector(std::to_string(client)));
+  {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_leaders.insert(leader);
+  }
+
+  std::vector<char> expected;
+  for (int i = 0; i < ADDS_PER_CLIENT; ++i) {
+    while (true) {
+      auto desired = to_vector(std::to_string(parse_count(expected) + 1) + "/" +
+                               std::to_string(client));
+      expected = store.compareSet("cas_counter", expected, desired);
+      if (expected == desired)
+        break;
+    }
+  }
+}
+
+void check_compare_set(thd::Store& store) {
+  assert(g_leaders.size() == 1);
+  assert(store.get("leader") == *g_leaders.begin());
+  // a value that doesn't match leaves the key alone
+  assert(store.compareSet("leader", to_vector("none"), to_vector("x")) == *g_leaders.begin());
+  assert(parse_count(store.get("cas_counter")) == CLIENTS * ADDS_PER_CLIENT);
+}
+
+void run_client(int client, thd::port_type port) {
+  thd::Store store("127.0.0.1", port);
+
+  test_batched_set_get(store, client);
+  g_barriers[0]->wait();
+  test_wait_prefix(store, client);
+  g_barriers[1]->wait();
+  test_add(store, client);
+  g_barriers[2]->wait();
+  if (client == 0)
+    check_add(store);
+  g_barriers[3]->wait();
+  test_compare_set(store, client);
+  g_barriers[4]->wait();
+  if (client == 0)
+    check_compare_set(store);
+
+  // the store stops as soon as a client disconnects
+  g_barriers[5]->wait();
+}
+
+int main() {
+  int listen_socket;
+  thd::port_type port;
+  std::tie(listen_socket, port) = thd::listen();
+
+  {
+    thd::Store master_store("127.0.0.1", port, listen_socket);
+    for (int phase = 0; phase < PHASES; ++phase)
+      g_barriers.emplace_back(new Barrier(CLIENTS));
+
+    std::vector<std::thread> clients;
+    for (int client = 0; client < CLIENTS; ++client)
+      clients.emplace_back(run_client, client, port);
+    for (auto& client : clients)
+      client.join();
+  }
+
+  std::cout << "OK" << std::endl;
+  return 0;
+}
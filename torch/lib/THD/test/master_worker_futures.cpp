@@ -0,0 +1,77 @@
+#include "../THD.h"
+#include "TestUtils.hpp"
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cassert>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+constexpr char MASTER_PORT[] = "45682";
+// enough calls to span several command batches
+constexpr int CALLS = 1000;
+
+void test_async_reductions() {
+  THDFloatTensor *a = THDFloatTensor_newWithSize1d(100);
+  THDFloatTensor *b = THDFloatTensor_newWithSize1d(100);
+  THDFloatTensor_fill(a, 2);
+  THDFloatTensor_fill(b, 3);
+
+  // nothing is read until all calls are issued
+  std::vector<THDFuture*> sums, dots;
+  for (int i = 0; i < CALLS; i++) {
+    THDFloatTensor_add(a, a, 1);
+    sums.push_back(THDFloatTensor_sumallAsync(a));
+    dots.push_back(THDFloatTensor_dotAsync(a, b));
+  }
+  THDFuture *same = THDFloatTensor_equalAsync(a, a);
+  THDFuture *different = THDFloatTensor_equalAsync(a, b);
+
+  // every future gets the result of its own call, whatever the reading order
+  assert(THDFuture_getLong(different) == 0);
+  assert(THDFuture_getLong(same) == 1);
+  for (int i = CALLS - 1; i >= 0; i--) {
+    assert(THDFuture_getDouble(sums[i]) == 100 * (i + 3));
+    assert(THDFuture_getDouble(dots[i]) == 300 * (i + 3));
+    assert(THDFuture_isReady(sums[i]));
+    THDFuture_free(sums[i]);
+    THDFuture_free(dots[i]);
+  }
+  THDFuture_free(same);
+  THDFuture_free(different);
+
+  THDFloatTensor_free(a);
+  THDFloatTensor_free(b);
+}
+
+int main() {
+  setenv(WORLD_SIZE_ENV, "2", 1);
+  setenv(MASTER_PORT_ENV, MASTER_PORT, 1);
+  setenv(MASTER_ADDR_ENV, "127.0.0.1", 1);
+
+  pid_t worker = fork();
+  assert(worker != -1);
+  if (worker == 0) {
+    setenv(RANK_ENV, "1", 1);
+    // runs the worker loop and never returns
+    THDMasterWorkerInit(THDChannelTCP, "env://", -1, "", -1);
+    _exit(1);
+  }
+
+  setenv(RANK_ENV, "0", 1);
+  // the workers are killed first, so the exit message sent to them on
+  // shutdown has to fail with EPIPE instead of a signal
+  std::signal(SIGPIPE, SIG_IGN);
+  THDMasterWorkerInit(THDChannelTCP, "env://", -1, "", -1);
+
+  test_async_reductions();
+
+  kill(worker, SIGTERM);
+  waitpid(worker, nullptr, 0);
+  std::cout << "OK" << std::endl;
+  return 0;
+}
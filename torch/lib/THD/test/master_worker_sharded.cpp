@@ -0,0 +1,99 @@
+#include "../THD.h"
+#include "TestUtils.hpp"
+
+#include <THPP/tensors/THTensor.hpp>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cassert>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+constexpr int WORKERS = 3;
+constexpr char MASTER_PORT[] = "45681";
+
+// fills a master tensor with 0, 1, 2, ... in its own element order
+void fill_range(thpp::FloatTensor& tensor) {
+  float *data = reinterpret_cast<float*>(tensor.data());
+  for (long i = 0; i < tensor.numel(); i++)
+    data[i] = i;
+}
+
+void test_sharded_tensor(const std::vector<long>& sizes, int dim) {
+  THLongStorage *size = THLongStorage_newWithSize(sizes.size());
+  for (std::size_t i = 0; i < sizes.size(); i++)
+    size->data[i] = sizes[i];
+  THDFloatShardedTensor *a = THDFloatShardedTensor_newWithSize(size, dim);
+  THDFloatShardedTensor *b = THDFloatShardedTensor_newWithSize(size, dim);
+  THLongStorage_free(size);
+
+  thpp::THTensor<float> master;
+  master.resize(sizes);
+  fill_range(master);
+  long numel = master.numel();
+  assert(THDFloatShardedTensor_nElement(a) == numel);
+  assert(THDFloatShardedTensor_size(a, dim) == sizes[dim]);
+
+  // shards along other dimensions than the first are strided on the master
+  THDFloatShardedTensor_copyFromMaster(a, &master);
+  THDFloatShardedTensor_fill(b, 2);
+  assert(THDFloatShardedTensor_sumall(a) == numel * (numel - 1) / 2);
+  assert(THDFloatShardedTensor_minall(a) == 0);
+  assert(THDFloatShardedTensor_maxall(a) == numel - 1);
+  assert(THDFloatShardedTensor_dot(a, b) == numel * (numel - 1));
+
+  // b = a * 2 + 1
+  THDFloatShardedTensor_cmul(b, a, b);
+  THDFloatShardedTensor_add(b, b, 1);
+  thpp::THTensor<float> result;
+  result.resize(sizes);
+  result.fill(-1);
+  THDFloatShardedTensor_copyFromWorkers(&result, b);
+  float *data = reinterpret_cast<float*>(result.data());
+  for (long i = 0; i < numel; i++)
+    assert(data[i] == 2 * i + 1);
+
+  THDFloatShardedTensor_free(a);
+  THDFloatShardedTensor_free(b);
+}
+
+int main() {
+  setenv(WORLD_SIZE_ENV, std::to_string(WORKERS + 1).data(), 1);
+  setenv(MASTER_PORT_ENV, MASTER_PORT, 1);
+  setenv(MASTER_ADDR_ENV, "127.0.0.1", 1);
+
+  std::vector<pid_t> workers;
+  for (int rank = 1; rank <= WORKERS; ++rank) {
+    pid_t pid = fork();
+    assert(pid != -1);
+    if (pid == 0) {
+      setenv(RANK_ENV, std::to_string(rank).data(), 1);
+      // runs the worker loop and never returns
+      THDMasterWorkerInit(THDChannelTCP, "env://", -1, "", -1);
+      _exit(1);
+    }
+    workers.push_back(pid);
+  }
+
+  setenv(RANK_ENV, "0", 1);
+  // the workers are killed first, so the exit message sent to them on
+  // shutdown has to fail with EPIPE instead of a signal
+  std::signal(SIGPIPE, SIG_IGN);
+  THDMasterWorkerInit(THDChannelTCP, "env://", -1, "", -1);
+
+  test_sharded_tensor({7, 3}, 0);
+  test_sharded_tensor({4, 5, 2}, 1);
+  // fewer slices than workers
+  test_sharded_tensor({3, 2}, 1);
+
+  for (pid_t pid : workers) {
+    kill(pid, SIGTERM);
+    waitpid(pid, nullptr, 0);
+  }
+  std::cout << "OK" << std::endl;
+  return 0;
+}
@@ -2,6 +2,60 @@
 #define TH_GENERIC_FILE "generic/BatchNormalization.c"
 #else
 
+/* Evaluation mode on contiguous data: the running statistics, weight and bias
+ * are folded into a per-feature scale and shift, and the input is streamed
+ * plane by plane so the inner loop is a unit-stride multiply-add. */
+static void THNN_(BatchNormalization_updateOutputInference)(
+  THTensor *input, THTensor *output,
+  THTensor *weight, THTensor *bias,
+  THTensor *running_mean, THTensor *running_var,
+  double eps)
+{
+  long nBatch = THTensor_(size)(input, 0);
+  long nInput = THTensor_(size)(input, 1);
+  ptrdiff_t planeSize = THTensor_(nElement)(input) / (nBatch * nInput);
+  real *scale = (real*)THAlloc(sizeof(real) * nInput);
+  real *shift = (real*)THAlloc(sizeof(real) * nInput);
+  real *input_data = THTensor_(data)(input);
+  real *output_data = THTensor_(data)(output);
+  long f, p;
+
+  for (f = 0; f < nInput; ++f) {
+    real invstd = 1 / sqrt(THTensor_(get1d)(running_var, f) + eps);
+    real w = weight ? THTensor_(get1d)(weight, f) : 1;
+    real b = bias ? THTensor_(get1d)(bias, f) : 0;
+    scale[f] = w * invstd;
+    shift[f] = b - THTensor_(get1d)(running_mean, f) * scale[f];
+  }
+
+  if (planeSize == 1) {
+    #pragma omp parallel for private(p)
+    for (p = 0; p < nBatch; ++p) {
+      real *in = input_data + p * nInput;
+      real *out = output_data + p * nInput;
+      long i;
+      for (i = 0; i < nInput; ++i) {
+        out[i] = in[i] * scale[i] + shift[i];
+      }
+    }
+  } else {
+    #pragma omp parallel for private(p)
+    for (p = 0; p < nBatch * nInput; ++p) {
+      real *in = input_data + p * planeSize;
+      real *out = output_data + p * planeSize;
+      real s = scale[p % nInput];
+      real t = shift[p % nInput];
+      ptrdiff_t i;
+      for (i = 0; i < planeSize; ++i) {
+        out[i] = in[i] * s + t;
+      }
+    }
+  }
+
+  THFree(scale);
+  THFree(shift);
+}
+
 void THNN_(BatchNormalization_updateOutput)(
   THNNState *state, THTensor *input, THTensor *output,
   THTensor *weight, THTensor *bias,
@@ -14,6 +68,13 @@ void THNN_(BatchNormalization_updateOutput)(
   long f;
   ptrdiff_t n = THTensor_(nElement)(input) / nInput;
 
+  if (!train && n > 0
+      && THTensor_(isContiguous)(input) && THTensor_(isContiguous)(output)) {
+    THNN_(BatchNormalization_updateOutputInference)(
+      input, output, weight, bias, running_mean, running_var, eps);
+    return;
+  }
+
   #pragma omp parallel for
   for (f = 0; f < nInput; ++f) {
     THTensor *in = THTensor_(newSelect)(input, 1, f);
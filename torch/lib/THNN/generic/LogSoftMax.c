@@ -2,12 +2,124 @@
 #define TH_GENERIC_FILE "generic/LogSoftMax.c"
 #else
 
+/* Returns max + log(sum(exp(x - max))) over one contiguous row, using a single
+ * online pass for rows that outgrow the cache (see SoftMax.c). */
+static accreal THNN_(LogSoftMax_logSumRow)(
+          real *input_data,
+          ptrdiff_t dim)
+{
+  real maxInput = -THInf;
+  accreal sum = 0;
+  ptrdiff_t d;
+
+  if (dim >= THNN_SOFTMAX_ONLINE_DIM)
+  {
+    /* masked (-inf) entries add nothing, and rescaling a sum that is still
+     * empty would compute exp(-inf - -inf) */
+    for (d = 0; d < dim; d++)
+    {
+      real x = input_data[d];
+      if (x == -THInf)
+        continue;
+      if (x > maxInput)
+      {
+        sum = (maxInput == -THInf ? 0 : sum * exp(maxInput - x)) + 1;
+        maxInput = x;
+      }
+      else
+        sum += exp(x - maxInput);
+    }
+    return maxInput + log(sum);
+  }
+
+  for (d = 0; d < dim; d++)
+    maxInput = THMax(maxInput, input_data[d]);
+
+  for (d = 0; d < dim; d++)
+    sum += exp(input_data[d] - maxInput);
+
+  return maxInput + log(sum);
+}
+
+static void THNN_(LogSoftMax_updateOutputTile)(
+          real *input_data,
+          real *output_data,
+          ptrdiff_t dim,
+          ptrdiff_t stride,
+          ptrdiff_t n)
+{
+  real maxInput[THNN_SOFTMAX_TILE];
+  accreal logsum[THNN_SOFTMAX_TILE];
+  ptrdiff_t d, s;
+
+  for (s = 0; s < n; s++)
+  {
+    maxInput[s] = -THInf;
+    logsum[s] = 0;
+  }
+
+  for (d = 0; d < dim; d++)
+  {
+    real *input_row = input_data + d*stride;
+    for (s = 0; s < n; s++)
+      maxInput[s] = THMax(maxInput[s], input_row[s]);
+  }
+
+  for (d = 0; d < dim; d++)
+  {
+    real *input_row = input_data + d*stride;
+    for (s = 0; s < n; s++)
+      logsum[s] += exp(input_row[s] - maxInput[s]);
+  }
+
+  for (s = 0; s < n; s++)
+    logsum[s] = maxInput[s] + log(logsum[s]);
+
+  for (d = 0; d < dim; d++)
+  {
+    real *input_row = input_data + d*stride;
+    real *output_row = output_data + d*stride;
+    for (s = 0; s < n; s++)
+      output_row[s] = input_row[s] - logsum[s];
+  }
+}
+
+static void THNN_(LogSoftMax_updateGradInputTile)(
+          real *gradInput_data,
+          real *gradOutput_data,
+          real *output_data,
+          ptrdiff_t dim,
+          ptrdiff_t stride,
+          ptrdiff_t n)
+{
+  accreal sum[THNN_SOFTMAX_TILE];
+  ptrdiff_t d, s;
+
+  for (s = 0; s < n; s++)
+    sum[s] = 0;
+
+  for (d = 0; d < dim; d++)
+  {
+    real *gradOutput_row = gradOutput_data + d*stride;
+    for (s = 0; s < n; s++)
+      sum[s] += gradOutput_row[s];
+  }
+
+  for (d = 0; d < dim; d++)
+  {
+    real *gradInput_row = gradInput_data + d*stride;
+    real *gradOutput_row = gradOutput_data + d*stride;
+    real *output_row = output_data + d*stride;
+    for (s = 0; s < n; s++)
+      gradInput_row[s] = gradOutput_row[s] - exp(output_row[s])*sum[s];
+  }
+}
+
 void THNN_(LogSoftMax_updateOutput)(
           THNNState *state,
           THTensor *input,
           THTensor *output)
 {
-  real *input_data, *output_data;
   ptrdiff_t nframe = 0, dim = 0, stride = 0;
   ptrdiff_t t, d;
 
@@ -44,25 +156,30 @@ void THNN_(LogSoftMax_updateOutput)(
   real *input_data0 = THTensor_(data)(input);
   real *output_data0 = THTensor_(data)(output);
 
-  accreal logsum;
-  real maxInput;
-  #pragma omp parallel for private(t, d, maxInput, logsum, input_data, output_data)
-  for (t = 0; t < stride*nframe; t++)
+  if (stride == 1)
   {
-    logsum = 0;
-    maxInput = -THInf;
-    input_data = input_data0 + (t/stride)*dim*stride + t % stride;
-    output_data = output_data0 + (t/stride)*dim*stride + t % stride;
-
-    for (d = 0; d < dim; d++)
-      maxInput = THMax(maxInput, input_data[d*stride]);
-
-    for (d = 0; d < dim; d++)
-      logsum += exp(input_data[d*stride] - maxInput);
-    logsum = maxInput + log(logsum);
+    #pragma omp parallel for private(t, d)
+    for (t = 0; t < nframe; t++)
+    {
+      real *input_data = input_data0 + t*dim;
+      real *output_data = output_data0 + t*dim;
+      accreal logsum = THNN_(LogSoftMax_logSumRow)(input_data, dim);
 
-    for (d = 0; d < dim; d++)
-      output_data[d*stride] = input_data[d*stride] - logsum;
+      for (d = 0; d < dim; d++)
+        output_data[d] = input_data[d] - logsum;
+    }
+  }
+  else
+  {
+    ptrdiff_t ntile = (stride + THNN_SOFTMAX_TILE - 1) / THNN_SOFTMAX_TILE;
+    #pragma omp parallel for private(t)
+    for (t = 0; t < nframe*ntile; t++)
+    {
+      ptrdiff_t s = (t % ntile) * THNN_SOFTMAX_TILE;
+      ptrdiff_t offset = (t / ntile)*dim*stride + s;
+      THNN_(LogSoftMax_updateOutputTile)(input_data0 + offset, output_data0 + offset,
+                                         dim, stride, THMin(THNN_SOFTMAX_TILE, stride - s));
+    }
   }
 
   THTensor_(free)(input);
@@ -76,7 +193,6 @@ void THNN_(LogSoftMax_updateGradInput)(
           THTensor *output)
 {
   THNN_CHECK_SHAPE(input, gradOutput);
-  real *gradInput_data, *gradOutput_data, *output_data;
   ptrdiff_t nframe = 0, dim = 0, stride = 0;
   ptrdiff_t t, d;
 
@@ -114,20 +230,35 @@ void THNN_(LogSoftMax_updateGradInput)(
   real *gradInput_data0 = THTensor_(data)(gradInput);
   real *output_data0 = THTensor_(data)(output);
   real *gradOutput_data0 = THTensor_(data)(gradOutput);
-  accreal sum;
-  #pragma omp parallel for private(t, sum, d, gradInput_data, output_data, gradOutput_data)
-  for (t = 0; t < stride*nframe; t++)
+  if (stride == 1)
   {
-    sum = 0;
-    gradInput_data = gradInput_data0 + (t/stride)*dim*stride + t % stride;
-    output_data = output_data0 + (t/stride)*dim*stride + t % stride;
-    gradOutput_data = gradOutput_data0 + (t/stride)*dim*stride + t % stride;
+    #pragma omp parallel for private(t, d)
+    for (t = 0; t < nframe; t++)
+    {
+      real *gradInput_data = gradInput_data0 + t*dim;
+      real *output_data = output_data0 + t*dim;
+      real *gradOutput_data = gradOutput_data0 + t*dim;
+      accreal sum = 0;
 
-    for (d = 0; d < dim; d++)
-      sum += gradOutput_data[d*stride];
+      for (d = 0; d < dim; d++)
+        sum += gradOutput_data[d];
 
-    for (d = 0; d < dim; d++)
-      gradInput_data[d*stride] = gradOutput_data[d*stride] - exp(output_data[d*stride])*sum;
+      for (d = 0; d < dim; d++)
+        gradInput_data[d] = gradOutput_data[d] - exp(output_data[d])*sum;
+    }
+  }
+  else
+  {
+    ptrdiff_t ntile = (stride + THNN_SOFTMAX_TILE - 1) / THNN_SOFTMAX_TILE;
+    #pragma omp parallel for private(t)
+    for (t = 0; t < nframe*ntile; t++)
+    {
+      ptrdiff_t s = (t % ntile) * THNN_SOFTMAX_TILE;
+      ptrdiff_t offset = (t / ntile)*dim*stride + s;
+      THNN_(LogSoftMax_updateGradInputTile)(gradInput_data0 + offset, gradOutput_data0 + offset,
+                                            output_data0 + offset, dim, stride,
+                                            THMin(THNN_SOFTMAX_TILE, stride - s));
+    }
   }
 
   THTensor_(free)(gradOutput);
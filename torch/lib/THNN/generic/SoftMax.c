@@ -2,6 +2,154 @@
 #define TH_GENERIC_FILE "generic/SoftMax.c"
 #else
 
+/* Normalizes one contiguous row.  Rows that outgrow the cache get the max and
+ * the exp-sum from a single online pass, rescaling the running sum whenever
+ * the max grows, so the input is only read twice. */
+static void THNN_(SoftMax_updateOutputRow)(
+          real *input_ptr,
+          real *output_ptr,
+          ptrdiff_t dim)
+{
+  real inputMax = -THInf;
+  accreal sum = 0;
+  ptrdiff_t d;
+
+  if (dim >= THNN_SOFTMAX_ONLINE_DIM)
+  {
+    /* masked (-inf) entries add nothing, and rescaling a sum that is still
+     * empty would compute exp(-inf - -inf) */
+    for (d = 0; d < dim; d++)
+    {
+      real x = input_ptr[d];
+      if (x == -THInf)
+        continue;
+      if (x > inputMax)
+      {
+        sum = (inputMax == -THInf ? 0 : sum * exp(inputMax - x)) + 1;
+        inputMax = x;
+      }
+      else
+        sum += exp(x - inputMax);
+    }
+
+    sum = 1/sum;
+    for (d = 0; d < dim; d++)
+      output_ptr[d] = exp(input_ptr[d] - inputMax) * sum;
+    return;
+  }
+
+  for (d = 0; d < dim; d++)
+    inputMax = THMax(inputMax, input_ptr[d]);
+
+  for (d = 0; d < dim; d++)
+  {
+    real z = exp(input_ptr[d] - inputMax);
+    output_ptr[d] = z;
+    sum += z;
+  }
+
+  sum = 1/sum;
+  for (d = 0; d < dim; d++)
+    output_ptr[d] *= sum;
+}
+
+/* Normalizes n adjacent spatial positions whose dim entries are stride apart.
+ * Every pass walks the positions contiguously, one dim slice at a time. */
+static void THNN_(SoftMax_updateOutputTile)(
+          real *input_ptr,
+          real *output_ptr,
+          ptrdiff_t dim,
+          ptrdiff_t stride,
+          ptrdiff_t n)
+{
+  real inputMax[THNN_SOFTMAX_TILE];
+  accreal sum[THNN_SOFTMAX_TILE];
+  ptrdiff_t d, s;
+
+  for (s = 0; s < n; s++)
+  {
+    inputMax[s] = -THInf;
+    sum[s] = 0;
+  }
+
+  for (d = 0; d < dim; d++)
+  {
+    real *input_row = input_ptr + d*stride;
+    for (s = 0; s < n; s++)
+      inputMax[s] = THMax(inputMax[s], input_row[s]);
+  }
+
+  for (d = 0; d < dim; d++)
+  {
+    real *input_row = input_ptr + d*stride;
+    real *output_row = output_ptr + d*stride;
+    for (s = 0; s < n; s++)
+    {
+      real z = exp(input_row[s] - inputMax[s]);
+      output_row[s] = z;
+      sum[s] += z;
+    }
+  }
+
+  for (s = 0; s < n; s++)
+    sum[s] = 1/sum[s];
+
+  for (d = 0; d < dim; d++)
+  {
+    real *output_row = output_ptr + d*stride;
+    for (s = 0; s < n; s++)
+      output_row[s] *= sum[s];
+  }
+}
+
+static void THNN_(SoftMax_updateGradInputRow)(
+          real *gradInput_ptr,
+          real *gradOutput_ptr,
+          real *output_ptr,
+          ptrdiff_t dim)
+{
+  accreal sum = 0;
+  ptrdiff_t d;
+
+  for (d = 0; d < dim; d++)
+    sum += (accreal)gradOutput_ptr[d] * output_ptr[d];
+
+  for (d = 0; d < dim; d++)
+    gradInput_ptr[d] = output_ptr[d] * (gradOutput_ptr[d] - sum);
+}
+
+static void THNN_(SoftMax_updateGradInputTile)(
+          real *gradInput_ptr,
+          real *gradOutput_ptr,
+          real *output_ptr,
+          ptrdiff_t dim,
+          ptrdiff_t stride,
+          ptrdiff_t n)
+{
+  accreal sum[THNN_SOFTMAX_TILE];
+  ptrdiff_t d, s;
+
+  for (s = 0; s < n; s++)
+    sum[s] = 0;
+
+  for (d = 0; d < dim; d++)
+  {
+    real *gradOutput_row = gradOutput_ptr + d*stride;
+    real *output_row = output_ptr + d*stride;
+    for (s = 0; s < n; s++)
+      sum[s] += (accreal)gradOutput_row[s] * output_row[s];
+  }
+
+  for (d = 0; d < dim; d++)
+  {
+    real *gradInput_row = gradInput_ptr + d*stride;
+    real *gradOutput_row = gradOutput_ptr + d*stride;
+    real *output_row = output_ptr + d*stride;
+    for (s = 0; s < n; s++)
+      gradInput_row[s] = output_row[s] * (gradOutput_row[s] - sum[s]);
+  }
+}
+
 void THNN_(SoftMax_updateOutput)(
           THNNState *state,
           THTensor *input,
@@ -46,32 +194,22 @@ void THNN_(SoftMax_updateOutput)(
   input_data = THTensor_(data)(input);
   output_data = THTensor_(data)(output);
 
+  if (stride == 1)
+  {
 #pragma omp parallel for private(t)
-  for (t = 0; t < stride*nframe; t++)
+    for (t = 0; t < nframe; t++)
+      THNN_(SoftMax_updateOutputRow)(input_data + t*dim, output_data + t*dim, dim);
+  }
+  else
   {
-    real *input_ptr = input_data + (t/stride)*dim*stride + t % stride;
-    real *output_ptr = output_data + (t/stride)*dim*stride + t % stride;
-
-    real inputMax = -THInf;
-    accreal sum;
-
-    ptrdiff_t d;
-    for (d = 0; d < dim; d++)
-    {
-      if (input_ptr[d*stride] >= inputMax) inputMax = input_ptr[d*stride];
-    }
-
-    sum = 0;
-    for (d = 0; d < dim; d++)
-    {
-      real z = exp(input_ptr[d*stride] - inputMax);
-      output_ptr[d*stride] = z;
-      sum += z;
-    }
-
-    for (d = 0; d < dim; d++)
+    ptrdiff_t ntile = (stride + THNN_SOFTMAX_TILE - 1) / THNN_SOFTMAX_TILE;
+#pragma omp parallel for private(t)
+    for (t = 0; t < nframe*ntile; t++)
     {
-      output_ptr[d*stride] *= 1/sum;
+      ptrdiff_t s = (t % ntile) * THNN_SOFTMAX_TILE;
+      ptrdiff_t offset = (t / ntile)*dim*stride + s;
+      THNN_(SoftMax_updateOutputTile)(input_data + offset, output_data + offset,
+                                      dim, stride, THMin(THNN_SOFTMAX_TILE, stride - s));
     }
   }
 
@@ -127,20 +265,25 @@ void THNN_(SoftMax_updateGradInput)(
   output_data = THTensor_(data)(output);
   gradOutput_data = THTensor_(data)(gradOutput);
 
+  if (stride == 1)
+  {
 #pragma omp parallel for private(t)
-  for (t = 0; t < stride*nframe; t++)
+    for (t = 0; t < nframe; t++)
+      THNN_(SoftMax_updateGradInputRow)(gradInput_data + t*dim, gradOutput_data + t*dim,
+                                        output_data + t*dim, dim);
+  }
+  else
   {
-    real *gradInput_ptr = gradInput_data + (t/stride)*dim*stride + t % stride;
-    real *output_ptr = output_data + (t/stride)*dim*stride + t % stride;
-    real *gradOutput_ptr = gradOutput_data + (t/stride)*dim*stride + t % stride;
-
-    ptrdiff_t d;
-    accreal sum = 0;
-    for (d = 0; d < dim; d++)
-      sum += (accreal)gradOutput_ptr[d*stride] * output_ptr[d*stride];
-
-    for (d = 0; d < dim; d++)
-      gradInput_ptr[d*stride] = output_ptr[d*stride] * (gradOutput_ptr[d*stride] - sum);
+    ptrdiff_t ntile = (stride + THNN_SOFTMAX_TILE - 1) / THNN_SOFTMAX_TILE;
+#pragma omp parallel for private(t)
+    for (t = 0; t < nframe*ntile; t++)
+    {
+      ptrdiff_t s = (t % ntile) * THNN_SOFTMAX_TILE;
+      ptrdiff_t offset = (t / ntile)*dim*stride + s;
+      THNN_(SoftMax_updateGradInputTile)(gradInput_data + offset, gradOutput_data + offset,
+                                         output_data + offset, dim, stride,
+                                         THMin(THNN_SOFTMAX_TILE, stride - s));
+    }
   }
 
   THTensor_(free)(gradOutput);
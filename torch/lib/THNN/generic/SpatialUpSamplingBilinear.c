@@ -51,53 +51,53 @@ void THNN_(SpatialUpSamplingBilinear_updateOutput)(
 		      THTensor_(size)(input, 0), 
 		      THTensor_(size)(input, 1), 
 		      outputHeight, outputWidth);
-  THTensor_(zero)(output);
-  real *idata = THTensor_(data)(input);
-  real *odata = THTensor_(data)(output);
   channels = nbatch * channels;
   THAssert(inputHeight > 0 && inputWidth > 0 && outputHeight > 0 && outputWidth > 0);
   // special case: just copy
   if (inputHeight == outputHeight && inputWidth == outputWidth) {
-    for (int h2 = 0; h2 < outputHeight; ++h2) {
-      const int h1 = h2;
-      for (int w2 = 0; w2 < outputWidth; ++w2) {
-        const int w1 = w2;
-        const real* pos1 = &idata[h1 * inputWidth + w1];
-        real* pos2 = &odata[h2 * outputWidth + w2];
-        for (int c = 0; c < channels; ++c) {
-          pos2[0] = pos1[0];
-          pos1 += inputWidth * inputHeight;
-          pos2 += outputWidth * outputHeight;
-        }
-      }
-    }
+    THTensor_(copy)(output, input);
+    THTensor_(free)(input);
     return;
   }
+  real *idata = THTensor_(data)(input);
+  real *odata = THTensor_(data)(output);
   const float rheight =(outputHeight > 1) ? (float)(inputHeight - 1)/(outputHeight - 1) : 0.f;
   const float rwidth = (outputWidth > 1) ? (float)(inputWidth - 1) / (outputWidth - 1) : 0.f;
-  for (int h2 = 0; h2 < outputHeight; ++h2) {
-    const float h1r = rheight * h2;
-    const int h1 = h1r;
-    const int h1p = (h1 < inputHeight - 1) ? 1 : 0;
-    const real h1lambda = h1r - h1;
-    const real h0lambda = (real)1. - h1lambda;
-    for (int w2 = 0; w2 < outputWidth; ++w2) {
-      const float w1r = rwidth * w2;
-      const int w1 = w1r;
-      const int w1p = (w1 < inputWidth - 1) ? 1 : 0;
-      const real w1lambda = w1r - w1;
-      const real w0lambda = (real)1. - w1lambda;
-      const real* pos1 = &idata[h1 * inputWidth + w1];
-      real* pos2 = &odata[h2 * outputWidth + w2];
-      for (int c = 0; c < channels; ++c) {
-        pos2[0] = h0lambda * (w0lambda * pos1[0]+ w1lambda * pos1[w1p])
-                  + h1lambda * (w0lambda * pos1[h1p * inputWidth]
-                  + w1lambda * pos1[h1p * inputWidth + w1p]);
-        pos1 += inputWidth * inputHeight;
-        pos2 += outputWidth * outputHeight;
+
+  // the horizontal taps are shared by every row of every plane
+  int *w1 = (int*)THAlloc(sizeof(int) * outputWidth);
+  int *w1p = (int*)THAlloc(sizeof(int) * outputWidth);
+  real *w0lambda = (real*)THAlloc(sizeof(real) * outputWidth);
+  real *w1lambda = (real*)THAlloc(sizeof(real) * outputWidth);
+  THNN_(linear_upsampling_computeTaps)
+    (rwidth, inputWidth, outputWidth, w1, w1p, w0lambda, w1lambda);
+
+  long c;
+#pragma omp parallel for private(c)
+  for (c = 0; c < channels; ++c) {
+    const real *iplane = idata + c * inputHeight * inputWidth;
+    real *oplane = odata + c * outputHeight * outputWidth;
+    for (int h2 = 0; h2 < outputHeight; ++h2) {
+      const float h1r = rheight * h2;
+      const int h1 = h1r;
+      const int h1p = (h1 < inputHeight - 1) ? 1 : 0;
+      const real h1lambda = h1r - h1;
+      const real h0lambda = (real)1. - h1lambda;
+      const real *row0 = iplane + h1 * inputWidth;
+      const real *row1 = row0 + h1p * inputWidth;
+      real *orow = oplane + h2 * outputWidth;
+      for (int w2 = 0; w2 < outputWidth; ++w2) {
+        const int x0 = w1[w2];
+        const int x1 = x0 + w1p[w2];
+        orow[w2] = h0lambda * (w0lambda[w2] * row0[x0] + w1lambda[w2] * row0[x1])
+                 + h1lambda * (w0lambda[w2] * row1[x0] + w1lambda[w2] * row1[x1]);
       }
     }
   }
+  THFree(w1);
+  THFree(w1p);
+  THFree(w0lambda);
+  THFree(w1lambda);
   THTensor_(free)(input);
 }
 
@@ -119,55 +119,58 @@ void THNN_(SpatialUpSamplingBilinear_updateGradInput)(
      outputHeight, outputWidth);
 
   THTensor_(resize4d)(gradInput, nbatch, channels, inputHeight, inputWidth);
-  THTensor_(zero)(gradInput);
   gradOutput = THTensor_(newContiguous)(gradOutput);
-  real *data1 = THTensor_(data)(gradInput);
-  real *data2 = THTensor_(data)(gradOutput);
   channels = nbatch * channels;
 
   // special case: same-size matching grids
   if (inputHeight == outputHeight && inputWidth == outputWidth) {
-    for (int h2 = 0; h2 < outputHeight; ++h2) {
-      const int h1 = h2;
-      for (int w2 = 0; w2 < outputWidth; ++w2) {
-        const int w1 = w2;
-        real* pos1 = &data1[h1 * inputWidth + w1];
-        const real* pos2 = &data2[h2 * outputWidth + w2];
-        for (int c = 0; c < channels; ++c) {
-          pos1[0] += pos2[0];
-          pos1 += inputWidth * inputHeight;
-          pos2 += outputWidth * outputHeight;
-        }
-      }
-    }
+    THTensor_(copy)(gradInput, gradOutput);
+    THTensor_(free)(gradOutput);
     return;
   }
+  THTensor_(zero)(gradInput);
+  real *data1 = THTensor_(data)(gradInput);
+  real *data2 = THTensor_(data)(gradOutput);
   const float rheight =(outputHeight > 1) ? (float)(inputHeight - 1)/(outputHeight - 1) : 0.f;
   const float rwidth = (outputWidth > 1) ? (float)(inputWidth - 1)/(outputWidth - 1) : 0.f;
-  for (int h2 = 0; h2 < outputHeight; ++h2) {
-    const float h1r = rheight * h2;
-    const int h1 = h1r;
-    const int h1p = (h1 < inputHeight - 1) ? 1 : 0;
-    const real h1lambda = h1r - h1;
-    const real h0lambda = (real)1. - h1lambda;
-    for (int w2 = 0; w2 < outputWidth; ++w2) {
-      const float w1r = rwidth * w2;
-      const int w1 = w1r;
-      const int w1p = (w1 < inputWidth - 1) ? 1 : 0;
-      const real w1lambda = w1r - w1;
-      const real w0lambda = (real)1. - w1lambda;
-      real* pos1 = &data1[h1 * inputWidth + w1];
-      const real* pos2 = &data2[h2 * outputWidth + w2];
-      for (int c = 0; c < channels; ++c) {
-        pos1[0] += h0lambda * w0lambda * pos2[0];
-        pos1[w1p] += h0lambda * w1lambda * pos2[0];
-        pos1[h1p * inputWidth] += h1lambda * w0lambda * pos2[0];
-        pos1[h1p * inputWidth + w1p] += h1lambda * w1lambda * pos2[0];
-        pos1 += inputWidth * inputHeight;
-        pos2 += outputWidth * outputHeight;
+
+  int *w1 = (int*)THAlloc(sizeof(int) * outputWidth);
+  int *w1p = (int*)THAlloc(sizeof(int) * outputWidth);
+  real *w0lambda = (real*)THAlloc(sizeof(real) * outputWidth);
+  real *w1lambda = (real*)THAlloc(sizeof(real) * outputWidth);
+  THNN_(linear_upsampling_computeTaps)
+    (rwidth, inputWidth, outputWidth, w1, w1p, w0lambda, w1lambda);
+
+  // every plane only scatters into its own gradInput plane, so planes
+  // can be processed concurrently without atomics
+  long c;
+#pragma omp parallel for private(c)
+  for (c = 0; c < channels; ++c) {
+    real *iplane = data1 + c * inputHeight * inputWidth;
+    const real *oplane = data2 + c * outputHeight * outputWidth;
+    for (int h2 = 0; h2 < outputHeight; ++h2) {
+      const float h1r = rheight * h2;
+      const int h1 = h1r;
+      const int h1p = (h1 < inputHeight - 1) ? 1 : 0;
+      const real h1lambda = h1r - h1;
+      const real h0lambda = (real)1. - h1lambda;
+      real *row0 = iplane + h1 * inputWidth;
+      real *row1 = row0 + h1p * inputWidth;
+      const real *orow = oplane + h2 * outputWidth;
+      for (int w2 = 0; w2 < outputWidth; ++w2) {
+        const int x0 = w1[w2];
+        const int x1 = x0 + w1p[w2];
+        row0[x0] += h0lambda * w0lambda[w2] * orow[w2];
+        row0[x1] += h0lambda * w1lambda[w2] * orow[w2];
+        row1[x0] += h1lambda * w0lambda[w2] * orow[w2];
+        row1[x1] += h1lambda * w1lambda[w2] * orow[w2];
       }
     }
   }
+  THFree(w1);
+  THFree(w1p);
+  THFree(w0lambda);
+  THFree(w1lambda);
   THTensor_(free)(gradOutput);
 }
 
@@ -61,63 +61,38 @@ void THNN_(SpatialUpSamplingNearest_updateOutput)(
 			outputHeight, outputWidth);
   }
 
-  int dW = scale_factor;
-  int dH = scale_factor;
-  int xDim = input->nDimension-2;
-  int yDim = input->nDimension-1;
-
-  // dims
-  int idim = input->nDimension;
-  int osz0 = output->size[0];
-  int osz1 = output->size[1];
-  int osz2 = output->size[2];
-  int osz3 = 1;  
-  if (idim > 3) {
-    osz3 = output->size[3];
-  }
-
-  // get strides
-  long *is = input->stride;
-  long *os = output->stride;
-
-  // get raw pointers
+  // the planes are walked as contiguous blocks of memory
+  input = THTensor_(newContiguous)(input);
+  THTensor *output_ = THTensor_(newContiguous)(output);
   real *pin = THTensor_(data)(input);
-  real *pout = THTensor_(data)(output);
+  real *pout = THTensor_(data)(output_);
+
+  // every (batch, plane) pair is an independent image
+  long nplanes = THTensor_(nElement)(input) / (inputHeight * inputWidth);
+  long p;
 
   // perform the upsampling
-  int i0, i1, i2, i3, isrc, idst;
-  int iout[4];  // Output indices
-  int iin[4];  // Input indices
-
-  for (i0 = 0; i0 < osz0; i0++) {
-    iout[0] = i0;
-    iin[0] = i0;
-    for (i1 = 0; i1 < osz1; i1++) {
-      iout[1] = i1;
-      iin[1] = i1;
-      for (i2 = 0; i2 < osz2; i2++) {
-        iout[2] = i2;
-        iin[2] = i2;
-        for (i3 = 0; i3 < osz3; i3++) {
-          iout[3] = i3;
-          iin[3] = i3;
-
-          // set the indices for the upsampled dimensions
-          iin[xDim] = iout[xDim] / dW;
-          iin[yDim] = iout[yDim] / dH;
-
-          idst = i0*os[0] + i1*os[1] + i2*os[2];
-          isrc = iin[0]*is[0] + iin[1]*is[1] + iin[2]*is[2];
-          if (idim > 3) {
-            idst += i3*os[3];
-            isrc += iin[3]*is[3];
-          }
-
-          pout[idst] = pin[isrc];
-        }
+#pragma omp parallel for private(p)
+  for (p = 0; p < nplanes; p++) {
+    const real *iplane = pin + p * inputHeight * inputWidth;
+    real *oplane = pout + p * outputHeight * outputWidth;
+    long oh, ow;
+    for (oh = 0; oh < outputHeight; oh++) {
+      const real *irow = iplane + (oh / scale_factor) * inputWidth;
+      real *orow = oplane + oh * outputWidth;
+      if (oh % scale_factor != 0) {
+        // rows that map onto the same input row are identical
+        memcpy(orow, orow - outputWidth, outputWidth * sizeof(real));
+        continue;
+      }
+      for (ow = 0; ow < outputWidth; ow++) {
+        orow[ow] = irow[ow / scale_factor];
       }
     }
   }
+
+  THTensor_(free)(input);
+  THTensor_(freeCopyTo)(output_, output);
 }
 
 void THNN_(SpatialUpSamplingNearest_updateGradInput)(
@@ -130,70 +105,38 @@ void THNN_(SpatialUpSamplingNearest_updateGradInput)(
   THNN_(SpatialUpSamplingNearest_shapeCheck)(input, gradOutput, scale_factor);
   THTensor_(resizeAs)(gradInput, input);
 
-  int dW = scale_factor;
-  int dH = scale_factor;
-  int xDim = gradInput->nDimension-2;
-  int yDim = gradInput->nDimension-1;
-
-  // dims
-  int idim = gradInput->nDimension;  // Guaranteed to be between 3 and 5
-  int isz0 = gradInput->size[0];
-  int isz1 = gradInput->size[1];
-  int isz2 = gradInput->size[2];
-  int isz3 = 1;
-  if (idim > 3) {
-    isz3 = gradInput->size[3];
-  }
-
-  // get strides
-  long *is = gradInput->stride;
-  long *os = gradOutput->stride;
+  int inputHeight = THTensor_(size)(gradInput, gradInput->nDimension-2);
+  int inputWidth  = THTensor_(size)(gradInput, gradInput->nDimension-1);
+  int outputHeight = inputHeight * scale_factor;
+  int outputWidth = inputWidth * scale_factor;
 
-  // get raw pointers
-  real *pin = THTensor_(data)(gradInput);
+  gradOutput = THTensor_(newContiguous)(gradOutput);
+  THTensor *gradInput_ = THTensor_(newContiguous)(gradInput);
+  real *pin = THTensor_(data)(gradInput_);
   real *pout = THTensor_(data)(gradOutput);
 
-  // perform the upsampling
-  int i0, i1, i2, i3, isrc, idst, x, y;
-  int iin[4];  // Input indices
-  int iout[4];  // Output indices
-
-  THTensor_(zero)(gradInput);
-
-  for (i0 = 0; i0 < isz0; i0++) {
-    iin[0] = i0;
-    iout[0] = i0;
-    for (i1 = 0; i1 < isz1; i1++) {
-      iin[1] = i1;
-      iout[1] = i1;
-      for (i2 = 0; i2 < isz2; i2++) {
-        iin[2] = i2;
-        iout[2] = i2;
-        for (i3 = 0; i3 < isz3; i3++) {
-          iin[3] = i3;
-          iout[3] = i3;
-
-          idst = i0*is[0] + i1*is[1] + i2*is[2];
-          if (idim > 3) {
-            idst += i3*is[3];
-          }
-
-          // Now accumulate the gradients from gradOutput
-          for (y = 0; y < dH; y++) {
-            for (x = 0; x < dW; x++) {
-              iout[xDim] = dW * iin[xDim] + x;
-              iout[yDim] = dH * iin[yDim] + y;
-              isrc = iout[0]*os[0] + iout[1]*os[1] + iout[2]*os[2];
-              if (idim > 3) {
-                isrc += iout[3]*os[3];
-              }
-              pin[idst] += pout[isrc];
-            }
-          }
-        }
+  long nplanes = THTensor_(nElement)(gradInput) / (inputHeight * inputWidth);
+  long p;
+
+  THTensor_(zero)(gradInput_);
+
+  // accumulate the gradients from gradOutput, one plane per thread
+#pragma omp parallel for private(p)
+  for (p = 0; p < nplanes; p++) {
+    real *iplane = pin + p * inputHeight * inputWidth;
+    const real *oplane = pout + p * outputHeight * outputWidth;
+    long oh, ow;
+    for (oh = 0; oh < outputHeight; oh++) {
+      real *irow = iplane + (oh / scale_factor) * inputWidth;
+      const real *orow = oplane + oh * outputWidth;
+      for (ow = 0; ow < outputWidth; ow++) {
+        irow[ow / scale_factor] += orow[ow];
       }
     }
   }
+
+  THTensor_(free)(gradOutput);
+  THTensor_(freeCopyTo)(gradInput_, gradInput);
 }
 
 #endif
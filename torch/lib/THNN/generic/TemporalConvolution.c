@@ -108,8 +108,6 @@ void THNN_(TemporalConvolution_updateOutput)(
   }
   else
   {
-    THTensor *outputSample = THTensor_(new)();
-    THTensor *inputSample = THTensor_(new)();
     int nBatchFrame = input->size[0];
 
     THTensor_(resize3d)(output,
@@ -117,17 +115,25 @@ void THNN_(TemporalConvolution_updateOutput)(
                         nOutputFrame,
                         outputFrameSize);
 
+    THTensor *tweight = THTensor_(new)();
+    THTensor_(transpose)(tweight, weight, 0, 1);
+
+    /* samples are independent, so each thread works on its own windows */
+#pragma omp parallel for private(i)
     for(i = 0; i < nBatchFrame; i++)
     {
-      THTensor_(select)(outputSample, output, 0, i);
-      THTensor_(select)(inputSample, input, 0, i);
+      THTensor *outputSample = THTensor_(newSelect)(output, 0, i);
+      THTensor *inputSample = THTensor_(newSelect)(input, 0, i);
+      THTensor *outputSampleWindow = THTensor_(new)();
+      THTensor *inputSampleWindow = THTensor_(new)();
       long nOutputSampleFrame = nOutputFrame;
+      long k;
 
       /* bias first */
       for(k = 0; k < nOutputFrame; k++)
       {
-        THTensor_(select)(outputWindow, outputSample, 0, k);
-        THTensor_(copy)(outputWindow, bias);
+        THTensor_(select)(outputSampleWindow, outputSample, 0, k);
+        THTensor_(copy)(outputSampleWindow, bias);
       }
 
       /* ouch */
@@ -138,24 +144,25 @@ void THNN_(TemporalConvolution_updateOutput)(
         long nFrame = (nInputFrame-k*dW-kW)/inputFrameStride + 1;
         nOutputSampleFrame -= nFrame;
 
-        THTensor_(setStorage2d)(inputWindow, inputSample->storage,
+        THTensor_(setStorage2d)(inputSampleWindow, inputSample->storage,
                                 inputSample->storageOffset+k*dW*inputSample->size[1],
                                 nFrame, inputFrameStride*inputSample->size[1],
                                 kW*inputSample->size[1], 1);
 
-        THTensor_(setStorage2d)(outputWindow, outputSample->storage,
+        THTensor_(setStorage2d)(outputSampleWindow, outputSample->storage,
                                 outputSample->storageOffset + k*outputSample->size[1],
                                 nFrame, outputFrameStride*outputSample->size[1],
                                 outputSample->size[1], 1);
 
-        THTensor *tweight = THTensor_(new)();
-        THTensor_(transpose)(tweight, weight, 0, 1);
-        THTensor_(addmm)(outputWindow, 1, outputWindow, 1, inputWindow, tweight);
-        THTensor_(free)(tweight);
+        THTensor_(addmm)(outputSampleWindow, 1, outputSampleWindow, 1, inputSampleWindow, tweight);
       }
+
+      THTensor_(free)(outputSampleWindow);
+      THTensor_(free)(inputSampleWindow);
+      THTensor_(free)(outputSample);
+      THTensor_(free)(inputSample);
     }
-    THTensor_(free)(outputSample);
-    THTensor_(free)(inputSample);
+    THTensor_(free)(tweight);
   }
 
   THTensor_(free)(outputWindow);
@@ -229,15 +236,17 @@ void THNN_(TemporalConvolution_updateGradInput)(
   }
   else
   {
-    THTensor *gradOutputSample = THTensor_(new)();
-    THTensor *gradInputSample = THTensor_(new)();
     int nBatchFrame = input->size[0];
 
+#pragma omp parallel for private(i)
     for(i = 0; i < nBatchFrame; i++)
     {
-      THTensor_(select)(gradOutputSample, gradOutput, 0, i);
-      THTensor_(select)(gradInputSample, gradInput, 0, i);
-      int nOutputSampleFrame = nOutputFrame;
+      THTensor *gradOutputSample = THTensor_(newSelect)(gradOutput, 0, i);
+      THTensor *gradInputSample = THTensor_(newSelect)(gradInput, 0, i);
+      THTensor *gradOutputSampleWindow = THTensor_(new)();
+      THTensor *gradInputSampleWindow = THTensor_(new)();
+      long nOutputSampleFrame = nOutputFrame;
+      long k;
 
       /* ouch */
       for(k = 0; nOutputSampleFrame > 0; k++)
@@ -247,21 +256,24 @@ void THNN_(TemporalConvolution_updateGradInput)(
         long nFrame = (nInputFrame-k*dW-kW)/inputFrameStride + 1;
         nOutputSampleFrame -= nFrame;
 
-        THTensor_(setStorage2d)(gradOutputWindow, gradOutputSample->storage,
+        THTensor_(setStorage2d)(gradOutputSampleWindow, gradOutputSample->storage,
                                 gradOutputSample->storageOffset + k*gradOutputSample->size[1],
                                 nFrame, outputFrameStride*gradOutputSample->size[1],
                                 gradOutputSample->size[1], 1);
 
-        THTensor_(setStorage2d)(gradInputWindow, gradInputSample->storage,
+        THTensor_(setStorage2d)(gradInputSampleWindow, gradInputSample->storage,
                                 gradInputSample->storageOffset+k*dW*gradInputSample->size[1],
                                 nFrame, inputFrameStride*gradInputSample->size[1],
                                 kW*gradInputSample->size[1], 1);
 
-        THTensor_(addmm)(gradInputWindow, 1, gradInputWindow, 1, gradOutputWindow, weight);
+        THTensor_(addmm)(gradInputSampleWindow, 1, gradInputSampleWindow, 1, gradOutputSampleWindow, weight);
       }
+
+      THTensor_(free)(gradOutputSampleWindow);
+      THTensor_(free)(gradInputSampleWindow);
+      THTensor_(free)(gradOutputSample);
+      THTensor_(free)(gradInputSample);
     }
-    THTensor_(free)(gradOutputSample);
-    THTensor_(free)(gradInputSample);
   }
 
   THTensor_(free)(gradOutputWindow);
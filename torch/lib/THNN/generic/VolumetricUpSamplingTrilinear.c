@@ -54,72 +54,66 @@ void THNN_(VolumetricUpSamplingTrilinear_updateOutput)(
 		      THTensor_(size)(input, 0), 
 		      THTensor_(size)(input, 1), 
 		      outputDepth, outputHeight, outputWidth);
-  THTensor_(zero)(output);
-  real *idata = THTensor_(data)(input);
-  real *odata = THTensor_(data)(output);
   channels = nbatch * channels;
   THAssert(inputDepth > 0 && inputHeight > 0 && inputWidth > 0 && 
            outputDepth > 0 && outputHeight > 0 && outputWidth > 0);
   // special case: just copy
   if (inputDepth == outputDepth && inputHeight == outputHeight && inputWidth == outputWidth) {
-    for (int t2 = 0; t2 < outputDepth; ++t2) {
-      const int t1 = t2;
-      for (int h2 = 0; h2 < outputHeight; ++h2) {
-        const int h1 = h2;
-        for (int w2 = 0; w2 < outputWidth; ++w2) {
-          const int w1 = w2;
-          const real* pos1 = &idata[t1 * inputHeight * inputWidth + h1 * inputWidth + w1];
-          real* pos2 = &odata[t2 * outputHeight * outputWidth + h2 * outputWidth + w2];
-          for (int c = 0; c < channels; ++c) {
-            pos2[0] = pos1[0];
-            pos1 += inputWidth * inputHeight * inputDepth;
-            pos2 += outputWidth * outputHeight * outputDepth;
-          }
-        }
-      }
-    }
+    THTensor_(copy)(output, input);
+    THTensor_(free)(input);
     return;
   }
+  real *idata = THTensor_(data)(input);
+  real *odata = THTensor_(data)(output);
   const float rdepth  = (outputDepth > 1) ? (float)(inputDepth - 1)/(outputDepth - 1) : 0.f;
   const float rheight = (outputHeight > 1) ? (float)(inputHeight - 1)/(outputHeight - 1) : 0.f;
   const float rwidth  = (outputWidth > 1) ? (float)(inputWidth - 1) / (outputWidth - 1) : 0.f;
-  for (int t2 = 0; t2 < outputDepth; ++t2) {
-    const float t1r = rdepth * t2;
-    const int t1 = t1r;
-    const int t1p = (t1 < inputDepth - 1) ? 1 : 0;
-    const real t1lambda = t1r - t1;
-    const real t0lambda = (real)1. - t1lambda;
-    for (int h2 = 0; h2 < outputHeight; ++h2) {
-      const float h1r = rheight * h2;
-      const int h1 = h1r;
-      const int h1p = (h1 < inputHeight - 1) ? 1 : 0;
-      const real h1lambda = h1r - h1;
-      const real h0lambda = (real)1. - h1lambda;
-      for (int w2 = 0; w2 < outputWidth; ++w2) {
-        const float w1r = rwidth * w2;
-        const int w1 = w1r;
-        const int w1p = (w1 < inputWidth - 1) ? 1 : 0;
-        const real w1lambda = w1r - w1;
-        const real w0lambda = (real)1. - w1lambda;
-        const real* pos1 = &idata[t1 * inputHeight * inputWidth + h1 * inputWidth + w1];
-        real* pos2 = &odata[t2 * outputHeight * outputWidth + h2 * outputWidth + w2];
-        for (int c = 0; c < channels; ++c) {
-          pos2[0] = t0lambda * (h0lambda * (w0lambda * pos1[0] + w1lambda * pos1[w1p])
-                              + h1lambda * (w0lambda * pos1[h1p * inputWidth]
-                                          + w1lambda * pos1[h1p * inputWidth + w1p]))
-                  + t1lambda * (h0lambda * (w0lambda * pos1[t1p * inputHeight * inputWidth] 
-                                          + w1lambda * pos1[t1p * inputHeight * inputWidth
-                                                            + w1p])
-                              + h1lambda * (w0lambda * pos1[t1p * inputHeight * inputWidth 
-                                                            + h1p * inputWidth]
-                                          + w1lambda * pos1[t1p * inputHeight * inputWidth 
-                                                            + h1p * inputWidth + w1p]));
-          pos1 += inputWidth * inputHeight * inputDepth;
-          pos2 += outputWidth * outputHeight * outputDepth;
+
+  int *w1 = (int*)THAlloc(sizeof(int) * outputWidth);
+  int *w1p = (int*)THAlloc(sizeof(int) * outputWidth);
+  real *w0lambda = (real*)THAlloc(sizeof(real) * outputWidth);
+  real *w1lambda = (real*)THAlloc(sizeof(real) * outputWidth);
+  THNN_(linear_upsampling_computeTaps)
+    (rwidth, inputWidth, outputWidth, w1, w1p, w0lambda, w1lambda);
+
+  const long islice = inputHeight * inputWidth;
+  long c;
+#pragma omp parallel for private(c)
+  for (c = 0; c < channels; ++c) {
+    const real *ivolume = idata + c * inputDepth * islice;
+    real *ovolume = odata + c * outputDepth * outputHeight * outputWidth;
+    for (int t2 = 0; t2 < outputDepth; ++t2) {
+      const float t1r = rdepth * t2;
+      const int t1 = t1r;
+      const int t1p = (t1 < inputDepth - 1) ? 1 : 0;
+      const real t1lambda = t1r - t1;
+      const real t0lambda = (real)1. - t1lambda;
+      for (int h2 = 0; h2 < outputHeight; ++h2) {
+        const float h1r = rheight * h2;
+        const int h1 = h1r;
+        const int h1p = (h1 < inputHeight - 1) ? 1 : 0;
+        const real h1lambda = h1r - h1;
+        const real h0lambda = (real)1. - h1lambda;
+        const real *row00 = ivolume + t1 * islice + h1 * inputWidth;
+        const real *row01 = row00 + h1p * inputWidth;
+        const real *row10 = row00 + t1p * islice;
+        const real *row11 = row10 + h1p * inputWidth;
+        real *orow = ovolume + (t2 * outputHeight + h2) * outputWidth;
+        for (int w2 = 0; w2 < outputWidth; ++w2) {
+          const int x0 = w1[w2];
+          const int x1 = x0 + w1p[w2];
+          orow[w2] = t0lambda * (h0lambda * (w0lambda[w2] * row00[x0] + w1lambda[w2] * row00[x1])
+                               + h1lambda * (w0lambda[w2] * row01[x0] + w1lambda[w2] * row01[x1]))
+                   + t1lambda * (h0lambda * (w0lambda[w2] * row10[x0] + w1lambda[w2] * row10[x1])
+                               + h1lambda * (w0lambda[w2] * row11[x0] + w1lambda[w2] * row11[x1]));
         }
       }
     }
   }
+  THFree(w1);
+  THFree(w1p);
+  THFree(w0lambda);
+  THFree(w1lambda);
   THTensor_(free)(input);
 }
 
@@ -143,70 +137,73 @@ void THNN_(VolumetricUpSamplingTrilinear_updateGradInput)(
      outputDepth, outputHeight, outputWidth);
 
   THTensor_(resize5d)(gradInput, nbatch, channels, inputDepth, inputHeight, inputWidth);
-  THTensor_(zero)(gradInput);
   gradOutput = THTensor_(newContiguous)(gradOutput);
-  real *data1 = THTensor_(data)(gradInput);
-  real *data2 = THTensor_(data)(gradOutput);
   channels = nbatch * channels;
 
   // special case: same-size matching grids
   if (inputDepth == outputDepth && inputHeight == outputHeight && inputWidth == outputWidth) {
-    for (int t2 = 0; t2 < outputDepth; ++t2) {
-      const int t1 = t2;
-      for (int h2 = 0; h2 < outputHeight; ++h2) {
-        const int h1 = h2;
-        for (int w2 = 0; w2 < outputWidth; ++w2) {
-          const int w1 = w2;
-          real* pos1 = &data1[t1 * inputHeight * inputWidth + h1 * inputWidth + w1];
-          const real* pos2 = &data2[t2 * outputHeight * outputWidth + h2 * outputWidth + w2];
-          for (int c = 0; c < channels; ++c) {
-            pos1[0] += pos2[0];
-            pos1 += inputWidth * inputHeight * inputDepth;
-            pos2 += outputWidth * outputHeight * outputDepth;
-          }
-        }
-      }
-    }
+    THTensor_(copy)(gradInput, gradOutput);
+    THTensor_(free)(gradOutput);
     return;
   }
+  THTensor_(zero)(gradInput);
+  real *data1 = THTensor_(data)(gradInput);
+  real *data2 = THTensor_(data)(gradOutput);
   const float rdepth  = (outputDepth > 1) ? (float)(inputDepth - 1)/(outputDepth - 1) : 0.f;
   const float rheight = (outputHeight > 1) ? (float)(inputHeight - 1)/(outputHeight - 1) : 0.f;
   const float rwidth  = (outputWidth > 1) ? (float)(inputWidth - 1)/(outputWidth - 1) : 0.f;
-  for (int t2 = 0; t2 < outputDepth; ++t2) {
-    const float t1r = rdepth * t2;
-    const int t1 = t1r;
-    const int t1p = (t1 < inputDepth - 1) ? 1 : 0;
-    const real t1lambda = t1r - t1;
-    const real t0lambda = (real)1. - t1lambda;
-    for (int h2 = 0; h2 < outputHeight; ++h2) {
-      const float h1r = rheight * h2;
-      const int h1 = h1r;
-      const int h1p = (h1 < inputHeight - 1) ? 1 : 0;
-      const real h1lambda = h1r - h1;
-      const real h0lambda = (real)1. - h1lambda;
-      for (int w2 = 0; w2 < outputWidth; ++w2) {
-        const float w1r = rwidth * w2;
-        const int w1 = w1r;
-        const int w1p = (w1 < inputWidth - 1) ? 1 : 0;
-        const real w1lambda = w1r - w1;
-        const real w0lambda = (real)1. - w1lambda;
-        real* pos1 = &data1[t1 * inputHeight * inputWidth + h1 * inputWidth + w1];
-        const real* pos2 = &data2[t2 * outputHeight * outputWidth + h2 * outputWidth + w2];
-        for (int c = 0; c < channels; ++c) {
-          pos1[0] += t0lambda * h0lambda * w0lambda * pos2[0];
-          pos1[w1p] += t0lambda * h0lambda * w1lambda * pos2[0];
-          pos1[h1p * inputWidth] += t0lambda * h1lambda * w0lambda * pos2[0];
-          pos1[h1p * inputWidth + w1p] += t0lambda * h1lambda * w1lambda * pos2[0];
-          pos1[t1p * inputHeight * inputWidth] += t1lambda * h0lambda * w0lambda * pos2[0];
-          pos1[t1p * inputHeight * inputWidth + w1p] += t1lambda * h0lambda * w1lambda * pos2[0]; 
-          pos1[t1p * inputHeight * inputWidth + h1p * inputWidth] += t1lambda * h1lambda * w0lambda * pos2[0];
-          pos1[t1p * inputHeight * inputWidth + h1p * inputWidth + w1p] += t1lambda * h1lambda * w1lambda * pos2[0]; 
-          pos1 += inputWidth * inputHeight * inputDepth;
-          pos2 += outputWidth * outputHeight * outputDepth;
+
+  int *w1 = (int*)THAlloc(sizeof(int) * outputWidth);
+  int *w1p = (int*)THAlloc(sizeof(int) * outputWidth);
+  real *w0lambda = (real*)THAlloc(sizeof(real) * outputWidth);
+  real *w1lambda = (real*)THAlloc(sizeof(real) * outputWidth);
+  THNN_(linear_upsampling_computeTaps)
+    (rwidth, inputWidth, outputWidth, w1, w1p, w0lambda, w1lambda);
+
+  // gradients of a volume only land in the same gradInput volume
+  const long islice = inputHeight * inputWidth;
+  long c;
+#pragma omp parallel for private(c)
+  for (c = 0; c < channels; ++c) {
+    real *ivolume = data1 + c * inputDepth * islice;
+    const real *ovolume = data2 + c * outputDepth * outputHeight * outputWidth;
+    for (int t2 = 0; t2 < outputDepth; ++t2) {
+      const float t1r = rdepth * t2;
+      const int t1 = t1r;
+      const int t1p = (t1 < inputDepth - 1) ? 1 : 0;
+      const real t1lambda = t1r - t1;
+      const real t0lambda = (real)1. - t1lambda;
+      for (int h2 = 0; h2 < outputHeight; ++h2) {
+        const float h1r = rheight * h2;
+        const int h1 = h1r;
+        const int h1p = (h1 < inputHeight - 1) ? 1 : 0;
+        const real h1lambda = h1r - h1;
+        const real h0lambda = (real)1. - h1lambda;
+        real *row00 = ivolume + t1 * islice + h1 * inputWidth;
+        real *row01 = row00 + h1p * inputWidth;
+        real *row10 = row00 + t1p * islice;
+        real *row11 = row10 + h1p * inputWidth;
+        const real *orow = ovolume + (t2 * outputHeight + h2) * outputWidth;
+        for (int w2 = 0; w2 < outputWidth; ++w2) {
+          const int x0 = w1[w2];
+          const int x1 = x0 + w1p[w2];
+          const real g = orow[w2];
+          row00[x0] += t0lambda * h0lambda * w0lambda[w2] * g;
+          row00[x1] += t0lambda * h0lambda * w1lambda[w2] * g;
+          row01[x0] += t0lambda * h1lambda * w0lambda[w2] * g;
+          row01[x1] += t0lambda * h1lambda * w1lambda[w2] * g;
+          row10[x0] += t1lambda * h0lambda * w0lambda[w2] * g;
+          row10[x1] += t1lambda * h0lambda * w1lambda[w2] * g;
+          row11[x0] += t1lambda * h1lambda * w0lambda[w2] * g;
+          row11[x1] += t1lambda * h1lambda * w1lambda[w2] * g;
         }
       }
     }
   }
+  THFree(w1);
+  THFree(w1p);
+  THFree(w0lambda);
+  THFree(w1lambda);
   THTensor_(free)(gradOutput);
 }
 
@@ -0,0 +1,20 @@
+#ifndef TH_GENERIC_FILE
+#define TH_GENERIC_FILE "generic/linear_upsampling.c"
+#else
+
+/* Interpolation taps along the output width, shared by the bilinear and
+ * trilinear upsampling kernels: output column w2 reads input columns
+ * w1[w2] and w1[w2] + w1p[w2] with weights w0lambda[w2] and w1lambda[w2]. */
+static void THNN_(linear_upsampling_computeTaps)
+     (float rwidth, int inputWidth, int outputWidth,
+      int *w1, int *w1p, real *w0lambda, real *w1lambda) {
+  for (int w2 = 0; w2 < outputWidth; ++w2) {
+    const float w1r = rwidth * w2;
+    w1[w2] = w1r;
+    w1p[w2] = (w1[w2] < inputWidth - 1) ? 1 : 0;
+    w1lambda[w2] = w1r - w1[w2];
+    w0lambda[w2] = (real)1. - w1lambda[w2];
+  }
+}
+
+#endif
@@ -62,6 +62,14 @@
     THArgCheck(COND, ARG, FORMAT, s1.str);	\
   }
 
+/* SoftMax and LogSoftMax normalize THNN_SOFTMAX_TILE spatial positions at a
+ * time when the reduced dimension is not the innermost one, and switch to a
+ * single online max/sum pass over contiguous rows of at least
+ * THNN_SOFTMAX_ONLINE_DIM elements, which no longer stay in cache between
+ * passes. */
+#define THNN_SOFTMAX_TILE 256
+#define THNN_SOFTMAX_ONLINE_DIM 16384
+
 #include "generic/Abs.c"
 #include "THGenerateFloatTypes.h"
 
@@ -236,6 +244,9 @@
 #include "generic/SpatialSubSampling.c"
 #include "THGenerateFloatTypes.h"
 
+#include "generic/linear_upsampling.c"
+#include "THGenerateFloatTypes.h"
+
 #include "generic/SpatialUpSamplingNearest.c"
 #include "THGenerateFloatTypes.h"
 
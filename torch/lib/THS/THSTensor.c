@@ -1,7 +1,74 @@
 #include "THSTensor.h"
 
+#define THS_RADIX_BITS 11
+#define THS_RADIX_SIZE (1 << THS_RADIX_BITS)
+#define THS_RADIX_GRAIN 65536
+
+/* Stable LSD radix sort of non-negative keys, carrying along a permutation.
+ * keys and perm are sorted in place; keysBuf and permBuf are scratch space of
+ * the same length.  Each pass builds per-chunk digit histograms in parallel,
+ * turns them into scatter offsets and scatters every chunk in order, which
+ * keeps equal keys in their original relative order. */
+static void THSTensor_radixSort(long *keys, long *perm, long *keysBuf, long *permBuf,
+                                ptrdiff_t n, long maxKey) {
+  long nChunks = n / THS_RADIX_GRAIN + 1;
+  long nThreads = THGetNumThreads();
+  if (nChunks > nThreads) nChunks = nThreads;
+  long chunkSize = (n + nChunks - 1) / nChunks;
+  long *offsets = (long*)THAlloc(sizeof(long) * nChunks * THS_RADIX_SIZE);
+  long c;
+  int shift;
+
+  for (shift = 0; shift < 64 && (maxKey >> shift) > 0; shift += THS_RADIX_BITS) {
+#pragma omp parallel for private(c) if (nChunks > 1)
+    for (c = 0; c < nChunks; c++) {
+      long *hist = offsets + c * THS_RADIX_SIZE;
+      ptrdiff_t end = (c + 1) * chunkSize < n ? (c + 1) * chunkSize : n;
+      memset(hist, 0, sizeof(long) * THS_RADIX_SIZE);
+      for (ptrdiff_t i = c * chunkSize; i < end; i++) {
+        hist[(keys[i] >> shift) & (THS_RADIX_SIZE - 1)]++;
+      }
+    }
+
+    long total = 0;
+    for (long d = 0; d < THS_RADIX_SIZE; d++) {
+      for (c = 0; c < nChunks; c++) {
+        long count = offsets[c * THS_RADIX_SIZE + d];
+        offsets[c * THS_RADIX_SIZE + d] = total;
+        total += count;
+      }
+    }
+
+#pragma omp parallel for private(c) if (nChunks > 1)
+    for (c = 0; c < nChunks; c++) {
+      long *offset = offsets + c * THS_RADIX_SIZE;
+      ptrdiff_t end = (c + 1) * chunkSize < n ? (c + 1) * chunkSize : n;
+      for (ptrdiff_t i = c * chunkSize; i < end; i++) {
+        long pos = offset[(keys[i] >> shift) & (THS_RADIX_SIZE - 1)]++;
+        keysBuf[pos] = keys[i];
+        permBuf[pos] = perm[i];
+      }
+    }
+
+    long *tmp;
+    tmp = keys; keys = keysBuf; keysBuf = tmp;
+    tmp = perm; perm = permBuf; permBuf = tmp;
+  }
+
+  /* an odd number of passes leaves the result in the scratch buffers */
+  if ((shift / THS_RADIX_BITS) % 2 == 1) {
+    memcpy(keysBuf, keys, sizeof(long) * n);
+    memcpy(permBuf, perm, sizeof(long) * n);
+  }
+  THFree(offsets);
+}
+
 #include "generic/THSTensor.c"
 #include "THSGenerateAllTypes.h"
 
 #include "generic/THSTensorMath.c"
 #include "THSGenerateAllTypes.h"
+
+#undef THS_RADIX_BITS
+#undef THS_RADIX_SIZE
+#undef THS_RADIX_GRAIN
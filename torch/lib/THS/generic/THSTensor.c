@@ -73,6 +73,7 @@ static void THSTensor_(rawInit)(THSTensor *self)
   self->nDimensionV = 0;
   self->coalesced = 0;
   self->nnz = 0;
+  self->csr = NULL;
   // self->flag = TH_TENSOR_REFCOUNTED;
 }
 
@@ -86,6 +87,15 @@ static void THSTensor_(rawResize)(THSTensor *self, int nDimI, int nDimV, long *s
   self->nDimensionI = nDimI;
   self->nDimensionV = nDimV;
   self->coalesced = 0;
+  THSTensor_(_invalidateCSR)(self);
+}
+
+// drop the cached row pointer; must be called whenever indices are written
+void THSTensor_(_invalidateCSR)(THSTensor *self) {
+  if (self->csr) {
+    THLongTensor_free(self->csr);
+    self->csr = NULL;
+  }
 }
 
 // directly assign without cloning or retaining (internal method)
@@ -110,6 +120,7 @@ THSTensor* THSTensor_(_move)(THSTensor *self, THLongTensor *indices, THTensor *v
   self->values = values;
   self->nnz = empty ? 0 : THTensor_(size)(values, 0);
   self->coalesced = 0;
+  THSTensor_(_invalidateCSR)(self);
 
   return self;
 }
@@ -345,6 +356,7 @@ void THSTensor_(transpose)(THSTensor *self, int d1, int d2) {
   self->size[d1] = self->size[d2];
   self->size[d2] = i;
   self->coalesced = 0;
+  THSTensor_(_invalidateCSR)(self);
   THLongTensor_free(indices);
 }
 
@@ -409,57 +421,84 @@ THSTensor *THSTensor_(newCoalesce)(THSTensor *self) {
   THTensor *values = THTensor_(newContiguous)(values_);
   long nDimI = THSTensor_(nDimensionI)(self);
   long nDimV = THSTensor_(nDimensionV)(self);
+  ptrdiff_t nnz = self->nnz;
+  long *indices_p = THLongTensor_data(indices);
+  long indicesStride0 = indices->stride[0];
+  long indicesStride1 = indices->stride[1];
+  long i, j;
+
+  // Linearize the indices into a single key per nonzero
+  long *keys = (long*)THAlloc(sizeof(long) * nnz);
+  long *perm = (long*)THAlloc(sizeof(long) * nnz);
+  long maxKey = 1;
+  for (long d = 0; d < nDimI; d++) {
+    maxKey *= self->size[d];
+  }
+  maxKey -= 1;
+#pragma omp parallel for private(j) if (nnz > THS_RADIX_GRAIN)
+  for (j = 0; j < nnz; j++) {
+    long key = 0;
+    for (long d = 0; d < nDimI; d++) {
+      key = key * self->size[d] + indices_p[d * indicesStride0 + j * indicesStride1];
+    }
+    keys[j] = key;
+    perm[j] = j;
+  }
+  // Tensors that are already ordered but not flagged only need the merge
+  int sorted = 1;
+  for (j = 1; j < nnz && sorted; j++) {
+    sorted = keys[j - 1] <= keys[j];
+  }
+  if (!sorted) {
+    long *keysBuf = (long*)THAlloc(sizeof(long) * nnz);
+    long *permBuf = (long*)THAlloc(sizeof(long) * nnz);
+    THSTensor_radixSort(keys, perm, keysBuf, permBuf, nnz, maxKey);
+    THFree(keysBuf);
+    THFree(permBuf);
+  }
 
-  THLongTensor *indicesScalar = THLongTensor_newWithSize1d(self->nnz);
-  THLongTensor *indicesSlice = THLongTensor_new();
-  THLongTensor *indicesBuffer = THLongTensor_newWithSize1d(self->nnz);
-  THLongTensor *indicesPermutation = THLongTensor_newWithSize1d(self->nnz);
-  THLongTensor_zero(indicesScalar);
-  long factor = 1;
-  for (long d = nDimI - 1; d >= 0; d--) {
-    THLongTensor_select(indicesSlice, indices, 0, d);
-    THLongTensor_cadd(indicesScalar, indicesScalar, factor, indicesSlice);
-    factor *= self->size[d];
+  // Find where each run of equal keys starts; the runs become the output
+  // nonzeros and can be merged independently of each other
+  long *segments = (long*)THAlloc(sizeof(long) * (nnz + 1));
+  long newNnz = 0;
+  for (j = 0; j < nnz; j++) {
+    if (j == 0 || keys[j] != keys[j - 1]) {
+      segments[newNnz++] = j;
+    }
   }
+  segments[newNnz] = nnz;
 
-  THLongTensor *newIndices = THLongTensor_new();
+  THLongTensor *newIndices = THLongTensor_newWithSize2d(nDimI, nnz);
   THTensor *newValues = THTensor_(new)();
-  THLongTensor_resizeAs(newIndices, indices);
   THTensor_(resizeAs)(newValues, values_);
-  // THSTensor_(_move)(self, newIndices, newValues);
   THSTensor *dst = THSTensor_(new)();
   THSTensor_(rawResize)(dst, nDimI, nDimV, self->size);
   THSTensor_(_move)(dst, newIndices, newValues);
 
-  THLongTensor_sort(indicesBuffer, indicesPermutation, indicesScalar, 0, 0);
-
-  long i = -1;
-  long prev = -1;
+  long *newIndices_p = THLongTensor_data(newIndices);
+  real *values_p = THTensor_(data)(values);
+  real *newValues_p = THTensor_(data)(newValues);
   long blockSize = values->stride[0];
-  for (long j = 0; j < self->nnz; j++) {
-    long pos = THTensor_fastGet1d(indicesPermutation, j);
-    long curr = THTensor_fastGet1d(indicesBuffer, j);
-    if (curr == prev) {
-      THBlas_(axpy)(blockSize, 1,
-        THTensor_(data)(values) + pos * blockSize, 1,
-        THTensor_(data)(newValues) + i * blockSize, 1);
-    } else {
-      ++i;
-      for (long d = 0; d < nDimI; d++) {
-        THTensor_fastSet2d(newIndices, d, i, THTensor_fastGet2d(indices, d, pos));
+#pragma omp parallel for private(i, j) if (newNnz * blockSize > THS_RADIX_GRAIN)
+  for (i = 0; i < newNnz; i++) {
+    long pos = perm[segments[i]];
+    real *dstBlock = newValues_p + i * blockSize;
+    for (long d = 0; d < nDimI; d++) {
+      newIndices_p[d * nnz + i] = indices_p[d * indicesStride0 + pos * indicesStride1];
+    }
+    memcpy(dstBlock, values_p + pos * blockSize, sizeof(real) * blockSize);
+    for (j = segments[i] + 1; j < segments[i + 1]; j++) {
+      real *srcBlock = values_p + perm[j] * blockSize;
+      for (long k = 0; k < blockSize; k++) {
+        dstBlock[k] += srcBlock[k];
       }
-      THBlas_(copy)(blockSize,
-        THTensor_(data)(values) + pos * blockSize, 1,
-        THTensor_(data)(newValues) + i * blockSize, 1);
     }
-    prev = curr;
   }
-  dst->nnz = i + 1;
+  dst->nnz = newNnz;
   dst->coalesced = 1;
-  THLongTensor_free(indicesScalar);
-  THLongTensor_free(indicesBuffer);
-  THLongTensor_free(indicesPermutation);
-  THLongTensor_free(indicesSlice);
+  THFree(keys);
+  THFree(perm);
+  THFree(segments);
   THLongTensor_free(indices);
   THTensor_(free)(values_);
   THTensor_(free)(values);
@@ -467,6 +506,44 @@ THSTensor *THSTensor_(newCoalesce)(THSTensor *self) {
   return dst;
 }
 
+THLongTensor *THSTensor_(toCSR)(long const *indices, long dim, long nnz) {
+  long h, i, hp0, hp1;
+  THLongTensor *csr = THLongTensor_newWithSize1d(dim + 1);
+  THLongTensor_zero(csr);
+
+  // Convert the sparse matrix to CSR format
+#pragma omp parallel for private(i, h, hp0, hp1) schedule(static) if (nnz > 10000)
+  for (i=0; i<nnz; i++) {
+    hp0 = indices[i];
+    hp1 = (i+1 == nnz) ?  dim : indices[i+1];
+    if (hp0 != hp1) for (h = hp0; h < hp1; h++) {
+      THTensor_fastSet1d(csr, h+1, i+1);
+    }
+  }
+  return csr;
+}
+
+THLongTensor *THSTensor_(newCSR)(THSTensor *self) {
+  THArgCheck(self->nDimensionI == 2, 1,
+      "CSR layout expects 2 sparse dimensions, got %d", self->nDimensionI);
+  THArgCheck(self->coalesced || self->nnz < 2, 1,
+      "CSR layout can only be built for a coalesced tensor");
+  ptrdiff_t volatile *cached = (ptrdiff_t volatile *)&self->csr;
+  THLongTensor *csr = (THLongTensor *)THAtomicGetPtrdiff(cached);
+  if (!csr) {
+    // threads reading the same tensor may race to build it; the first one wins
+    THLongTensor *indices = THSTensor_(newIndices)(self);
+    csr = THSTensor_(toCSR)(THLongTensor_data(indices), self->size[0], self->nnz);
+    THLongTensor_free(indices);
+    if (!THAtomicCompareAndSwapPtrdiff(cached, 0, (ptrdiff_t)csr)) {
+      THLongTensor_free(csr);
+      csr = (THLongTensor *)THAtomicGetPtrdiff(cached);
+    }
+  }
+  THLongTensor_retain(csr);
+  return csr;
+}
+
 void THTensor_(sparseMask)(THSTensor *r_, THTensor *t, THSTensor *mask) {
   THArgCheck(mask->coalesced, 2, "mask is uncoalesced");
   THSTensor_(resizeAs)(r_, mask);
@@ -520,6 +597,7 @@ void THSTensor_(free)(THSTensor *self)
   if(THAtomicDecrementRef(&self->refcount))
   {
     THFree(self->size);
+    THSTensor_(_invalidateCSR)(self);
     THLongTensor_free(self->indices);
     THTensor_(free)(self->values);
     THFree(self);
@@ -17,6 +17,12 @@ typedef struct THSTensor
     int coalesced;
     int refcount;
 
+    // Compressed row pointer (size[0] + 1 entries) of a coalesced tensor,
+    // built lazily by newCSR and dropped whenever indices or sizes change.
+    // NULL when no up to date copy is cached. Like `coalesced`, it isn't
+    // updated when the indices tensor is modified in place from outside.
+    THLongTensor *csr;
+
 } THSTensor;
 
 /**** access methods ****/
@@ -58,6 +64,7 @@ TH_API void THSTensor_(transpose)(THSTensor *self, int dimension1_, int dimensio
 TH_API int THSTensor_(isCoalesced)(const THSTensor *self);
 TH_API int THSTensor_(isSameSizeAs)(const THSTensor *self, const THSTensor *src);
 TH_API THSTensor *THSTensor_(newCoalesce)(THSTensor *self);
+TH_API THLongTensor *THSTensor_(newCSR)(THSTensor *self);
 
 TH_API void THTensor_(sparseMask)(THSTensor *r_, THTensor *t, THSTensor *mask);
 
@@ -75,5 +82,6 @@ TH_API void THSTensor_(select)(THSTensor *self, THSTensor *src, int dimension_,
 // internal methods
 THSTensor* THSTensor_(_move)(THSTensor *self, THLongTensor *indices, THTensor *values);
 THSTensor* THSTensor_(_set)(THSTensor *self, THLongTensor *indices, THTensor *values);
+void THSTensor_(_invalidateCSR)(THSTensor *self);
 
 #endif
@@ -13,6 +13,7 @@ void THSTensor_(zero)(THSTensor *self) {
     THTensor_(resizeNd)(self->values, 0, NULL, NULL);
   }
   self->nnz = 0;
+  THSTensor_(_invalidateCSR)(self);
 }
 
 void THSTensor_(mul)(THSTensor *r_, THSTensor *t, real value) {
@@ -33,6 +34,7 @@ void THSTensor_(mul)(THSTensor *r_, THSTensor *t, real value) {
     THTensor_(mul)(r_values_, t_values_, value);
     r_->nnz = t->nnz;
     r_->coalesced = t->coalesced;
+    THSTensor_(_invalidateCSR)(r_);
 
     THLongTensor_free(r_indices_);
     THTensor_(free)(r_values_);
@@ -63,6 +65,7 @@ void THSTensor_(pow)(THSTensor *r_, THSTensor *t_, real value) {
   THTensor_(pow)(r_values_, t_values_, value);
   r_->nnz = t->nnz;
   r_->coalesced = t->coalesced;
+  THSTensor_(_invalidateCSR)(r_);
 
   THLongTensor_free(r_indices_);
   THTensor_(free)(r_values_);
@@ -91,6 +94,7 @@ void THSTensor_(div)(THSTensor *r_, THSTensor *t, real value) {
     THTensor_(div)(r_values_, t_values_, value);
     r_->nnz = t->nnz;
     r_->coalesced = t->coalesced;
+    THSTensor_(_invalidateCSR)(r_);
 
     THLongTensor_free(r_indices_);
     THTensor_(free)(r_values_);
@@ -260,23 +264,6 @@ void THTensor_(spaddcmul)(THTensor *r_, THTensor *t, real value, THSTensor *src1
   THSTensor_(free)(intermediate);
 }
 
-THLongTensor *THSTensor_(toCSR)(long const *indices, long dim, long nnz) {
-  long h, i, hp0, hp1;
-  THLongTensor *csr = THLongTensor_newWithSize1d(dim + 1);
-  THLongTensor_zero(csr);
-
-  // Convert the sparse matrix to CSR format
-#pragma omp parallel for private(i, h, hp0, hp1) schedule(static) if (nnz > 10000)
-  for (i=0; i<nnz; i++) {
-    hp0 = indices[i];
-    hp1 = (i+1 == nnz) ?  dim : indices[i+1];
-    if (hp0 != hp1) for (h = hp0; h < hp1; h++) {
-      THTensor_fastSet1d(csr, h+1, i+1);
-    }
-  }
-  return csr;
-}
-
 void THSTensor_(spaddmm)(THTensor *r_,
     real beta, THTensor *t,
     real alpha, THSTensor *sparse_, THTensor *dense) {
@@ -312,7 +299,7 @@ void THSTensor_(spaddmm)(THTensor *r_,
   indices = THSTensor_(newIndices)(sparse);
   values  = THSTensor_(newValues)(sparse);
 
-  csr = THSTensor_(toCSR)(THLongTensor_data(indices), dim_i, nnz);
+  csr = THSTensor_(newCSR)(sparse);
 
   // r_ = alpha * sparse * dense
   if (beta == 0) {
@@ -324,21 +311,40 @@ void THSTensor_(spaddmm)(THTensor *r_,
   } else {
     THTensor_(mul)(r_, t, beta);
   }
+  long *csr_p = THLongTensor_data(csr);
+  long *col_p = THLongTensor_data(indices) + (nnz ? indices->stride[0] : 0);
+  long col_stride = nnz ? indices->stride[1] : 0;
+  real *values_p = THTensor_(data)(values);
+  long values_stride = nnz ? values->stride[0] : 0;
+  for (i = 0; i < nnz; i++) {
+    long col = col_p[i * col_stride];
+    if (col < 0 || col >= dim_j) {
+      THError("index out of bound. spmm: %d not between 1 and %d",
+          col, dim_j);
+    }
+  }
+
+  // Every output row only depends on its own nonzeros, so rows are split
+  // between threads; matrix-vector products skip the BLAS call per nonzero.
+  if (dim_k == 1) {
+    real *r_p = THTensor_(data)(r_);
+    real *dense_p = THTensor_(data)(dense);
 #pragma omp parallel for private(h, i) schedule(static) if (nnz > 10000)
-  for (h = 0; h < dim_i; h++) {
-    long i_start = THTensor_fastGet1d(csr, h);
-    long i_end = THTensor_fastGet1d(csr, h+1);
-    for (i = i_start; i < i_end; i++) {
-      real val = THTensor_fastGet1d(values, i);
-      long col = THTensor_fastGet2d(indices, 1, i);
-      if (col >= 0 && col < dim_j) {
+    for (h = 0; h < dim_i; h++) {
+      real sum = 0;
+      for (i = csr_p[h]; i < csr_p[h+1]; i++) {
+        sum += values_p[i * values_stride] * dense_p[col_p[i * col_stride] * dense->stride[0]];
+      }
+      r_p[h * r_->stride[0]] += alpha * sum;
+    }
+  } else {
+#pragma omp parallel for private(h, i) schedule(static) if (nnz * dim_k > 10000)
+    for (h = 0; h < dim_i; h++) {
+      for (i = csr_p[h]; i < csr_p[h+1]; i++) {
         THBlas_(axpy)(dim_k,
-            alpha * val,
-            ROW_PTR2(dense, col), dense->stride[1],
+            alpha * values_p[i * values_stride],
+            ROW_PTR2(dense, col_p[i * col_stride]), dense->stride[1],
             ROW_PTR2(r_, h), r_->stride[1]);
-      } else {
-        THError("index out of bound. spmm: %d not between 1 and %d",
-            col, dim_j);
       }
     }
   }
@@ -385,7 +391,7 @@ void THSTensor_(sspaddmm)(THSTensor *r_,
   indices = THSTensor_(newIndices)(sparse);
   values  = THSTensor_(newValues)(sparse);
 
-  csr = THSTensor_(toCSR)(THLongTensor_data(indices), dim_i, nnz);
+  csr = THSTensor_(newCSR)(sparse);
 
   t_nnz = THSTensor_(nnz)(t);
   r_nnz = nnz * dim_k + t_nnz;
@@ -436,9 +442,8 @@ void THSTensor_(sspaddmm)(THSTensor *r_,
 
 
   // to avoid a clone
-  r_->indices = newi;
-  r_-> values = newv;
-  r_->    nnz = p;
+  THSTensor_(_move)(r_, newi, newv);
+  r_->nnz = p;
 
   THLongTensor_free(csr);
   THLongTensor_free(indices);
@@ -466,29 +471,37 @@ void THSTensor_(hspmm)(THSTensor *r_, real alpha, THSTensor *sparse_, THTensor *
   THSTensor *sparse = THSTensor_(newCoalesce)(sparse_);
 
   long nnz = THSTensor_(nnz)(sparse);
-  THLongTensor *indices = THLongTensor_newWithSize2d(1, nnz);
+  THLongTensor *csr = THSTensor_(newCSR)(sparse);
+  long *csr_p = THLongTensor_data(csr);
+
+  // The output has a row for every nonempty row of sparse
+  long outNnz = 0;
+  for (long h = 0; h < m; h++) {
+    if (csr_p[h+1] > csr_p[h]) outNnz++;
+  }
+  THLongTensor *indices = THLongTensor_newWithSize2d(1, outNnz);
 
   // Initialize the sparse matrix that will be used with spaddmm to send rows
-  // from the dense matrix to rows of the output's value tensor
+  // from the dense matrix to rows of the output's value tensor. Its row
+  // pointer is the one of sparse without the empty rows, so it is cached
+  // right away instead of being rebuilt from the indices.
   THSTensor *newSparse = THSTensor_(newClone)(sparse);
   THLongTensor *spIndices = THSTensor_(newIndices)(newSparse);
-  THLongTensor *valueIndices = THLongTensor_new();
-  THLongTensor_select(valueIndices, spIndices, 0, 0);
-
-  // Compute output indices
-  long i = -1, prevIdx = -1;
-  for (long j = 0; j < nnz; j++) {
-    long currIdx = THTensor_fastGet1d(valueIndices, j);
-    if (currIdx != prevIdx) {
-      THTensor_fastSet2d(indices, 0, ++i, currIdx);
-      prevIdx = currIdx;
+  THLongTensor *newCSR = THLongTensor_newWithSize1d(outNnz + 1);
+  long i = 0;
+  for (long h = 0; h < m; h++) {
+    if (csr_p[h+1] == csr_p[h]) continue;
+    THTensor_fastSet2d(indices, 0, i, h);
+    THTensor_fastSet1d(newCSR, i, csr_p[h]);
+    for (long j = csr_p[h]; j < csr_p[h+1]; j++) {
+      THTensor_fastSet2d(spIndices, 0, j, i);
     }
-    THTensor_fastSet1d(valueIndices, j, i);
+    i++;
   }
-  long outNnz = i + 1;
-  THLongTensor_resize2d(indices, 1, outNnz);
+  THTensor_fastSet1d(newCSR, outNnz, nnz);
   THTensor *values = THTensor_(newWithSize2d)(outNnz, n);
   newSparse->size[0] = outNnz;
+  newSparse->csr = newCSR;
 
   // Compute output values tensor with sparse * dense multiplication
   THSTensor_(spaddmm)(values, 0, values, alpha, newSparse, dense);
@@ -496,7 +509,7 @@ void THSTensor_(hspmm)(THSTensor *r_, real alpha, THSTensor *sparse_, THTensor *
 
   THSTensor_(free)(newSparse);
   THLongTensor_free(spIndices);
-  THLongTensor_free(valueIndices);
+  THLongTensor_free(csr);
   THSTensor_(free)(sparse);
 }
 
@@ -1,3 +1,4 @@
 from . import rnn
 from .clip_grad import clip_grad_norm
 from .weight_norm import weight_norm, remove_weight_norm
+from .fusion import fuse_conv_bn_eval
@@ -0,0 +1,77 @@
+import copy
+
+from torch.nn.parameter import Parameter
+
+
+def fuse_conv_bn_weights(conv_w, conv_b, bn_rm, bn_rv, bn_eps, bn_w=None, bn_b=None):
+    """Folds batch normalization statistics and affine parameters into the
+    weight and bias of the preceding convolution.
+
+    Arguments:
+        conv_w (Tensor): convolution weight, ``out_channels`` first
+        conv_b (Tensor or None): convolution bias
+        bn_rm (Tensor): batch norm running mean
+        bn_rv (Tensor): batch norm running variance
+        bn_eps (float): batch norm epsilon
+        bn_w (Tensor, optional): batch norm weight
+        bn_b (Tensor, optional): batch norm bias
+
+    Returns:
+        A ``(weight, bias)`` tuple of new tensors.
+    """
+    scale = (bn_rv + bn_eps).rsqrt()
+    if bn_w is not None:
+        scale = scale * bn_w
+    if conv_b is None:
+        conv_b = bn_rm.new(bn_rm.size()).zero_()
+
+    shape = (conv_w.size(0),) + (1,) * (conv_w.dim() - 1)
+    fused_w = conv_w * scale.view(*shape)
+    fused_b = (conv_b - bn_rm) * scale
+    if bn_b is not None:
+        fused_b = fused_b + bn_b
+    return fused_w, fused_b
+
+
+def fuse_conv_bn_eval(conv, bn):
+    """Returns a copy of ``conv`` that computes ``bn(conv(x))`` for a batch
+    norm layer in evaluation mode.
+
+    The running statistics and affine parameters of ``bn`` are folded into the
+    convolution weight and bias, so the normalization costs nothing at
+    inference time. Both modules must be in evaluation mode, since the fused
+    convolution cannot update running statistics.
+
+    Arguments:
+        conv (nn.Conv1d, nn.Conv2d or nn.Conv3d): convolution feeding ``bn``
+        bn (nn.BatchNorm1d, nn.BatchNorm2d or nn.BatchNorm3d): batch norm layer
+
+    Returns:
+        A new convolution module; ``conv`` and ``bn`` are left untouched
+
+    Example::
+
+        >>> conv, bn = nn.Conv2d(3, 16, 3).eval(), nn.BatchNorm2d(16).eval()
+        >>> fused = fuse_conv_bn_eval(conv, bn)
+    """
+    if conv.training or bn.training:
+        raise ValueError("fuse_conv_bn_eval expects both modules to be in "
+                         "evaluation mode")
+    if conv.transposed:
+        raise ValueError("fuse_conv_bn_eval does not support transposed "
+                         "convolutions")
+    if conv.out_channels != bn.num_features:
+        raise ValueError("convolution has {} output channels, but batch norm "
+                         "expects {} features".format(conv.out_channels,
+                                                      bn.num_features))
+
+    fused_conv = copy.deepcopy(conv)
+    fused_w, fused_b = fuse_conv_bn_weights(
+        conv.weight.data,
+        conv.bias.data if conv.bias is not None else None,
+        bn.running_mean, bn.running_var, bn.eps,
+        bn.weight.data if bn.affine else None,
+        bn.bias.data if bn.affine else None)
+    fused_conv.weight = Parameter(fused_w)
+    fused_conv.bias = Parameter(fused_b)
+    return fused_conv
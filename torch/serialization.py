@@ -1,5 +1,7 @@
 import difflib
 import inspect
+import io
+import mmap
 import os
 import shutil
 import struct
@@ -23,7 +25,14 @@ SHORT_SIZE = struct.Struct('=h').size
 
 MAGIC_NUMBER = 0x1950a86a20f9469cfc6c
 PROTOCOL_VERSION = 1001
+# storages are written before the object and their data is page aligned
+PAGE_ALIGNED_PROTOCOL_VERSION = 1002
+# storages are written after the object in checksummed (compressed) chunks
+CHUNKED_PROTOCOL_VERSION = 1003
 STORAGE_KEY_SEPARATOR = ','
+STORAGE_ALIGNMENT = mmap.ALLOCATIONGRANULARITY
+STORAGE_HEADER_SIZE = 8  # every storage starts with its size (int64)
+CHUNK_SIZE = 16 * 1024 * 1024
 
 
 class SourceChangeWarning(Warning):
@@ -116,7 +125,19 @@ def _with_file_like(f, mode, body):
             f.close()
 
 
-def save(obj, f, pickle_module=pickle, pickle_protocol=DEFAULT_PROTOCOL):
+def _storage_record_offset(offset, alignment):
+    """
+    Returns the first position at or after offset where a storage can be
+    written, so that its data (following the size) starts at a multiple of
+    alignment.
+    """
+    data_offset = offset + STORAGE_HEADER_SIZE
+    data_offset = (data_offset + alignment - 1) // alignment * alignment
+    return data_offset - STORAGE_HEADER_SIZE
+
+
+def save(obj, f, pickle_module=pickle, pickle_protocol=DEFAULT_PROTOCOL,
+         page_aligned=False, chunked=False, compress=False, num_threads=None):
     """Saves an object to a disk file.
 
     See also: :ref:`recommend-saving-models`
@@ -127,11 +148,28 @@ def save(obj, f, pickle_module=pickle, pickle_protocol=DEFAULT_PROTOCOL):
             or a string containing a file name
         pickle_module: module used for pickling metadata and objects
         pickle_protocol: can be specified to override the default protocol
+        page_aligned: if True, the data of every storage will start at a page
+            boundary of the file, so it can be loaded with
+            ``torch.load(f, mmap=True)``. Such files can't be loaded by
+            older versions of PyTorch.
+        chunked: if True, storages are split into chunks that are written by
+            several threads at once. Every chunk has a CRC32 checksum, which
+            is verified when the file is loaded. Such files can't be loaded by
+            older versions of PyTorch.
+        compress: if True, chunks are compressed with zlib at its fastest
+            level. Implies ``chunked``.
+        num_threads: number of threads writing chunks (default:
+            :func:`torch.get_num_threads`)
     """
-    return _with_file_like(f, "wb", lambda f: _save(obj, f, pickle_module, pickle_protocol))
+    if page_aligned and (chunked or compress):
+        raise ValueError("page aligned files can't be chunked or compressed")
+    return _with_file_like(f, "wb", lambda f: _save(obj, f, pickle_module, pickle_protocol,
+                                                    page_aligned, chunked or compress,
+                                                    compress, num_threads))
 
 
-def _save(obj, f, pickle_module, pickle_protocol):
+def _save(obj, f, pickle_module, pickle_protocol, page_aligned, chunked, compress,
+          num_threads):
     import torch.nn as nn
     serialized_container_types = {}
     serialized_storages = {}
@@ -186,9 +224,27 @@ def _save(obj, f, pickle_module, pickle_protocol):
         ),
     )
 
+    if page_aligned:
+        sys_info['storage_alignment'] = STORAGE_ALIGNMENT
+        protocol_version = PAGE_ALIGNED_PROTOCOL_VERSION
+    elif chunked:
+        sys_info['chunk_size'] = CHUNK_SIZE
+        protocol_version = CHUNKED_PROTOCOL_VERSION
+    else:
+        protocol_version = PROTOCOL_VERSION
+
     pickle_module.dump(MAGIC_NUMBER, f, protocol=pickle_protocol)
-    pickle_module.dump(PROTOCOL_VERSION, f, protocol=pickle_protocol)
+    pickle_module.dump(protocol_version, f, protocol=pickle_protocol)
     pickle_module.dump(sys_info, f, protocol=pickle_protocol)
+    if page_aligned or chunked:
+        storages = _save_storage_index(obj, f, pickle_module, pickle_protocol,
+                                       persistent_id, serialized_storages)
+        if page_aligned:
+            _write_page_aligned(f, storages)
+        else:
+            _write_chunked(f, storages, pickle_module, pickle_protocol, compress,
+                           num_threads)
+        return
     pickler = pickle_module.Pickler(f, protocol=pickle_protocol)
     pickler.persistent_id = persistent_id
     pickler.dump(obj)
@@ -200,7 +256,59 @@ def _save(obj, f, pickle_module, pickle_protocol):
         serialized_storages[key]._write_file(f)
 
 
-def load(f, map_location=None, pickle_module=pickle):
+def _save_storage_index(obj, f, pickle_module, pickle_protocol, persistent_id,
+                        serialized_storages):
+    """
+    Writes the list of storages followed by the pickled object and returns
+    the storages in the order in which they have to be written.
+    """
+    # The loader has to create storages before it unpickles the object, so
+    # they're listed first. The object is pickled to memory to find them.
+    pickled_obj = io.BytesIO()
+    pickler = pickle_module.Pickler(pickled_obj, protocol=pickle_protocol)
+    pickler.persistent_id = persistent_id
+    pickler.dump(obj)
+
+    serialized_storage_keys = sorted(serialized_storages.keys())
+    storage_index = [(key,
+                      normalize_storage_type(type(serialized_storages[key])),
+                      serialized_storages[key].size())
+                     for key in serialized_storage_keys]
+    pickle_module.dump((pickled_obj.tell(), storage_index), f, protocol=pickle_protocol)
+    f.write(pickled_obj.getvalue())
+    return [serialized_storages[key] for key in serialized_storage_keys]
+
+
+def _write_page_aligned(f, storages):
+    for storage in storages:
+        f.flush()
+        offset = f.tell()
+        f.write(b'\0' * (_storage_record_offset(offset, STORAGE_ALIGNMENT) - offset))
+        f.flush()
+        storage._write_file(f)
+
+
+def _storage_chunk_spans(storages):
+    return [(storage.data_ptr(), storage.size() * storage.element_size(),
+             storage.element_size()) for storage in storages]
+
+
+def _write_chunked(f, storages, pickle_module, pickle_protocol, compress, num_threads):
+    # Chunks are written at arbitrary positions, so their list follows them
+    # and the file ends with its offset.
+    if num_threads is None:
+        num_threads = torch.get_num_threads()
+    storages = [storage.cpu() if storage.is_cuda else storage for storage in storages]
+    f.flush()
+    end, chunks = torch._C._write_storage_chunks(
+        f.fileno(), _storage_chunk_spans(storages), f.tell(), CHUNK_SIZE,
+        compress, num_threads)
+    f.seek(end)
+    pickle_module.dump(chunks, f, protocol=pickle_protocol)
+    f.write(struct.pack('<q', end))
+
+
+def load(f, map_location=None, pickle_module=pickle, mmap=False):
     """Loads an object saved with :func:`torch.save` from a file.
 
     torch.load can dynamically remap storages to be loaded on a different device
@@ -223,6 +331,12 @@ def load(f, map_location=None, pickle_module=pickle):
             locations
         pickle_module: module used for unpickling metadata and objects (has to
             match the pickle_module used to serialize file)
+        mmap: if True, storages of files saved with ``page_aligned=True`` are
+            mapped into memory instead of being read. Loading is then almost
+            instant, data is read only when it's accessed, and processes that
+            load the same file share it through the page cache. Mappings are
+            copy-on-write, so modifying the storages doesn't change the file.
+            Other files are read as usual.
 
     Example:
         >>> torch.load('tensors.pt')
@@ -230,19 +344,21 @@ def load(f, map_location=None, pickle_module=pickle):
         >>> torch.load('tensors.pt', map_location=lambda storage, loc: storage)
         # Map tensors from GPU 1 to GPU 0
         >>> torch.load('tensors.pt', map_location={'cuda:1':'cuda:0'})
+        # Map storages of a file saved with page_aligned=True into memory
+        >>> torch.load('tensors.pt', mmap=True)
     """
     new_fd = False
     if isinstance(f, str) or (sys.version_info[0] == 2 and isinstance(f, unicode)):
         new_fd = True
         f = open(f, 'rb')
     try:
-        return _load(f, map_location, pickle_module)
+        return _load(f, map_location, pickle_module, mmap)
     finally:
         if new_fd:
             f.close()
 
 
-def _load(f, map_location, pickle_module):
+def _load(f, map_location, pickle_module, use_mmap):
     deserialized_objects = {}
 
     if map_location is None:
@@ -340,6 +456,8 @@ def _load(f, map_location, pickle_module):
             return result
 
     deserialized_objects = {}
+    # storages read before the object, they still have to be restored
+    loaded_storages = {}
 
     def persistent_load(saved_id):
         assert isinstance(saved_id, tuple)
@@ -354,8 +472,11 @@ def _load(f, map_location, pickle_module):
         elif typename == 'storage':
             data_type, root_key, location, size, view_metadata = data
             if root_key not in deserialized_objects:
-                deserialized_objects[root_key] = restore_location(
-                    data_type(size), location)
+                if root_key in loaded_storages:
+                    obj = loaded_storages.pop(root_key)
+                else:
+                    obj = data_type(size)
+                deserialized_objects[root_key] = restore_location(obj, location)
             storage = deserialized_objects[root_key]
             if view_metadata is not None:
                 view_key, offset, view_size = view_metadata
@@ -378,10 +499,26 @@ def _load(f, map_location, pickle_module):
     if magic_number != MAGIC_NUMBER:
         raise RuntimeError("Invalid magic number; corrupt file?")
     protocol_version = pickle_module.load(f)
-    if protocol_version != PROTOCOL_VERSION:
+    if protocol_version not in (PROTOCOL_VERSION, PAGE_ALIGNED_PROTOCOL_VERSION,
+                                CHUNKED_PROTOCOL_VERSION):
         raise RuntimeError("Invalid protocol version: %s" % protocol_version)
 
-    _sys_info = pickle_module.load(f)
+    sys_info = pickle_module.load(f)
+    if protocol_version in (PAGE_ALIGNED_PROTOCOL_VERSION, CHUNKED_PROTOCOL_VERSION):
+        pickled_obj_size, storage_index = pickle_module.load(f)
+        # storages are accessed through the file descriptor, so the object
+        # is read before the file position changes
+        pickled_obj = io.BytesIO(f.read(pickled_obj_size))
+        if protocol_version == PAGE_ALIGNED_PROTOCOL_VERSION:
+            storages = _read_page_aligned(f, sys_info, storage_index, use_mmap)
+        else:
+            storages = _read_chunked(f, sys_info, storage_index, pickle_module)
+        loaded_storages.update(zip([key for key, _, _ in storage_index], storages))
+
+        unpickler = pickle_module.Unpickler(pickled_obj)
+        unpickler.persistent_load = persistent_load
+        return unpickler.load()
+
     unpickler = pickle_module.Unpickler(f)
     unpickler.persistent_load = persistent_load
     result = unpickler.load()
@@ -395,3 +532,37 @@ def _load(f, map_location, pickle_module):
         offset = None
 
     return result
+
+
+def _read_page_aligned(f, sys_info, storage_index, use_mmap):
+    alignment = sys_info['storage_alignment']
+    # data in the file is little endian
+    use_mmap = (use_mmap and sys.byteorder == 'little' and
+                alignment % mmap.ALLOCATIONGRANULARITY == 0)
+    storages = []
+    offset = f.tell()
+    for _, storage_type, size in storage_index:
+        offset = _storage_record_offset(offset, alignment)
+        # storages are read on the CPU, restore_location moves them later
+        storage_type = normalize_storage_type(storage_type)
+        if use_mmap:
+            storage = storage_type._new_with_mapped_file(f, offset)
+        else:
+            storage = storage_type(size)
+            storage._set_from_file(f, offset)
+        storages.append(storage)
+        offset += STORAGE_HEADER_SIZE + size * storage.element_size()
+    return storages
+
+
+def _read_chunked(f, sys_info, storage_index, pickle_module):
+    f.seek(-8, os.SEEK_END)
+    chunk_list_offset, = struct.unpack('<q', f.read(8))
+    f.seek(chunk_list_offset)
+    chunks = pickle_module.load(f)
+    # chunks are read into CPU storages, restore_location moves them later
+    storages = [normalize_storage_type(storage_type)(size)
+                for _, storage_type, size in storage_index]
+    torch._C._read_storage_chunks(f.fileno(), _storage_chunk_spans(storages),
+                                  sys_info['chunk_size'], chunks, torch.get_num_threads())
+    return storages